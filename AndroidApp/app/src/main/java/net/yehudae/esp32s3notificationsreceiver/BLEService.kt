@@ -28,6 +28,11 @@ class BLEService : Service() {
     // ESP32 Service and Characteristic UUIDs
     private val SERVICE_UUID = UUID.fromString("12345678-1234-1234-1234-123456789abc")
     private val CHARACTERISTIC_UUID = UUID.fromString("87654321-4321-4321-4321-cba987654321")
+    private val ACTION_CHARACTERISTIC_UUID = UUID.fromString("87654322-4321-4321-4321-cba987654321")
+    private val CCC_DESCRIPTOR_UUID = UUID.fromString("00002902-0000-1000-8000-00805f9b34fb")
+    // MCUmgr SMP service, firmware updates
+    private val SMP_SERVICE_UUID = UUID.fromString("8D53DC1D-1DB7-4CD3-868B-8A527460AA84")
+    private val SMP_CHARACTERISTIC_UUID = UUID.fromString("DA2E7828-FBCE-4E01-AE9E-261174997C48")
     
     private val _connectionStatus = MutableStateFlow("Disconnected")
     val connectionStatus: StateFlow<String> = _connectionStatus
@@ -47,6 +52,9 @@ class BLEService : Service() {
     private val _syncStatus = MutableStateFlow<SyncStatus?>(null)
     val syncStatus: StateFlow<SyncStatus?> = _syncStatus
 
+    private val _firmwareUpdateStatus = MutableStateFlow<FirmwareUpdateStatus?>(null)
+    val firmwareUpdateStatus: StateFlow<FirmwareUpdateStatus?> = _firmwareUpdateStatus
+
     private val notificationQueue = mutableListOf<NotificationData>()
     private var lastConnectionTime: Long = 0
     private var totalNotificationsSent: Int = 0
@@ -56,10 +64,48 @@ class BLEService : Service() {
     private val CMD_REMOVE_NOTIFICATION: Byte = 0x02
     private val CMD_CLEAR_ALL: Byte = 0x03
     private val CMD_ACTION: Byte = 0x04
+    private val CMD_SET_RULES: Byte = 0x05
+    private val CMD_SET_TIME: Byte = 0x06
+    private val CMD_SET_DND: Byte = 0x07
+    private val CMD_ACTION_ACK: Byte = 0x08
+    private val CMD_SET_ICON: Byte = 0x09
+    private val CMD_SEARCH: Byte = 0x0A
+
+    // Set in the type byte of urgent notifications (PROTOCOL_TYPE_PRIORITY)
+    private val TYPE_PRIORITY = 0x80
+    // Set when the notification key follows the header (PROTOCOL_TYPE_HAS_KEY)
+    private val TYPE_HAS_KEY = 0x40
+    // Set when the app icon id follows the key (PROTOCOL_TYPE_HAS_ICON)
+    private val TYPE_HAS_ICON = 0x20
+    private val NOTIFICATION_HEADER_SIZE = 13
+    private val ACTION_HEADER_SIZE = 7
+    private val ACTION_REQUEST_ICON = 0x10
+    private val ICON_HEADER_SIZE = 5
+    private val RULES_HEADER_SIZE = 6
+
+    // Only one GATT write may be outstanding, the rest wait here
+    private val writeQueue = ArrayDeque<ByteArray>()
+    private val urgentWriteQueue = ArrayDeque<ByteArray>()
+    // Firmware update writes, only sent when no notification packet waits
+    private val bulkWriteQueue = ArrayDeque<() -> Boolean>()
+    private var writeInProgress = false
+
+    // Kept across disconnects so the upload resumes on the next link
+    private var firmwareUpdater: FirmwareUpdater? = null
+    private var smpCharacteristic: BluetoothGattCharacteristic? = null
+
+    // Encoded app icons by package, and which icon ids the watch has stored
+    private val iconsByPackage = HashMap<String, IconEncoder.EncodedIcon?>()
+    private val iconsById = HashMap<Int, IconEncoder.EncodedIcon>()
+    private val watchIcons by lazy { getSharedPreferences("watch_icons", Context.MODE_PRIVATE) }
+
+    // Re-sends the filter rules when the settings they are compiled from change
+    private var rulesListener: android.content.SharedPreferences.OnSharedPreferenceChangeListener? = null
 
     companion object {
         private const val TAG = "BLEService"
         private const val MAX_PACKET_SIZE = 240 // Safe packet size for most devices
+        private const val MAX_DELTA_RATIO = 0.7 // Full image above this, the rebuild costs time too
     }
 
     inner class LocalBinder : Binder() {
@@ -78,6 +124,11 @@ class BLEService : Service() {
             bluetoothLeScanner = bluetoothAdapter?.bluetoothLeScanner
             
             NotificationWorker.startPeriodicSync(this)
+
+            rulesListener = NotificationSettings(this).registerRulesListener {
+                sendRules()
+                sendQuietHours()
+            }
             
             Log.d(TAG, "BLE Service created with background worker support")
         } catch (e: Exception) {
@@ -99,6 +150,12 @@ class BLEService : Service() {
                 "READ_EXISTING_NOTIFICATIONS" -> {
                     readExistingNotifications()
                 }
+                "ACTION_PERFORMED" -> {
+                    val seq = intent.getIntExtra("seq", 0)
+                    val status = intent.getIntExtra("status", 0)
+                    // Acks go ahead of other writes, they close the tap latency
+                    writePacket(byteArrayOf(CMD_ACTION_ACK, seq.toByte(), status.toByte()), urgent = true)
+                }
                 "SYNC_COMPLETED" -> {
                     val processedCount = intent.getIntExtra("processed_count", 0)
                     val sentCount = intent.getIntExtra("sent_count", 0)
@@ -267,9 +324,12 @@ class BLEService : Service() {
             }
             
             bluetoothGatt?.disconnect()
+            bluetoothGatt?.close()
             
             _connectionStatus.value = "Connecting..."
-            bluetoothGatt = device.connectGatt(this, false, gattCallback)
+            // Direct connection over LE catches the watch's directed advertising
+            // within milliseconds; autoConnect would scan at a low duty cycle
+            bluetoothGatt = device.connectGatt(this, false, gattCallback, android.bluetooth.BluetoothDevice.TRANSPORT_LE)
             connectedDevice = device
             
             _connectedDeviceInfo.value = ConnectedDeviceInfo(
@@ -302,6 +362,9 @@ class BLEService : Service() {
                         }
                         
                         if (hasBluetoothPermissions()) {
+                            // Short connection interval while setting up, every
+                            // request below is a round trip
+                            gatt.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_HIGH)
                             // Request larger MTU for better performance
                             gatt.requestMtu(517) // Max MTU size
                         }
@@ -309,12 +372,33 @@ class BLEService : Service() {
                         processNotificationQueue()
                     }
                     BluetoothProfile.STATE_DISCONNECTED -> {
+                        val linkLost = _connectionStatus.value == "Connected" ||
+                            _connectionStatus.value == "Ready"
                         _connectionStatus.value = "Disconnected"
                         _connectedDeviceInfo.value = _connectedDeviceInfo.value?.copy(
                             status = "Disconnected"
                         )
                         notificationCharacteristic = null
+                        smpCharacteristic = null
                         currentMtu = 23 // Reset to default
+                        synchronized(writeQueue) {
+                            writeQueue.clear()
+                            urgentWriteQueue.clear()
+                            bulkWriteQueue.clear()
+                        }
+                        writeInProgress = false
+
+                        // Link loss, not a manual disconnect: reconnect right away
+                        // while the watch advertises directly to this phone. The
+                        // bond keeps keys and the GATT cache, so the reconnect
+                        // needs no pairing and no service discovery traffic.
+                        // Failed attempts are left to the sync check.
+                        connectedDevice?.let { device ->
+                            if (linkLost) {
+                                Log.d(TAG, "Link lost (status $status), reconnecting")
+                                android.os.Handler(mainLooper).post { connectToDevice(device) }
+                            }
+                        }
                     }
                     BluetoothProfile.STATE_CONNECTING -> {
                         _connectionStatus.value = "Connecting..."
@@ -369,7 +453,17 @@ class BLEService : Service() {
                                 status = "Ready"
                             )
                             Log.d(TAG, "Notification characteristic found and ready! MTU: $currentMtu")
+                            enableWatchActions(gatt, service)
+                            // Queued notifications first: the watch keeps its
+                            // time, rules and quiet hours across a link loss
                             processNotificationQueue()
+                            sendTime()
+                            sendRules()
+                            sendQuietHours()
+                            if (hasBluetoothPermissions()) {
+                                gatt.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_BALANCED)
+                            }
+                            enableFirmwareUpdate(gatt)
                         } else {
                             Log.e(TAG, "Notification characteristic not found!")
                             _connectionStatus.value = "Characteristic not found"
@@ -396,20 +490,58 @@ class BLEService : Service() {
             }
         }
 
+        override fun onDescriptorWrite(
+            gatt: BluetoothGatt,
+            descriptor: BluetoothGattDescriptor,
+            status: Int
+        ) {
+            if (status != BluetoothGatt.GATT_SUCCESS) {
+                Log.e(TAG, "Failed to subscribe to ${descriptor.characteristic.uuid}: $status")
+            }
+            writeInProgress = false
+            writeNextPacket()
+        }
+
+        @Deprecated("Used below API 33, forwards to the byte array variant")
+        override fun onCharacteristicChanged(
+            gatt: BluetoothGatt,
+            characteristic: BluetoothGattCharacteristic
+        ) {
+            onCharacteristicChanged(gatt, characteristic, characteristic.value ?: return)
+        }
+
+        override fun onCharacteristicChanged(
+            gatt: BluetoothGatt,
+            characteristic: BluetoothGattCharacteristic,
+            value: ByteArray
+        ) {
+            when (characteristic.uuid) {
+                ACTION_CHARACTERISTIC_UUID -> handleWatchAction(value)
+                SMP_CHARACTERISTIC_UUID -> android.os.Handler(mainLooper).post {
+                    firmwareUpdater?.onNotification(value)
+                }
+            }
+        }
+
         override fun onCharacteristicWrite(
             gatt: BluetoothGatt,
             characteristic: BluetoothGattCharacteristic,
             status: Int
         ) {
+            val command = characteristic.value?.firstOrNull()
             if (status == BluetoothGatt.GATT_SUCCESS) {
-                totalNotificationsSent++
-                _connectedDeviceInfo.value = _connectedDeviceInfo.value?.copy(
-                    notificationsSent = totalNotificationsSent
-                )
-                Log.d(TAG, "Notification sent successfully. Total sent: $totalNotificationsSent")
+                if (command == CMD_ADD_NOTIFICATION) {
+                    totalNotificationsSent++
+                    _connectedDeviceInfo.value = _connectedDeviceInfo.value?.copy(
+                        notificationsSent = totalNotificationsSent
+                    )
+                    Log.d(TAG, "Notification sent successfully. Total sent: $totalNotificationsSent")
+                }
             } else {
-                Log.e(TAG, "Failed to send notification: $status")
+                Log.e(TAG, "Failed to send packet (cmd $command): $status")
             }
+            writeInProgress = false
+            writeNextPacket()
         }
     }
 
@@ -424,11 +556,15 @@ class BLEService : Service() {
                 val maxDataSize = currentMtu - 3 - 5 // MTU minus ATT overhead minus our header
                 val truncatedData = truncateNotificationData(notificationData, maxDataSize)
                 
-                val packet = createNotificationPacket(truncatedData)
+                val icon = iconFor(notificationData.packageName)
+                if (icon != null && !watchHasIcon(icon.id)) {
+                    // Ahead of the notification so the watch never has to ask
+                    sendIcon(icon, urgent = notificationData.isPriority)
+                }
+                val packet = createNotificationPacket(truncatedData, icon?.id ?: 0)
                 
                 if (packet.size <= maxDataSize) {
-                    notificationCharacteristic?.value = packet
-                    bluetoothGatt?.writeCharacteristic(notificationCharacteristic)
+                    writePacket(packet, urgent = notificationData.isPriority)
                     
                     if (!isExisting) {
                         val currentList = _notifications.value.toMutableList()
@@ -474,12 +610,12 @@ class BLEService : Service() {
         
         var appLen = minOf(appNameBytes.size, 20) // Max 20 chars for app name
         var titleLen = minOf(titleBytes.size, 40) // Max 40 chars for title
-        var textLen = minOf(textBytes.size, maxSize - 5 - appLen - titleLen) // Remaining for text
+        var textLen = minOf(textBytes.size, maxSize - NOTIFICATION_HEADER_SIZE - appLen - titleLen) // Remaining for text
         
         // Ensure we don't go negative
         if (textLen < 0) {
-            titleLen = minOf(titleLen, maxSize - 5 - appLen - 10) // Leave at least 10 for text
-            textLen = maxSize - 5 - appLen - titleLen
+            titleLen = minOf(titleLen, maxSize - NOTIFICATION_HEADER_SIZE - appLen - 10) // Leave at least 10 for text
+            textLen = maxSize - NOTIFICATION_HEADER_SIZE - appLen - titleLen
         }
         
         return NotificationData(
@@ -488,11 +624,12 @@ class BLEService : Service() {
             text = String(textBytes, 0, maxOf(0, textLen), Charsets.UTF_8),
             timestamp = data.timestamp,
             isPriority = data.isPriority,
-            packageName = data.packageName
+            packageName = data.packageName,
+            key = data.key
         )
     }
 
-    private fun createNotificationPacket(notificationData: NotificationData): ByteArray {
+    private fun createNotificationPacket(notificationData: NotificationData, iconId: Int): ByteArray {
         val appNameBytes = notificationData.appName.toByteArray(Charsets.UTF_8)
         val titleBytes = notificationData.title.toByteArray(Charsets.UTF_8)
         val textBytes = notificationData.text.toByteArray(Charsets.UTF_8)
@@ -501,15 +638,25 @@ class BLEService : Service() {
         val titleLen = titleBytes.size
         val textLen = textBytes.size
         
-        val totalLength = 5 + appLen + titleLen + textLen
+        val totalLength = NOTIFICATION_HEADER_SIZE + appLen + titleLen + textLen
         val packet = ByteArray(totalLength)
         
         var offset = 0
         packet[offset++] = CMD_ADD_NOTIFICATION
-        packet[offset++] = getNotificationType(notificationData.packageName).toByte()
+        var type = getNotificationType(notificationData.packageName) or TYPE_HAS_KEY or TYPE_HAS_ICON
+        if (notificationData.isPriority) {
+            type = type or TYPE_PRIORITY
+        }
+        packet[offset++] = type.toByte()
         packet[offset++] = appLen.toByte()
         packet[offset++] = titleLen.toByte()
         packet[offset++] = textLen.toByte()
+        for (shift in 0 until 32 step 8) {
+            packet[offset++] = (notificationData.key shr shift).toByte()
+        }
+        for (shift in 0 until 32 step 8) {
+            packet[offset++] = (iconId shr shift).toByte()
+        }
         
         System.arraycopy(appNameBytes, 0, packet, offset, appLen)
         offset += appLen
@@ -522,6 +669,310 @@ class BLEService : Service() {
         return packet
     }
 
+    private fun writePacket(packet: ByteArray, urgent: Boolean = false) {
+        synchronized(writeQueue) {
+            // Urgent packets skip ahead of queued bulk writes such as rules
+            if (urgent) {
+                urgentWriteQueue.addLast(packet)
+            } else {
+                writeQueue.addLast(packet)
+            }
+        }
+        writeNextPacket()
+    }
+
+    private fun writeNextPacket() {
+        if (!hasBluetoothPermissions()) {
+            return
+        }
+
+        synchronized(writeQueue) {
+            if (writeInProgress) {
+                return
+            }
+            // Notification packets first, firmware chunks fill the gaps
+            val packet = urgentWriteQueue.removeFirstOrNull() ?: writeQueue.removeFirstOrNull()
+            if (packet != null) {
+                val characteristic = notificationCharacteristic ?: return
+                characteristic.value = packet
+                writeInProgress = bluetoothGatt?.writeCharacteristic(characteristic) == true
+                return
+            }
+            writeInProgress = bulkWriteQueue.removeFirstOrNull()?.invoke() == true
+        }
+    }
+
+    /**
+     * Compile the notification settings into filter rules and send them to
+     * the watch, split into chunks that fit the MTU.
+     */
+    fun sendRules() {
+        try {
+            if (notificationCharacteristic == null || _connectionStatus.value != "Ready") {
+                return
+            }
+
+            val settings = NotificationSettings(this)
+            val program = RuleCompiler { packageName -> getAppLabel(packageName) }.compile(settings)
+            val chunkSize = currentMtu - 3 - RULES_HEADER_SIZE
+
+            var offset = 0
+            do {
+                val length = minOf(chunkSize, program.size - offset)
+                val packet = ByteArray(RULES_HEADER_SIZE + length)
+                packet[0] = CMD_SET_RULES
+                packet[1] = 0
+                packet[2] = (offset and 0xFF).toByte()
+                packet[3] = (offset shr 8).toByte()
+                packet[4] = (program.size and 0xFF).toByte()
+                packet[5] = (program.size shr 8).toByte()
+                System.arraycopy(program, offset, packet, RULES_HEADER_SIZE, length)
+                writePacket(packet)
+                offset += length
+            } while (offset < program.size)
+
+            Log.d(TAG, "Rules sent: ${program.size} bytes")
+        } catch (e: Exception) {
+            Log.e(TAG, "Error sending rules", e)
+        }
+    }
+
+    /**
+     * Send the quiet hours to the watch, which enforces them as its do not
+     * disturb schedule: notifications are still stored but don't wake it.
+     */
+    private fun sendQuietHours() {
+        if (notificationCharacteristic == null || _connectionStatus.value != "Ready") {
+            return
+        }
+
+        val settings = NotificationSettings(this)
+        // Quiet hours are whole hours, inclusive of the end hour
+        val start = settings.getQuietHoursStart() * 60
+        val end = ((settings.getQuietHoursEnd() + 1) % 24) * 60
+        writePacket(byteArrayOf(
+            CMD_SET_DND,
+            if (settings.isQuietHoursEnabled()) 1 else 0,
+            (start and 0xFF).toByte(), (start shr 8).toByte(),
+            (end and 0xFF).toByte(), (end shr 8).toByte()
+        ))
+    }
+
+    /**
+     * Subscribe to the watch's action characteristic. The descriptor write
+     * holds the write queue until it completes, so later writes wait for it.
+     */
+    private fun enableWatchActions(gatt: BluetoothGatt, service: BluetoothGattService) {
+        val characteristic = service.getCharacteristic(ACTION_CHARACTERISTIC_UUID)
+        val descriptor = characteristic?.getDescriptor(CCC_DESCRIPTOR_UUID)
+        if (descriptor == null || !hasBluetoothPermissions()) {
+            Log.w(TAG, "Watch actions not supported by this firmware")
+            return
+        }
+
+        gatt.setCharacteristicNotification(characteristic, true)
+        descriptor.value = BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE
+        synchronized(writeQueue) {
+            writeInProgress = gatt.writeDescriptor(descriptor)
+        }
+    }
+
+    /**
+     * Start uploading a signed MCUboot image to the watch. The upload runs
+     * alongside notifications and resumes by itself after a disconnect.
+     *
+     * When the image last installed on this watch is known, a delta patch
+     * against it is sent instead if it is clearly smaller.
+     *
+     * @return false if the file is not an MCUboot image
+     */
+    fun startFirmwareUpdate(image: ByteArray): Boolean {
+        if (!FirmwareUpdater.isImage(image)) {
+            Log.w(TAG, "Not an MCUboot image (${image.size} bytes)")
+            return false
+        }
+
+        val installed = installedImageFile()
+        val patch = installed?.takeIf { it.exists() }?.let { file ->
+            DeltaEncoder.encode(file.readBytes(), image).takeIf { it.size < image.size * MAX_DELTA_RATIO }
+        }
+        patch?.let { Log.d(TAG, "Delta update: ${it.size} byte patch for a ${image.size} byte image") }
+
+        firmwareUpdater = FirmwareUpdater(image, patch, ::writeSmpPacket) { status ->
+            _firmwareUpdateStatus.value = status
+            if (status.active) {
+                return@FirmwareUpdater
+            }
+            if (hasBluetoothPermissions()) {
+                bluetoothGatt?.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_BALANCED)
+            }
+            // The base of the next delta; should the watch revert instead,
+            // it refuses that delta and the full image is sent
+            if (firmwareUpdater?.succeeded == true) {
+                installed?.let { file ->
+                    file.parentFile?.mkdirs()
+                    file.writeBytes(image)
+                }
+            }
+        }
+        bluetoothGatt?.let { enableFirmwareUpdate(it) }
+        return true
+    }
+
+    private fun installedImageFile(): java.io.File? {
+        val address = connectedDevice?.address ?: return null
+        return java.io.File(java.io.File(filesDir, "firmware"), address.replace(":", "") + ".bin")
+    }
+
+    /**
+     * Subscribe to the SMP characteristic and continue a pending upload on
+     * this link. Does nothing without an upload, the subscription is only
+     * needed for one.
+     */
+    private fun enableFirmwareUpdate(gatt: BluetoothGatt) {
+        val updater = firmwareUpdater ?: return
+        if (!updater.active || _connectionStatus.value != "Ready" || !hasBluetoothPermissions()) {
+            return
+        }
+
+        val characteristic = gatt.getService(SMP_SERVICE_UUID)?.getCharacteristic(SMP_CHARACTERISTIC_UUID)
+        val descriptor = characteristic?.getDescriptor(CCC_DESCRIPTOR_UUID)
+        if (descriptor == null) {
+            Log.w(TAG, "Firmware update not supported by this firmware")
+            return
+        }
+
+        smpCharacteristic = characteristic
+        gatt.setCharacteristicNotification(characteristic, true)
+        // Short connection interval while chunks flow, the watch asks for its
+        // bulk link profile as well
+        gatt.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_HIGH)
+        synchronized(writeQueue) {
+            bulkWriteQueue.addLast {
+                descriptor.value = BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE
+                gatt.writeDescriptor(descriptor)
+            }
+        }
+        writeNextPacket()
+        updater.resume(currentMtu)
+    }
+
+    private fun writeSmpPacket(packet: ByteArray) {
+        synchronized(writeQueue) {
+            bulkWriteQueue.addLast {
+                val characteristic = smpCharacteristic
+                if (characteristic == null || !hasBluetoothPermissions()) {
+                    false
+                } else {
+                    characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE
+                    characteristic.value = packet
+                    bluetoothGatt?.writeCharacteristic(characteristic) == true
+                }
+            }
+        }
+        writeNextPacket()
+    }
+
+    /**
+     * Hand an action from the watch ([CMD_ACTION] [action] [seq] [key u32]
+     * reply text) to the notification listener, which performs it and
+     * reports back with ACTION_PERFORMED.
+     */
+    private fun handleWatchAction(value: ByteArray) {
+        if (value.size < ACTION_HEADER_SIZE || value[0] != CMD_ACTION) {
+            Log.w(TAG, "Malformed watch action (${value.size} bytes)")
+            return
+        }
+
+        var key = 0
+        for (i in 0 until 4) {
+            key = key or ((value[3 + i].toInt() and 0xFF) shl (8 * i))
+        }
+
+        // Icon requests carry an icon id in place of the key
+        if ((value[1].toInt() and 0xFF) == ACTION_REQUEST_ICON) {
+            val icon = iconsById[key]
+            icon?.let { sendIcon(it, urgent = false) }
+            writePacket(byteArrayOf(CMD_ACTION_ACK, value[2], if (icon != null) 0 else 1))
+            return
+        }
+        val intent = Intent(this, NotificationListener::class.java).apply {
+            action = NotificationListener.ACTION_PERFORM_WATCH_ACTION
+            putExtra("action", value[1].toInt() and 0xFF)
+            putExtra("seq", value[2].toInt() and 0xFF)
+            putExtra("key", key)
+            putExtra("reply", String(value, ACTION_HEADER_SIZE, value.size - ACTION_HEADER_SIZE, Charsets.UTF_8))
+        }
+        startService(intent)
+    }
+
+    /**
+     * Encoded icon for an app, cached for the lifetime of the service.
+     */
+    private fun iconFor(packageName: String): IconEncoder.EncodedIcon? {
+        if (packageName.isEmpty()) {
+            return null
+        }
+        return iconsByPackage.getOrPut(packageName) {
+            try {
+                IconEncoder.encode(packageManager.getApplicationIcon(packageName))
+                    ?.also { iconsById[it.id] = it }
+            } catch (e: Exception) {
+                Log.w(TAG, "No icon for $packageName", e)
+                null
+            }
+        }
+    }
+
+    private fun watchHasIcon(id: Int): Boolean {
+        val address = connectedDevice?.address ?: return false
+        return watchIcons.getStringSet(address, emptySet())!!.contains(id.toString())
+    }
+
+    /**
+     * Send an icon ([CMD_SET_ICON] [id u32] encoded icon) and remember the
+     * watch has it, it keeps icons in flash across reconnects.
+     */
+    private fun sendIcon(icon: IconEncoder.EncodedIcon, urgent: Boolean) {
+        if (ICON_HEADER_SIZE + icon.bytes.size > currentMtu - 3) {
+            Log.w(TAG, "Icon ${icon.bytes.size} bytes does not fit MTU $currentMtu")
+            return
+        }
+
+        val packet = ByteArray(ICON_HEADER_SIZE + icon.bytes.size)
+        packet[0] = CMD_SET_ICON
+        for (i in 0 until 4) {
+            packet[1 + i] = (icon.id shr (8 * i)).toByte()
+        }
+        System.arraycopy(icon.bytes, 0, packet, ICON_HEADER_SIZE, icon.bytes.size)
+        writePacket(packet, urgent)
+
+        connectedDevice?.address?.let { address ->
+            val sent = watchIcons.getStringSet(address, emptySet())!!.toMutableSet()
+            sent.add(icon.id.toString())
+            watchIcons.edit().putStringSet(address, sent).apply()
+        }
+    }
+
+    private fun sendTime() {
+        val now = Calendar.getInstance()
+        writePacket(byteArrayOf(
+            CMD_SET_TIME,
+            now.get(Calendar.HOUR_OF_DAY).toByte(),
+            now.get(Calendar.MINUTE).toByte(),
+            now.get(Calendar.SECOND).toByte()
+        ))
+    }
+
+    private fun getAppLabel(packageName: String): String {
+        return try {
+            val applicationInfo = packageManager.getApplicationInfo(packageName, 0)
+            packageManager.getApplicationLabel(applicationInfo).toString()
+        } catch (e: Exception) {
+            packageName
+        }
+    }
+
     private fun getNotificationType(packageName: String): Int {
         return when {
             packageName.contains("phone", true) || packageName.contains("dialer", true) -> 0
@@ -541,7 +992,8 @@ class BLEService : Service() {
     private fun processNotificationQueue() {
         if (notificationCharacteristic != null && notificationQueue.isNotEmpty()) {
             Log.d(TAG, "Processing ${notificationQueue.size} queued notifications")
-            val queuedNotifications = notificationQueue.toList()
+            // Urgent notifications go out first
+            val queuedNotifications = notificationQueue.sortedByDescending { it.isPriority }
             notificationQueue.clear()
             
             queuedNotifications.forEach { notification ->
@@ -593,8 +1045,7 @@ class BLEService : Service() {
             if (notificationCharacteristic != null && _connectionStatus.value == "Ready") {
                 val packet = ByteArray(5) { 0 }
                 packet[0] = CMD_CLEAR_ALL
-                notificationCharacteristic?.value = packet
-                bluetoothGatt?.writeCharacteristic(notificationCharacteristic)
+                writePacket(packet)
             }
             
             Log.d(TAG, "All notifications cleared")
@@ -603,6 +1054,24 @@ class BLEService : Service() {
         }
     }
 
+    /**
+     * Search the notifications stored on the watch ([CMD_SEARCH] query),
+     * which lists the matches on its screen. The query is cut to fit the MTU
+     * on a character boundary.
+     */
+    fun searchOnWatch(query: String) {
+        if (notificationCharacteristic == null || _connectionStatus.value != "Ready" || query.isBlank()) {
+            return
+        }
+
+        val maxBytes = currentMtu - 3 - 1
+        var text = query.trim()
+        while (text.toByteArray(Charsets.UTF_8).size > maxBytes) {
+            text = text.dropLast(1)
+        }
+        writePacket(byteArrayOf(CMD_SEARCH) + text.toByteArray(Charsets.UTF_8), urgent = true)
+    }
+
     override fun onDestroy() {
         super.onDestroy()
         try {
@@ -0,0 +1,119 @@
+package net.yehudae.esp32s3notificationsreceiver
+
+import java.io.ByteArrayOutputStream
+import java.security.MessageDigest
+
+/**
+ * Encodes a delta patch that rebuilds a new firmware image from the one
+ * the watch runs (see delta.h): a header with the source's size and
+ * SHA-256, then copy and add operations.
+ *
+ * Greedy: at each target position the copy continuing the previous one,
+ * moved by the bytes added since, is tried first, it survives code moved
+ * by an edit; then the last source position with the same 8 bytes.
+ * tools/delta_sim encodes the same way.
+ */
+object DeltaEncoder {
+    private const val MAGIC = 0x3144575A // "ZWD1"
+    private const val OP_COPY = 0
+    private const val OP_ADD = 1
+    private const val HASH_BITS = 18
+    private const val BLOCK = 8
+    private const val MIN_MATCH = 12 // Copy found through the hash table
+    private const val MIN_CONTINUATION = 4 // Copy continuing the previous one
+
+    fun encode(source: ByteArray, target: ByteArray): ByteArray {
+        val table = IntArray(1 shl HASH_BITS) { -1 }
+        for (i in 0..source.size - BLOCK) {
+            table[hash(source, i)] = i
+        }
+
+        val out = ByteArrayOutputStream()
+        writeLe32(out, MAGIC)
+        writeLe32(out, source.size)
+        writeLe32(out, target.size)
+        out.write(MessageDigest.getInstance("SHA-256").digest(source))
+
+        var literal = 0 // Start of bytes to add
+        var sourcePos = 0 // End of the previous copy
+        var t = 0
+        while (t < target.size) {
+            var best = 0
+            var bestLength = 0
+
+            val next = sourcePos + (t - literal)
+            if (next < source.size) {
+                val length = matchLength(source, next, target, t)
+                if (length >= MIN_CONTINUATION) {
+                    best = next
+                    bestLength = length
+                }
+            }
+            if (bestLength < MIN_MATCH && t + BLOCK <= target.size) {
+                val found = table[hash(target, t)]
+                if (found >= 0) {
+                    val length = matchLength(source, found, target, t)
+                    if (length >= MIN_MATCH && length > bestLength) {
+                        best = found
+                        bestLength = length
+                    }
+                }
+            }
+
+            if (bestLength == 0) {
+                t++
+                continue
+            }
+
+            if (t > literal) {
+                writeVarint(out, ((t - literal) shl 1) or OP_ADD)
+                out.write(target, literal, t - literal)
+            }
+            val move = best - sourcePos
+            writeVarint(out, (bestLength shl 1) or OP_COPY)
+            writeVarint(out, (move shl 1) xor (move shr 31))
+            sourcePos = best + bestLength
+            t += bestLength
+            literal = t
+        }
+        if (t > literal) {
+            writeVarint(out, ((t - literal) shl 1) or OP_ADD)
+            out.write(target, literal, t - literal)
+        }
+        return out.toByteArray()
+    }
+
+    private fun hash(data: ByteArray, pos: Int): Int {
+        var v = 0L
+        for (i in BLOCK - 1 downTo 0) {
+            v = (v shl 8) or (data[pos + i].toLong() and 0xFF)
+        }
+        return ((v * -0x61c8864680b583ebL) ushr (64 - HASH_BITS)).toInt()
+    }
+
+    private fun matchLength(source: ByteArray, s: Int, target: ByteArray, t: Int): Int {
+        var n = 0
+        while (s + n < source.size && t + n < target.size && source[s + n] == target[t + n]) {
+            n++
+        }
+        return n
+    }
+
+    private fun writeVarint(out: ByteArrayOutputStream, value: Int) {
+        var v = value
+        do {
+            var byte = v and 0x7F
+            v = v ushr 7
+            if (v != 0) {
+                byte = byte or 0x80
+            }
+            out.write(byte)
+        } while (v != 0)
+    }
+
+    private fun writeLe32(out: ByteArrayOutputStream, value: Int) {
+        for (shift in 0 until 32 step 8) {
+            out.write(value shr shift)
+        }
+    }
+}
@@ -0,0 +1,397 @@
+package net.yehudae.esp32s3notificationsreceiver
+
+import android.util.Log
+import java.io.ByteArrayOutputStream
+import java.security.MessageDigest
+
+/**
+ * Uploads a signed MCUboot image to the watch with MCUmgr's SMP protocol
+ * (image group), then marks it for a test swap and resets the watch, which
+ * confirms the new image once its Bluetooth is up again (see dfu.h).
+ *
+ * One chunk is in flight at a time and every response carries the offset
+ * the watch expects next, so an upload interrupted by a disconnect resumes
+ * from the last acknowledged offset when [resume] is called on the new link.
+ * Chunks are handed to [send]; BLEService writes them after any pending
+ * notification packets so notifications are not held up by the upload.
+ *
+ * With a [patch] from DeltaEncoder, the patch is uploaded with the watch's
+ * delta command instead and the watch rebuilds, verifies and marks the
+ * image itself. If it refuses the patch, e.g. it does not run the image
+ * the patch was made from, the full image is uploaded.
+ */
+class FirmwareUpdater(
+    private val image: ByteArray,
+    private var patch: ByteArray?,
+    private val send: (ByteArray) -> Unit,
+    private val onStatus: (FirmwareUpdateStatus) -> Unit
+) {
+    private val imageHash = imageHash(image)
+    private val uploadSha = MessageDigest.getInstance("SHA-256").digest(image)
+    private var state = State.UPLOADING
+    private var offset = 0
+    private var mtu = 23
+    private var seq = 0
+    private var resumes = 0
+    private var busyMs = 0L
+    private var lastSentMs = 0L
+    private val response = ByteArrayOutputStream()
+
+    private enum class State { UPLOADING, TESTING, RESETTING, DONE, FAILED }
+
+    val active: Boolean
+        get() = state != State.DONE && state != State.FAILED
+
+    val succeeded: Boolean
+        get() = state == State.DONE
+
+    private val payload: ByteArray
+        get() = patch ?: image
+
+    /**
+     * Send the next request on a new link, or the first one.
+     */
+    fun resume(mtu: Int) {
+        if (!active) {
+            return
+        }
+        if (offset > 0 && state == State.UPLOADING) {
+            resumes++
+        }
+        this.mtu = mtu
+        response.reset()
+        sendNext()
+    }
+
+    /**
+     * Handle a notification from the SMP characteristic. Responses longer
+     * than the MTU arrive in several notifications.
+     */
+    fun onNotification(value: ByteArray) {
+        response.write(value)
+        val packet = response.toByteArray()
+        if (packet.size < SMP_HEADER_SIZE) {
+            return
+        }
+        val length = ((packet[2].toInt() and 0xFF) shl 8) or (packet[3].toInt() and 0xFF)
+        if (packet.size < SMP_HEADER_SIZE + length) {
+            return
+        }
+        response.reset()
+
+        val body = try {
+            Cbor.decodeMap(packet, SMP_HEADER_SIZE, SMP_HEADER_SIZE + length)
+        } catch (e: Exception) {
+            Log.w(TAG, "Malformed SMP response", e)
+            return
+        }
+        val rc = (body["rc"] as? Long)?.toInt() ?: 0
+
+        when (state) {
+            State.UPLOADING -> onUploadResponse(rc, body["off"] as? Long)
+            State.TESTING -> {
+                if (rc != 0) {
+                    fail("Image rejected (rc $rc)")
+                    return
+                }
+                state = State.RESETTING
+                sendNext()
+            }
+            State.RESETTING -> {
+                state = State.DONE
+                report("Done, the watch restarts with the new firmware")
+            }
+            else -> {}
+        }
+    }
+
+    private fun onUploadResponse(rc: Int, off: Long?) {
+        val now = System.currentTimeMillis()
+        if (rc != 0 || off == null) {
+            if (offset == 0 && patch != null) {
+                Log.w(TAG, "Delta refused (rc $rc), uploading the full image")
+                patch = null
+                sendNext()
+                return
+            }
+            if (offset == 0) {
+                fail("Upload refused (rc $rc)")
+                return
+            }
+            // The watch lost the upload, e.g. it restarted: start over
+            Log.w(TAG, "Resume at $offset refused (rc $rc), restarting upload")
+            offset = 0
+            sendNext()
+            return
+        }
+
+        // Pauses such as reconnects do not count against throughput
+        if (now - lastSentMs < IDLE_MS) {
+            busyMs += now - lastSentMs
+        }
+        offset = off.toInt()
+        if (offset >= payload.size) {
+            // The watch marks a rebuilt image for test itself
+            state = if (patch != null) State.RESETTING else State.TESTING
+        }
+        sendNext()
+    }
+
+    private fun sendNext() {
+        when (state) {
+            State.UPLOADING -> sendChunk()
+            State.TESTING -> {
+                report("Marking image for test")
+                send(smpPacket(OP_WRITE, GROUP_IMAGE, ID_STATE, Cbor.Map()
+                    .put("hash", imageHash)
+                    .put("confirm", false)))
+            }
+            State.RESETTING -> {
+                report("Restarting watch")
+                send(smpPacket(OP_WRITE, GROUP_OS, ID_RESET, Cbor.Map()))
+            }
+            else -> {}
+        }
+    }
+
+    private fun sendChunk() {
+        val data = payload
+        val fields = Cbor.Map()
+        if (offset == 0) {
+            if (patch == null) {
+                fields.put("image", 0)
+            }
+            // The SHA-256 of the image either way, a rebuilt one must match it
+            fields.put("len", data.size.toLong()).put("sha", uploadSha)
+        }
+        fields.put("off", offset.toLong())
+
+        // Each request fits one write, the watch does not reassemble them
+        val overhead = SMP_HEADER_SIZE + fields.encode().size + DATA_FIELD_SIZE
+        val length = minOf(data.size - offset, mtu - ATT_OVERHEAD - overhead)
+        fields.put("data", data.copyOfRange(offset, offset + length))
+
+        lastSentMs = System.currentTimeMillis()
+        if (patch != null) {
+            send(smpPacket(OP_WRITE, GROUP_DFU, ID_DELTA_UPLOAD, fields))
+            report("Uploading delta for a ${image.size / 1024} KB image")
+        } else {
+            send(smpPacket(OP_WRITE, GROUP_IMAGE, ID_UPLOAD, fields))
+            report("Uploading")
+        }
+    }
+
+    private fun smpPacket(op: Int, group: Int, id: Int, body: Cbor.Map): ByteArray {
+        val payload = body.encode()
+        val packet = ByteArray(SMP_HEADER_SIZE + payload.size)
+        packet[0] = op.toByte()
+        packet[1] = 0
+        packet[2] = (payload.size shr 8).toByte()
+        packet[3] = payload.size.toByte()
+        packet[4] = (group shr 8).toByte()
+        packet[5] = group.toByte()
+        packet[6] = (seq++).toByte()
+        packet[7] = id.toByte()
+        System.arraycopy(payload, 0, packet, SMP_HEADER_SIZE, payload.size)
+        return packet
+    }
+
+    private fun fail(message: String) {
+        Log.e(TAG, message)
+        state = State.FAILED
+        report(message)
+    }
+
+    private fun report(message: String) {
+        // Bytes per millisecond is KB/s with 1000 byte KB, use 1024
+        val kbPerSecond = if (busyMs > 0) offset * 1000f / 1024f / busyMs else 0f
+        onStatus(FirmwareUpdateStatus(message, offset, payload.size, kbPerSecond, resumes, active))
+    }
+
+    /**
+     * Minimal CBOR for SMP: maps with text keys and unsigned, negative,
+     * boolean or byte string values. Other values are skipped when decoding.
+     */
+    private object Cbor {
+        class Map {
+            private val entries = LinkedHashMap<String, Any>()
+
+            fun put(key: String, value: Any): Map {
+                entries[key] = value
+                return this
+            }
+
+            fun encode(): ByteArray {
+                val out = ByteArrayOutputStream()
+                head(out, 5, entries.size.toLong())
+                entries.forEach { (key, value) ->
+                    val keyBytes = key.toByteArray(Charsets.UTF_8)
+                    head(out, 3, keyBytes.size.toLong())
+                    out.write(keyBytes)
+                    when (value) {
+                        is Int -> head(out, 0, value.toLong())
+                        is Long -> head(out, 0, value)
+                        is Boolean -> out.write(if (value) 0xF5 else 0xF4)
+                        is ByteArray -> {
+                            head(out, 2, value.size.toLong())
+                            out.write(value)
+                        }
+                    }
+                }
+                return out.toByteArray()
+            }
+        }
+
+        private fun head(out: ByteArrayOutputStream, major: Int, value: Long) {
+            val type = major shl 5
+            when {
+                value < 24 -> out.write(type or value.toInt())
+                value < 0x100 -> {
+                    out.write(type or 24)
+                    out.write(value.toInt())
+                }
+                value < 0x10000 -> {
+                    out.write(type or 25)
+                    out.write((value shr 8).toInt())
+                    out.write(value.toInt())
+                }
+                else -> {
+                    out.write(type or 26)
+                    for (shift in 24 downTo 0 step 8) {
+                        out.write((value shr shift).toInt())
+                    }
+                }
+            }
+        }
+
+        fun decodeMap(data: ByteArray, start: Int, end: Int): kotlin.collections.Map<String, Any> {
+            val reader = Reader(data, start, end)
+            val result = HashMap<String, Any>()
+            val (major, count) = reader.head()
+            require(major == 5) { "Not a map" }
+            for (i in 0 until count) {
+                val (keyMajor, keyLength) = reader.head()
+                require(keyMajor == 3) { "Key is not text" }
+                val key = String(reader.bytes(keyLength.toInt()), Charsets.UTF_8)
+                reader.value()?.let { result[key] = it }
+            }
+            return result
+        }
+
+        private class Reader(val data: ByteArray, var pos: Int, val end: Int) {
+            fun byte(): Int {
+                require(pos < end) { "Truncated" }
+                return data[pos++].toInt() and 0xFF
+            }
+
+            fun head(): Pair<Int, Long> {
+                val initial = byte()
+                val info = initial and 0x1F
+                val value = when {
+                    info < 24 -> info.toLong()
+                    info in 24..27 -> {
+                        var v = 0L
+                        repeat(1 shl (info - 24)) { v = (v shl 8) or byte().toLong() }
+                        v
+                    }
+                    else -> throw IllegalArgumentException("Indefinite length")
+                }
+                return Pair(initial shr 5, value)
+            }
+
+            fun bytes(length: Int): ByteArray {
+                require(pos + length <= end) { "Truncated" }
+                return data.copyOfRange(pos, pos + length).also { pos += length }
+            }
+
+            /** Read a value, null for the kinds SMP responses here do not need */
+            fun value(): Any? {
+                val (major, arg) = head()
+                return when (major) {
+                    0 -> arg
+                    1 -> -1 - arg
+                    2 -> bytes(arg.toInt())
+                    3 -> { bytes(arg.toInt()); null }
+                    4 -> { repeat(arg.toInt()) { value() }; null }
+                    5 -> { repeat(arg.toInt() * 2) { value() }; null }
+                    7 -> when (arg) {
+                        20L -> false
+                        21L -> true
+                        else -> null
+                    }
+                    else -> null
+                }
+            }
+        }
+    }
+
+    companion object {
+        private const val TAG = "FirmwareUpdater"
+        private const val SMP_HEADER_SIZE = 8
+        private const val ATT_OVERHEAD = 3
+        private const val DATA_FIELD_SIZE = 5 + 3 // "data" key, byte string head
+        private const val IDLE_MS = 3000L // DFU_IDLE_MS on the watch
+
+        private const val OP_WRITE = 2
+        private const val GROUP_OS = 0
+        private const val GROUP_IMAGE = 1
+        private const val ID_STATE = 0
+        private const val ID_UPLOAD = 1
+        private const val ID_RESET = 5
+        private const val GROUP_DFU = 64 // DFU_MGMT_GROUP
+        private const val ID_DELTA_UPLOAD = 0
+
+        private const val IMAGE_MAGIC = 0x96f3b83dL
+        private const val TLV_INFO_MAGIC = 0x6907
+        private const val TLV_PROT_INFO_MAGIC = 0x6908
+        private const val TLV_SHA256 = 0x10
+
+        /**
+         * Check a file is an MCUboot image.
+         */
+        fun isImage(image: ByteArray): Boolean {
+            return image.size > 32 && le32(image, 0) == IMAGE_MAGIC
+        }
+
+        /**
+         * SHA-256 of the image from its TLV trailer, the hash MCUmgr's image
+         * commands identify it by.
+         */
+        private fun imageHash(image: ByteArray): ByteArray {
+            require(isImage(image)) { "Not an MCUboot image" }
+            var pos = le16(image, 8) + le32(image, 12).toInt()
+            if (le16(image, pos) == TLV_PROT_INFO_MAGIC) {
+                pos += le16(image, pos + 2)
+            }
+            require(le16(image, pos) == TLV_INFO_MAGIC) { "No TLV trailer" }
+            val end = pos + le16(image, pos + 2)
+            pos += 4
+            while (pos + 4 <= end) {
+                val type = le16(image, pos)
+                val length = le16(image, pos + 2)
+                if (type == TLV_SHA256 && length == 32) {
+                    return image.copyOfRange(pos + 4, pos + 4 + length)
+                }
+                pos += 4 + length
+            }
+            throw IllegalArgumentException("No SHA-256 in the image")
+        }
+
+        private fun le16(data: ByteArray, pos: Int): Int {
+            return (data[pos].toInt() and 0xFF) or ((data[pos + 1].toInt() and 0xFF) shl 8)
+        }
+
+        private fun le32(data: ByteArray, pos: Int): Long {
+            return le16(data, pos).toLong() or (le16(data, pos + 2).toLong() shl 16)
+        }
+    }
+}
+
+data class FirmwareUpdateStatus(
+    val message: String,
+    val offset: Int,
+    val size: Int,
+    val kbPerSecond: Float,
+    val resumes: Int,
+    val active: Boolean
+)
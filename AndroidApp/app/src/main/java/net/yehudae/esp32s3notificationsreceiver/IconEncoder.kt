@@ -0,0 +1,121 @@
+package net.yehudae.esp32s3notificationsreceiver
+
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.drawable.Drawable
+import java.io.ByteArrayOutputStream
+import java.util.zip.CRC32
+
+/**
+ * Encodes app icons in the watch's icon cache format (see icons.h):
+ * [width] [height] [palette count] [palette RGB565 LE ...] runs, where each
+ * run byte is (length - 1) shl 4 or palette index and index 0 is transparent.
+ *
+ * The icon id is the CRC32 of the encoded bytes, so the watch can verify
+ * what it stores and the same picture is only sent once.
+ */
+object IconEncoder {
+    const val DIM = 20
+    private const val MAX_COLORS = 15 // Plus the transparent entry
+    private const val MAX_RUN = 16
+
+    class EncodedIcon(val id: Int, val bytes: ByteArray)
+
+    fun encode(drawable: Drawable): EncodedIcon? {
+        val bitmap = Bitmap.createBitmap(DIM, DIM, Bitmap.Config.ARGB_8888)
+        val canvas = Canvas(bitmap)
+        drawable.setBounds(0, 0, DIM, DIM)
+        drawable.draw(canvas)
+
+        val pixels = IntArray(DIM * DIM)
+        bitmap.getPixels(pixels, 0, DIM, 0, 0, DIM, DIM)
+        bitmap.recycle()
+
+        val palette = buildPalette(pixels)
+        val out = ByteArrayOutputStream()
+        out.write(DIM)
+        out.write(DIM)
+        out.write(palette.size + 1)
+        out.write(0)
+        out.write(0)
+        palette.forEach { rgb565 ->
+            out.write(rgb565 and 0xFF)
+            out.write(rgb565 shr 8)
+        }
+
+        var runIndex = -1
+        var runLength = 0
+        pixels.forEach { pixel ->
+            val index = paletteIndex(pixel, palette)
+            if (index != runIndex || runLength == MAX_RUN) {
+                if (runLength > 0) {
+                    out.write(((runLength - 1) shl 4) or runIndex)
+                }
+                runIndex = index
+                runLength = 0
+            }
+            runLength++
+        }
+        out.write(((runLength - 1) shl 4) or runIndex)
+
+        val bytes = out.toByteArray()
+        val crc = CRC32().apply { update(bytes) }.value.toInt()
+        // Id 0 means no icon on the watch
+        return if (crc == 0) null else EncodedIcon(crc, bytes)
+    }
+
+    private fun isTransparent(pixel: Int) = Color.alpha(pixel) < 128
+
+    private fun toRgb565(pixel: Int): Int {
+        return ((Color.red(pixel) shr 3) shl 11) or
+            ((Color.green(pixel) shr 2) shl 5) or
+            (Color.blue(pixel) shr 3)
+    }
+
+    /**
+     * Most common colors, counted on 4 bits per channel so near-identical
+     * shades from anti-aliasing share a bucket.
+     */
+    private fun buildPalette(pixels: IntArray): List<Int> {
+        val buckets = HashMap<Int, IntArray>() // RGB444 -> count, r, g, b sums
+        pixels.filterNot { isTransparent(it) }.forEach { pixel ->
+            val bucket = ((Color.red(pixel) shr 4) shl 8) or
+                ((Color.green(pixel) shr 4) shl 4) or
+                (Color.blue(pixel) shr 4)
+            val sums = buckets.getOrPut(bucket) { IntArray(4) }
+            sums[0]++
+            sums[1] += Color.red(pixel)
+            sums[2] += Color.green(pixel)
+            sums[3] += Color.blue(pixel)
+        }
+
+        return buckets.values
+            .sortedByDescending { it[0] }
+            .take(MAX_COLORS)
+            .map { toRgb565(Color.rgb(it[1] / it[0], it[2] / it[0], it[3] / it[0])) }
+    }
+
+    private fun paletteIndex(pixel: Int, palette: List<Int>): Int {
+        if (isTransparent(pixel) || palette.isEmpty()) {
+            return 0
+        }
+
+        val r = Color.red(pixel)
+        val g = Color.green(pixel)
+        val b = Color.blue(pixel)
+        var best = 0
+        var bestDistance = Int.MAX_VALUE
+        palette.forEachIndexed { i, rgb565 ->
+            val dr = r - ((rgb565 shr 11) shl 3)
+            val dg = g - (((rgb565 shr 5) and 0x3F) shl 2)
+            val db = b - ((rgb565 and 0x1F) shl 3)
+            val distance = dr * dr + dg * dg + db * db
+            if (distance < bestDistance) {
+                best = i
+                bestDistance = distance
+            }
+        }
+        return best + 1
+    }
+}
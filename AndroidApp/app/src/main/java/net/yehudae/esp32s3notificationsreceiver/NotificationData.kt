@@ -10,5 +10,7 @@ data class NotificationData(
     val text: String,
     val timestamp: String,
     val isPriority: Boolean = false,
-    val packageName: String = ""
+    val packageName: String = "",
+    // Identifies the notification when the watch sends an action back
+    val key: Int = 0
 ) : Parcelable
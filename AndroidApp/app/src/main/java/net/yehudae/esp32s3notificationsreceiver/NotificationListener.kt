@@ -1,6 +1,11 @@
 package net.yehudae.esp32s3notificationsreceiver
 
+import android.app.Notification
+import android.app.PendingIntent
+import android.app.RemoteInput
 import android.content.Intent
+import android.os.Build
+import android.os.Bundle
 import android.service.notification.NotificationListenerService
 import android.service.notification.StatusBarNotification
 import android.util.Log
@@ -12,6 +17,19 @@ class NotificationListener : NotificationListenerService() {
     companion object {
         private const val TAG = "NotificationListener"
         const val ACTION_READ_EXISTING = "ACTION_READ_EXISTING"
+        const val ACTION_PERFORM_WATCH_ACTION = "ACTION_PERFORM_WATCH_ACTION"
+
+        // Actions the watch sends back (PROTOCOL_ACTION_* in the firmware)
+        private const val WATCH_ACTION_DISMISS = 1
+        private const val WATCH_ACTION_MARK_READ = 2
+        private const val WATCH_ACTION_OPEN = 3
+        private const val WATCH_ACTION_REPLY = 4
+
+        /** Key sent to the watch for a notification, never 0 (no key) */
+        fun watchKey(sbn: StatusBarNotification): Int {
+            val key = sbn.key.hashCode()
+            return if (key == 0) 1 else key
+        }
     }
     
     private lateinit var settings: NotificationSettings
@@ -26,6 +44,19 @@ class NotificationListener : NotificationListenerService() {
             ACTION_READ_EXISTING -> {
                 readExistingNotifications()
             }
+            ACTION_PERFORM_WATCH_ACTION -> {
+                val performed = performWatchAction(
+                    intent.getIntExtra("action", 0),
+                    intent.getIntExtra("key", 0),
+                    intent.getStringExtra("reply") ?: ""
+                )
+                val ack = Intent(this, BLEService::class.java).apply {
+                    action = "ACTION_PERFORMED"
+                    putExtra("seq", intent.getIntExtra("seq", 0))
+                    putExtra("status", if (performed) 0 else 1)
+                }
+                startService(ack)
+            }
         }
         return super.onStartCommand(intent, flags, startId)
     }
@@ -104,12 +135,6 @@ class NotificationListener : NotificationListenerService() {
                 return false
             }
             
-            // Check quiet hours (but allow existing notifications to be synced)
-            if (!isExisting && settings.isInQuietHours()) {
-                Log.d(TAG, "Notification from $packageName blocked by quiet hours")
-                return false
-            }
-            
             val extras = sbn.notification.extras
             val title = extras.getString("android.title") ?: ""
             val text = extras.getString("android.text") ?: ""
@@ -136,7 +161,8 @@ class NotificationListener : NotificationListenerService() {
                 text = text,
                 timestamp = timestamp,
                 isPriority = isPriority,
-                packageName = packageName
+                packageName = packageName,
+                key = watchKey(sbn)
             )
             
             Log.d(TAG, "${if (isExisting) "Existing" else "New"} notification: $appName - $title ${if (isPriority) "(PRIORITY)" else ""}")
@@ -170,6 +196,64 @@ class NotificationListener : NotificationListenerService() {
         }
     }
 
+    /**
+     * Perform an action the user took on the watch
+     * @return true if the notification was found and the action performed
+     */
+    private fun performWatchAction(action: Int, key: Int, reply: String): Boolean {
+        try {
+            val sbn = activeNotifications?.firstOrNull { watchKey(it) == key }
+            if (sbn == null) {
+                Log.d(TAG, "Watch action $action for a notification that is gone")
+                return false
+            }
+
+            val notification = sbn.notification
+            Log.d(TAG, "Watch action $action on ${sbn.packageName}")
+            return when (action) {
+                WATCH_ACTION_DISMISS -> {
+                    cancelNotification(sbn.key)
+                    true
+                }
+                WATCH_ACTION_MARK_READ -> {
+                    val markRead = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
+                        notification.actions?.firstOrNull {
+                            it.semanticAction == Notification.Action.SEMANTIC_ACTION_MARK_AS_READ
+                        }
+                    } else {
+                        null
+                    }
+                    markRead?.actionIntent?.send() != null
+                }
+                WATCH_ACTION_OPEN -> {
+                    notification.contentIntent?.send() != null
+                }
+                WATCH_ACTION_REPLY -> sendReply(notification, reply)
+                else -> false
+            }
+        } catch (e: PendingIntent.CanceledException) {
+            Log.w(TAG, "Watch action $action target is no longer valid", e)
+            return false
+        } catch (e: Exception) {
+            Log.e(TAG, "Error performing watch action $action", e)
+            return false
+        }
+    }
+
+    private fun sendReply(notification: Notification, reply: String): Boolean {
+        val replyAction = notification.actions?.firstOrNull { action ->
+            action.remoteInputs?.any { it.allowFreeFormInput } == true
+        } ?: return false
+
+        val remoteInputs = replyAction.remoteInputs
+        val results = Bundle()
+        remoteInputs.forEach { results.putCharSequence(it.resultKey, reply) }
+        val fillIn = Intent()
+        RemoteInput.addResultsToIntent(remoteInputs, fillIn, results)
+        replyAction.actionIntent.send(this, 0, fillIn)
+        return true
+    }
+
     override fun onNotificationRemoved(sbn: StatusBarNotification) {
         // Handle notification removal if needed
         Log.d(TAG, "Notification removed: ${sbn.packageName}")
@@ -18,6 +18,15 @@ class NotificationSettings(context: Context) {
         private const val KEY_QUIET_HOURS_END = "quiet_hours_end"
         private const val KEY_MAX_NOTIFICATIONS = "max_notifications"
         
+        // Settings that are compiled into the watch's filter rules
+        private val RULE_KEYS = setOf(
+            KEY_PRIORITY_APPS,
+            KEY_FILTER_KEYWORDS,
+            KEY_QUIET_HOURS_ENABLED,
+            KEY_QUIET_HOURS_START,
+            KEY_QUIET_HOURS_END
+        )
+        
         // Default blocked apps
         private val DEFAULT_BLOCKED_APPS = setOf(
             "android",
@@ -27,6 +36,18 @@ class NotificationSettings(context: Context) {
         )
     }
     
+    /**
+     * Call [onChange] whenever a setting that affects the watch's filter rules
+     * changes. The caller must keep the returned listener referenced.
+     */
+    fun registerRulesListener(onChange: () -> Unit): SharedPreferences.OnSharedPreferenceChangeListener {
+        val listener = SharedPreferences.OnSharedPreferenceChangeListener { _, key ->
+            if (key in RULE_KEYS) onChange()
+        }
+        prefs.registerOnSharedPreferenceChangeListener(listener)
+        return listener
+    }
+    
     fun isAppEnabled(packageName: String): Boolean {
         if (DEFAULT_BLOCKED_APPS.contains(packageName)) return false
         
@@ -85,6 +106,15 @@ class NotificationSettings(context: Context) {
         setPriorityApps(priorityApps)
     }
     
+    fun getFilterKeywords(): Set<String> {
+        return prefs.getStringSet(KEY_FILTER_KEYWORDS, emptySet()) ?: emptySet()
+    }
+    
+    fun setFilterKeywords(keywords: Set<String>) {
+        prefs.edit().putStringSet(KEY_FILTER_KEYWORDS, keywords).apply()
+        Log.d(TAG, "Filter keywords updated: ${keywords.size} keywords")
+    }
+    
     fun isQuietHoursEnabled(): Boolean {
         return prefs.getBoolean(KEY_QUIET_HOURS_ENABLED, false)
     }
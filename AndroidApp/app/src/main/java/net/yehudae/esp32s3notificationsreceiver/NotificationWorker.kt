@@ -27,6 +27,7 @@ class NotificationWorker(
                     .putString("title", notificationData.title)
                     .putString("text", notificationData.text)
                     .putString("timestamp", notificationData.timestamp)
+                    .putInt("key", notificationData.key)
                     .build()
 
                 val workRequest = if (delay > 0) {
@@ -105,7 +106,8 @@ class NotificationWorker(
                 appName = inputData.getString("appName") ?: "",
                 title = inputData.getString("title") ?: "",
                 text = inputData.getString("text") ?: "",
-                timestamp = inputData.getString("timestamp") ?: ""
+                timestamp = inputData.getString("timestamp") ?: "",
+                key = inputData.getInt("key", 0)
             )
 
             Log.d(TAG, "Processing notification: ${notificationData.appName} - ${notificationData.title}")
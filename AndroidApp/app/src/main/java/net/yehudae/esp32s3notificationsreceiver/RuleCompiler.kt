@@ -0,0 +1,137 @@
+package net.yehudae.esp32s3notificationsreceiver
+
+import android.util.Log
+import java.io.ByteArrayOutputStream
+import java.util.Locale
+
+/**
+ * Compiles the notification settings into the watch's filter rules bytecode
+ * (see src/rules/rules.h in the firmware), so the watch can mute, drop and
+ * prioritize notifications by itself.
+ *
+ * Rule order matters, the first matching rule wins:
+ *  1. Priority apps are delivered as priority, even during quiet hours
+ *  2. Filter keywords drop the notification
+ *
+ * Quiet hours are not a rule, they are sent as the watch's do not disturb
+ * schedule.
+ */
+class RuleCompiler(private val appLabel: (String) -> String) {
+
+    companion object {
+        private const val TAG = "RuleCompiler"
+
+        private const val MAGIC_0 = 'Z'.code
+        private const val MAGIC_1 = 'R'.code
+        private const val VERSION = 1
+
+        private const val MAX_STRINGS = 96
+        private const val MAX_RULES = 64
+        private const val MAX_STRING_BYTES = 255
+
+        // Must match the app name truncation in BLEService
+        const val MAX_APP_NAME_BYTES = 20
+
+        const val OP_APP_IS = 0x01
+        const val OP_SENDER_IS = 0x02
+        const val OP_SENDER_HAS = 0x03
+        const val OP_CONTENT_HAS = 0x04
+        const val OP_CATEGORY_IS = 0x05
+        const val OP_TIME_IN = 0x06
+        const val OP_NOT = 0x80
+
+        const val ACTION_DROP = 1
+        const val ACTION_SILENT = 2
+        const val ACTION_PRIORITY = 3
+        const val ACTION_COALESCE = 4
+    }
+
+    private class Rule(val action: Int, val ops: ByteArray)
+
+    private val strings = mutableListOf<ByteArray>()
+    private val rules = mutableListOf<Rule>()
+
+    fun compile(settings: NotificationSettings): ByteArray {
+        strings.clear()
+        rules.clear()
+
+        settings.getPriorityApps().sorted().forEach { packageName ->
+            addRule(ACTION_PRIORITY, appIs(packageName))
+        }
+
+        settings.getFilterKeywords().sorted().forEach { keyword ->
+            if (keyword.isNotBlank()) {
+                addRule(ACTION_DROP, contentHas(keyword))
+            }
+        }
+
+        return encode()
+    }
+
+    private fun addRule(action: Int, ops: ByteArray) {
+        if (rules.size >= MAX_RULES) {
+            Log.w(TAG, "Rule limit reached, skipping rule")
+            return
+        }
+        rules.add(Rule(action, ops))
+    }
+
+    private fun appIs(packageName: String): ByteArray {
+        val label = truncateUtf8(appLabel(packageName), MAX_APP_NAME_BYTES)
+        return byteArrayOf(OP_APP_IS.toByte(), internString(label).toByte())
+    }
+
+    private fun contentHas(keyword: String): ByteArray {
+        return byteArrayOf(OP_CONTENT_HAS.toByte(), internString(keyword.trim()).toByte())
+    }
+
+    private fun internString(value: String): Int {
+        val bytes = truncateUtf8(value.lowercase(Locale.ROOT), MAX_STRING_BYTES)
+            .toByteArray(Charsets.UTF_8)
+        val existing = strings.indexOfFirst { it.contentEquals(bytes) }
+        if (existing >= 0) {
+            return existing
+        }
+        if (strings.size >= MAX_STRINGS) {
+            throw IllegalStateException("Too many rule strings")
+        }
+        strings.add(bytes)
+        return strings.size - 1
+    }
+
+    private fun truncateUtf8(value: String, maxBytes: Int): String {
+        val bytes = value.toByteArray(Charsets.UTF_8)
+        return if (bytes.size <= maxBytes) value else String(bytes, 0, maxBytes, Charsets.UTF_8)
+    }
+
+    private fun encode(): ByteArray {
+        val out = ByteArrayOutputStream()
+        out.write(MAGIC_0)
+        out.write(MAGIC_1)
+        out.write(VERSION)
+        out.write(strings.size)
+        out.write(rules.size)
+        strings.forEach { bytes ->
+            out.write(bytes.size)
+            out.write(bytes)
+        }
+        rules.forEach { rule ->
+            out.write(rule.action)
+            out.write(countOps(rule.ops))
+            out.write(rule.ops)
+        }
+        Log.d(TAG, "Compiled ${rules.size} rules, ${strings.size} strings, ${out.size()} bytes")
+        return out.toByteArray()
+    }
+
+    private fun countOps(ops: ByteArray): Int {
+        var count = 0
+        var i = 0
+        while (i < ops.size) {
+            val op = ops[i].toInt() and 0xFF and OP_NOT.inv()
+            i += if (op == OP_TIME_IN) 5 else 2
+            count++
+        }
+        return count
+    }
+}
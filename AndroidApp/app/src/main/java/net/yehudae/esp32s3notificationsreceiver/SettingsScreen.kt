@@ -1,5 +1,7 @@
 package net.yehudae.esp32s3notificationsreceiver
 
+import androidx.activity.compose.rememberLauncherForActivityResult
+import androidx.activity.result.contract.ActivityResultContracts
 import androidx.compose.foundation.background
 import androidx.compose.foundation.layout.*
 import androidx.compose.foundation.lazy.LazyColumn
@@ -35,6 +37,7 @@ fun SettingsScreen(
     var connectedDeviceInfo by remember { mutableStateOf<ConnectedDeviceInfo?>(null) }
     var syncStatus by remember { mutableStateOf<SyncStatus?>(null) }
     var connectionStatus by remember { mutableStateOf("Disconnected") }
+    var firmwareUpdateStatus by remember { mutableStateOf<FirmwareUpdateStatus?>(null) }
     
     LaunchedEffect(bleService) {
         try {
@@ -76,6 +79,16 @@ fun SettingsScreen(
         }
     }
 
+    LaunchedEffect(bleService) {
+        try {
+            bleService?.firmwareUpdateStatus?.collect { status ->
+                firmwareUpdateStatus = status
+            }
+        } catch (e: Exception) {
+            e.printStackTrace()
+        }
+    }
+
     Column(
         modifier = Modifier
             .fillMaxSize()
@@ -141,6 +154,23 @@ fun SettingsScreen(
                 )
             }
 
+            // Firmware Update Card
+            item {
+                FirmwareUpdateCard(
+                    status = firmwareUpdateStatus,
+                    connectionStatus = connectionStatus,
+                    onImageSelected = { image -> bleService?.startFirmwareUpdate(image) == true }
+                )
+            }
+
+            // Watch Search Card
+            item {
+                WatchSearchCard(
+                    connectionStatus = connectionStatus,
+                    onSearch = { query -> bleService?.searchOnWatch(query) }
+                )
+            }
+
             // Statistics Card
             item {
                 StatisticsCard(
@@ -316,6 +346,173 @@ fun SyncManagementCard(
     }
 }
 
+@Composable
+fun FirmwareUpdateCard(
+    status: FirmwareUpdateStatus?,
+    connectionStatus: String,
+    onImageSelected: (ByteArray) -> Boolean
+) {
+    val context = LocalContext.current
+    var error by remember { mutableStateOf<String?>(null) }
+    val picker = rememberLauncherForActivityResult(ActivityResultContracts.OpenDocument()) { uri ->
+        uri ?: return@rememberLauncherForActivityResult
+        val image = context.contentResolver.openInputStream(uri)?.use { it.readBytes() }
+        error = if (image != null && onImageSelected(image)) null else "Not a signed firmware image"
+    }
+
+    Card(
+        modifier = Modifier.fillMaxWidth(),
+        shape = RoundedCornerShape(16.dp),
+        colors = CardDefaults.cardColors(
+            containerColor = Color.White.copy(alpha = 0.95f)
+        ),
+        elevation = CardDefaults.cardElevation(defaultElevation = 8.dp)
+    ) {
+        Column(
+            modifier = Modifier.padding(20.dp)
+        ) {
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                modifier = Modifier.padding(bottom = 16.dp)
+            ) {
+                Icon(
+                    Icons.Default.SystemUpdate,
+                    contentDescription = null,
+                    tint = Color(0xFF667eea),
+                    modifier = Modifier.size(24.dp)
+                )
+                Spacer(Modifier.width(8.dp))
+                Text(
+                    "Firmware Update",
+                    fontSize = 18.sp,
+                    fontWeight = FontWeight.Bold,
+                    color = Color(0xFF333333)
+                )
+            }
+
+            if (status != null) {
+                LinearProgressIndicator(
+                    progress = { if (status.size > 0) status.offset.toFloat() / status.size else 0f },
+                    modifier = Modifier.fillMaxWidth(),
+                    color = Color(0xFF4CAF50)
+                )
+                Spacer(modifier = Modifier.height(8.dp))
+                Text(
+                    text = "${status.message}: ${status.offset / 1024}/${status.size / 1024} KB",
+                    fontSize = 14.sp,
+                    color = Color(0xFF666666)
+                )
+                Text(
+                    text = String.format(Locale.US, "%.1f KB/s, resumed %d times",
+                        status.kbPerSecond, status.resumes),
+                    fontSize = 12.sp,
+                    color = Color(0xFF888888)
+                )
+                Spacer(modifier = Modifier.height(16.dp))
+            }
+
+            error?.let {
+                Text(text = it, fontSize = 12.sp, color = Color(0xFFF44336))
+                Spacer(modifier = Modifier.height(8.dp))
+            }
+
+            Button(
+                onClick = { picker.launch(arrayOf("application/octet-stream", "*/*")) },
+                enabled = connectionStatus == "Ready" && status?.active != true,
+                colors = ButtonDefaults.buttonColors(
+                    containerColor = Color(0xFF667eea)
+                ),
+                shape = RoundedCornerShape(12.dp)
+            ) {
+                Icon(
+                    Icons.Default.SystemUpdate,
+                    contentDescription = null,
+                    modifier = Modifier.size(16.dp)
+                )
+                Spacer(Modifier.width(8.dp))
+                Text("Choose Image")
+            }
+            Spacer(modifier = Modifier.height(4.dp))
+            Text(
+                text = "Signed zephyr.signed.bin, the upload continues after a disconnect",
+                fontSize = 12.sp,
+                color = Color(0xFF666666)
+            )
+        }
+    }
+}
+
+@Composable
+fun WatchSearchCard(
+    connectionStatus: String,
+    onSearch: (String) -> Unit
+) {
+    var query by remember { mutableStateOf("") }
+
+    Card(
+        modifier = Modifier.fillMaxWidth(),
+        shape = RoundedCornerShape(16.dp),
+        colors = CardDefaults.cardColors(
+            containerColor = Color.White.copy(alpha = 0.95f)
+        ),
+        elevation = CardDefaults.cardElevation(defaultElevation = 8.dp)
+    ) {
+        Column(
+            modifier = Modifier.padding(20.dp)
+        ) {
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                modifier = Modifier.padding(bottom = 16.dp)
+            ) {
+                Icon(
+                    Icons.Default.Search,
+                    contentDescription = null,
+                    tint = Color(0xFF667eea),
+                    modifier = Modifier.size(24.dp)
+                )
+                Spacer(Modifier.width(8.dp))
+                Text(
+                    "Search Watch",
+                    fontSize = 18.sp,
+                    fontWeight = FontWeight.Bold,
+                    color = Color(0xFF333333)
+                )
+            }
+
+            OutlinedTextField(
+                value = query,
+                onValueChange = { query = it },
+                modifier = Modifier.fillMaxWidth(),
+                singleLine = true,
+                placeholder = { Text("Words or their beginnings") }
+            )
+            Spacer(modifier = Modifier.height(8.dp))
+            Button(
+                onClick = { onSearch(query) },
+                enabled = connectionStatus == "Ready" && query.isNotBlank(),
+                colors = ButtonDefaults.buttonColors(
+                    containerColor = Color(0xFF667eea)
+                ),
+                shape = RoundedCornerShape(12.dp)
+            ) {
+                Icon(
+                    Icons.Default.Search,
+                    contentDescription = null,
+                    modifier = Modifier.size(16.dp)
+                )
+                Spacer(Modifier.width(8.dp))
+                Text("Search")
+            }
+            Spacer(modifier = Modifier.height(4.dp))
+            Text(
+                text = "Matches are listed on the watch, tap one to open it",
+                fontSize = 12.sp,
+                color = Color(0xFF666666)
+            )
+        }
+    }
+}
+
 @Composable
 fun StatisticsCard(
     notifications: List<NotificationData>,
@@ -0,0 +1,137 @@
+/**
+ * @file main.c
+ * @brief Protocol Fuzzer for the Notification Ingest Path
+ *
+ * Everything the phone writes is radio input anyone nearby can forge. This
+ * native_sim application feeds libFuzzer's inputs into the receive lanes
+ * and fair scheduler that GATT writes are queued in on the watch (see
+ * rx_lanes.h), then through protocol_handle_packet() with rules,
+ * de-duplication, icons, clock and do not disturb, and into the
+ * notification store and its LVGL screen, rendered on a dummy panel. The
+ * radio and the rest of bluetooth.c are not part of it. ASan and UBSan turn
+ * any memory or undefined behavior error into a crash with the input that
+ * caused it.
+ *
+ * The main loop pass is the one replay/ uses (see sim/ingest.h). An input
+ * is a sequence of packet records, the way they would arrive over the air
+ * from up to BLUETOOTH_MAX_PEERS phones:
+ *
+ *   [ctl] [len u16] packet[len]
+ *
+ *   ctl bits 0-1  Connection the packet arrives on, modulo the peers
+ *   ctl bit 5     Icon packet: replace its id with the CRC32 of the icon,
+ *                 so mutations get past the check and reach the decoder
+ *   ctl bit 6     The user touches the screen after the packet is queued
+ *   ctl bit 7     Run a main loop pass after the packet is queued
+ *
+ * A short last record is cut to the bytes left, and a main loop pass always
+ * ends the input. Lanes that fill up reject packets as the GATT write would.
+ * Every module the packets reach is reset before each input (see
+ * ingest_reset()), so a crash reproduces from its input alone, up to the
+ * time of day: the clock runs on from the build time with the uptime.
+ *
+ * tools/fuzz_corpus generates the seed corpus in fuzz/corpus, sessions
+ * encoded like the Android app's createNotificationPacket() and friends.
+ *
+ * Build with clang for 64-bit native_sim and run from the repository root:
+ *
+ *   west build -b native_sim/native/64 fuzz -- -DZEPHYR_TOOLCHAIN_VARIANT=llvm
+ *   mkdir -p build/corpus && ./build/zephyr/zephyr.exe build/corpus fuzz/corpus
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/irq.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/protocol.h"
+#include "display/display_power.h"
+#include "ingest.h"
+
+/** @brief Record header: control byte and packet length */
+#define FUZZ_RECORD_HEADER_LEN 3
+
+/** @brief Record control bits */
+#define FUZZ_CTL_PEER_MASK 0x03
+#define FUZZ_CTL_FIX_ICON_ID BIT(5)
+#define FUZZ_CTL_TOUCH BIT(6)
+#define FUZZ_CTL_PROCESS BIT(7)
+
+/* Fuzz data from libFuzzer, delivered with CONFIG_ARCH_POSIX_FUZZ_IRQ */
+extern const uint8_t* posix_fuzz_buf;
+extern size_t posix_fuzz_sz;
+
+static K_SEM_DEFINE(fuzz_sem, 0, 1);
+
+static void fuzz_isr(const void* arg)
+{
+    ARG_UNUSED(arg);
+
+    /* Run the input on the main thread, as packets are on the watch */
+    k_sem_give(&fuzz_sem);
+}
+
+static void receive(uint8_t ctl, const uint8_t* data, size_t len)
+{
+    static uint8_t packet[BLUETOOTH_MAX_PACKET_LEN];
+    uint8_t source = (ctl & FUZZ_CTL_PEER_MASK) % BLUETOOTH_MAX_PEERS;
+
+    if (len == 0 || len > sizeof(packet)) {
+        return;
+    }
+    memcpy(packet, data, len);
+
+    if ((ctl & FUZZ_CTL_FIX_ICON_ID) && packet[0] == CMD_SET_ICON
+        && len > PROTOCOL_ICON_HEADER_LEN) {
+        uint32_t id = crc32_ieee(&packet[PROTOCOL_ICON_HEADER_LEN],
+            len - PROTOCOL_ICON_HEADER_LEN);
+
+        sys_put_le32(id, &packet[1]);
+    }
+
+    ingest_receive(source, packet, len);
+}
+
+static void run_input(const uint8_t* buf, size_t size)
+{
+    size_t pos = 0;
+
+    ingest_reset();
+
+    while (size - pos >= FUZZ_RECORD_HEADER_LEN) {
+        uint8_t ctl = buf[pos];
+        size_t len = MIN(sys_get_le16(&buf[pos + 1]), size - pos - FUZZ_RECORD_HEADER_LEN);
+
+        pos += FUZZ_RECORD_HEADER_LEN;
+        receive(ctl, &buf[pos], len);
+        pos += len;
+
+        if (ctl & FUZZ_CTL_TOUCH) {
+            display_power_user_activity();
+        }
+        if (ctl & FUZZ_CTL_PROCESS) {
+            ingest_process();
+        }
+    }
+
+    ingest_process();
+}
+
+int main(void)
+{
+    ingest_init();
+
+    IRQ_CONNECT(CONFIG_ARCH_POSIX_FUZZ_IRQ, 0, fuzz_isr, NULL, 0);
+    irq_enable(CONFIG_ARCH_POSIX_FUZZ_IRQ);
+
+    while (true) {
+        k_sem_take(&fuzz_sem, K_FOREVER);
+        run_input(posix_fuzz_buf, posix_fuzz_sz);
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file main.c
+ * @brief Traffic Replay Benchmark
+ *
+ * Feeds a trace recorded on the watch (see bluetooth/recorder.h) through
+ * the firmware's ingest path on native_sim (see sim/ingest.h). Packets
+ * arrive at their recorded times, divided by the speed factor, and the
+ * main loop runs as on the watch: every INGEST_LOOP_PERIOD_MS, and right
+ * away for priority packets. Simulated time does not depend on the host,
+ * so a trace gives the same report on every run:
+ *
+ * - Ingest latency: receipt to handling percentiles, and the packets the
+ *   lanes pushed back
+ * - Redraws: frames rendered, and main loop passes
+ * - Store: notifications added, coalesced and evicted, and the peak count
+ * - Peak memory: packet bytes queued at once, and the main stack used
+ *
+ * The trace is built in. Save the output of 'recorder dump' on the watch,
+ * lines not starting with "t " are ignored so a console log works as is,
+ * and build and run from the repository root:
+ *
+ *   west build -b native_sim replay -- -DTRACE=$PWD/my_trace.txt
+ *   ./build/zephyr/zephyr.exe -speed=4
+ *
+ * replay/traces/storm.txt is a synthetic trace from tools/trace_gen, the
+ * default.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#include <cmdline.h>
+#include <posix_board_if.h>
+#include <posix_native_task.h>
+
+#include "bluetooth/bluetooth.h"
+#include "ingest.h"
+#include "notifications/notifications.h"
+
+/**
+ * @brief Packet read from the trace
+ */
+struct record {
+    uint32_t delta_us;
+    uint8_t source;
+    uint16_t len;
+    uint8_t data[BLUETOOTH_MAX_PACKET_LEN];
+};
+
+static const uint8_t trace[] = {
+#include "trace.inc"
+};
+
+static uint32_t speed = 1;
+static size_t trace_pos;
+static uint32_t malformed;
+
+static void add_options(void)
+{
+    static struct args_struct_t options[] = {
+        { .option = "speed",
+            .name = "factor",
+            .type = 'u',
+            .dest = (void*)&speed,
+            .descript = "Replay the trace this many times faster than recorded (default 1)" },
+        ARG_TABLE_ENDMARKER,
+    };
+
+    native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(add_options, PRE_BOOT_1, 1);
+
+static int64_t now_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static bool at_end_of_line(size_t pos)
+{
+    return pos >= sizeof(trace) || trace[pos] == '\n' || trace[pos] == '\r';
+}
+
+static void skip_spaces(size_t* pos)
+{
+    while (*pos < sizeof(trace) && (trace[*pos] == ' ' || trace[*pos] == '\t')) {
+        (*pos)++;
+    }
+}
+
+static bool parse_uint(size_t* pos, uint32_t* value)
+{
+    size_t start;
+
+    skip_spaces(pos);
+    start = *pos;
+    *value = 0;
+    while (*pos < sizeof(trace) && trace[*pos] >= '0' && trace[*pos] <= '9') {
+        *value = *value * 10 + (trace[*pos] - '0');
+        (*pos)++;
+    }
+    return *pos > start;
+}
+
+static int hex_digit(uint8_t c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse a "t <delta us> <source> <packet hex>" line
+ */
+static bool parse_record(size_t pos, struct record* rec)
+{
+    uint32_t source;
+    int hi;
+    int lo;
+
+    if (!parse_uint(&pos, &rec->delta_us) || !parse_uint(&pos, &source)) {
+        return false;
+    }
+
+    skip_spaces(&pos);
+    rec->source = source % BLUETOOTH_MAX_PEERS;
+    rec->len = 0;
+    while (!at_end_of_line(pos) && rec->len < sizeof(rec->data)) {
+        if (pos + 1 >= sizeof(trace)) {
+            return false;
+        }
+        hi = hex_digit(trace[pos]);
+        lo = hex_digit(trace[pos + 1]);
+        if (hi < 0 || lo < 0) {
+            break;
+        }
+        rec->data[rec->len++] = (uint8_t)(hi << 4 | lo);
+        pos += 2;
+    }
+
+    return rec->len > 0;
+}
+
+/**
+ * @brief Read the next record from the trace
+ *
+ * @retval true A record was read
+ * @retval false End of the trace
+ */
+static bool next_record(struct record* rec)
+{
+    while (trace_pos < sizeof(trace)) {
+        size_t line = trace_pos;
+        bool found = false;
+
+        while (!at_end_of_line(trace_pos)) {
+            trace_pos++;
+        }
+        while (trace_pos < sizeof(trace) && at_end_of_line(trace_pos)) {
+            trace_pos++;
+        }
+
+        skip_spaces(&line);
+        if (line + 1 < sizeof(trace) && trace[line] == 't' && trace[line + 1] == ' ') {
+            found = parse_record(line + 1, rec);
+            if (!found) {
+                malformed++;
+            }
+        }
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void report(uint32_t records, int64_t duration_us)
+{
+    struct ingest_stats s;
+    struct notifications_stats n;
+    size_t stack_unused = 0;
+
+    ingest_get_stats(&s);
+    notifications_get_stats(&n);
+    k_thread_stack_space_get(k_current_get(), &stack_unused);
+
+    printk("trace: %u packets over %u ms at %ux, %u malformed lines\n", records,
+        (uint32_t)(duration_us / 1000), speed, malformed);
+    printk("ingest latency: p50 %u us, p95 %u us, p99 %u us, max %u us, avg %u us\n",
+        ingest_latency_percentile(50), ingest_latency_percentile(95),
+        ingest_latency_percentile(99), s.latency_max_us,
+        s.handled ? (uint32_t)(s.latency_total_us / s.handled) : 0U);
+    printk("ingest: %u handled, %u pushed back\n", s.handled, s.rejected);
+    printk("redraws: %u in %u main loop passes\n", s.redraws, s.passes);
+    printk("store: %u added, %u coalesced, %u evicted, peak %u notifications\n", n.added,
+        n.coalesced, n.evicted, n.peak_count);
+    printk("peak memory: %u bytes queued, main stack %u of %u bytes\n", s.queued_peak_bytes,
+        (uint32_t)(CONFIG_MAIN_STACK_SIZE - stack_unused), CONFIG_MAIN_STACK_SIZE);
+}
+
+int main(void)
+{
+    /* Static, too large for the stack it measures */
+    static struct record rec;
+    uint32_t records = 0;
+    bool have;
+    int64_t start_us;
+    int64_t arrival_us;
+    int64_t next_pass_us;
+    int64_t wake_us;
+    int64_t now;
+
+    if (speed == 0) {
+        speed = 1;
+    }
+
+    ingest_init();
+
+    start_us = now_us();
+    arrival_us = start_us;
+    next_pass_us = start_us;
+    have = next_record(&rec);
+
+    while (have || ingest_pending()) {
+        now = now_us();
+
+        while (have && arrival_us <= now) {
+            /* Priority packets cut the main loop's sleep short */
+            if (ingest_receive(rec.source, rec.data, rec.len) == 1) {
+                next_pass_us = now;
+            }
+            records++;
+            have = next_record(&rec);
+            if (have) {
+                arrival_us += rec.delta_us / speed;
+            }
+        }
+
+        if (now >= next_pass_us) {
+            ingest_process();
+            next_pass_us = now + INGEST_LOOP_PERIOD_MS * 1000;
+        }
+
+        wake_us = have ? MIN(next_pass_us, arrival_us) : next_pass_us;
+        if (wake_us > now) {
+            k_sleep(K_USEC(wake_us - now));
+        }
+    }
+
+    report(records, now_us() - start_us);
+    posix_exit(0);
+    return 0;
+}
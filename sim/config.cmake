@@ -0,0 +1,14 @@
+# Board overlay and configuration of the native_sim applications (fuzz/,
+# replay/, loadtest/). Include before find_package(Zephyr), and sim.cmake
+# after it.
+#
+# -DPIPELINE_TRACING=ON adds tracing.conf, a CTF trace of the notification
+# pipeline (see src/trace/trace.h).
+
+set(DTC_OVERLAY_FILE ${CMAKE_CURRENT_LIST_DIR}/native_sim.overlay)
+set(EXTRA_CONF_FILE ${CMAKE_CURRENT_LIST_DIR}/sim.conf)
+
+option(PIPELINE_TRACING "CTF trace of the notification pipeline" OFF)
+if(PIPELINE_TRACING)
+    list(APPEND EXTRA_CONF_FILE ${CMAKE_CURRENT_LIST_DIR}/tracing.conf)
+endif()
@@ -0,0 +1,215 @@
+/**
+ * @file ingest.c
+ * @brief Notification Ingest Path on native_sim Implementation
+ *
+ * Packets are queued and taken through the watch's lanes (rx_lanes.c); what
+ * bluetooth.c adds around them, the radio, the recorder and the wakeup of
+ * the main loop, has no part here. Connections are their slots: the
+ * simulated phones never reconnect.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+
+#include <lvgl.h>
+
+#include "ambient/ambient.h"
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/dedup.h"
+#include "bluetooth/outbox.h"
+#include "bluetooth/protocol.h"
+#include "bluetooth/rx_lanes.h"
+#include "clock/clock.h"
+#include "display/display_power.h"
+#include "dnd/dnd.h"
+#include "graphics/rle_decoder.h"
+#include "icons/icons.h"
+#include "ingest.h"
+#include "notifications/notifications.h"
+#include "rules/rules.h"
+#include "trace/trace.h"
+
+static uint32_t queued_bytes;
+
+static struct ingest_stats stats;
+static bluetooth_handled_cb_t handled_cb;
+static uint32_t latency_us[INGEST_LATENCY_SAMPLES];
+static uint32_t sorted_us[INGEST_LATENCY_SAMPLES];
+
+/* Packets are handed over right aligned, so reading past one runs into the
+ * buffer's redzone (under ASan) instead of stale bytes */
+static uint8_t handle_buf[BLUETOOTH_MAX_PACKET_LEN];
+
+int ingest_receive(uint8_t source, const uint8_t* data, size_t len)
+{
+    int ret = rx_lanes_put(source, source, data, len);
+
+    if (ret == -ENOBUFS) {
+        stats.rejected++;
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    stats.received++;
+    queued_bytes += len;
+    stats.queued_peak_bytes = MAX(stats.queued_peak_bytes, queued_bytes);
+    TRACE_POINT(RX, (uint32_t)source << 16 | len);
+    return ret;
+}
+
+int bluetooth_receive(uint8_t source, const uint8_t* data, size_t len)
+{
+    return ingest_receive(source, data, len);
+}
+
+void bluetooth_set_handled_callback(bluetooth_handled_cb_t cb)
+{
+    handled_cb = cb;
+}
+
+bool ingest_pending(void)
+{
+    return rx_lanes_pending();
+}
+
+static void handle(const struct rx_packet* packet)
+{
+    uint8_t* data = &handle_buf[sizeof(handle_buf) - packet->len];
+    uint32_t wait_us = k_cyc_to_us_floor32(k_cycle_get_32() - packet->rx_cycles);
+
+    latency_us[stats.handled % INGEST_LATENCY_SAMPLES] = wait_us;
+    stats.handled++;
+    stats.latency_total_us += wait_us;
+    stats.latency_max_us = MAX(stats.latency_max_us, wait_us);
+    queued_bytes -= packet->len;
+
+    memcpy(data, packet->data, packet->len);
+    protocol_handle_packet(packet->conn_id, data, packet->len, packet->rx_cycles);
+    if (handled_cb) {
+        handled_cb(packet->source, data, packet->len, packet->rx_cycles);
+    }
+}
+
+/**
+ * @brief Send the actions the store posted, as if the phone took them all
+ */
+static void send_actions(void)
+{
+    struct outbox_entry entry;
+    uint8_t buf[PROTOCOL_ACTION_HEADER_LEN + OUTBOX_MAX_REPLY_LEN];
+
+    while (outbox_peek(&entry)) {
+        outbox_encode(&entry, buf, sizeof(buf));
+        outbox_sent(entry.seq);
+    }
+}
+
+void ingest_process(void)
+{
+    static struct rx_packet packet;
+    bool priority;
+
+    while (rx_lanes_take(&packet, &priority)) {
+        handle(&packet);
+    }
+
+    send_actions();
+    notifications_handle_timers();
+    icons_process();
+    display_power_process();
+    clock_process();
+    ambient_process();
+    lv_timer_handler();
+    stats.passes++;
+}
+
+void ingest_reset(void)
+{
+    rx_lanes_init();
+    queued_bytes = 0;
+
+    /* Wake the display first, so clearing the store is not deferred */
+    display_power_reset();
+    ambient_reset();
+    outbox_reset();
+    notifications_clear_all();
+    dedup_reset();
+    icons_reset();
+    clock_reset();
+    rules_reset();
+    dnd_set_manual(false);
+    dnd_set_schedule(false, 0, 0);
+
+    memset(&stats, 0, sizeof(stats));
+}
+
+void ingest_get_stats(struct ingest_stats* out)
+{
+    *out = stats;
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+uint32_t ingest_latency_percentile(unsigned int percent)
+{
+    size_t n = MIN(stats.handled, INGEST_LATENCY_SAMPLES);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    memcpy(sorted_us, latency_us, n * sizeof(sorted_us[0]));
+    qsort(sorted_us, n, sizeof(sorted_us[0]), compare_u32);
+    return sorted_us[MIN(n - 1, n * MIN(percent, 100U) / 100U)];
+}
+
+static void on_render_ready(lv_event_t* e)
+{
+    ARG_UNUSED(e);
+    stats.redraws++;
+}
+
+/**
+ * @brief Switch between the notification screen and the ambient face
+ *
+ * As on the watch (see main.c), without the Bluetooth side.
+ */
+static void on_display_state_changed(display_power_state_t prev, display_power_state_t next)
+{
+    if (next == DISPLAY_STATE_AMBIENT) {
+        ambient_show();
+    } else if (prev == DISPLAY_STATE_AMBIENT) {
+        ambient_hide();
+    }
+
+    if (next == DISPLAY_STATE_ACTIVE || next == DISPLAY_STATE_WAKE_ON_NOTIFICATION) {
+        notifications_refresh_deferred();
+    }
+}
+
+void ingest_init(void)
+{
+    /* LVGL and the dummy panel are set up by Zephyr's LVGL module */
+    display_power_init();
+    rle_decoder_init();
+    create_notification_screen();
+    display_power_set_state_callback(on_display_state_changed);
+    settings_subsys_init();
+    trace_init();
+
+    lv_display_add_event_cb(lv_display_get_default(), on_render_ready, LV_EVENT_RENDER_READY,
+        NULL);
+    ingest_reset();
+}
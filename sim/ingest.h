@@ -0,0 +1,112 @@
+/**
+ * @file ingest.h
+ * @brief Notification Ingest Path on native_sim
+ *
+ * Stands in for the receive side of bluetooth.c and for the main loop in
+ * the native_sim applications (fuzz/, replay/, loadtest/). Packets are
+ * queued in the watch's priority and per-connection lanes (rx_lanes.h), and
+ * every main loop pass drains them into protocol_handle_packet(), sends the
+ * posted actions, runs the store's timers, icons, display power and clock,
+ * and renders a frame.
+ *
+ * The simulated CPU is infinitely fast: handling takes no simulated time,
+ * so latencies are the time packets wait for a main loop pass.
+ *
+ * bluetooth_receive() and the handled callback of bluetooth.h are served
+ * from here as well, for the load generator (see loadtest/).
+ *
+ * Main thread only, or timer expiry functions: on native_sim they only run
+ * while the main thread sleeps.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Main loop period without priority packets, as in main.c */
+#define INGEST_LOOP_PERIOD_MS 100
+
+/** @brief Latencies kept for percentiles, the oldest are overwritten */
+#define INGEST_LATENCY_SAMPLES 8192
+
+/**
+ * @brief Ingest statistics since ingest_reset()
+ */
+struct ingest_stats {
+    uint32_t received; /**< Packets queued */
+    uint32_t rejected; /**< Packets pushed back by a full lane */
+    uint32_t handled; /**< Packets handed to the protocol parser */
+    uint32_t passes; /**< Main loop passes */
+    uint32_t redraws; /**< Frames rendered */
+    uint32_t queued_peak_bytes; /**< Most packet bytes waiting at once */
+    uint32_t latency_max_us; /**< Worst receipt to handling time */
+    uint64_t latency_total_us;
+};
+
+/**
+ * @brief Set up the modules as main.c does, with LVGL already running
+ */
+void ingest_init(void);
+
+/**
+ * @brief Bring the modules back to their state after ingest_init()
+ *
+ * Empties the lanes, the outbox, the store, de-duplication and the icon
+ * cache, removes rules and do not disturb, forgets the time set, wakes the
+ * display with the default settings and clears the statistics. The kernel
+ * uptime keeps running, and with it the clock.
+ */
+void ingest_reset(void);
+
+/**
+ * @brief Queue a packet written by a phone
+ *
+ * @param source Connection it arrives on, below BLUETOOTH_MAX_PEERS
+ * @param data Packet bytes
+ * @param len Packet length
+ * @retval 0 Queued on the connection's lane
+ * @retval 1 Queued on the priority lane, the main loop wakes up for it
+ * @retval -EINVAL Empty or too long
+ * @retval -ENOBUFS Lane full, pushed back
+ */
+int ingest_receive(uint8_t source, const uint8_t* data, size_t len);
+
+/**
+ * @brief Check if packets are waiting for a main loop pass
+ */
+bool ingest_pending(void);
+
+/**
+ * @brief Run one main loop pass
+ */
+void ingest_process(void);
+
+/**
+ * @brief Get ingest statistics
+ *
+ * @param stats Output for the statistics
+ */
+void ingest_get_stats(struct ingest_stats* stats);
+
+/**
+ * @brief Get a percentile of the receipt to handling latency
+ *
+ * @param percent 0 to 100
+ * @return Latency in microseconds, 0 without samples
+ */
+uint32_t ingest_latency_percentile(unsigned int percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INGEST_H */
@@ -0,0 +1,14 @@
+# Firmware sources for the native_sim applications, include after
+# find_package(Zephyr) and config.cmake before it.
+
+set(sim_dir ${CMAKE_CURRENT_LIST_DIR})
+set(app_dir ${sim_dir}/..)
+
+# Everything but the radio, panel and boot front ends, which stubs.c and
+# ingest.c stand in for
+file(GLOB_RECURSE sim_app_sources ${app_dir}/src/*.c)
+list(FILTER sim_app_sources EXCLUDE REGEX
+    "/src/(main|bluetooth/bluetooth|display/display|display/display_te|graphics/graphics|watchdog/watchdog|dfu/dfu)\\.c$")
+
+target_sources(app PRIVATE ${sim_app_sources} ${sim_dir}/ingest.c ${sim_dir}/stubs.c)
+target_include_directories(app PRIVATE ${app_dir}/src ${sim_dir})
@@ -0,0 +1,95 @@
+/**
+ * @file stubs.c
+ * @brief Front Ends Replaced on native_sim
+ *
+ * The panel, backlight and LVGL thread (display.c, graphics.c) and the
+ * Bluetooth stack (bluetooth.c) are not built for native_sim. These stand
+ * in for the parts of them the ingest path calls: the panel only keeps its
+ * sleep state, frames are rendered on every main loop pass (see ingest.h),
+ * and actions go through the real outbox, drained by the main loop pass.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/outbox.h"
+#include "display/display.h"
+#include "graphics/graphics.h"
+
+static bool panel_sleeping = false;
+
+int change_brightness(uint8_t perc)
+{
+    ARG_UNUSED(perc);
+    return 0;
+}
+
+int turn_off_backlight(void)
+{
+    return 0;
+}
+
+int set_display_blanking(bool blank)
+{
+    ARG_UNUSED(blank);
+    return 0;
+}
+
+int set_display_sleep(bool sleep)
+{
+    panel_sleeping = sleep;
+    return 0;
+}
+
+bool is_display_sleeping(void)
+{
+    return panel_sleeping;
+}
+
+uint32_t get_display_wake_latency_us(void)
+{
+    return 0;
+}
+
+void get_lvgl_flush_stats(struct lvgl_flush_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void lvgl_request_refresh(void)
+{
+}
+
+void lvgl_arm_frame_probe(uint32_t start_cycles)
+{
+    ARG_UNUSED(start_cycles);
+}
+
+void lvgl_cancel_frame_probe(void)
+{
+}
+
+void lvgl_arm_glass_probe(uint32_t start_cycles, const lv_area_t* area)
+{
+    ARG_UNUSED(start_cycles);
+    ARG_UNUSED(area);
+}
+
+bool lvgl_take_frame_probe(uint32_t* latency_us)
+{
+    ARG_UNUSED(latency_us);
+    return false;
+}
+
+int bluetooth_send_action(uint8_t action, uint32_t key, const char* reply)
+{
+    return outbox_post(action, key, reply);
+}
+
+void bluetooth_action_acked(uint8_t seq, uint8_t status)
+{
+    outbox_ack(seq, status);
+}
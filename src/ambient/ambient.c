@@ -0,0 +1,271 @@
+/**
+ * @file ambient.c
+ * @brief Always-On Ambient Clock Face Implementation
+ *
+ * The face is a single small, fixed-size box in the middle of a black screen
+ * holding the time and the unread count. Both labels have fixed sizes, so a
+ * minute change invalidates only their own rectangles and LVGL flushes a few
+ * hundred pixels instead of the whole panel. Nothing else on the screen ever
+ * changes, so between minutes no frame is rendered at all.
+ *
+ * Each redraw's cost is read back from the LVGL flush statistics, which
+ * gives the pixels and panel write time per update and, together with the
+ * time spent shown, the write duty cycle for current budgeting.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "ambient/ambient.h"
+#include "clock/clock.h"
+#include "display/display_power.h"
+#include "graphics/graphics.h"
+#include "notifications/notifications.h"
+
+LOG_MODULE_REGISTER(ambient, LOG_LEVEL_INF);
+
+/** @brief Size of the redraw region holding clock and badge */
+#define AMBIENT_BOX_WIDTH 80
+#define AMBIENT_BOX_HEIGHT 44
+
+/** @brief Dim gray keeps the lit pixel count and perceived glare low */
+#define AMBIENT_TEXT_COLOR 0x808080
+#define AMBIENT_BADGE_COLOR 0xB06000
+
+static lv_obj_t* ambient_screen;
+static lv_obj_t* ambient_time_label;
+static lv_obj_t* ambient_badge_label;
+
+/** @brief Screen to restore when leaving ambient mode */
+static lv_obj_t* previous_screen;
+
+static bool shown = false;
+static int64_t shown_since_ms;
+
+/** @brief Last rendered values, to skip redundant redraws */
+static uint32_t rendered_minute = UINT32_MAX;
+static int rendered_unread = -1;
+
+/** @brief Flush statistics taken right before the last redraw */
+static struct lvgl_flush_stats update_baseline;
+static bool update_pending = false;
+
+static struct ambient_stats stats;
+
+/**
+ * @brief Wake the display on any touch of the ambient face
+ */
+static void ambient_event_handler(lv_event_t* e)
+{
+    if (lv_event_get_code(e) == LV_EVENT_PRESSED) {
+        display_power_user_activity();
+    }
+}
+
+/**
+ * @brief Create the ambient screen objects
+ */
+static void create_ambient_screen(void)
+{
+    lv_obj_t* box;
+
+    ambient_screen = lv_obj_create(NULL);
+    lv_obj_set_style_bg_color(ambient_screen, lv_color_hex(0x000000), 0);
+    lv_obj_add_event_cb(ambient_screen, ambient_event_handler, LV_EVENT_ALL, NULL);
+
+    box = lv_obj_create(ambient_screen);
+    lv_obj_set_size(box, AMBIENT_BOX_WIDTH, AMBIENT_BOX_HEIGHT);
+    lv_obj_align(box, LV_ALIGN_CENTER, 0, 0);
+    lv_obj_set_style_bg_opa(box, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_opa(box, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_pad_all(box, 0, 0);
+    lv_obj_clear_flag(box, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(box, ambient_event_handler, LV_EVENT_ALL, NULL);
+
+    /* Fixed sizes keep every redraw inside the same small rectangles */
+    ambient_time_label = lv_label_create(box);
+    lv_obj_set_size(ambient_time_label, AMBIENT_BOX_WIDTH, 24);
+    lv_label_set_long_mode(ambient_time_label, LV_LABEL_LONG_CLIP);
+    lv_obj_align(ambient_time_label, LV_ALIGN_TOP_MID, 0, 0);
+    lv_obj_set_style_text_align(ambient_time_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_style_text_font(ambient_time_label, &lv_font_montserrat_18, 0);
+    lv_obj_set_style_text_color(ambient_time_label, lv_color_hex(AMBIENT_TEXT_COLOR), 0);
+
+    ambient_badge_label = lv_label_create(box);
+    lv_obj_set_size(ambient_badge_label, AMBIENT_BOX_WIDTH, 16);
+    lv_label_set_long_mode(ambient_badge_label, LV_LABEL_LONG_CLIP);
+    lv_obj_align(ambient_badge_label, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_text_align(ambient_badge_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_style_text_font(ambient_badge_label, &lv_font_montserrat_12, 0);
+    lv_obj_set_style_text_color(ambient_badge_label, lv_color_hex(AMBIENT_BADGE_COLOR), 0);
+}
+
+/**
+ * @brief Update labels whose value changed since the last redraw
+ *
+ * @param force Redraw even if nothing changed
+ */
+static void update_ambient_face(bool force)
+{
+    uint32_t minute = clock_get_minute_stamp();
+    int unread = notifications_get_unread_count();
+
+    if (!force && minute == rendered_minute && unread == rendered_unread) {
+        return;
+    }
+
+    /* Snapshot flush counters so the redraw's cost can be read back */
+    get_lvgl_flush_stats(&update_baseline);
+    update_pending = true;
+
+    if (force || minute != rendered_minute) {
+        char time_str[CLOCK_HHMM_STR_LEN];
+
+        clock_format_hhmm(time_str, sizeof(time_str));
+        lv_label_set_text(ambient_time_label, time_str);
+        rendered_minute = minute;
+    }
+
+    if (force || unread != rendered_unread) {
+        if (unread > 0) {
+            lv_label_set_text_fmt(ambient_badge_label, "%d unread", unread);
+        } else {
+            lv_label_set_text(ambient_badge_label, "");
+        }
+        rendered_unread = unread;
+    }
+}
+
+/**
+ * @brief Record the cost of the last redraw once LVGL has flushed it
+ */
+static void collect_update_cost(void)
+{
+    struct lvgl_flush_stats now;
+
+    get_lvgl_flush_stats(&now);
+    if (now.frames == update_baseline.frames) {
+        return; /* Not rendered yet */
+    }
+
+    stats.updates++;
+    stats.last_update_pixels = (uint32_t)(now.pixels - update_baseline.pixels);
+    stats.last_update_us = (uint32_t)(now.flush_us - update_baseline.flush_us);
+    stats.total_update_pixels += stats.last_update_pixels;
+    stats.total_update_us += stats.last_update_us;
+    update_pending = false;
+
+    LOG_DBG("Ambient update: %u px in %u us", stats.last_update_pixels, stats.last_update_us);
+}
+
+void ambient_show(void)
+{
+    if (shown) {
+        return;
+    }
+
+    if (!ambient_screen) {
+        create_ambient_screen();
+    }
+
+    previous_screen = lv_screen_active();
+    update_ambient_face(true);
+    /* Screen load repaints everything once, which is not a per-minute cost */
+    update_pending = false;
+    lv_screen_load(ambient_screen);
+
+    shown = true;
+    shown_since_ms = k_uptime_get();
+    LOG_DBG("Ambient face shown");
+}
+
+void ambient_hide(void)
+{
+    if (!shown) {
+        return;
+    }
+
+    if (previous_screen) {
+        lv_screen_load(previous_screen);
+    }
+
+    stats.shown_ms += k_uptime_get() - shown_since_ms;
+    shown = false;
+    update_pending = false;
+    LOG_DBG("Ambient face hidden");
+}
+
+bool ambient_is_shown(void)
+{
+    return shown;
+}
+
+void ambient_process(void)
+{
+    if (!shown) {
+        return;
+    }
+
+    if (update_pending) {
+        collect_update_cost();
+    }
+
+    update_ambient_face(false);
+}
+
+void ambient_get_stats(struct ambient_stats* out)
+{
+    if (!out) {
+        return;
+    }
+
+    *out = stats;
+    if (shown) {
+        out->shown_ms += k_uptime_get() - shown_since_ms;
+    }
+}
+
+void ambient_reset(void)
+{
+    ambient_hide();
+    rendered_minute = UINT32_MAX;
+    rendered_unread = -1;
+    memset(&stats, 0, sizeof(stats));
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_ambient_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct ambient_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    ambient_get_stats(&s);
+    shell_print(sh, "shown: %s, total %llu ms, updates: %u", shown ? "yes" : "no",
+        (unsigned long long)s.shown_ms, s.updates);
+    shell_print(sh, "last update: %u px, %u us", s.last_update_pixels, s.last_update_us);
+    if (s.updates > 0) {
+        shell_print(sh, "avg update: %u px, %u us",
+            (uint32_t)(s.total_update_pixels / s.updates), (uint32_t)(s.total_update_us / s.updates));
+    }
+    /* Share of ambient time the panel bus is busy, for the current budget */
+    shell_print(sh, "panel write duty: %u ppm",
+        s.shown_ms ? (uint32_t)((s.total_update_us * 1000U) / s.shown_ms) : 0U);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ambient_cmds,
+    SHELL_CMD(stats, NULL, "Show ambient frame cost", cmd_ambient_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(ambient, &ambient_cmds, "Always-on ambient face", NULL);
+#endif /* CONFIG_SHELL */
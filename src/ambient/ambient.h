@@ -0,0 +1,74 @@
+/**
+ * @file ambient.h
+ * @brief Always-On Ambient Clock Face Header
+ *
+ * Low-power screen shown instead of turning the display off: a small clock
+ * and an unread badge under a very dim backlight, redrawn once per minute.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef AMBIENT_H
+#define AMBIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ambient mode frame cost statistics
+ */
+struct ambient_stats {
+    uint32_t updates; /**< Per-minute redraws */
+    uint32_t last_update_pixels; /**< Pixels flushed by the last redraw */
+    uint32_t last_update_us; /**< Panel write time of the last redraw */
+    uint64_t total_update_pixels; /**< Pixels flushed by all redraws */
+    uint64_t total_update_us; /**< Panel write time of all redraws */
+    uint64_t shown_ms; /**< Total time the ambient face was shown */
+};
+
+/**
+ * @brief Show the ambient clock face
+ *
+ * Replaces the active LVGL screen. The face is created on first use.
+ */
+void ambient_show(void);
+
+/**
+ * @brief Hide the ambient clock face and restore the previous screen
+ */
+void ambient_hide(void);
+
+/**
+ * @brief Check if the ambient face is shown
+ *
+ * @retval true Ambient face is the active screen
+ * @retval false Ambient face is hidden
+ */
+bool ambient_is_shown(void);
+
+/**
+ * @brief Redraw the clock and badge when they change (call in main loop)
+ */
+void ambient_process(void);
+
+/**
+ * @brief Get ambient mode frame cost statistics
+ *
+ * @param stats Output for the statistics
+ */
+void ambient_get_stats(struct ambient_stats* stats);
+
+/**
+ * @brief Hide the ambient face and clear the statistics
+ */
+void ambient_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AMBIENT_H */
@@ -0,0 +1,131 @@
+/**
+ * @file adv_sched.c
+ * @brief Power-Aware Advertising Scheduler Implementation
+ *
+ * The interval is a pure function of the time since the burst started:
+ * ADV_SCHED_FAST_INTERVAL_MS for ADV_SCHED_FAST_MS, then doubled every
+ * ADV_SCHED_STEP_MS and capped at ADV_SCHED_SLOW_INTERVAL_MS.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+
+#include "bluetooth/adv_sched.h"
+
+void adv_sched_init(struct adv_sched* s, uint32_t now_ms)
+{
+    memset(s, 0, sizeof(*s));
+    adv_sched_reset(s, now_ms);
+}
+
+void adv_sched_reset(struct adv_sched* s, uint32_t now_ms)
+{
+    s->burst_ms = now_ms;
+    s->lost_ms = now_ms;
+    s->measuring = true;
+}
+
+void adv_sched_activity(struct adv_sched* s, uint32_t now_ms)
+{
+    s->burst_ms = now_ms;
+}
+
+uint32_t adv_sched_interval(const struct adv_sched* s, uint32_t now_ms)
+{
+    uint32_t elapsed = now_ms - s->burst_ms;
+    uint32_t interval = ADV_SCHED_FAST_INTERVAL_MS;
+
+    if (elapsed < ADV_SCHED_FAST_MS) {
+        return interval;
+    }
+
+    for (uint32_t steps = (elapsed - ADV_SCHED_FAST_MS) / ADV_SCHED_STEP_MS + 1; steps > 0;
+         steps--) {
+        interval *= 2;
+        if (interval >= ADV_SCHED_SLOW_INTERVAL_MS) {
+            return ADV_SCHED_SLOW_INTERVAL_MS;
+        }
+    }
+    return interval;
+}
+
+enum adv_sched_phase adv_sched_phase_of(uint32_t interval_ms)
+{
+    if (interval_ms <= ADV_SCHED_FAST_INTERVAL_MS) {
+        return ADV_SCHED_FAST;
+    }
+    return interval_ms >= ADV_SCHED_SLOW_INTERVAL_MS ? ADV_SCHED_SLOW : ADV_SCHED_BACKOFF;
+}
+
+/**
+ * @brief Account the time advertised at the current interval up to now
+ */
+static void account(struct adv_sched* s, uint32_t now_ms)
+{
+    struct adv_sched_phase_stats* phase;
+    uint32_t period = s->interval_ms + ADV_SCHED_ADV_DELAY_MS;
+    uint32_t elapsed;
+
+    if (!s->running) {
+        return;
+    }
+
+    elapsed = now_ms - s->account_ms;
+    phase = &s->phases[adv_sched_phase_of(s->interval_ms)];
+    phase->time_ms += elapsed;
+
+    s->carry_ms += elapsed;
+    phase->events += s->carry_ms / period;
+    s->carry_ms %= period;
+    s->account_ms = now_ms;
+}
+
+void adv_sched_started(struct adv_sched* s, uint32_t interval_ms, uint32_t now_ms)
+{
+    account(s, now_ms);
+    s->running = true;
+    s->interval_ms = interval_ms;
+    s->account_ms = now_ms;
+    s->carry_ms = 0;
+
+    /* One event is sent right away */
+    s->phases[adv_sched_phase_of(interval_ms)].events++;
+}
+
+void adv_sched_stopped(struct adv_sched* s, uint32_t now_ms)
+{
+    account(s, now_ms);
+    s->running = false;
+}
+
+void adv_sched_connected(struct adv_sched* s, uint32_t now_ms)
+{
+    struct adv_sched_phase_stats* phase;
+    uint32_t latency_ms;
+
+    adv_sched_stopped(s, now_ms);
+    if (!s->measuring) {
+        return;
+    }
+
+    /* Counted in the phase of the interval the schedule was at */
+    phase = &s->phases[adv_sched_phase_of(adv_sched_interval(s, now_ms))];
+    latency_ms = now_ms - s->lost_ms;
+    phase->connects++;
+    phase->connect_last_ms = latency_ms;
+    if (latency_ms > phase->connect_max_ms) {
+        phase->connect_max_ms = latency_ms;
+    }
+    phase->connect_total_ms += latency_ms;
+    s->measuring = false;
+}
+
+void adv_sched_get_stats(const struct adv_sched* s, uint32_t now_ms,
+    struct adv_sched_phase_stats* stats)
+{
+    struct adv_sched copy = *s;
+
+    account(&copy, now_ms);
+    memcpy(stats, copy.phases, sizeof(copy.phases));
+}
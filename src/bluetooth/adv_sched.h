@@ -0,0 +1,170 @@
+/**
+ * @file adv_sched.h
+ * @brief Power-Aware Advertising Scheduler Header
+ *
+ * Advertising fast keeps reconnects quick but costs power for as long as no
+ * phone comes back; advertising slowly saves power but makes the phone wait.
+ * The scheduler advertises fast for a burst after a disconnect or boot,
+ * when a returning phone is most likely, then doubles the interval step by
+ * step up to a slow interval. User interaction restarts the burst, the user
+ * looking at the watch is a good sign the phone is about to be wanted.
+ *
+ * The time spent and events sent in each phase, and the latency of the
+ * connections made in it, are accounted to weigh power against reconnect
+ * time.
+ *
+ * Main loop only.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef ADV_SCHED_H
+#define ADV_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Interval of the fast burst, BT_GAP_ADV_FAST_INT_MIN_1 */
+#define ADV_SCHED_FAST_INTERVAL_MS 30U
+
+/** @brief Length of the fast burst */
+#define ADV_SCHED_FAST_MS 30000U
+
+/** @brief Time spent at each interval while backing off */
+#define ADV_SCHED_STEP_MS 30000U
+
+/** @brief Interval backed off to, about BT_GAP_ADV_SLOW_INT_MIN */
+#define ADV_SCHED_SLOW_INTERVAL_MS 1280U
+
+/** @brief Mean random advDelay the controller adds to every interval */
+#define ADV_SCHED_ADV_DELAY_MS 5U
+
+/**
+ * @brief Advertising phases
+ */
+enum adv_sched_phase {
+    ADV_SCHED_FAST, /**< Burst after a disconnect, boot or interaction */
+    ADV_SCHED_BACKOFF, /**< Interval doubling toward the slow one */
+    ADV_SCHED_SLOW, /**< Slow interval until the next reset */
+    ADV_SCHED_PHASES
+};
+
+/**
+ * @brief Statistics of one advertising phase
+ */
+struct adv_sched_phase_stats {
+    uint64_t time_ms; /**< Time spent advertising */
+    uint64_t events; /**< Advertising events, estimated from the interval */
+    uint32_t connects; /**< Connections made */
+    uint32_t connect_last_ms; /**< Latest disconnect or boot to connection */
+    uint32_t connect_max_ms; /**< Worst disconnect or boot to connection */
+    uint64_t connect_total_ms; /**< Sum of disconnect or boot to connection */
+};
+
+/**
+ * @brief Scheduler state
+ */
+struct adv_sched {
+    uint32_t burst_ms; /**< Start of the current burst */
+    uint32_t lost_ms; /**< Disconnect or boot, for the connection latency */
+    bool measuring; /**< No connection since lost_ms */
+    bool running; /**< Advertising at interval_ms since account_ms */
+    uint32_t interval_ms;
+    uint32_t account_ms;
+    uint32_t carry_ms; /**< Time not yet making up a whole event */
+    struct adv_sched_phase_stats phases[ADV_SCHED_PHASES];
+};
+
+/**
+ * @brief Initialize the scheduler and start a burst (boot)
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ */
+void adv_sched_init(struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Start a burst after a disconnect and time the reconnect
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ */
+void adv_sched_reset(struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Restart the burst on user interaction
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ */
+void adv_sched_activity(struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Get the interval to advertise at
+ *
+ * Changes at most once per ADV_SCHED_STEP_MS, the caller restarts
+ * advertising when it does.
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ * @return Interval in milliseconds
+ */
+uint32_t adv_sched_interval(const struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Get the phase of an interval
+ *
+ * @param interval_ms Interval from adv_sched_interval()
+ * @return Phase it belongs to
+ */
+enum adv_sched_phase adv_sched_phase_of(uint32_t interval_ms);
+
+/**
+ * @brief Account advertising started
+ *
+ * @param s Scheduler
+ * @param interval_ms Interval advertised at
+ * @param now_ms Current time
+ */
+void adv_sched_started(struct adv_sched* s, uint32_t interval_ms, uint32_t now_ms);
+
+/**
+ * @brief Account advertising stopped
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ */
+void adv_sched_stopped(struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Account a connection, which also stops advertising
+ *
+ * The first connection after a disconnect or boot is timed and counted in
+ * the phase the interval was in.
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ */
+void adv_sched_connected(struct adv_sched* s, uint32_t now_ms);
+
+/**
+ * @brief Get the statistics of all phases
+ *
+ * The time of advertising still running is included up to now.
+ *
+ * @param s Scheduler
+ * @param now_ms Current time
+ * @param stats Output, ADV_SCHED_PHASES entries
+ */
+void adv_sched_get_stats(const struct adv_sched* s, uint32_t now_ms,
+    struct adv_sched_phase_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADV_SCHED_H */
@@ -0,0 +1,946 @@
+/**
+ * @file bluetooth.c
+ * @brief BLE Notification Service Implementation
+ *
+ * The write handler only copies packets into a message queue; parsing,
+ * rules evaluation and UI updates happen in bluetooth_process() on the main
+ * loop. Connection callbacks likewise only record events that the main loop
+ * applies to the status indicator and advertising.
+ *
+ * Ingest has two lanes. Urgent notifications go to their own queue, wake the
+ * main loop immediately instead of waiting for its next pass, and are always
+ * drained before any normal packet.
+ *
+ * Actions from the watch go the other way through the outbox and the action
+ * characteristic. Posting one wakes the main loop as well, so a tap reaches
+ * the phone in the next connection event rather than after a loop period.
+ *
+ * Up to BLUETOOTH_MAX_PEERS centrals (e.g. the Android app and a Web
+ * Bluetooth page) can be connected at once. Each has its own normal lane
+ * queue, drained fairly into the one notification store (see rx_lanes.h);
+ * notifications delivered by both are de-duplicated (see dedup.h), and
+ * actions go back to the peer the notification came from, waiting for it to
+ * reconnect if it is away.
+ *
+ * Phones are bonded on first connection (keys persisted through settings)
+ * so a reconnect needs neither pairing nor service discovery: the phone
+ * keeps its GATT cache, validated by the database hash. When a bonded phone
+ * drops, the watch advertises directly to it at high duty cycle for the
+ * phone's immediate reconnect, then falls back to undirected advertising.
+ * Undirected advertising follows the power-aware schedule of adv_sched.h,
+ * restarted at a new interval whenever the schedule steps.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+#include "bluetooth/adv_sched.h"
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/dedup.h"
+#include "bluetooth/outbox.h"
+#include "bluetooth/protocol.h"
+#include "bluetooth/recorder.h"
+#include "bluetooth/rx_lanes.h"
+#include "graphics/graphics.h"
+#include "icons/icons.h"
+#include "latency/latency.h"
+#include "notifications/notifications.h"
+#include "trace/trace.h"
+
+LOG_MODULE_REGISTER(bluetooth, LOG_LEVEL_INF);
+
+/** @brief Service UUID 12345678-1234-1234-1234-123456789abc */
+#define NOTIFICATION_SERVICE_UUID_VAL \
+    BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x1234, 0x1234, 0x123456789abc)
+
+/** @brief Characteristic UUID 87654321-4321-4321-4321-cba987654321 */
+#define NOTIFICATION_CHAR_UUID_VAL \
+    BT_UUID_128_ENCODE(0x87654321, 0x4321, 0x4321, 0x4321, 0xcba987654321)
+
+/** @brief Action characteristic UUID 87654322-4321-4321-4321-cba987654321 */
+#define ACTION_CHAR_UUID_VAL \
+    BT_UUID_128_ENCODE(0x87654322, 0x4321, 0x4321, 0x4321, 0xcba987654321)
+
+/** @brief Stats characteristic UUID 87654323-4321-4321-4321-cba987654321 */
+#define STATS_CHAR_UUID_VAL \
+    BT_UUID_128_ENCODE(0x87654323, 0x4321, 0x4321, 0x4321, 0xcba987654321)
+
+static const struct bt_uuid_128 notification_service_uuid = BT_UUID_INIT_128(NOTIFICATION_SERVICE_UUID_VAL);
+static const struct bt_uuid_128 notification_char_uuid = BT_UUID_INIT_128(NOTIFICATION_CHAR_UUID_VAL);
+static const struct bt_uuid_128 action_char_uuid = BT_UUID_INIT_128(ACTION_CHAR_UUID_VAL);
+static const struct bt_uuid_128 stats_char_uuid = BT_UUID_INIT_128(STATS_CHAR_UUID_VAL);
+
+/** @brief Index of the action characteristic value in the service */
+#define ACTION_ATTR_INDEX 4
+
+/** @brief Connection event flags, set in Bluetooth callbacks */
+#define EVENT_CONNECTED BIT(0)
+#define EVENT_DISCONNECTED BIT(1)
+#define EVENT_BONDED_LOST BIT(2)
+#define EVENT_DIRECTED_TIMEOUT BIT(3)
+#define EVENT_USER_ACTIVITY BIT(4)
+
+/** @brief Link profiles, intervals in 1.25 ms units and timeout in 10 ms units */
+#define BULK_INTERVAL_MIN 6 /* 7.5 ms */
+#define BULK_INTERVAL_MAX 12 /* 15 ms */
+#define DEFAULT_INTERVAL_MIN 24 /* 30 ms */
+#define DEFAULT_INTERVAL_MAX 40 /* 50 ms */
+#define SUPERVISION_TIMEOUT 400 /* 4 s */
+
+/** @brief Priority frames not rendered within this time are given up */
+#define PRIORITY_PROBE_TIMEOUT_MS 1000
+
+/**
+ * @brief Connected central
+ */
+struct peer {
+    struct bt_conn* conn; /**< NULL while the slot is free */
+    uint8_t conn_id; /**< New for every connection, a reconnect is a new source */
+};
+
+static struct peer peers[BLUETOOTH_MAX_PEERS];
+
+/**
+ * @brief Connection that was lost, and the phone it was with
+ */
+struct lost_conn {
+    bt_addr_le_t addr;
+    uint8_t conn_id;
+};
+
+/* Lost connections, forgotten by de-duplication on the main loop */
+K_MSGQ_DEFINE(lost_conn_queue, sizeof(struct lost_conn), 2 * BLUETOOTH_MAX_PEERS, 4);
+static uint8_t next_conn_id;
+
+/* Lost connections whose phone may come back, oldest first, main loop only */
+static struct lost_conn lost_conns[BLUETOOTH_MAX_PEERS];
+static uint8_t lost_conn_count;
+
+/* Given for priority packets and posted actions to cut the main loop's sleep short */
+static K_SEM_DEFINE(rx_wakeup, 0, 1);
+
+static struct bluetooth_stats stats;
+static int64_t probe_armed_ms = -1;
+static bluetooth_handled_cb_t handled_cb;
+
+static atomic_t pending_events;
+static bool bt_ready = false;
+static bool advertising = false;
+static struct adv_sched adv_sched;
+static bool bulk_link = false;
+static uint32_t adv_interval_ms; /* Of the undirected advertising running */
+
+/* Written before EVENT_BONDED_LOST is raised, read by the main loop after */
+static bt_addr_le_t lost_addr;
+
+/**
+ * @brief Reconnect state, main loop only
+ */
+static struct {
+    bt_addr_le_t target; /**< Bonded phone to advertise directly to */
+    bool pending; /**< Directed advertising still to be started */
+    bool directed; /**< Directed advertising is running */
+    int64_t lost_ms; /**< Last link loss, negative when not measuring */
+    int64_t connected_ms; /**< Reconnection after it, negative until then */
+} reconnect = { .lost_ms = -1, .connected_ms = -1 };
+
+static const struct bt_data ad[] = {
+    BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+    BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
+};
+
+static const struct bt_data sd[] = {
+    BT_DATA_BYTES(BT_DATA_UUID128_ALL, NOTIFICATION_SERVICE_UUID_VAL),
+};
+
+int bluetooth_receive(uint8_t source, const uint8_t* data, size_t len)
+{
+    int ret;
+
+    if (source >= BLUETOOTH_MAX_PEERS || len == 0 || len > BLUETOOTH_MAX_PACKET_LEN) {
+        return -EINVAL;
+    }
+
+    /* The load offered, including packets pushed back below */
+    recorder_add(source, data, len);
+
+    ret = rx_lanes_put(source, peers[source].conn_id, data, len);
+    if (ret >= 0) {
+        TRACE_POINT(RX, (uint32_t)source << 16 | len);
+    }
+    if (ret == 1) {
+        k_sem_give(&rx_wakeup);
+    } else if (ret == -ENOBUFS) {
+        LOG_WRN("RX queue %u full, packet rejected", source);
+    }
+    return ret;
+}
+
+void bluetooth_set_handled_callback(bluetooth_handled_cb_t cb)
+{
+    handled_cb = cb;
+}
+
+/**
+ * @brief Queue a packet written by the phone
+ */
+static ssize_t on_notification_write(struct bt_conn* conn, const struct bt_gatt_attr* attr,
+    const void* buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    uint8_t source = bt_conn_index(conn);
+
+    ARG_UNUSED(attr);
+    ARG_UNUSED(flags);
+
+    if (source >= BLUETOOTH_MAX_PEERS) {
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len == 0 || len > BLUETOOTH_MAX_PACKET_LEN) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    if (bluetooth_receive(source, buf, len) < 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+    return len;
+}
+
+static void on_action_ccc_changed(const struct bt_gatt_attr* attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+    ARG_UNUSED(value);
+
+    /* Subscriptions are per connection, checked when sending */
+    k_sem_give(&rx_wakeup);
+}
+
+/**
+ * @brief Read the receipt to glass latency summary
+ */
+static ssize_t on_stats_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf,
+    uint16_t len, uint16_t offset)
+{
+    uint8_t value[LATENCY_ENCODED_LEN];
+    size_t value_len = latency_encode(value, sizeof(value));
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, value_len);
+}
+
+BT_GATT_SERVICE_DEFINE(notification_svc,
+    BT_GATT_PRIMARY_SERVICE(&notification_service_uuid.uuid),
+    BT_GATT_CHARACTERISTIC(&notification_char_uuid.uuid,
+        BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+        BT_GATT_PERM_WRITE_ENCRYPT, NULL, on_notification_write, NULL),
+    BT_GATT_CHARACTERISTIC(&action_char_uuid.uuid, BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(on_action_ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+    BT_GATT_CHARACTERISTIC(&stats_char_uuid.uuid, BT_GATT_CHRC_READ, BT_GATT_PERM_READ,
+        on_stats_read, NULL, NULL), );
+
+static void on_connected(struct bt_conn* conn, uint8_t err)
+{
+    int ret;
+
+    if (err == BT_HCI_ERR_ADV_TIMEOUT) {
+        /* High duty directed advertising ends after 1.28 s unanswered */
+        atomic_or(&pending_events, EVENT_DIRECTED_TIMEOUT);
+        k_sem_give(&rx_wakeup);
+        return;
+    }
+    if (err) {
+        LOG_WRN("Connection failed (err 0x%02x)", err);
+        return;
+    }
+
+    peers[bt_conn_index(conn)].conn = bt_conn_ref(conn);
+    peers[bt_conn_index(conn)].conn_id = next_conn_id++;
+
+    /* Pairs and bonds a new phone, re-encrypts with the stored keys otherwise */
+    ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+    if (ret < 0) {
+        LOG_WRN("Failed to request security (ret: %d)", ret);
+    }
+
+    atomic_or(&pending_events, EVENT_CONNECTED);
+    k_sem_give(&rx_wakeup);
+}
+
+static void on_disconnected(struct bt_conn* conn, uint8_t reason)
+{
+    struct peer* peer = &peers[bt_conn_index(conn)];
+    struct lost_conn lost;
+
+    LOG_INF("Disconnected (reason 0x%02x)", reason);
+
+    if (peer->conn == conn) {
+        bt_addr_le_copy(&lost.addr, bt_conn_get_dst(conn));
+        lost.conn_id = peer->conn_id;
+        bt_conn_unref(peer->conn);
+        peer->conn = NULL;
+        /* If full, its notifications are still duplicates only for a while */
+        k_msgq_put(&lost_conn_queue, &lost, K_NO_WAIT);
+    }
+
+    if (bt_addr_le_is_bonded(BT_ID_DEFAULT, bt_conn_get_dst(conn))) {
+        bt_addr_le_copy(&lost_addr, bt_conn_get_dst(conn));
+        atomic_or(&pending_events, EVENT_BONDED_LOST);
+    }
+    atomic_or(&pending_events, EVENT_DISCONNECTED);
+
+    /* Advertising is restarted from the main loop, start it now */
+    k_sem_give(&rx_wakeup);
+}
+
+static void on_security_changed(struct bt_conn* conn, bt_security_t level, enum bt_security_err err)
+{
+    ARG_UNUSED(conn);
+
+    if (err) {
+        LOG_WRN("Security failed (level %d, err %d)", level, err);
+    } else {
+        LOG_INF("Link secured (level %d)", level);
+    }
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = on_connected,
+    .disconnected = on_disconnected,
+    .security_changed = on_security_changed,
+};
+
+/**
+ * @brief Start high duty directed advertising toward the lost phone
+ *
+ * The phone's address is resolved by the controller, so directing to its
+ * current private address works as well.
+ */
+static int start_directed_advertising(void)
+{
+    const struct bt_le_adv_param* param = BT_LE_ADV_PARAM(
+        BT_LE_ADV_OPT_CONN | BT_LE_ADV_OPT_DIR_ADDR_RPA, 0, 0, &reconnect.target);
+    int ret;
+
+    ret = bt_le_adv_start(param, NULL, 0, NULL, 0);
+    if (ret == -ENOMEM) {
+        /* Connection object not released yet, retried next pass */
+        return ret;
+    }
+
+    reconnect.pending = false;
+    if (ret < 0) {
+        LOG_WRN("Failed to start directed advertising (ret: %d)", ret);
+        return ret;
+    }
+
+    advertising = true;
+    reconnect.directed = true;
+    stats.directed_adv++;
+    LOG_INF("Advertising directly to the bonded phone");
+    return 0;
+}
+
+/**
+ * @brief Start connectable advertising if not already advertising
+ *
+ * Directed advertising toward a phone that just dropped goes first, the
+ * undirected one follows when it times out or fails, at the interval the
+ * schedule is at.
+ */
+static int start_advertising(void)
+{
+    uint32_t now = k_uptime_get_32();
+    uint32_t interval = adv_sched_interval(&adv_sched, now);
+    int ret;
+
+    if (advertising) {
+        return 0;
+    }
+
+    if (reconnect.pending) {
+        ret = start_directed_advertising();
+        if (ret == 0 || ret == -ENOMEM) {
+            return ret;
+        }
+    }
+
+    ret = bt_le_adv_start(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONN, BT_GAP_MS_TO_ADV_INTERVAL(interval),
+                              BT_GAP_MS_TO_ADV_INTERVAL(interval), NULL),
+        ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+    if (ret < 0) {
+        LOG_ERR("Failed to start advertising (ret: %d)", ret);
+        return ret;
+    }
+
+    advertising = true;
+    adv_interval_ms = interval;
+    adv_sched_started(&adv_sched, interval, now);
+    LOG_INF("Advertising as %s every %u ms", CONFIG_BT_DEVICE_NAME, interval);
+    return 0;
+}
+
+/**
+ * @brief Stop undirected advertising, to restart it differently
+ */
+static void stop_advertising(void)
+{
+    if (!advertising || reconnect.directed) {
+        return;
+    }
+
+    if (bt_le_adv_stop() == 0) {
+        advertising = false;
+        adv_sched_stopped(&adv_sched, k_uptime_get_32());
+    }
+}
+
+int bluetooth_init(void)
+{
+    int ret;
+
+    ret = bt_enable(NULL);
+    if (ret < 0) {
+        LOG_ERR("Bluetooth init failed (ret: %d)", ret);
+        return ret;
+    }
+
+    rx_lanes_init();
+    adv_sched_init(&adv_sched, k_uptime_get_32());
+
+    /* Advertising starts from bluetooth_process(), once the bonds are loaded */
+    bt_ready = true;
+    notifications_update_connection_status(CONN_DISCONNECTED);
+    return 0;
+}
+
+/**
+ * @brief Request the connection parameters of the current link profile
+ *
+ * The bulk profile also asks for the longest packets on the 2M PHY, which
+ * are kept afterwards, they cost nothing when idle.
+ */
+static void apply_link_profile(struct bt_conn* conn)
+{
+    int ret;
+
+    ret = bt_conn_le_param_update(conn, bulk_link
+            ? BT_LE_CONN_PARAM(BULK_INTERVAL_MIN, BULK_INTERVAL_MAX, 0, SUPERVISION_TIMEOUT)
+            : BT_LE_CONN_PARAM(DEFAULT_INTERVAL_MIN, DEFAULT_INTERVAL_MAX, 0, SUPERVISION_TIMEOUT));
+    if (ret < 0) {
+        LOG_WRN("Failed to update connection parameters (ret: %d)", ret);
+    }
+
+    if (!bulk_link) {
+        return;
+    }
+
+    ret = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (ret < 0) {
+        LOG_WRN("Failed to update data length (ret: %d)", ret);
+    }
+    ret = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (ret < 0) {
+        LOG_WRN("Failed to update PHY (ret: %d)", ret);
+    }
+}
+
+/**
+ * @brief Account the time from link loss to the first notification after it
+ *
+ * Only notifications arriving shortly after the reconnect count, they are
+ * the ones the phone queued while the link was down.
+ */
+static void collect_reconnect_latency(const struct rx_packet* packet)
+{
+    int64_t now = k_uptime_get();
+    uint32_t latency_ms;
+
+    if (reconnect.lost_ms < 0 || reconnect.connected_ms < 0
+        || packet->data[0] != CMD_ADD_NOTIFICATION) {
+        return;
+    }
+
+    if (now - reconnect.connected_ms <= BLUETOOTH_RECONNECT_WINDOW_MS) {
+        latency_ms = (uint32_t)(now - reconnect.lost_ms);
+        stats.reconnects++;
+        stats.reconnect_last_ms = latency_ms;
+        stats.reconnect_max_ms = MAX(stats.reconnect_max_ms, latency_ms);
+        if (latency_ms > BLUETOOTH_RECONNECT_TARGET_MS) {
+            LOG_WRN("Reconnect took %u ms to the first notification", latency_ms);
+        }
+    }
+    reconnect.lost_ms = -1;
+}
+
+/**
+ * @brief Handle a packet and start timing it if it armed a frame probe
+ */
+static void handle_packet(const struct rx_packet* packet, bool priority)
+{
+    uint32_t queued_us = k_cyc_to_us_floor32(k_cycle_get_32() - packet->rx_cycles);
+
+    if (priority) {
+        stats.priority_queue_max_us = MAX(stats.priority_queue_max_us, queued_us);
+    }
+
+    protocol_handle_packet(packet->conn_id, packet->data, packet->len, packet->rx_cycles);
+    collect_reconnect_latency(packet);
+
+    if (handled_cb) {
+        handled_cb(packet->source, packet->data, packet->len, packet->rx_cycles);
+    }
+
+    if (priority) {
+        probe_armed_ms = k_uptime_get();
+    }
+}
+
+/**
+ * @brief Account the receipt to glass latency of the last priority packet
+ */
+static void collect_priority_latency(void)
+{
+    uint32_t latency_us;
+
+    /* Rules can promote normal lane packets too, so always poll the probe */
+    if (lvgl_take_frame_probe(&latency_us)) {
+        stats.priority_samples++;
+        stats.priority_last_us = latency_us;
+        stats.priority_max_us = MAX(stats.priority_max_us, latency_us);
+        stats.priority_total_us += latency_us;
+        if (latency_us > BLUETOOTH_PRIORITY_TARGET_MS * 1000U) {
+            stats.priority_target_misses++;
+            LOG_WRN("Priority notification took %u us to reach the panel", latency_us);
+        }
+        probe_armed_ms = -1;
+    } else if (probe_armed_ms >= 0 && k_uptime_get() - probe_armed_ms > PRIORITY_PROBE_TIMEOUT_MS) {
+        /* Nothing was redrawn, e.g. a rule made it silent */
+        lvgl_cancel_frame_probe();
+        probe_armed_ms = -1;
+    }
+}
+
+/**
+ * @brief Check if a peer takes actions
+ */
+static bool peer_subscribed(const struct peer* peer)
+{
+    return peer->conn
+        && bt_gatt_is_subscribed(peer->conn, &notification_svc.attrs[ACTION_ATTR_INDEX],
+            BT_GATT_CCC_NOTIFY);
+}
+
+/**
+ * @brief Notify an action to the peer that sent its notification
+ *
+ * Unkeyed actions and icon requests are for whichever phone can answer and
+ * go to every subscribed peer.
+ *
+ * @retval 0 Sent, to at least one peer for unkeyed actions
+ * @retval -ENOTCONN Its peer is not connected or not subscribed, keep it
+ * @retval -ENOENT The key's source is no longer remembered
+ * @retval Negative errno codes from bt_gatt_notify()
+ */
+static int notify_action(const struct outbox_entry* entry, const uint8_t* buf, size_t len)
+{
+    bool connected;
+    int conn_id;
+    int ret = -ENOTCONN;
+
+    if (entry->key == 0 || entry->action == PROTOCOL_ACTION_REQUEST_ICON) {
+        for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+            if (peer_subscribed(&peers[i])
+                && bt_gatt_notify(peers[i].conn, &notification_svc.attrs[ACTION_ATTR_INDEX], buf, len)
+                    == 0) {
+                ret = 0;
+            }
+        }
+        return ret;
+    }
+
+    conn_id = dedup_source_of(entry->key, &connected);
+    if (conn_id < 0) {
+        return -ENOENT;
+    }
+    /* Held until its phone reconnects, never handed to another one */
+    if (!connected) {
+        return -ENOTCONN;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+        if (peers[i].conn_id == conn_id && peer_subscribed(&peers[i])) {
+            return bt_gatt_notify(peers[i].conn, &notification_svc.attrs[ACTION_ATTR_INDEX],
+                buf, len);
+        }
+    }
+    return -ENOTCONN;
+}
+
+/**
+ * @brief Notify waiting actions to the phone
+ *
+ * Actions stay in the outbox while their phone is away or when the stack is
+ * out of buffers, and are sent on a later pass. The ones behind wait too,
+ * actions reach the phones in the order they were taken.
+ */
+static void send_actions(void)
+{
+    struct outbox_entry entry;
+    uint8_t buf[PROTOCOL_ACTION_HEADER_LEN + OUTBOX_MAX_REPLY_LEN];
+    size_t len;
+    int ret;
+
+    while (outbox_peek(&entry)) {
+        len = outbox_encode(&entry, buf, sizeof(buf));
+        ret = notify_action(&entry, buf, len);
+        if (ret == -ENOENT) {
+            LOG_WRN("Action on %08x dropped, its phone is unknown", entry.key);
+        } else if (ret == -ENOMEM || ret == -ENOTCONN) {
+            break;
+        } else if (ret < 0) {
+            LOG_WRN("Failed to send action (ret: %d)", ret);
+            break;
+        }
+        outbox_sent(entry.seq);
+    }
+}
+
+/**
+ * @brief Keep a lost connection for its phone's return, dropping the oldest
+ */
+static void remember_lost_conn(const struct lost_conn* lost)
+{
+    if (lost_conn_count == ARRAY_SIZE(lost_conns)) {
+        memmove(&lost_conns[0], &lost_conns[1], sizeof(lost_conns[0]) * --lost_conn_count);
+    }
+    lost_conns[lost_conn_count++] = *lost;
+}
+
+/**
+ * @brief Give a returning phone back what it sent on its lost connection
+ *
+ * Bonded phones connect with their identity address, so a phone is the
+ * same across connections.
+ */
+static void adopt_reconnected(void)
+{
+    uint8_t j;
+
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+        j = 0;
+        while (peers[i].conn && j < lost_conn_count) {
+            if (bt_addr_le_cmp(bt_conn_get_dst(peers[i].conn), &lost_conns[j].addr) != 0) {
+                j++;
+                continue;
+            }
+            dedup_adopt_source(lost_conns[j].conn_id, peers[i].conn_id);
+            lost_conn_count--;
+            memmove(&lost_conns[j], &lost_conns[j + 1],
+                sizeof(lost_conns[0]) * (lost_conn_count - j));
+        }
+    }
+}
+
+void bluetooth_process(void)
+{
+    static struct rx_packet packet;
+    atomic_val_t events = atomic_clear(&pending_events);
+    struct lost_conn lost;
+    bool priority;
+
+    if (events & EVENT_DISCONNECTED) {
+        reconnect.lost_ms = k_uptime_get();
+        reconnect.connected_ms = -1;
+        adv_sched_reset(&adv_sched, k_uptime_get_32());
+    }
+
+    if (events & EVENT_BONDED_LOST) {
+        bt_addr_le_copy(&reconnect.target, &lost_addr);
+        reconnect.pending = true;
+        /* Undirected advertising for a free slot gives way to the directed one */
+        stop_advertising();
+    }
+
+    if (events & EVENT_USER_ACTIVITY) {
+        adv_sched_activity(&adv_sched, k_uptime_get_32());
+    }
+
+    if (events & EVENT_DIRECTED_TIMEOUT) {
+        LOG_INF("Bonded phone did not answer, advertising to all");
+        stats.directed_adv_timeouts++;
+        reconnect.directed = false;
+        advertising = false;
+    }
+
+    if (events & EVENT_CONNECTED) {
+        adv_sched_connected(&adv_sched, k_uptime_get_32());
+        if (reconnect.directed) {
+            stats.reconnect_directed++;
+            reconnect.directed = false;
+        }
+        if (reconnect.lost_ms >= 0 && reconnect.connected_ms < 0) {
+            reconnect.connected_ms = k_uptime_get();
+            stats.reconnect_link_last_ms = (uint32_t)(reconnect.connected_ms - reconnect.lost_ms);
+        }
+
+        /* Advertising stops on connection, restarted below for a free slot */
+        advertising = false;
+        LOG_INF("Central connected (%u/%u)", bluetooth_connection_count(), BLUETOOTH_MAX_PEERS);
+        /* Icons requested on an earlier link may never have arrived */
+        icons_reset_requests();
+        /* A resumed upload continues on the new link at full speed */
+        if (bulk_link) {
+            for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+                if (peers[i].conn) {
+                    apply_link_profile(peers[i].conn);
+                }
+            }
+        }
+        notifications_update_connection_status(CONN_CONNECTED);
+    }
+
+    if ((events & EVENT_DISCONNECTED) && !bluetooth_is_connected()) {
+        outbox_reset_inflight();
+        notifications_update_connection_status(CONN_DISCONNECTED);
+    }
+
+    /* Restarted below at the interval the schedule stepped to */
+    if (advertising && !reconnect.directed
+        && adv_sched_interval(&adv_sched, k_uptime_get_32()) != adv_interval_ms) {
+        stop_advertising();
+    }
+
+    /* Retried every pass, the connection object may not be released yet */
+    if (bt_ready && bluetooth_connection_count() < BLUETOOTH_MAX_PEERS && !advertising) {
+        start_advertising();
+    }
+
+    while (rx_lanes_take(&packet, &priority)) {
+        handle_packet(&packet, priority);
+    }
+
+    /* After the packets a lost connection left in its lane */
+    while (k_msgq_get(&lost_conn_queue, &lost, K_NO_WAIT) == 0) {
+        dedup_forget_source(lost.conn_id);
+        remember_lost_conn(&lost);
+    }
+    adopt_reconnected();
+
+    collect_priority_latency();
+    send_actions();
+}
+
+int bluetooth_send_action(uint8_t action, uint32_t key, const char* reply)
+{
+    int ret = outbox_post(action, key, reply);
+
+    k_sem_give(&rx_wakeup);
+    return ret;
+}
+
+void bluetooth_action_acked(uint8_t seq, uint8_t status)
+{
+    outbox_ack(seq, status);
+}
+
+void bluetooth_wait(k_timeout_t timeout)
+{
+    k_sem_take(&rx_wakeup, timeout);
+}
+
+void bluetooth_set_bulk(bool enable)
+{
+    if (enable == bulk_link) {
+        return;
+    }
+
+    bulk_link = enable;
+    LOG_INF("%s link profile", enable ? "Bulk" : "Default");
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+        if (peers[i].conn) {
+            apply_link_profile(peers[i].conn);
+        }
+    }
+}
+
+void bluetooth_user_activity(void)
+{
+    atomic_or(&pending_events, EVENT_USER_ACTIVITY);
+    k_sem_give(&rx_wakeup);
+}
+
+void bluetooth_get_stats(struct bluetooth_stats* out)
+{
+    struct rx_lanes_stats lanes;
+
+    if (!out) {
+        return;
+    }
+
+    rx_lanes_get_stats(&lanes);
+    *out = stats;
+    out->rx_normal = lanes.normal;
+    out->rx_priority = lanes.priority;
+    out->rx_rejected = lanes.rejected;
+    memcpy(out->peers, lanes.peers, sizeof(out->peers));
+}
+
+uint8_t bluetooth_connection_count(void)
+{
+    uint8_t count = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+        if (peers[i].conn) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool bluetooth_is_connected(void)
+{
+    return bluetooth_connection_count() > 0;
+}
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+static int cmd_ble_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct bluetooth_stats s;
+    struct outbox_stats o;
+    struct dedup_stats d;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    bluetooth_get_stats(&s);
+    shell_print(sh, "connected: %u/%u, packets: %u normal, %u priority, %u rejected",
+        bluetooth_connection_count(), BLUETOOTH_MAX_PEERS, s.rx_normal, s.rx_priority,
+        s.rx_rejected);
+    for (unsigned int i = 0; i < BLUETOOTH_MAX_PEERS; i++) {
+        shell_print(sh, "peer %u%s: %u packets, %llu bytes, %u served, %u rejected", i,
+            peers[i].conn ? "" : " (free)", s.peers[i].rx_packets,
+            (unsigned long long)s.peers[i].rx_bytes, s.peers[i].served, s.peers[i].rx_rejected);
+    }
+    dedup_get_stats(&d);
+    shell_print(sh, "de-duplicated: %u by key, %u by text (%u checked)", d.key_duplicates,
+        d.text_duplicates, d.checked);
+    shell_print(sh, "priority receipt to glass: last %u us, max %u us, avg %u us (%u samples)",
+        s.priority_last_us, s.priority_max_us,
+        s.priority_samples ? (uint32_t)(s.priority_total_us / s.priority_samples) : 0U,
+        s.priority_samples);
+    shell_print(sh, "priority target %u ms missed %u times, max queue wait %u us",
+        BLUETOOTH_PRIORITY_TARGET_MS, s.priority_target_misses, s.priority_queue_max_us);
+
+    shell_print(sh, "reconnect to first notification: last %u ms, max %u ms, target %u ms "
+                    "(%u samples)",
+        s.reconnect_last_ms, s.reconnect_max_ms, BLUETOOTH_RECONNECT_TARGET_MS, s.reconnects);
+    shell_print(sh, "link loss to connected: last %u ms, directed advertising: %u started, "
+                    "%u answered, %u timed out",
+        s.reconnect_link_last_ms, s.directed_adv, s.reconnect_directed, s.directed_adv_timeouts);
+
+    outbox_get_stats(&o);
+    shell_print(sh, "actions: %u posted, %u coalesced, %u dropped, %u sent, %u acked (%u failed)",
+        o.posted, o.coalesced, o.dropped, o.sent, o.acked, o.failed);
+    shell_print(sh, "tap to phone: last %u us, max %u us, avg %u us",
+        o.last_us, o.max_us, o.acked ? (uint32_t)(o.total_us / o.acked) : 0U);
+    return 0;
+}
+
+static int cmd_ble_action(const struct shell* sh, size_t argc, char** argv)
+{
+    static const struct {
+        const char* name;
+        uint8_t action;
+    } names[] = {
+        { "dismiss", PROTOCOL_ACTION_DISMISS },
+        { "read", PROTOCOL_ACTION_MARK_READ },
+        { "open", PROTOCOL_ACTION_OPEN },
+        { "reply", PROTOCOL_ACTION_REPLY },
+    };
+    uint32_t key = strtoul(argv[2], NULL, 0);
+
+    for (size_t i = 0; i < ARRAY_SIZE(names); i++) {
+        if (strcmp(argv[1], names[i].name) == 0) {
+            bluetooth_send_action(names[i].action, key, argc > 3 ? argv[3] : NULL);
+            return 0;
+        }
+    }
+
+    shell_error(sh, "Unknown action %s", argv[1]);
+    return -EINVAL;
+}
+
+static int cmd_ble_adv(const struct shell* sh, size_t argc, char** argv)
+{
+    static const char* const names[ADV_SCHED_PHASES] = { "fast", "backoff", "slow" };
+    struct adv_sched_phase_stats phases[ADV_SCHED_PHASES];
+    uint32_t now = k_uptime_get_32();
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    adv_sched_get_stats(&adv_sched, now, phases);
+    shell_print(sh, "advertising: %s, every %u ms, schedule at %u ms",
+        !advertising ? "off" : (reconnect.directed ? "directed" : "undirected"), adv_interval_ms,
+        adv_sched_interval(&adv_sched, now));
+    for (int i = 0; i < ADV_SCHED_PHASES; i++) {
+        shell_print(sh, "%-7s %7llu s, %8llu events (%llu/h), %u connects: last %u ms, "
+                        "max %u ms, avg %u ms",
+            names[i], (unsigned long long)(phases[i].time_ms / 1000),
+            (unsigned long long)phases[i].events,
+            (unsigned long long)(phases[i].time_ms
+                    ? phases[i].events * 3600000ULL / phases[i].time_ms
+                    : 0),
+            phases[i].connects, phases[i].connect_last_ms, phases[i].connect_max_ms,
+            phases[i].connects ? (uint32_t)(phases[i].connect_total_ms / phases[i].connects)
+                               : 0U);
+    }
+    return 0;
+}
+
+static int cmd_ble_unpair(const struct shell* sh, size_t argc, char** argv)
+{
+    int ret;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    /* Also disconnects bonded peers, they pair again on reconnect */
+    ret = bt_unpair(BT_ID_DEFAULT, BT_ADDR_LE_ANY);
+    if (ret < 0) {
+        shell_error(sh, "Failed to remove bonds (ret: %d)", ret);
+        return ret;
+    }
+
+    shell_print(sh, "All bonds removed");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ble_cmds,
+    SHELL_CMD(stats, NULL, "Show ingest, priority, reconnect and action latency statistics",
+        cmd_ble_stats),
+    SHELL_CMD_ARG(action, NULL, "Send an action: <dismiss|read|open|reply> <key> [text]",
+        cmd_ble_action, 3, 1),
+    SHELL_CMD(adv, NULL, "Show advertising events per hour and reconnect latency by phase",
+        cmd_ble_adv),
+    SHELL_CMD(unpair, NULL, "Remove all bonded phones", cmd_ble_unpair),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(ble, &ble_cmds, "Notification service", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,210 @@
+/**
+ * @file bluetooth.h
+ * @brief BLE Notification Service Header
+ *
+ * GATT service the phone writes notification protocol packets to. Packets
+ * are received in the Bluetooth thread and handed to the protocol parser from
+ * the main loop, so all UI and rules work stays on the main thread.
+ *
+ * Phones are bonded and reconnect through directed advertising after a link
+ * loss, see bluetooth.c.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef BLUETOOTH_H
+#define BLUETOOTH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest packet accepted on the notification characteristic */
+#define BLUETOOTH_MAX_PACKET_LEN 512
+
+/** @brief Number of received packets buffered per connection for the main loop */
+#define BLUETOOTH_RX_QUEUE_LEN 8
+
+/** @brief Centrals connected at once (e.g. Android app and Web Bluetooth) */
+#define BLUETOOTH_MAX_PEERS CONFIG_BT_MAX_CONN
+
+/** @brief Number of urgent notifications buffered ahead of the others */
+#define BLUETOOTH_RX_PRIORITY_QUEUE_LEN 4
+
+/** @brief Receipt to glass latency target for priority notifications */
+#define BLUETOOTH_PRIORITY_TARGET_MS 100U
+
+/** @brief Link loss to first notification target for a bonded phone */
+#define BLUETOOTH_RECONNECT_TARGET_MS 1000U
+
+/** @brief Notifications this long after a reconnect are not counted for it */
+#define BLUETOOTH_RECONNECT_WINDOW_MS 5000
+
+/**
+ * @brief Per-connection ingest statistics
+ */
+struct bluetooth_peer_stats {
+    uint32_t rx_packets; /**< Packets queued on either lane */
+    uint64_t rx_bytes; /**< Bytes queued on either lane */
+    uint32_t rx_rejected; /**< Packets rejected with a full queue */
+    uint32_t served; /**< Normal lane packets handed to the store */
+};
+
+/**
+ * @brief Ingest statistics
+ */
+struct bluetooth_stats {
+    uint32_t rx_normal; /**< Packets queued on the normal lane */
+    uint32_t rx_priority; /**< Packets queued on the priority lane */
+    uint32_t rx_rejected; /**< Packets rejected with full queues */
+    uint32_t priority_samples; /**< Priority notifications measured */
+    uint32_t priority_last_us; /**< Latest receipt to glass latency */
+    uint32_t priority_max_us; /**< Worst receipt to glass latency */
+    uint64_t priority_total_us; /**< Sum of receipt to glass latencies */
+    uint32_t priority_target_misses; /**< Latencies above the target */
+    uint32_t priority_queue_max_us; /**< Worst wait in the priority queue */
+    uint32_t reconnects; /**< Reconnects measured to their first notification */
+    uint32_t reconnect_last_ms; /**< Latest link loss to first notification */
+    uint32_t reconnect_max_ms; /**< Worst link loss to first notification */
+    uint32_t reconnect_link_last_ms; /**< Latest link loss to connected */
+    uint32_t directed_adv; /**< Directed advertising started toward a bonded phone */
+    uint32_t reconnect_directed; /**< Reconnects through directed advertising */
+    uint32_t directed_adv_timeouts; /**< Directed advertising ended unanswered */
+    struct bluetooth_peer_stats peers[BLUETOOTH_MAX_PEERS]; /**< By connection slot */
+};
+
+/**
+ * @brief Called on the main loop after a received packet is handled
+ *
+ * @param source Connection it arrived on
+ * @param data Packet bytes
+ * @param len Packet length
+ * @param rx_cycles Cycle count when it was received
+ */
+typedef void (*bluetooth_handled_cb_t)(uint8_t source, const uint8_t* data, size_t len,
+    uint32_t rx_cycles);
+
+/**
+ * @brief Enable Bluetooth and register the notification service
+ *
+ * Load the settings after this so the bonds are restored, advertising
+ * starts from the first bluetooth_process() call.
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int bluetooth_init(void);
+
+/**
+ * @brief Handle received packets and connection changes (call in main loop)
+ */
+void bluetooth_process(void);
+
+/**
+ * @brief Queue a packet as if a phone wrote it
+ *
+ * The notification characteristic's write goes through here, as does the
+ * load generator (see loadgen.h). Safe to call from any thread or ISR.
+ *
+ * @param source Connection it arrives on, below BLUETOOTH_MAX_PEERS
+ * @param data Packet bytes
+ * @param len Packet length
+ * @retval 0 Queued on the connection's lane
+ * @retval 1 Queued on the priority lane, the main loop is woken
+ * @retval -EINVAL Unknown connection, empty or too long packet
+ * @retval -ENOBUFS Lane full, pushed back
+ */
+int bluetooth_receive(uint8_t source, const uint8_t* data, size_t len);
+
+/**
+ * @brief Register the packet handled callback
+ *
+ * @param cb Callback, NULL to unregister
+ */
+void bluetooth_set_handled_callback(bluetooth_handled_cb_t cb);
+
+/**
+ * @brief Send an action on a notification to the phone
+ *
+ * Safe to call from any thread, e.g. LVGL event handlers. The action goes
+ * through the outbox (see outbox.h) and is notified from the main loop,
+ * which is woken right away.
+ *
+ * @param action PROTOCOL_ACTION_*
+ * @param key Phone's notification key
+ * @param reply Reply text for PROTOCOL_ACTION_REPLY, NULL otherwise
+ *
+ * @retval 0 Queued
+ * @retval 1 Merged into a waiting action for the same notification
+ */
+int bluetooth_send_action(uint8_t action, uint32_t key, const char* reply);
+
+/**
+ * @brief Account the phone's acknowledgement of an action
+ *
+ * @param seq Sequence number of the action
+ * @param status 0 if the phone performed it
+ */
+void bluetooth_action_acked(uint8_t seq, uint8_t status);
+
+/**
+ * @brief Sleep until a priority packet arrives or the timeout expires
+ *
+ * Use as the main loop's sleep so urgent notifications and actions posted
+ * by the user are handled without waiting for the next pass.
+ *
+ * @param timeout Longest time to sleep
+ */
+void bluetooth_wait(k_timeout_t timeout);
+
+/**
+ * @brief Switch the links between the default and the bulk profile
+ *
+ * The bulk profile (7.5-15 ms interval, longest packets, 2M PHY) is for
+ * large transfers such as firmware uploads; the default one returns to a
+ * power friendly 30-50 ms interval. Connections made while bulk is on get
+ * it as well. Main loop only.
+ *
+ * @param enable true for the bulk profile
+ */
+void bluetooth_set_bulk(bool enable);
+
+/**
+ * @brief Report user interaction with the watch
+ *
+ * Restarts the fast advertising burst, the phone is likely wanted soon.
+ * Safe to call from any thread.
+ */
+void bluetooth_user_activity(void);
+
+/**
+ * @brief Get ingest statistics
+ *
+ * @param stats Output for the statistics
+ */
+void bluetooth_get_stats(struct bluetooth_stats* stats);
+
+/**
+ * @brief Check if a phone is connected
+ *
+ * @retval true At least one central is connected
+ * @retval false Advertising or idle
+ */
+bool bluetooth_is_connected(void);
+
+/**
+ * @brief Get the number of connected centrals
+ *
+ * @return Connections, at most BLUETOOTH_MAX_PEERS
+ */
+uint8_t bluetooth_connection_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLUETOOTH_H */
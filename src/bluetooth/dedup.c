@@ -0,0 +1,149 @@
+/**
+ * @file dedup.c
+ * @brief Cross-Source Notification De-duplication Implementation
+ *
+ * Entries live in a ring; new notifications overwrite the oldest entry and
+ * updates from the same source refresh their entry in place, as do keyed
+ * notifications taking over an entry without an owner.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+
+#include "bluetooth/dedup.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+static struct {
+    uint32_t key;
+    uint32_t text_hash;
+    uint32_t seen_ms;
+    uint8_t source;
+    bool owned; /**< false once the source disconnected */
+    bool used;
+} entries[DEDUP_LEN];
+
+static uint8_t next_entry;
+static struct dedup_stats stats;
+
+uint32_t dedup_hash_init(void)
+{
+    return FNV_OFFSET_BASIS;
+}
+
+uint32_t dedup_hash(uint32_t hash, const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+bool dedup_check(uint8_t source, uint32_t key, uint32_t text_hash, uint32_t now_ms)
+{
+    int same_source = -1;
+
+    stats.checked++;
+
+    for (int i = 0; i < DEDUP_LEN; i++) {
+        uint32_t age_ms = now_ms - entries[i].seen_ms;
+
+        if (!entries[i].used) {
+            continue;
+        }
+
+        if (entries[i].owned && entries[i].source == source) {
+            /* Keyed updates replace their entry, unkeyed ones match by text */
+            if (key ? entries[i].key == key : entries[i].text_hash == text_hash) {
+                same_source = i;
+            }
+            continue;
+        }
+
+        /* A reconnected source takes its notifications back by key */
+        if (!entries[i].owned && key != 0 && entries[i].key == key) {
+            same_source = i;
+            continue;
+        }
+
+        if (key != 0 && entries[i].key == key && age_ms < DEDUP_KEY_WINDOW_MS) {
+            stats.key_duplicates++;
+            return true;
+        }
+        if (entries[i].text_hash == text_hash && age_ms < DEDUP_WINDOW_MS) {
+            stats.text_duplicates++;
+            return true;
+        }
+    }
+
+    if (same_source < 0) {
+        same_source = next_entry;
+        next_entry = (next_entry + 1) % DEDUP_LEN;
+    }
+
+    entries[same_source].key = key;
+    entries[same_source].text_hash = text_hash;
+    entries[same_source].seen_ms = now_ms;
+    entries[same_source].source = source;
+    entries[same_source].owned = true;
+    entries[same_source].used = true;
+    return false;
+}
+
+int dedup_source_of(uint32_t key, bool* connected)
+{
+    int newest = -1;
+
+    if (key == 0) {
+        return -1;
+    }
+
+    /* Another source may have sent the key again after the window */
+    for (int i = 0; i < DEDUP_LEN; i++) {
+        if (entries[i].used && entries[i].key == key
+            && (newest < 0 || (int32_t)(entries[i].seen_ms - entries[newest].seen_ms) > 0)) {
+            newest = i;
+        }
+    }
+    if (newest < 0) {
+        return -1;
+    }
+
+    *connected = entries[newest].owned;
+    return entries[newest].source;
+}
+
+void dedup_forget_source(uint8_t source)
+{
+    for (int i = 0; i < DEDUP_LEN; i++) {
+        if (entries[i].source == source) {
+            entries[i].owned = false;
+        }
+    }
+}
+
+void dedup_adopt_source(uint8_t lost, uint8_t source)
+{
+    for (int i = 0; i < DEDUP_LEN; i++) {
+        if (entries[i].used && !entries[i].owned && entries[i].source == lost) {
+            entries[i].source = source;
+            entries[i].owned = true;
+        }
+    }
+}
+
+void dedup_reset(void)
+{
+    memset(entries, 0, sizeof(entries));
+    next_entry = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void dedup_get_stats(struct dedup_stats* out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file dedup.h
+ * @brief Cross-Source Notification De-duplication Header
+ *
+ * With the Android app and a web browser connected at once, the same
+ * notification can arrive from both. Recent notifications are remembered by
+ * the phone's key and by a hash of their text, together with the connection
+ * they came from. A notification is a duplicate when another source
+ * delivered the same key within DEDUP_KEY_WINDOW_MS, or the same text within
+ * DEDUP_WINDOW_MS.
+ *
+ * Repeats from the same source are not duplicates, they are updates (e.g. a
+ * conversation getting a new message) and go through as before.
+ *
+ * Sources are connections, not connection slots: a phone that reconnects is
+ * a new source. The notifications of a disconnected source are kept without
+ * an owner until the phone is back (see dedup_adopt_source()), or until a
+ * source sends one of their keys again and takes it over.
+ *
+ * The table also tells which source a key came from, so actions on a
+ * notification are sent back to the peer that owns it, and held while that
+ * peer is away.
+ *
+ * Main loop only.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Recent notifications remembered, about the notification store size */
+#define DEDUP_LEN 32
+
+/** @brief Same text from another source within this time is a duplicate */
+#define DEDUP_WINDOW_MS 10000U
+
+/** @brief Same key from another source within this time is a duplicate */
+#define DEDUP_KEY_WINDOW_MS 60000U
+
+/**
+ * @brief De-duplication statistics
+ */
+struct dedup_stats {
+    uint32_t checked; /**< Notifications checked */
+    uint32_t key_duplicates; /**< Dropped for a key seen from another source */
+    uint32_t text_duplicates; /**< Dropped for text seen from another source */
+};
+
+/**
+ * @brief Hash notification text for de-duplication (FNV-1a)
+ *
+ * @param hash Running hash, start with dedup_hash_init()
+ * @param data Bytes to add
+ * @param len Number of bytes
+ * @return Updated hash
+ */
+uint32_t dedup_hash(uint32_t hash, const uint8_t* data, size_t len);
+
+/**
+ * @brief Initial value for dedup_hash()
+ */
+uint32_t dedup_hash_init(void);
+
+/**
+ * @brief Check a notification and remember it if it is new
+ *
+ * @param source Connection it arrived on, unique while it is connected
+ * @param key Phone's notification key, 0 if the source has none
+ * @param text_hash Hash of the app, title and text
+ * @param now_ms Current time in milliseconds
+ *
+ * @retval true Duplicate of a notification from another source, drop it
+ * @retval false New, or an update from the same source
+ */
+bool dedup_check(uint8_t source, uint32_t key, uint32_t text_hash, uint32_t now_ms);
+
+/**
+ * @brief Find the source a notification key arrived from
+ *
+ * @param key Phone's notification key
+ * @param connected Set to false if that source has disconnected since
+ * @return Source, negative if the key is not remembered
+ */
+int dedup_source_of(uint32_t key, bool* connected);
+
+/**
+ * @brief Forget a source that disconnected
+ *
+ * Its notifications are kept, without an owner, to still catch their
+ * duplicates and to be taken over on a reconnect.
+ *
+ * @param source Connection that was lost
+ */
+void dedup_forget_source(uint8_t source);
+
+/**
+ * @brief Give the notifications of a lost source to its phone's new one
+ *
+ * @param lost Source that disconnected
+ * @param source Connection the same phone came back on
+ */
+void dedup_adopt_source(uint8_t lost, uint8_t source);
+
+/**
+ * @brief Forget every notification, every source and the statistics
+ */
+void dedup_reset(void);
+
+/**
+ * @brief Get de-duplication statistics
+ *
+ * @param stats Output for the statistics
+ */
+void dedup_get_stats(struct dedup_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEDUP_H */
@@ -0,0 +1,199 @@
+/**
+ * @file outbox.c
+ * @brief Watch to Phone Action Outbox Implementation
+ *
+ * Waiting actions are a ring ordered by posting time; merging keeps the
+ * slot (and the original tap time) of the action it merges into. The head
+ * is in flight from outbox_peek() until outbox_sent(), posts do not merge
+ * into it meanwhile since what is being sent is already encoded.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "bluetooth/outbox.h"
+#include "bluetooth/protocol.h"
+
+static struct outbox_entry ring[OUTBOX_LEN];
+static uint8_t head;
+static uint8_t count;
+static uint8_t next_seq;
+static bool head_in_flight;
+
+/** @brief Tap time of sent actions, indexed by sequence number */
+static struct {
+    uint32_t tap_cycles;
+    uint8_t seq;
+    bool pending;
+} inflight[OUTBOX_INFLIGHT_LEN];
+
+static struct outbox_stats stats;
+static struct k_spinlock lock;
+
+/**
+ * @brief Check if a waiting action absorbs a newly posted one
+ */
+static bool absorbs(const struct outbox_entry* waiting, uint8_t action, uint32_t key)
+{
+    if (waiting->key != key) {
+        return false;
+    }
+    return waiting->action == action
+        || (action == PROTOCOL_ACTION_DISMISS && waiting->action == PROTOCOL_ACTION_MARK_READ);
+}
+
+int outbox_post(uint8_t action, uint32_t key, const char* reply)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+    struct outbox_entry* entry = NULL;
+    int ret = 0;
+
+    stats.posted++;
+
+    for (uint8_t i = head_in_flight ? 1 : 0; i < count; i++) {
+        struct outbox_entry* waiting = &ring[(head + i) % OUTBOX_LEN];
+
+        if (absorbs(waiting, action, key)) {
+            entry = waiting;
+            stats.coalesced++;
+            ret = 1;
+            break;
+        }
+    }
+
+    if (!entry) {
+        if (count == OUTBOX_LEN) {
+            head = (head + 1) % OUTBOX_LEN;
+            count--;
+            head_in_flight = false;
+            stats.dropped++;
+        }
+        entry = &ring[(head + count) % OUTBOX_LEN];
+        count++;
+        entry->seq = next_seq++;
+        entry->tap_cycles = k_cycle_get_32();
+    }
+
+    entry->action = action;
+    entry->key = key;
+    entry->reply[0] = '\0';
+    if (reply) {
+        strncpy(entry->reply, reply, OUTBOX_MAX_REPLY_LEN);
+        entry->reply[OUTBOX_MAX_REPLY_LEN] = '\0';
+    }
+
+    k_spin_unlock(&lock, k);
+    return ret;
+}
+
+bool outbox_peek(struct outbox_entry* entry)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+    bool found = count > 0;
+
+    if (found) {
+        *entry = ring[head];
+        head_in_flight = true;
+    }
+
+    k_spin_unlock(&lock, k);
+    return found;
+}
+
+void outbox_sent(uint8_t seq)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+
+    /* Unless dropped on a full outbox while it was being sent */
+    if (count > 0 && head_in_flight && ring[head].seq == seq) {
+        const struct outbox_entry* entry = &ring[head];
+        uint8_t slot = entry->seq % OUTBOX_INFLIGHT_LEN;
+
+        inflight[slot].tap_cycles = entry->tap_cycles;
+        inflight[slot].seq = entry->seq;
+        inflight[slot].pending = true;
+
+        head = (head + 1) % OUTBOX_LEN;
+        count--;
+        head_in_flight = false;
+        stats.sent++;
+    }
+
+    k_spin_unlock(&lock, k);
+}
+
+void outbox_ack(uint8_t seq, uint8_t status)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+    uint8_t slot = seq % OUTBOX_INFLIGHT_LEN;
+
+    if (inflight[slot].pending && inflight[slot].seq == seq) {
+        uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - inflight[slot].tap_cycles);
+
+        inflight[slot].pending = false;
+        stats.acked++;
+        if (status != 0) {
+            stats.failed++;
+        }
+        stats.last_us = latency_us;
+        stats.max_us = MAX(stats.max_us, latency_us);
+        stats.total_us += latency_us;
+    }
+
+    k_spin_unlock(&lock, k);
+}
+
+void outbox_reset_inflight(void)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+
+    memset(inflight, 0, sizeof(inflight));
+
+    k_spin_unlock(&lock, k);
+}
+
+void outbox_reset(void)
+{
+    k_spinlock_key_t k = k_spin_lock(&lock);
+
+    head = 0;
+    count = 0;
+    next_seq = 0;
+    head_in_flight = false;
+    memset(inflight, 0, sizeof(inflight));
+    memset(&stats, 0, sizeof(stats));
+
+    k_spin_unlock(&lock, k);
+}
+
+size_t outbox_encode(const struct outbox_entry* entry, uint8_t* buf, size_t len)
+{
+    size_t reply_len = strlen(entry->reply);
+
+    if (len < PROTOCOL_ACTION_HEADER_LEN + reply_len) {
+        return 0;
+    }
+
+    buf[0] = CMD_ACTION;
+    buf[1] = entry->action;
+    buf[2] = entry->seq;
+    sys_put_le32(entry->key, &buf[3]);
+    memcpy(&buf[PROTOCOL_ACTION_HEADER_LEN], entry->reply, reply_len);
+    return PROTOCOL_ACTION_HEADER_LEN + reply_len;
+}
+
+void outbox_get_stats(struct outbox_stats* out)
+{
+    k_spinlock_key_t k;
+
+    if (!out) {
+        return;
+    }
+
+    k = k_spin_lock(&lock);
+    *out = stats;
+    k_spin_unlock(&lock, k);
+}
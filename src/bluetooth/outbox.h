@@ -0,0 +1,142 @@
+/**
+ * @file outbox.h
+ * @brief Watch to Phone Action Outbox Header
+ *
+ * Small bounded queue of actions (dismiss, mark read, open, reply) waiting
+ * to be notified to the phone. Posting an action that is already waiting
+ * for the same notification merges into it instead of taking a new slot,
+ * so repeated taps do not flood the link.
+ *
+ * Each action gets a sequence number that the phone echoes back once it has
+ * performed the action, which gives the tap to phone latency.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Actions waiting to be sent */
+#define OUTBOX_LEN 8
+
+/** @brief Longest canned reply text, without terminator */
+#define OUTBOX_MAX_REPLY_LEN 40
+
+/** @brief Sent actions tracked until acknowledged */
+#define OUTBOX_INFLIGHT_LEN 8
+
+/**
+ * @brief Action waiting in the outbox
+ */
+struct outbox_entry {
+    uint8_t action; /**< PROTOCOL_ACTION_* */
+    uint8_t seq; /**< Sequence number echoed in the acknowledgement */
+    uint32_t key; /**< Phone's notification key */
+    uint32_t tap_cycles; /**< Cycle count when the user triggered it */
+    char reply[OUTBOX_MAX_REPLY_LEN + 1]; /**< Reply text for PROTOCOL_ACTION_REPLY */
+};
+
+/**
+ * @brief Outbox statistics
+ */
+struct outbox_stats {
+    uint32_t posted; /**< Actions posted */
+    uint32_t coalesced; /**< Posts merged into a waiting action */
+    uint32_t dropped; /**< Oldest actions dropped on a full outbox */
+    uint32_t sent; /**< Actions notified to the phone */
+    uint32_t acked; /**< Acknowledgements matched to a sent action */
+    uint32_t failed; /**< Acknowledgements reporting failure */
+    uint32_t last_us; /**< Latest tap to acknowledgement latency */
+    uint32_t max_us; /**< Worst tap to acknowledgement latency */
+    uint64_t total_us; /**< Sum of tap to acknowledgement latencies */
+};
+
+/**
+ * @brief Post an action for a notification
+ *
+ * Safe to call from any thread. A waiting action of the same kind for the
+ * same notification is replaced, and a dismiss also replaces a waiting mark
+ * read. When the outbox is full the oldest action is dropped.
+ *
+ * @param action PROTOCOL_ACTION_*
+ * @param key Phone's notification key
+ * @param reply Reply text for PROTOCOL_ACTION_REPLY, NULL otherwise
+ *
+ * @retval 0 Queued in a new slot
+ * @retval 1 Merged into a waiting action
+ */
+int outbox_post(uint8_t action, uint32_t key, const char* reply);
+
+/**
+ * @brief Get the oldest waiting action without removing it
+ *
+ * The action is in flight until outbox_sent(): later posts no longer merge
+ * into it, so what is sent is what gets removed. If it could not be sent,
+ * the next peek returns it again.
+ *
+ * @param entry Output for the action
+ *
+ * @retval true An action was waiting
+ * @retval false Outbox is empty
+ */
+bool outbox_peek(struct outbox_entry* entry);
+
+/**
+ * @brief Remove the oldest waiting action after it was sent
+ *
+ * The action is tracked until outbox_ack() is called for its sequence
+ * number, or until it is overwritten by later actions.
+ *
+ * @param seq Sequence number of the action sent, as peeked; nothing is
+ *            removed if it is no longer the oldest waiting action
+ */
+void outbox_sent(uint8_t seq);
+
+/**
+ * @brief Account the phone's acknowledgement of an action
+ *
+ * @param seq Sequence number from the acknowledgement
+ * @param status 0 if the phone performed the action
+ */
+void outbox_ack(uint8_t seq, uint8_t status);
+
+/**
+ * @brief Forget the actions sent but not acknowledged (on disconnect)
+ */
+void outbox_reset_inflight(void);
+
+/**
+ * @brief Drop all waiting and sent actions and clear the statistics
+ */
+void outbox_reset(void);
+
+/**
+ * @brief Encode an action into a CMD_ACTION packet
+ *
+ * @param entry Action
+ * @param buf Output buffer
+ * @param len Buffer length
+ * @return Packet length, 0 if the buffer is too small
+ */
+size_t outbox_encode(const struct outbox_entry* entry, uint8_t* buf, size_t len);
+
+/**
+ * @brief Get outbox statistics
+ *
+ * @param stats Output for the statistics
+ */
+void outbox_get_stats(struct outbox_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OUTBOX_H */
@@ -0,0 +1,281 @@
+/**
+ * @file protocol.c
+ * @brief Phone to Watch Protocol Parser Implementation
+ *
+ * Runs on the main loop thread. Received notifications go through the rules
+ * engine before they reach the notification store, so muting and priority
+ * decisions are made on the watch.
+ *
+ * Priority notifications (flagged by the phone or by a rule) are pushed to
+ * the panel right away, with a frame probe measuring receipt to glass.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/dedup.h"
+#include "bluetooth/protocol.h"
+#include "clock/clock.h"
+#include "dnd/dnd.h"
+#include "graphics/graphics.h"
+#include "icons/icons.h"
+#include "notifications/notifications.h"
+#include "rules/rules.h"
+#include "trace/trace.h"
+
+LOG_MODULE_REGISTER(protocol, LOG_LEVEL_INF);
+
+/** @brief Field buffer sizes, match the notification store */
+#define APP_NAME_LEN 32
+#define SENDER_LEN 64
+#define CONTENT_LEN 256
+
+/**
+ * @brief Copy a length-prefixed field into a NUL terminated buffer
+ */
+static void copy_field(char* dst, size_t dst_size, const char* src, size_t len)
+{
+    len = MIN(len, dst_size - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+/**
+ * @brief Map a rule action to notification delivery flags
+ */
+static uint32_t action_to_flags(rule_action_t action)
+{
+    switch (action) {
+    case RULE_ACTION_SILENT:
+        return NOTIFICATION_FLAG_SILENT;
+    case RULE_ACTION_PRIORITY:
+        return NOTIFICATION_FLAG_PRIORITY;
+    case RULE_ACTION_COALESCE:
+        return NOTIFICATION_FLAG_COALESCE;
+    default:
+        return 0;
+    }
+}
+
+static int handle_add_notification(uint8_t source, const uint8_t* data, size_t len,
+    uint32_t rx_cycles)
+{
+    char app_name[APP_NAME_LEN];
+    char sender[SENDER_LEN];
+    char content[CONTENT_LEN];
+    char timestamp[CLOCK_HHMM_STR_LEN];
+    struct clock_time now;
+    struct rules_input input;
+    rule_action_t action;
+    size_t header_len = PROTOCOL_ADD_HEADER_LEN;
+    size_t app_len, title_len, text_len;
+    const uint8_t* payload;
+    uint32_t flags;
+    struct notification_meta meta = { .rx_cycles = rx_cycles };
+
+    if (len < PROTOCOL_ADD_HEADER_LEN) {
+        return -EINVAL;
+    }
+
+    if (data[1] & PROTOCOL_TYPE_HAS_KEY) {
+        if (len < header_len + PROTOCOL_KEY_LEN) {
+            return -EINVAL;
+        }
+        meta.key = sys_get_le32(&data[header_len]);
+        header_len += PROTOCOL_KEY_LEN;
+    }
+
+    if (data[1] & PROTOCOL_TYPE_HAS_ICON) {
+        if (len < header_len + PROTOCOL_ICON_ID_LEN) {
+            return -EINVAL;
+        }
+        meta.icon_id = sys_get_le32(&data[header_len]);
+        header_len += PROTOCOL_ICON_ID_LEN;
+    }
+
+    app_len = data[2];
+    title_len = data[3];
+    text_len = data[4];
+    if (header_len + app_len + title_len + text_len > len) {
+        LOG_WRN("Truncated notification packet (%u bytes)", (unsigned int)len);
+        return -EINVAL;
+    }
+
+    payload = &data[header_len];
+
+    /* The same notification may also arrive from the other connection */
+    if (dedup_check(source, meta.key,
+            dedup_hash(dedup_hash_init(), payload, app_len + title_len + text_len),
+            k_uptime_get_32())) {
+        LOG_DBG("Duplicate notification from source %u dropped", source);
+        return 0;
+    }
+
+    clock_get_time(&now);
+
+    input.app = (const char*)payload;
+    input.app_len = app_len;
+    input.sender = (const char*)payload + app_len;
+    input.sender_len = title_len;
+    input.content = (const char*)payload + app_len + title_len;
+    input.content_len = text_len;
+    input.category = data[1] & PROTOCOL_TYPE_CATEGORY_MASK;
+    input.minute_of_day = now.hours * 60 + now.minutes;
+
+    action = rules_evaluate(&input);
+    if (action == RULE_ACTION_DROP) {
+        LOG_DBG("Notification dropped by rules");
+        return 0;
+    }
+
+    copy_field(app_name, sizeof(app_name), input.app, app_len);
+    copy_field(sender, sizeof(sender), input.sender, title_len);
+    copy_field(content, sizeof(content), input.content, text_len);
+    clock_format_hhmm(timestamp, sizeof(timestamp));
+
+    flags = action_to_flags(action);
+    if ((data[1] & PROTOCOL_TYPE_PRIORITY) && action != RULE_ACTION_SILENT) {
+        flags |= NOTIFICATION_FLAG_PRIORITY;
+    }
+
+    /* Decoded on the main loop before the user can swipe to it */
+    icons_prefetch(meta.icon_id);
+
+    TRACE_POINT(PARSED, meta.key);
+    notifications_add_notification_meta(&meta, app_name, sender, content, timestamp, flags);
+
+    if (flags & NOTIFICATION_FLAG_PRIORITY) {
+        lvgl_arm_frame_probe(rx_cycles);
+        lvgl_request_refresh();
+    }
+    return 0;
+}
+
+static int handle_set_rules(const uint8_t* data, size_t len)
+{
+    uint16_t offset, total;
+    int ret;
+
+    if (len < PROTOCOL_RULES_HEADER_LEN) {
+        return -EINVAL;
+    }
+
+    offset = data[2] | (data[3] << 8);
+    total = data[4] | (data[5] << 8);
+
+    ret = rules_receive_chunk(offset, total, &data[PROTOCOL_RULES_HEADER_LEN],
+        len - PROTOCOL_RULES_HEADER_LEN);
+    return (ret < 0) ? ret : 0;
+}
+
+static int handle_set_time(const uint8_t* data, size_t len)
+{
+    struct clock_time time;
+
+    if (len < 4) {
+        return -EINVAL;
+    }
+
+    time.hours = data[1];
+    time.minutes = data[2];
+    time.seconds = data[3];
+    return clock_set_time(&time);
+}
+
+static int handle_action_ack(const uint8_t* data, size_t len)
+{
+    if (len < 3) {
+        return -EINVAL;
+    }
+
+    bluetooth_action_acked(data[1], data[2]);
+    return 0;
+}
+
+static int handle_set_icon(const uint8_t* data, size_t len)
+{
+    if (len <= PROTOCOL_ICON_HEADER_LEN) {
+        return -EINVAL;
+    }
+
+    return icons_store(sys_get_le32(&data[1]), &data[PROTOCOL_ICON_HEADER_LEN],
+        len - PROTOCOL_ICON_HEADER_LEN);
+}
+
+static int handle_set_dnd(const uint8_t* data, size_t len)
+{
+    uint16_t start, end;
+
+    if (len < PROTOCOL_DND_LEN) {
+        return -EINVAL;
+    }
+
+    start = data[2] | (data[3] << 8);
+    end = data[4] | (data[5] << 8);
+    return dnd_set_schedule(data[1] != 0, start, end);
+}
+
+static int handle_search(const uint8_t* data, size_t len)
+{
+    if (len < 2) {
+        return -EINVAL;
+    }
+
+    notifications_search((const char*)&data[1], len - 1);
+    return 0;
+}
+
+bool protocol_is_priority_packet(const uint8_t* data, size_t len)
+{
+    return len >= 2 && data[0] == CMD_ADD_NOTIFICATION && (data[1] & PROTOCOL_TYPE_PRIORITY);
+}
+
+int protocol_handle_packet(uint8_t source, const uint8_t* data, size_t len, uint32_t rx_cycles)
+{
+    int ret;
+
+    if (!data || len == 0) {
+        return -EINVAL;
+    }
+
+    switch (data[0]) {
+    case CMD_ADD_NOTIFICATION:
+        ret = handle_add_notification(source, data, len, rx_cycles);
+        break;
+    case CMD_CLEAR_ALL:
+        notifications_clear_all();
+        ret = 0;
+        break;
+    case CMD_SET_RULES:
+        ret = handle_set_rules(data, len);
+        break;
+    case CMD_SET_TIME:
+        ret = handle_set_time(data, len);
+        break;
+    case CMD_SET_DND:
+        ret = handle_set_dnd(data, len);
+        break;
+    case CMD_ACTION_ACK:
+        ret = handle_action_ack(data, len);
+        break;
+    case CMD_SET_ICON:
+        ret = handle_set_icon(data, len);
+        break;
+    case CMD_SEARCH:
+        ret = handle_search(data, len);
+        break;
+    default:
+        LOG_WRN("Unsupported command 0x%02x", data[0]);
+        return -ENOTSUP;
+    }
+
+    if (ret < 0) {
+        LOG_WRN("Command 0x%02x failed (ret: %d)", data[0], ret);
+    }
+    return ret;
+}
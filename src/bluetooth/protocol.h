@@ -0,0 +1,123 @@
+/**
+ * @file protocol.h
+ * @brief Phone to Watch Protocol Parser Header
+ *
+ * Every packet starts with a command byte:
+ *
+ *   CMD_ADD_NOTIFICATION  [type] [app len] [title len] [text len] [key u32] [icon u32]
+ *                         app title text
+ *   CMD_CLEAR_ALL
+ *   CMD_SET_RULES         [flags] [offset u16] [total u16] program chunk
+ *   CMD_SET_TIME          [hours] [minutes] [seconds]
+ *   CMD_SET_DND           [enabled] [start minute u16] [end minute u16]
+ *   CMD_ACTION_ACK        [seq] [status]
+ *   CMD_SET_ICON          [icon u32] encoded icon (see icons.h)
+ *   CMD_SEARCH            query text
+ *
+ * Multi-byte values are little endian. The low bits of the notification type
+ * are the phone's category (phone, message, email, social, calendar, other),
+ * PROTOCOL_TYPE_PRIORITY marks urgent notifications, PROTOCOL_TYPE_HAS_KEY
+ * and PROTOCOL_TYPE_HAS_ICON say the optional key and icon id are present.
+ *
+ * The watch sends actions back on the action characteristic (notify):
+ *
+ *   CMD_ACTION            [action] [seq] [key u32] reply text
+ *
+ * and the phone acknowledges each one with CMD_ACTION_ACK once performed.
+ * PROTOCOL_ACTION_REQUEST_ICON carries an icon id instead of a notification
+ * key, and is answered with CMD_SET_ICON.
+ *
+ * The stats characteristic (read) holds the receipt to glass latency
+ * summary, encoded as described in latency.h.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Command bytes */
+#define CMD_ADD_NOTIFICATION 0x01
+#define CMD_REMOVE_NOTIFICATION 0x02
+#define CMD_CLEAR_ALL 0x03
+#define CMD_ACTION 0x04
+#define CMD_SET_RULES 0x05
+#define CMD_SET_TIME 0x06
+#define CMD_SET_DND 0x07
+#define CMD_ACTION_ACK 0x08
+#define CMD_SET_ICON 0x09
+#define CMD_SEARCH 0x0A
+
+/** @brief Actions sent from the watch with CMD_ACTION */
+#define PROTOCOL_ACTION_DISMISS 0x01
+#define PROTOCOL_ACTION_MARK_READ 0x02
+#define PROTOCOL_ACTION_OPEN 0x03
+#define PROTOCOL_ACTION_REPLY 0x04
+#define PROTOCOL_ACTION_REQUEST_ICON 0x10
+
+/** @brief Notification type bits */
+#define PROTOCOL_TYPE_PRIORITY 0x80
+#define PROTOCOL_TYPE_HAS_KEY 0x40
+#define PROTOCOL_TYPE_HAS_ICON 0x20
+#define PROTOCOL_TYPE_CATEGORY_MASK 0x1F
+
+/** @brief CMD_ADD_NOTIFICATION header length */
+#define PROTOCOL_ADD_HEADER_LEN 5
+
+/** @brief Notification key length, after the header with PROTOCOL_TYPE_HAS_KEY */
+#define PROTOCOL_KEY_LEN 4
+
+/** @brief Icon id length, after the key with PROTOCOL_TYPE_HAS_ICON */
+#define PROTOCOL_ICON_ID_LEN 4
+
+/** @brief CMD_SET_ICON header length, before the encoded icon */
+#define PROTOCOL_ICON_HEADER_LEN 5
+
+/** @brief CMD_ACTION header length, before the reply text */
+#define PROTOCOL_ACTION_HEADER_LEN 7
+
+/** @brief CMD_SET_RULES header length */
+#define PROTOCOL_RULES_HEADER_LEN 6
+
+/** @brief CMD_SET_DND packet length */
+#define PROTOCOL_DND_LEN 6
+
+/**
+ * @brief Check if a packet is an urgent notification
+ *
+ * @param data Packet bytes
+ * @param len Packet length
+ * @return true for CMD_ADD_NOTIFICATION packets with PROTOCOL_TYPE_PRIORITY
+ */
+bool protocol_is_priority_packet(const uint8_t* data, size_t len);
+
+/**
+ * @brief Handle one packet received from the phone
+ *
+ * Priority notifications are rendered right away and the time from
+ * rx_cycles until they reach the panel is measured.
+ *
+ * @param source Connection the packet arrived on, for de-duplication
+ * @param data Packet bytes
+ * @param len Packet length
+ * @param rx_cycles Cycle count when the packet was received
+ *
+ * @retval 0 Packet handled
+ * @retval -EINVAL Malformed packet
+ * @retval -ENOTSUP Unknown or unsupported command
+ */
+int protocol_handle_packet(uint8_t source, const uint8_t* data, size_t len, uint32_t rx_cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROTOCOL_H */
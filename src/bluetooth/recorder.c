@@ -0,0 +1,287 @@
+/**
+ * @file recorder.c
+ * @brief Notification Traffic Recorder Implementation
+ *
+ * The ring is a byte buffer, records wrap around its end. Adding a record
+ * drops as many of the oldest as it needs room for.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/recorder.h"
+
+#if defined(CONFIG_TRAFFIC_RECORDER)
+
+#define RING_SIZE CONFIG_TRAFFIC_RECORDER_SIZE
+
+BUILD_ASSERT(RING_SIZE >= RECORDER_HEADER_LEN + BLUETOOTH_MAX_PACKET_LEN,
+    "Recorder ring too small for a packet");
+
+static uint8_t ring[RING_SIZE];
+static size_t head; /* Oldest record */
+static size_t used;
+static bool running;
+static int64_t last_us; /* Time of the latest record */
+static uint64_t total_delta_us; /* Of the records in the ring */
+static struct recorder_stats stats;
+static struct k_spinlock lock;
+
+static void ring_read(size_t pos, uint8_t* buf, size_t len)
+{
+    size_t first = MIN(len, RING_SIZE - pos);
+
+    memcpy(buf, &ring[pos], first);
+    memcpy(buf + first, ring, len - first);
+}
+
+static void ring_write(size_t pos, const uint8_t* buf, size_t len)
+{
+    size_t first = MIN(len, RING_SIZE - pos);
+
+    memcpy(&ring[pos], buf, first);
+    memcpy(ring, buf + first, len - first);
+}
+
+static void read_header(size_t pos, uint32_t* delta_us, uint16_t* len, uint8_t* source)
+{
+    uint8_t header[RECORDER_HEADER_LEN];
+
+    ring_read(pos, header, sizeof(header));
+    *delta_us = sys_get_le32(&header[0]);
+    *len = sys_get_le16(&header[4]);
+    *source = header[6];
+}
+
+static void drop_oldest(void)
+{
+    uint32_t delta_us;
+    uint16_t len;
+    uint8_t source;
+
+    read_header(head, &delta_us, &len, &source);
+    head = (head + RECORDER_HEADER_LEN + len) % RING_SIZE;
+    used -= RECORDER_HEADER_LEN + len;
+    total_delta_us -= delta_us;
+    stats.records--;
+    stats.dropped++;
+}
+
+int recorder_start(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    head = 0;
+    used = 0;
+    total_delta_us = 0;
+    memset(&stats, 0, sizeof(stats));
+    last_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    running = true;
+
+    k_spin_unlock(&lock, key);
+    return 0;
+}
+
+void recorder_stop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    running = false;
+    k_spin_unlock(&lock, key);
+}
+
+void recorder_add(uint8_t source, const uint8_t* data, size_t len)
+{
+    uint8_t header[RECORDER_HEADER_LEN];
+    size_t need = RECORDER_HEADER_LEN + len;
+    k_spinlock_key_t key;
+    int64_t now_us;
+    uint32_t delta_us;
+
+    if (len > BLUETOOTH_MAX_PACKET_LEN) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    if (!running) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    now_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    delta_us = (uint32_t)MIN(now_us - last_us, (int64_t)UINT32_MAX);
+    last_us = now_us;
+
+    while (RING_SIZE - used < need) {
+        drop_oldest();
+    }
+
+    sys_put_le32(delta_us, &header[0]);
+    sys_put_le16(len, &header[4]);
+    header[6] = source;
+    ring_write((head + used) % RING_SIZE, header, sizeof(header));
+    ring_write((head + used + RECORDER_HEADER_LEN) % RING_SIZE, data, len);
+    used += need;
+    total_delta_us += delta_us;
+    stats.records++;
+
+    k_spin_unlock(&lock, key);
+}
+
+int recorder_foreach(recorder_cb_t cb, void* ctx)
+{
+    /* Static, the shell thread stack is small; the ring does not change
+     * while stopped */
+    static uint8_t packet[BLUETOOTH_MAX_PACKET_LEN];
+    size_t pos = head;
+    uint32_t delta_us;
+    uint16_t len;
+    uint8_t source;
+
+    if (running) {
+        return -EBUSY;
+    }
+
+    for (uint32_t i = 0; i < stats.records; i++) {
+        read_header(pos, &delta_us, &len, &source);
+        ring_read((pos + RECORDER_HEADER_LEN) % RING_SIZE, packet, len);
+        cb(delta_us, source, packet, len, ctx);
+        pos = (pos + RECORDER_HEADER_LEN + len) % RING_SIZE;
+    }
+
+    return 0;
+}
+
+void recorder_get_stats(struct recorder_stats* out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t first_delta_us = 0;
+    uint16_t len;
+    uint8_t source;
+
+    if (stats.records > 0) {
+        read_header(head, &first_delta_us, &len, &source);
+    }
+
+    *out = stats;
+    out->running = running;
+    out->bytes = used;
+    out->duration_ms = (uint32_t)((total_delta_us - first_delta_us) / 1000U);
+
+    k_spin_unlock(&lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+/** @brief Packet bytes printed per shell write */
+#define DUMP_CHUNK 32
+
+static void dump_record(uint32_t delta_us, uint8_t source, const uint8_t* data, size_t len,
+    void* ctx)
+{
+    const struct shell* sh = ctx;
+    char hex[DUMP_CHUNK * 2 + 1];
+
+    shell_fprintf(sh, SHELL_NORMAL, "t %u %u ", delta_us, source);
+    for (size_t i = 0; i < len; i += DUMP_CHUNK) {
+        bin2hex(&data[i], MIN(len - i, DUMP_CHUNK), hex, sizeof(hex));
+        shell_fprintf(sh, SHELL_NORMAL, "%s", hex);
+    }
+    shell_fprintf(sh, SHELL_NORMAL, "\n");
+}
+
+static int cmd_recorder_start(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    recorder_start();
+    shell_print(sh, "Recording into %u bytes", RING_SIZE);
+    return 0;
+}
+
+static int cmd_recorder_stop(const struct shell* sh, size_t argc, char** argv)
+{
+    struct recorder_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    recorder_stop();
+    recorder_get_stats(&s);
+    shell_print(sh, "Stopped, %u records over %u ms", s.records, s.duration_ms);
+    return 0;
+}
+
+static int cmd_recorder_dump(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    /* Records must not move while they are printed */
+    recorder_stop();
+    return recorder_foreach(dump_record, (void*)sh);
+}
+
+static int cmd_recorder_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct recorder_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    recorder_get_stats(&s);
+    shell_print(sh, "%s, %u records over %u ms, %u/%u bytes, %u dropped",
+        s.running ? "recording" : "stopped", s.records, s.duration_ms, s.bytes, RING_SIZE,
+        s.dropped);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(recorder_cmds,
+    SHELL_CMD(start, NULL, "Clear the ring and record received packets", cmd_recorder_start),
+    SHELL_CMD(stop, NULL, "Stop recording", cmd_recorder_stop),
+    SHELL_CMD(dump, NULL, "Stop and print the records for replay", cmd_recorder_dump),
+    SHELL_CMD(stats, NULL, "Show recorder statistics", cmd_recorder_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(recorder, &recorder_cmds, "Notification traffic recorder", NULL);
+#endif /* CONFIG_SHELL */
+
+#else /* !CONFIG_TRAFFIC_RECORDER */
+
+int recorder_start(void)
+{
+    return -ENOTSUP;
+}
+
+void recorder_stop(void)
+{
+}
+
+void recorder_add(uint8_t source, const uint8_t* data, size_t len)
+{
+    ARG_UNUSED(source);
+    ARG_UNUSED(data);
+    ARG_UNUSED(len);
+}
+
+int recorder_foreach(recorder_cb_t cb, void* ctx)
+{
+    ARG_UNUSED(cb);
+    ARG_UNUSED(ctx);
+    return -ENOTSUP;
+}
+
+void recorder_get_stats(struct recorder_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif /* CONFIG_TRAFFIC_RECORDER */
@@ -0,0 +1,114 @@
+/**
+ * @file recorder.h
+ * @brief Notification Traffic Recorder Header
+ *
+ * Records the packets phones write to the notification characteristic,
+ * with their arrival times, so real traffic can be replayed on native_sim
+ * as a repeatable benchmark (see replay/). Packets are recorded as written,
+ * before the receive lanes, so the load offered is replayed, including the
+ * packets the watch had to push back.
+ *
+ * Records are kept in a RAM ring of CONFIG_TRAFFIC_RECORDER_SIZE bytes.
+ * When it is full the oldest records are dropped, so the ring always holds
+ * the latest traffic:
+ *
+ *   [delta us u32] [len u16] [source] packet[len]
+ *
+ * where delta is the time since the previous record was written. The
+ * first record's delta counts from a dropped record or from the start of
+ * the recording; replay starts with it.
+ *
+ * The shell dumps records one per line, the format replay reads:
+ *
+ *   t <delta us> <source> <packet hex>
+ *
+ * Without CONFIG_TRAFFIC_RECORDER nothing is recorded and
+ * recorder_start() fails.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Record header: delta, length and source */
+#define RECORDER_HEADER_LEN 7
+
+/**
+ * @brief Recorder statistics
+ */
+struct recorder_stats {
+    bool running;
+    uint32_t records; /**< Records in the ring */
+    uint32_t bytes; /**< Ring bytes used by them */
+    uint32_t dropped; /**< Oldest records dropped for new ones */
+    uint32_t duration_ms; /**< Time covered by the records in the ring */
+};
+
+/**
+ * @brief Called for each record, oldest first
+ *
+ * @param delta_us Time since the previous record
+ * @param source Connection the packet arrived on
+ * @param data Packet bytes
+ * @param len Packet length
+ * @param ctx Passed to recorder_foreach()
+ */
+typedef void (*recorder_cb_t)(uint32_t delta_us, uint8_t source, const uint8_t* data, size_t len,
+    void* ctx);
+
+/**
+ * @brief Clear the ring and start recording
+ *
+ * @retval 0 Recording
+ * @retval -ENOTSUP Built without CONFIG_TRAFFIC_RECORDER
+ */
+int recorder_start(void);
+
+/**
+ * @brief Stop recording, the records are kept
+ */
+void recorder_stop(void);
+
+/**
+ * @brief Record a packet written by a phone
+ *
+ * Safe to call from any thread. Does nothing unless recording.
+ *
+ * @param source Connection the packet arrived on
+ * @param data Packet bytes
+ * @param len Packet length
+ */
+void recorder_add(uint8_t source, const uint8_t* data, size_t len);
+
+/**
+ * @brief Walk the records, oldest first
+ *
+ * @param cb Called for each record
+ * @param ctx Passed to cb
+ * @retval 0 Success
+ * @retval -EBUSY Still recording, stop first
+ * @retval -ENOTSUP Built without CONFIG_TRAFFIC_RECORDER
+ */
+int recorder_foreach(recorder_cb_t cb, void* ctx);
+
+/**
+ * @brief Get recorder statistics
+ *
+ * @param stats Output for the statistics
+ */
+void recorder_get_stats(struct recorder_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RECORDER_H */
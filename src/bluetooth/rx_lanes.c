@@ -0,0 +1,149 @@
+/**
+ * @file rx_lanes.c
+ * @brief Receive Lanes Implementation
+ *
+ * Lanes are message queues of whole packets. Writers are serialized by a
+ * spinlock, the load generator writes from a timer next to the Bluetooth
+ * thread.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "bluetooth/protocol.h"
+#include "bluetooth/rx_lanes.h"
+#include "bluetooth/rx_sched.h"
+
+BUILD_ASSERT(BLUETOOTH_MAX_PEERS <= RX_SCHED_MAX_QUEUES, "Too many peers to schedule");
+BUILD_ASSERT(BLUETOOTH_MAX_PACKET_LEN <= RX_SCHED_QUANTUM, "Quantum must cover a packet");
+
+/* Shared by all peers, urgent notifications go first whoever sent them */
+K_MSGQ_DEFINE(priority_queue, sizeof(struct rx_packet), BLUETOOTH_RX_PRIORITY_QUEUE_LEN, 4);
+
+/**
+ * @brief Normal lane of a connection slot
+ */
+static struct {
+    struct k_msgq queue;
+    char __aligned(4) buf[BLUETOOTH_RX_QUEUE_LEN * sizeof(struct rx_packet)];
+} lanes[BLUETOOTH_MAX_PEERS];
+
+static struct rx_sched rx_sched;
+static struct rx_lanes_stats stats;
+
+/* Serializes writers of the lanes and updates of their statistics */
+static struct k_spinlock lock;
+
+void rx_lanes_init(void)
+{
+    k_msgq_purge(&priority_queue);
+    for (size_t i = 0; i < ARRAY_SIZE(lanes); i++) {
+        k_msgq_init(&lanes[i].queue, lanes[i].buf, sizeof(struct rx_packet),
+            BLUETOOTH_RX_QUEUE_LEN);
+    }
+    rx_sched_init(&rx_sched);
+    memset(&stats, 0, sizeof(stats));
+}
+
+int rx_lanes_put(uint8_t source, uint8_t conn_id, const uint8_t* data, size_t len)
+{
+    /* Static, the Bluetooth RX thread stack is small */
+    static struct rx_packet packet;
+    k_spinlock_key_t key;
+    int ret = 0;
+
+    if (source >= BLUETOOTH_MAX_PEERS || len == 0 || len > BLUETOOTH_MAX_PACKET_LEN) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+
+    packet.rx_cycles = k_cycle_get_32();
+    packet.len = len;
+    packet.source = source;
+    packet.conn_id = conn_id;
+    memcpy(packet.data, data, len);
+
+    /* Full priority lane: fall back to the normal lane rather than drop */
+    if (protocol_is_priority_packet(packet.data, len)
+        && k_msgq_put(&priority_queue, &packet, K_NO_WAIT) == 0) {
+        stats.priority++;
+        ret = 1;
+    } else if (k_msgq_put(&lanes[source].queue, &packet, K_NO_WAIT) == 0) {
+        stats.normal++;
+    } else {
+        /* A full queue pushes back on its own peer only */
+        stats.rejected++;
+        stats.peers[source].rx_rejected++;
+        ret = -ENOBUFS;
+    }
+
+    if (ret >= 0) {
+        stats.peers[source].rx_packets++;
+        stats.peers[source].rx_bytes += len;
+    }
+
+    k_spin_unlock(&lock, key);
+    return ret;
+}
+
+/**
+ * @brief Take the next normal lane packet, fairly across peers
+ */
+static bool take_normal_packet(struct rx_packet* packet)
+{
+    uint16_t head_len[BLUETOOTH_MAX_PEERS] = { 0 };
+    k_spinlock_key_t key;
+    int source;
+
+    for (size_t i = 0; i < ARRAY_SIZE(lanes); i++) {
+        if (k_msgq_peek(&lanes[i].queue, packet) == 0) {
+            head_len[i] = packet->len;
+        }
+    }
+
+    source = rx_sched_pick(&rx_sched, head_len, BLUETOOTH_MAX_PEERS);
+    if (source < 0) {
+        return false;
+    }
+
+    key = k_spin_lock(&lock);
+
+    k_msgq_get(&lanes[source].queue, packet, K_NO_WAIT);
+    stats.peers[source].served++;
+
+    k_spin_unlock(&lock, key);
+    return true;
+}
+
+bool rx_lanes_take(struct rx_packet* packet, bool* priority)
+{
+    /* Priority lane is checked again before every normal packet */
+    *priority = k_msgq_get(&priority_queue, packet, K_NO_WAIT) == 0;
+    return *priority || take_normal_packet(packet);
+}
+
+bool rx_lanes_pending(void)
+{
+    if (k_msgq_num_used_get(&priority_queue) > 0) {
+        return true;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(lanes); i++) {
+        if (k_msgq_num_used_get(&lanes[i].queue) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void rx_lanes_get_stats(struct rx_lanes_stats* out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *out = stats;
+
+    k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file rx_lanes.h
+ * @brief Receive Lanes Header
+ *
+ * Packets written by the phones wait here for the main loop. Urgent
+ * notifications go to a priority lane shared by all connections, everything
+ * else to the lane of the connection slot it arrived on. The main loop takes
+ * from the priority lane first, and from the connection lanes fairly (see
+ * rx_sched.h).
+ *
+ * Used by bluetooth.c on the watch and by the native_sim applications
+ * (sim/ingest.c), so both queue and schedule packets the same way.
+ *
+ * Packets are put from the Bluetooth thread or timers and taken on the main
+ * loop.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RX_LANES_H
+#define RX_LANES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bluetooth/bluetooth.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Packet waiting in a lane
+ */
+struct rx_packet {
+    uint32_t rx_cycles; /**< Receipt time, for latency measurement */
+    uint16_t len;
+    uint8_t source; /**< Peer index of the connection it arrived on */
+    uint8_t conn_id; /**< Identity of that connection, for de-duplication */
+    uint8_t data[BLUETOOTH_MAX_PACKET_LEN];
+};
+
+/**
+ * @brief Lane statistics since rx_lanes_init()
+ */
+struct rx_lanes_stats {
+    uint32_t normal; /**< Packets queued on a connection lane */
+    uint32_t priority; /**< Packets queued on the priority lane */
+    uint32_t rejected; /**< Packets rejected with full lanes */
+    struct bluetooth_peer_stats peers[BLUETOOTH_MAX_PEERS]; /**< By connection slot */
+};
+
+/**
+ * @brief Empty the lanes and clear the statistics
+ *
+ * Not while packets may be put.
+ */
+void rx_lanes_init(void);
+
+/**
+ * @brief Queue a received packet
+ *
+ * @param source Connection slot it arrives on, below BLUETOOTH_MAX_PEERS
+ * @param conn_id Identity of the connection
+ * @param data Packet bytes
+ * @param len Packet length
+ * @retval 0 Queued on the connection's lane
+ * @retval 1 Queued on the priority lane
+ * @retval -EINVAL Empty or too long
+ * @retval -ENOBUFS Lane full, pushed back
+ */
+int rx_lanes_put(uint8_t source, uint8_t conn_id, const uint8_t* data, size_t len);
+
+/**
+ * @brief Take the next packet, priority lane first (main loop only)
+ *
+ * @param packet Output for the packet
+ * @param priority Set to true if it came from the priority lane
+ * @retval true A packet was taken
+ * @retval false All lanes are empty
+ */
+bool rx_lanes_take(struct rx_packet* packet, bool* priority);
+
+/**
+ * @brief Check if packets are waiting
+ */
+bool rx_lanes_pending(void);
+
+/**
+ * @brief Get lane statistics
+ *
+ * @param stats Output for the statistics
+ */
+void rx_lanes_get_stats(struct rx_lanes_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RX_LANES_H */
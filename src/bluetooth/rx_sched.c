@@ -0,0 +1,54 @@
+/**
+ * @file rx_sched.c
+ * @brief Fair Scheduling of Per-Connection Receive Queues Implementation
+ *
+ * Classic deficit round robin: a queue keeps being served while its credit
+ * covers its head packet, then the next busy queue is credited a quantum.
+ * Empty queues lose their credit so an idle source cannot save up a burst.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+
+#include "bluetooth/rx_sched.h"
+
+void rx_sched_init(struct rx_sched* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+int rx_sched_pick(struct rx_sched* s, const uint16_t* head_len, size_t queues)
+{
+    size_t busy = 0;
+
+    for (size_t i = 0; i < queues; i++) {
+        if (head_len[i] == 0) {
+            s->deficit[i] = 0;
+        } else {
+            busy++;
+        }
+    }
+
+    if (busy == 0 || queues > RX_SCHED_MAX_QUEUES) {
+        return -1;
+    }
+    if (s->current >= queues) {
+        s->current = 0;
+    }
+
+    /* Ends within two laps, the quantum covers any packet */
+    for (;;) {
+        uint8_t i = s->current;
+
+        if (head_len[i] != 0 && s->deficit[i] >= head_len[i]) {
+            s->deficit[i] -= head_len[i];
+            return i;
+        }
+
+        s->current = (i + 1) % queues;
+        if (head_len[s->current] != 0) {
+            s->deficit[s->current] += RX_SCHED_QUANTUM;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file rx_sched.h
+ * @brief Fair Scheduling of Per-Connection Receive Queues Header
+ *
+ * Each connected central has its own receive queue, drained into the one
+ * notification store by the main loop. Deficit round robin picks the queue
+ * to serve next so that every busy connection gets an equal share of bytes,
+ * whatever its packet sizes, and a flooding source cannot starve the other.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RX_SCHED_H
+#define RX_SCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Most queues scheduled */
+#define RX_SCHED_MAX_QUEUES 4
+
+/** @brief Bytes credited to a queue per round, at least one full packet */
+#define RX_SCHED_QUANTUM 512
+
+/**
+ * @brief Scheduler state
+ */
+struct rx_sched {
+    uint8_t current; /**< Queue being served in this round */
+    int32_t deficit[RX_SCHED_MAX_QUEUES]; /**< Bytes a queue may still send */
+};
+
+/**
+ * @brief Reset the scheduler
+ *
+ * @param s Scheduler
+ */
+void rx_sched_init(struct rx_sched* s);
+
+/**
+ * @brief Pick the queue to take the next packet from
+ *
+ * The caller must take the head packet of the returned queue before
+ * calling again.
+ *
+ * @param s Scheduler
+ * @param head_len Length of each queue's head packet, 0 for an empty queue
+ * @param queues Number of queues, at most RX_SCHED_MAX_QUEUES
+ * @return Queue index, negative if all queues are empty
+ */
+int rx_sched_pick(struct rx_sched* s, const uint16_t* head_len, size_t queues);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RX_SCHED_H */
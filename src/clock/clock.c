@@ -0,0 +1,176 @@
+/**
+ * @file clock.c
+ * @brief Wall Clock Service Implementation
+ *
+ * Local time is kept as an offset from the kernel uptime in milliseconds.
+ * Until the time is set it starts from the firmware build time, which is
+ * close enough to make a freshly flashed watch look sensible.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "clock/clock.h"
+#include "notifications/notifications.h"
+
+LOG_MODULE_REGISTER(clock, LOG_LEVEL_INF);
+
+/** @brief Milliseconds in a day */
+#define MS_PER_DAY (24U * 60U * 60U * 1000U)
+
+/** @brief Milliseconds in a minute */
+#define MS_PER_MINUTE (60U * 1000U)
+
+/** @brief Milliseconds since midnight at uptime zero */
+static int64_t day_offset_ms = -1;
+
+/** @brief Flag indicating if the time was set explicitly */
+static bool time_set = false;
+
+/** @brief Last minute stamp pushed to the status bar */
+static uint32_t last_shown_minute = UINT32_MAX;
+
+/**
+ * @brief Get the offset, defaulting to the firmware build time
+ *
+ * @return Milliseconds since midnight at uptime zero
+ */
+static int64_t get_day_offset_ms(void)
+{
+    if (day_offset_ms < 0) {
+        /* __TIME__ is "HH:MM:SS" */
+        const char* build_time = __TIME__;
+        int hours = (build_time[0] - '0') * 10 + (build_time[1] - '0');
+        int minutes = (build_time[3] - '0') * 10 + (build_time[4] - '0');
+        int seconds = (build_time[6] - '0') * 10 + (build_time[7] - '0');
+
+        day_offset_ms = ((int64_t)hours * 3600 + minutes * 60 + seconds) * 1000;
+    }
+    return day_offset_ms;
+}
+
+/**
+ * @brief Get milliseconds since midnight of the first day of uptime
+ *
+ * @return Milliseconds, not wrapped to a single day
+ */
+static int64_t get_local_ms(void)
+{
+    return get_day_offset_ms() + k_uptime_get();
+}
+
+int clock_set_time(const struct clock_time* time)
+{
+    int64_t wanted_ms;
+
+    if (!time || time->hours > 23 || time->minutes > 59 || time->seconds > 59) {
+        return -EINVAL;
+    }
+
+    wanted_ms = ((int64_t)time->hours * 3600 + time->minutes * 60 + time->seconds) * 1000;
+
+    /* Keep the offset within one day so minute stamps stay small */
+    day_offset_ms = (wanted_ms - (k_uptime_get() % MS_PER_DAY) + MS_PER_DAY) % MS_PER_DAY;
+    time_set = true;
+
+    LOG_INF("Clock set to %02u:%02u:%02u", time->hours, time->minutes, time->seconds);
+    return 0;
+}
+
+void clock_get_time(struct clock_time* time)
+{
+    uint32_t day_ms;
+
+    if (!time) {
+        return;
+    }
+
+    day_ms = (uint32_t)(get_local_ms() % MS_PER_DAY);
+    time->hours = day_ms / (3600U * 1000U);
+    time->minutes = (day_ms / MS_PER_MINUTE) % 60U;
+    time->seconds = (day_ms / 1000U) % 60U;
+}
+
+void clock_format_hhmm(char* buf, size_t len)
+{
+    struct clock_time now;
+
+    clock_get_time(&now);
+    snprintf(buf, len, "%02u:%02u", now.hours, now.minutes);
+}
+
+uint32_t clock_get_minute_stamp(void)
+{
+    return (uint32_t)(get_local_ms() / MS_PER_MINUTE);
+}
+
+bool clock_is_set(void)
+{
+    return time_set;
+}
+
+void clock_process(void)
+{
+    char time_str[CLOCK_HHMM_STR_LEN];
+    uint32_t minute = clock_get_minute_stamp();
+
+    if (minute == last_shown_minute) {
+        return;
+    }
+
+    last_shown_minute = minute;
+    clock_format_hhmm(time_str, sizeof(time_str));
+    notifications_update_time(time_str);
+}
+
+void clock_reset(void)
+{
+    day_offset_ms = -1;
+    time_set = false;
+    last_shown_minute = UINT32_MAX;
+}
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+static int cmd_clock_get(const struct shell* sh, size_t argc, char** argv)
+{
+    struct clock_time now;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    clock_get_time(&now);
+    shell_print(sh, "%02u:%02u:%02u%s", now.hours, now.minutes, now.seconds,
+        time_set ? "" : " (not set)");
+    return 0;
+}
+
+static int cmd_clock_set(const struct shell* sh, size_t argc, char** argv)
+{
+    struct clock_time t = { 0 };
+
+    t.hours = strtoul(argv[1], NULL, 10);
+    t.minutes = strtoul(argv[2], NULL, 10);
+    if (argc > 3) {
+        t.seconds = strtoul(argv[3], NULL, 10);
+    }
+
+    if (clock_set_time(&t) < 0) {
+        shell_error(sh, "Invalid time");
+        return -EINVAL;
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(clock_cmds,
+    SHELL_CMD(get, NULL, "Show the current time", cmd_clock_get),
+    SHELL_CMD_ARG(set, NULL, "Set the time: <hh> <mm> [ss]", cmd_clock_set, 3, 1),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(clock, &clock_cmds, "Wall clock", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,89 @@
+/**
+ * @file clock.h
+ * @brief Wall Clock Service Header
+ *
+ * Keeps local wall-clock time on top of the kernel uptime, so it can be set
+ * once (by the phone or the shell) and read cheaply from anywhere.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Buffer size for an "HH:MM" string including terminator */
+#define CLOCK_HHMM_STR_LEN 6
+
+/**
+ * @brief Broken-down local time of day
+ */
+struct clock_time {
+    uint8_t hours; /**< 0-23 */
+    uint8_t minutes; /**< 0-59 */
+    uint8_t seconds; /**< 0-59 */
+};
+
+/**
+ * @brief Set the current local time of day
+ *
+ * @param time New time of day
+ * @return 0 on success, -EINVAL if a field is out of range
+ */
+int clock_set_time(const struct clock_time* time);
+
+/**
+ * @brief Get the current local time of day
+ *
+ * @param time Output for the current time
+ */
+void clock_get_time(struct clock_time* time);
+
+/**
+ * @brief Format the current time as "HH:MM"
+ *
+ * @param buf Output buffer
+ * @param len Buffer size, at least CLOCK_HHMM_STR_LEN
+ */
+void clock_format_hhmm(char* buf, size_t len);
+
+/**
+ * @brief Get a counter that increments once per wall-clock minute
+ *
+ * Cheap to poll. Consumers compare it with the last value they rendered to
+ * decide whether a redraw is needed.
+ *
+ * @return Minutes since midnight of the first day of uptime
+ */
+uint32_t clock_get_minute_stamp(void);
+
+/**
+ * @brief Check if the time was set since boot
+ *
+ * @retval true Time was set explicitly
+ * @retval false Time is still the build-time default
+ */
+bool clock_is_set(void);
+
+/**
+ * @brief Refresh the status bar time when the minute changes (call in main loop)
+ */
+void clock_process(void);
+
+/**
+ * @brief Forget the time set, back to the build-time default
+ */
+void clock_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_H */
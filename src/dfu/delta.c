@@ -0,0 +1,155 @@
+/**
+ * @file delta.c
+ * @brief Streaming Delta Patch Decoder Implementation
+ *
+ * Copies are done as soon as their offset is decoded, through the copy
+ * buffer; added bytes are written straight from the fed data. A chunk can
+ * end anywhere, inside a varint or a run of added bytes.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "dfu/delta.h"
+
+enum {
+    STATE_OP,
+    STATE_COPY_OFFSET,
+    STATE_ADD,
+};
+
+static uint32_t get_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int delta_parse_header(struct delta_header* header, const uint8_t* data, size_t len)
+{
+    if (len < DELTA_HEADER_SIZE || get_le32(data) != DELTA_MAGIC) {
+        return -EINVAL;
+    }
+
+    header->source_size = get_le32(data + 4);
+    header->target_size = get_le32(data + 8);
+    memcpy(header->source_sha, data + 12, DELTA_SHA256_SIZE);
+    return 0;
+}
+
+void delta_init(struct delta* d, const struct delta_header* header, delta_read_t read,
+    delta_write_t write, void* ctx)
+{
+    memset(d, 0, sizeof(*d));
+    d->header = *header;
+    d->read = read;
+    d->write = write;
+    d->ctx = ctx;
+    d->state = STATE_OP;
+}
+
+/**
+ * @brief Add a byte to the varint being decoded
+ *
+ * @return 1 when the varint is complete, 0 when more bytes follow,
+ *         -EINVAL when it does not fit 32 bits
+ */
+static int varint_add(struct delta* d, uint8_t byte)
+{
+    /* The fifth byte has room for the top 4 bits only */
+    if (d->varint_shift > 28 || (d->varint_shift == 28 && (byte & 0x70))) {
+        return -EINVAL;
+    }
+
+    d->varint |= (uint32_t)(byte & 0x7F) << d->varint_shift;
+    d->varint_shift += 7;
+    return (byte & 0x80) ? 0 : 1;
+}
+
+static int copy(struct delta* d)
+{
+    int32_t move = (int32_t)(d->varint >> 1) ^ -(int32_t)(d->varint & 1);
+    uint32_t pos = d->source_pos + (uint32_t)move;
+
+    if ((move < 0 && (uint32_t)-move > d->source_pos) || pos > d->header.source_size
+        || d->length > d->header.source_size - pos) {
+        return -EINVAL;
+    }
+
+    while (d->length > 0) {
+        size_t n = d->length < sizeof(d->buf) ? d->length : sizeof(d->buf);
+        int ret = d->read(d->ctx, pos, d->buf, n);
+
+        if (ret < 0) {
+            return ret;
+        }
+        ret = d->write(d->ctx, d->buf, n);
+        if (ret < 0) {
+            return ret;
+        }
+        pos += n;
+        d->length -= n;
+        d->written += n;
+    }
+
+    d->source_pos = pos;
+    return 0;
+}
+
+int delta_feed(struct delta* d, const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+    int ret;
+
+    while (i < len) {
+        if (d->state == STATE_ADD) {
+            size_t n = len - i < d->length ? len - i : d->length;
+
+            ret = d->write(d->ctx, data + i, n);
+            if (ret < 0) {
+                return ret;
+            }
+            i += n;
+            d->length -= n;
+            d->written += n;
+            if (d->length == 0) {
+                d->state = STATE_OP;
+            }
+            continue;
+        }
+
+        ret = varint_add(d, data[i++]);
+        if (ret <= 0) {
+            if (ret < 0) {
+                return ret;
+            }
+            continue;
+        }
+
+        if (d->state == STATE_COPY_OFFSET) {
+            ret = copy(d);
+            if (ret < 0) {
+                return ret;
+            }
+            d->state = STATE_OP;
+        } else {
+            d->length = d->varint >> 1;
+            if (d->length > d->header.target_size - d->written) {
+                return -EINVAL;
+            }
+            d->state = (d->varint & 1) == DELTA_OP_ADD ? STATE_ADD : STATE_COPY_OFFSET;
+            if (d->state == STATE_ADD && d->length == 0) {
+                d->state = STATE_OP;
+            }
+        }
+        d->varint = 0;
+        d->varint_shift = 0;
+    }
+
+    return 0;
+}
+
+bool delta_done(const struct delta* d)
+{
+    return d->written == d->header.target_size && d->state == STATE_OP && d->varint_shift == 0;
+}
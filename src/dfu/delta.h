@@ -0,0 +1,138 @@
+/**
+ * @file delta.h
+ * @brief Streaming Delta Patch Decoder Header
+ *
+ * A delta patch rebuilds a new firmware image from the running one, so a
+ * release that changes a few KB does not send the whole image. It is a
+ * header followed by operations, each a varint of (length << 1) | kind:
+ *
+ * - DELTA_OP_COPY: a zigzag varint moves the source position relative to
+ *   the end of the previous copy, then length source bytes are copied. Code
+ *   shifted by an edit keeps copying at a small offset, and the bytes that
+ *   did change (e.g. addresses in literal pools) are added in between.
+ * - DELTA_OP_ADD: length literal bytes follow.
+ *
+ * Patches are fed in chunks of any size as they arrive and the image is
+ * written out in order, with a fixed amount of RAM (the copy buffer).
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief "ZWD1", little endian */
+#define DELTA_MAGIC 0x3144575AU
+
+/** @brief Magic, source size, target size, source SHA-256 */
+#define DELTA_HEADER_SIZE 44
+
+#define DELTA_SHA256_SIZE 32
+
+/** @brief Source bytes copied per read */
+#define DELTA_COPY_BUF_SIZE 256
+
+/**
+ * @brief Operation kinds, the low bit of an operation's varint
+ */
+enum delta_op {
+    DELTA_OP_COPY,
+    DELTA_OP_ADD,
+};
+
+/**
+ * @brief Patch header
+ */
+struct delta_header {
+    uint32_t source_size; /**< Bytes of the running image the patch uses */
+    uint32_t target_size; /**< Bytes of the image it rebuilds */
+    uint8_t source_sha[DELTA_SHA256_SIZE]; /**< SHA-256 of those source bytes */
+};
+
+/**
+ * @brief Read source bytes
+ *
+ * @return 0 on success, negative errno code on failure
+ */
+typedef int (*delta_read_t)(void* ctx, uint32_t off, uint8_t* buf, size_t len);
+
+/**
+ * @brief Write the next image bytes
+ *
+ * @return 0 on success, negative errno code on failure
+ */
+typedef int (*delta_write_t)(void* ctx, const uint8_t* buf, size_t len);
+
+/**
+ * @brief Decoder state
+ */
+struct delta {
+    struct delta_header header;
+    delta_read_t read;
+    delta_write_t write;
+    void* ctx;
+    uint8_t state;
+    uint8_t varint_shift;
+    uint32_t varint;
+    uint32_t length; /**< Of the operation in progress */
+    uint32_t source_pos; /**< End of the previous copy */
+    uint32_t written;
+    uint8_t buf[DELTA_COPY_BUF_SIZE];
+};
+
+/**
+ * @brief Parse a patch header
+ *
+ * @param header Output for the header
+ * @param data First patch bytes
+ * @param len Their length, at least DELTA_HEADER_SIZE
+ * @retval 0 Success
+ * @retval -EINVAL Not a delta patch
+ */
+int delta_parse_header(struct delta_header* header, const uint8_t* data, size_t len);
+
+/**
+ * @brief Start decoding a patch after its header
+ *
+ * @param d Decoder
+ * @param header Header from delta_parse_header()
+ * @param read Source reader
+ * @param write Image writer
+ * @param ctx Passed to read and write
+ */
+void delta_init(struct delta* d, const struct delta_header* header, delta_read_t read,
+    delta_write_t write, void* ctx);
+
+/**
+ * @brief Decode the next patch bytes
+ *
+ * @param d Decoder
+ * @param data Patch bytes following the ones fed before
+ * @param len Their length
+ * @retval 0 Success
+ * @retval -EINVAL Malformed patch, it reaches outside the source or target
+ * @retval Negative errno codes from read and write
+ */
+int delta_feed(struct delta* d, const uint8_t* data, size_t len);
+
+/**
+ * @brief Check the whole target was written and no operation is pending
+ *
+ * @param d Decoder
+ * @return true once the image is complete
+ */
+bool delta_done(const struct delta* d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DELTA_H */
@@ -0,0 +1,470 @@
+/**
+ * @file dfu.c
+ * @brief Firmware Update Over BLE Implementation
+ *
+ * The upload itself is MCUmgr's image management; this module watches it
+ * through the MCUmgr callbacks, which run on the SMP work queue, to account
+ * throughput and to switch the link profile from the main loop.
+ *
+ * Delta patches are decoded by an SMP handler, on the same work queue, as
+ * their chunks arrive: source bytes are read from the primary slot and the
+ * image goes to the secondary slot through flash_img, which erases ahead
+ * progressively. The decoder's copy buffer and flash_img's write buffer are
+ * all the RAM it takes.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <mgmt/mcumgr/util/zcbor_bulk.h>
+#include <string.h>
+#include <zcbor_common.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/mgmt/mcumgr/grp/img_mgmt/img_mgmt.h>
+#include <zephyr/mgmt/mcumgr/grp/img_mgmt/img_mgmt_callbacks.h>
+#include <zephyr/mgmt/mcumgr/mgmt/callbacks.h>
+#include <zephyr/mgmt/mcumgr/mgmt/mgmt.h>
+#include <zephyr/mgmt/mcumgr/smp/smp.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "bluetooth/bluetooth.h"
+#include "dfu/delta.h"
+#include "dfu/dfu.h"
+
+#define SOURCE_AREA FIXED_PARTITION_ID(slot0_partition)
+#define TARGET_AREA FIXED_PARTITION_ID(slot1_partition)
+
+LOG_MODULE_REGISTER(dfu, LOG_LEVEL_INF);
+
+static struct k_spinlock lock;
+static struct dfu_stats stats;
+static int64_t last_chunk_ms = -1;
+static bool bulk = false; /* Main loop only */
+
+/* Delta upload in progress, SMP work queue only */
+static struct {
+    struct delta decoder;
+    struct flash_img_context image;
+    const struct flash_area* source;
+    uint8_t sha[DELTA_SHA256_SIZE]; /* Of the image to rebuild */
+    uint32_t size; /* Of the patch */
+    uint32_t off; /* Patch bytes decoded */
+    uint32_t apply_ms;
+    uint32_t verify_ms;
+    bool active;
+} delta_upload;
+
+/**
+ * @brief Account an upload chunk (SMP work queue)
+ */
+static void account_chunk(uint32_t off, uint32_t len, uint32_t size, int64_t now)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (off == 0) {
+        stats.size = size;
+    } else if (last_chunk_ms >= 0 && now - last_chunk_ms > DFU_IDLE_MS) {
+        stats.resumes++;
+    }
+
+    /* Pauses, e.g. while reconnecting, do not count against throughput */
+    if (last_chunk_ms >= 0 && now - last_chunk_ms <= DFU_IDLE_MS) {
+        stats.busy_ms += now - last_chunk_ms;
+    }
+
+    stats.offset = off + len;
+    stats.bytes += len;
+    last_chunk_ms = now;
+
+    k_spin_unlock(&lock, key);
+}
+
+static enum mgmt_cb_return on_img_event(uint32_t event, enum mgmt_cb_return prev_status,
+    int32_t* rc, uint16_t* group, bool* abort_more, void* data, size_t data_size)
+{
+    const struct img_mgmt_upload_check* check;
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(prev_status);
+    ARG_UNUSED(rc);
+    ARG_UNUSED(group);
+    ARG_UNUSED(abort_more);
+    ARG_UNUSED(data_size);
+
+    switch (event) {
+    case MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK:
+        check = data;
+        account_chunk(check->req->off, check->req->img_data.len, check->action->size,
+            k_uptime_get());
+        break;
+
+    case MGMT_EVT_OP_IMG_MGMT_DFU_STARTED:
+        key = k_spin_lock(&lock);
+        stats.uploads++;
+        stats.offset = 0;
+        k_spin_unlock(&lock, key);
+        LOG_INF("Firmware upload started");
+        break;
+
+    case MGMT_EVT_OP_IMG_MGMT_DFU_PENDING:
+        key = k_spin_lock(&lock);
+        stats.completed++;
+        k_spin_unlock(&lock, key);
+        LOG_INF("Firmware image received, swapped on the next reset");
+        break;
+
+    case MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED:
+        key = k_spin_lock(&lock);
+        stats.aborted++;
+        k_spin_unlock(&lock, key);
+        LOG_WRN("Firmware upload stopped");
+        break;
+
+    default:
+        break;
+    }
+
+    return MGMT_CB_OK;
+}
+
+static struct mgmt_callback img_callback = {
+    .callback = on_img_event,
+    .event_id = MGMT_EVT_OP_IMG_MGMT_ALL,
+};
+
+static int delta_read(void* ctx, uint32_t off, uint8_t* buf, size_t len)
+{
+    ARG_UNUSED(ctx);
+
+    return flash_area_read(delta_upload.source, off, buf, len);
+}
+
+static int delta_write(void* ctx, const uint8_t* buf, size_t len)
+{
+    ARG_UNUSED(ctx);
+
+    return flash_img_buffered_write(&delta_upload.image, buf, len, false);
+}
+
+/**
+ * @brief Compare the SHA-256 of the start of a slot
+ *
+ * The decoder's copy buffer, idle between chunks, is the read buffer.
+ */
+static int check_sha(uint8_t area_id, const uint8_t* sha, uint32_t size)
+{
+    const struct flash_area* fa;
+    struct flash_area_check check = {
+        .match = sha,
+        .clen = size,
+        .off = 0,
+        .rbuf = delta_upload.decoder.buf,
+        .rblen = sizeof(delta_upload.decoder.buf),
+    };
+    int64_t start = k_uptime_get();
+    int ret;
+
+    ret = flash_area_open(area_id, &fa);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = flash_area_check_int_sha256(fa, &check);
+    flash_area_close(fa);
+
+    delta_upload.verify_ms += k_uptime_get() - start;
+    return ret;
+}
+
+static void delta_fail(void)
+{
+    k_spinlock_key_t key;
+
+    if (delta_upload.source) {
+        flash_area_close(delta_upload.source);
+        delta_upload.source = NULL;
+    }
+    delta_upload.active = false;
+
+    key = k_spin_lock(&lock);
+    stats.delta_failed++;
+    k_spin_unlock(&lock, key);
+}
+
+/**
+ * @brief Check the patch applies to the running image and start it
+ *
+ * @return MGMT_ERR_EOK or the error to answer with
+ */
+static int delta_start(const struct zcbor_string* data, const struct zcbor_string* sha,
+    uint32_t size)
+{
+    struct delta_header header;
+    k_spinlock_key_t key;
+    int ret;
+
+    if (delta_upload.active) {
+        /* Abandoned before, started over */
+        delta_fail();
+    }
+
+    if (sha->len != DELTA_SHA256_SIZE || size < DELTA_HEADER_SIZE
+        || delta_parse_header(&header, data->value, data->len) < 0) {
+        return MGMT_ERR_EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+    stats.uploads++;
+    k_spin_unlock(&lock, key);
+
+    delta_upload.verify_ms = 0;
+    delta_upload.apply_ms = 0;
+    ret = check_sha(SOURCE_AREA, header.source_sha, header.source_size);
+    if (ret < 0) {
+        LOG_WRN("Delta patch is not for the running image (ret: %d)", ret);
+        delta_fail();
+        return MGMT_ERR_EBADSTATE;
+    }
+
+    ret = flash_area_open(SOURCE_AREA, &delta_upload.source);
+    if (ret == 0) {
+        ret = flash_img_init_id(&delta_upload.image, TARGET_AREA);
+    }
+    if (ret < 0) {
+        LOG_ERR("Failed to open the slots (ret: %d)", ret);
+        delta_fail();
+        return MGMT_ERR_EUNKNOWN;
+    }
+
+    delta_init(&delta_upload.decoder, &header, delta_read, delta_write, NULL);
+    memcpy(delta_upload.sha, sha->value, DELTA_SHA256_SIZE);
+    delta_upload.size = size;
+    delta_upload.off = 0;
+    delta_upload.active = true;
+    LOG_INF("Delta patch of %u bytes for a %u byte image", size, header.target_size);
+    return MGMT_ERR_EOK;
+}
+
+/**
+ * @brief Verify the rebuilt image and mark it for the test swap
+ *
+ * @return MGMT_ERR_EOK or the error to answer with
+ */
+static int delta_finish(void)
+{
+    uint32_t image_size = delta_upload.decoder.header.target_size;
+    k_spinlock_key_t key;
+    int ret;
+
+    if (!delta_done(&delta_upload.decoder)) {
+        LOG_ERR("Delta patch ended before the image");
+        delta_fail();
+        return MGMT_ERR_EINVAL;
+    }
+
+    ret = flash_img_buffered_write(&delta_upload.image, NULL, 0, true);
+    if (ret == 0) {
+        ret = check_sha(TARGET_AREA, delta_upload.sha, image_size);
+    }
+    if (ret < 0) {
+        LOG_ERR("Rebuilt image failed verification (ret: %d)", ret);
+        delta_fail();
+        return MGMT_ERR_ECORRUPT;
+    }
+
+    ret = boot_request_upgrade(BOOT_UPGRADE_TEST);
+    if (ret < 0) {
+        LOG_ERR("Failed to mark the image for test (ret: %d)", ret);
+        delta_fail();
+        return MGMT_ERR_EUNKNOWN;
+    }
+
+    flash_area_close(delta_upload.source);
+    delta_upload.source = NULL;
+    delta_upload.active = false;
+
+    key = k_spin_lock(&lock);
+    stats.completed++;
+    stats.deltas++;
+    stats.delta_patch_size = delta_upload.size;
+    stats.delta_image_size = image_size;
+    stats.delta_apply_ms = delta_upload.apply_ms;
+    stats.delta_verify_ms = delta_upload.verify_ms;
+    k_spin_unlock(&lock, key);
+
+    LOG_INF("Delta image rebuilt in %u ms, verified in %u ms, swapped on the next reset",
+        delta_upload.apply_ms, delta_upload.verify_ms);
+    return MGMT_ERR_EOK;
+}
+
+/**
+ * @brief Delta upload command (SMP work queue)
+ *
+ * Chunks not at the expected offset, repeated or resumed from further
+ * back, are answered with that offset only.
+ */
+static int delta_upload_cmd(struct smp_streamer* ctxt)
+{
+    zcbor_state_t* zsd = ctxt->reader->zs;
+    zcbor_state_t* zse = ctxt->writer->zs;
+    struct zcbor_string data = { 0 };
+    struct zcbor_string sha = { 0 };
+    uint32_t off = UINT32_MAX;
+    uint32_t len = 0;
+    size_t decoded;
+    size_t skip = 0;
+    int64_t start;
+    int ret;
+    struct zcbor_map_decode_key_val fields[] = {
+        ZCBOR_MAP_DECODE_KEY_DECODER("off", zcbor_uint32_decode, &off),
+        ZCBOR_MAP_DECODE_KEY_DECODER("len", zcbor_uint32_decode, &len),
+        ZCBOR_MAP_DECODE_KEY_DECODER("sha", zcbor_bstr_decode, &sha),
+        ZCBOR_MAP_DECODE_KEY_DECODER("data", zcbor_bstr_decode, &data),
+    };
+
+    if (zcbor_map_decode_bulk(zsd, fields, ARRAY_SIZE(fields), &decoded) != 0
+        || off == UINT32_MAX) {
+        return MGMT_ERR_EINVAL;
+    }
+
+    if (off == 0) {
+        ret = delta_start(&data, &sha, len);
+        if (ret != MGMT_ERR_EOK) {
+            return ret;
+        }
+        skip = DELTA_HEADER_SIZE;
+    } else if (!delta_upload.active) {
+        /* Lost, e.g. to a reset, the phone starts over */
+        return MGMT_ERR_EBADSTATE;
+    }
+
+    if (off == delta_upload.off && data.len > 0) {
+        if (data.len > delta_upload.size - off) {
+            delta_fail();
+            return MGMT_ERR_EINVAL;
+        }
+
+        account_chunk(off, data.len, delta_upload.size, k_uptime_get());
+        start = k_uptime_get();
+        ret = delta_feed(&delta_upload.decoder, data.value + skip, data.len - skip);
+        delta_upload.apply_ms += k_uptime_get() - start;
+        if (ret < 0) {
+            LOG_ERR("Delta patch failed at %u (ret: %d)", off, ret);
+            delta_fail();
+            return MGMT_ERR_EINVAL;
+        }
+        delta_upload.off += data.len;
+
+        if (delta_upload.off == delta_upload.size) {
+            ret = delta_finish();
+            if (ret != MGMT_ERR_EOK) {
+                return ret;
+            }
+        }
+    }
+
+    if (!zcbor_tstr_put_lit(zse, "off") || !zcbor_uint32_put(zse, delta_upload.off)) {
+        return MGMT_ERR_EMSGSIZE;
+    }
+    return MGMT_ERR_EOK;
+}
+
+static const struct mgmt_handler dfu_handlers[] = {
+    [DFU_MGMT_ID_DELTA_UPLOAD] = {
+        .mh_read = NULL,
+        .mh_write = delta_upload_cmd,
+    },
+};
+
+static struct mgmt_group dfu_group = {
+    .mg_handlers = dfu_handlers,
+    .mg_handlers_count = ARRAY_SIZE(dfu_handlers),
+    .mg_group_id = DFU_MGMT_GROUP,
+};
+
+int dfu_init(void)
+{
+    int ret;
+
+    mgmt_callback_register(&img_callback);
+    mgmt_register_group(&dfu_group);
+
+    if (!IS_ENABLED(CONFIG_BOOTLOADER_MCUBOOT) || boot_is_img_confirmed()) {
+        return 0;
+    }
+
+    /* First boot after a test swap, keep this image */
+    ret = boot_write_img_confirmed();
+    if (ret < 0) {
+        LOG_ERR("Failed to confirm the image (ret: %d)", ret);
+        return ret;
+    }
+
+    LOG_INF("Updated image confirmed");
+    return 0;
+}
+
+void dfu_process(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool uploading = last_chunk_ms >= 0 && k_uptime_get() - last_chunk_ms <= DFU_IDLE_MS;
+
+    k_spin_unlock(&lock, key);
+
+    if (uploading != bulk) {
+        bulk = uploading;
+        bluetooth_set_bulk(bulk);
+    }
+}
+
+void dfu_get_stats(struct dfu_stats* out)
+{
+    k_spinlock_key_t key;
+
+    if (!out) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    *out = stats;
+    k_spin_unlock(&lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_dfu_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct dfu_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    dfu_get_stats(&s);
+    shell_print(sh, "uploads: %u started, %u completed, %u stopped, %u resumed", s.uploads,
+        s.completed, s.aborted, s.resumes);
+    shell_print(sh, "current image: %u / %u bytes", s.offset, s.size);
+    shell_print(sh, "throughput: %llu bytes in %llu ms, %u.%02u KB/s",
+        (unsigned long long)s.bytes, (unsigned long long)s.busy_ms,
+        s.busy_ms ? (uint32_t)(s.bytes * 1000 / 1024 / s.busy_ms) : 0U,
+        s.busy_ms ? (uint32_t)(s.bytes * 100000 / 1024 / s.busy_ms % 100) : 0U);
+    shell_print(sh, "deltas: %u applied, %u failed", s.deltas, s.delta_failed);
+    if (s.deltas > 0) {
+        shell_print(sh, "last delta: %u byte patch for a %u byte image (%u%%)", s.delta_patch_size,
+            s.delta_image_size, s.delta_patch_size * 100U / s.delta_image_size);
+        shell_print(sh, "last delta: rebuilt in %u ms, verified in %u ms", s.delta_apply_ms,
+            s.delta_verify_ms);
+    }
+    shell_print(sh, "link profile: %s", bulk ? "bulk" : "default");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(dfu_cmds,
+    SHELL_CMD(stats, NULL, "Show firmware upload statistics", cmd_dfu_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(dfu, &dfu_cmds, "Firmware update", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,93 @@
+/**
+ * @file dfu.h
+ * @brief Firmware Update Over BLE Header
+ *
+ * Firmware images are uploaded by the phone with MCUmgr's SMP protocol
+ * (image group) over its own GATT service, into MCUboot's secondary slot.
+ * After a test swap the new image confirms itself once Bluetooth is up, or
+ * MCUboot reverts it on the next reset.
+ *
+ * Uploads resume after a disconnect: the watch keeps the upload state, and
+ * every response carries the offset it expects next, so the phone continues
+ * from the last acknowledged offset. While chunks arrive the links run with
+ * the bulk profile (see bluetooth_set_bulk()). SMP requests are handled on
+ * MCUmgr's own low priority work queue with progressive erase, so the main
+ * loop keeps storing notifications during an upload.
+ *
+ * A release can also be sent as a delta patch against the running image
+ * (see delta.h) with the delta upload command of this module's own SMP
+ * group. It takes the same fields and resumes the same way as an image
+ * upload: "off", "data", and with the first chunk "len" (patch size) and
+ * "sha" (SHA-256 of the new image). The patch is rejected at offset 0 when
+ * the running image is not its source, and the rebuilt image must match
+ * "sha" before it is marked for the test swap.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DFU_H
+#define DFU_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Links return to the default profile after this long without chunks */
+#define DFU_IDLE_MS 3000
+
+/** @brief SMP group of the delta upload, MGMT_GROUP_ID_PERUSER */
+#define DFU_MGMT_GROUP 64
+
+/** @brief Delta upload command, write */
+#define DFU_MGMT_ID_DELTA_UPLOAD 0
+
+/**
+ * @brief Upload statistics
+ */
+struct dfu_stats {
+    uint32_t uploads; /**< Uploads started at offset 0 */
+    uint32_t completed; /**< Images fully received, pending the swap */
+    uint32_t aborted; /**< Uploads abandoned or failed */
+    uint32_t resumes; /**< Uploads continued after a pause of DFU_IDLE_MS */
+    uint32_t offset; /**< Bytes of the current image received */
+    uint32_t size; /**< Size of the current image */
+    uint64_t bytes; /**< Bytes received in all uploads */
+    uint64_t busy_ms; /**< Time receiving them, pauses excluded */
+    uint32_t deltas; /**< Delta patches applied and verified */
+    uint32_t delta_failed; /**< Delta patches refused or failing verification */
+    uint32_t delta_patch_size; /**< Last applied patch */
+    uint32_t delta_image_size; /**< Image it rebuilt */
+    uint32_t delta_apply_ms; /**< Time decoding it and writing the image */
+    uint32_t delta_verify_ms; /**< Time checking the source and the image */
+};
+
+/**
+ * @brief Register the upload hooks and the delta upload, confirm the image
+ *
+ * Call once Bluetooth is up: confirming proves the image can reach the
+ * phone again, an image that fails before this is reverted by MCUboot.
+ *
+ * @retval 0 Success
+ * @retval Negative errno codes on failure
+ */
+int dfu_init(void);
+
+/**
+ * @brief Switch the link profile with upload activity (call in main loop)
+ */
+void dfu_process(void);
+
+/**
+ * @brief Get upload statistics
+ *
+ * @param stats Output for the statistics
+ */
+void dfu_get_stats(struct dfu_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DFU_H */
@@ -9,14 +9,18 @@
  * - Display initialization and shutdown
  * - PWM-controlled backlight brightness adjustment
  * - Display blanking control
+ * - Panel controller sleep-in/sleep-out with wake latency measurement
  *
  * @author Yehuda@YehudaE.net
  */
 
 #include "display/display.h"
 #include <zephyr/drivers/display.h>
+#include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/pwm.h>
+#include <zephyr/drivers/spi.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/pm/device.h>
 
 LOG_MODULE_REGISTER(display, LOG_LEVEL_INF);
 
@@ -32,6 +36,30 @@ LOG_MODULE_REGISTER(display, LOG_LEVEL_INF);
 /** @brief Maximum brightness percentage */
 #define MAX_BRIGHTNESS_PERCENT 100U
 
+/** @brief Weight of the newest sample in the wake latency average (1/N) */
+#define WAKE_LATENCY_AVG_WEIGHT 4U
+
+/** @brief Panel controller node */
+#define LCD_NODE DT_CHOSEN(nr_lcd)
+
+/*
+ * The panel is either wired straight to a SPI bus with a data/command GPIO,
+ * or sits behind a MIPI DBI controller, depending on the board definition.
+ */
+#if DT_NODE_HAS_PROP(LCD_NODE, cmd_data_gpios)
+static const struct spi_dt_spec lcd_spi = SPI_DT_SPEC_GET(LCD_NODE, SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0);
+static const struct gpio_dt_spec lcd_cmd_data = GPIO_DT_SPEC_GET(LCD_NODE, cmd_data_gpios);
+#else
+#include <zephyr/drivers/mipi_dbi.h>
+static const struct mipi_dbi_config lcd_dbi_config = MIPI_DBI_CONFIG_DT(LCD_NODE, SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0);
+#endif
+
+/** @brief Flag indicating if the panel is in sleep-in mode */
+static bool display_sleeping = false;
+
+/** @brief Running average of panel wake latency in microseconds */
+static uint32_t wake_latency_avg_us = 0;
+
 /**
  * @brief Get and validate PWM backlight device
  *
@@ -97,6 +125,15 @@ int enable_display(void)
     }
     LOG_DBG("Initial PWM brightness configured (50%%)");
 
+    /* Wake the panel if a previous shutdown left it in sleep-in mode */
+    if (display_sleeping) {
+        ret = set_display_sleep(false);
+        if (ret < 0) {
+            LOG_ERR("Failed to wake panel from sleep (ret: %d)", ret);
+            return -ret;
+        }
+    }
+
     /* Enable display by turning off blanking */
     ret = display_blanking_off(display_dev);
     if (ret < 0) {
@@ -115,6 +152,7 @@ int enable_display(void)
  * This function performs cleanup operations when shutting down the display:
  * 1. Enables display blanking (turns off display)
  * 2. Sets backlight brightness to minimum
+ * 3. Puts the panel controller into sleep-in mode
  *
  * @return 0 on success, negative error code on failure
  */
@@ -156,6 +194,12 @@ int disable_display(void)
     }
     LOG_DBG("Backlight turned off");
 
+    /* Stop the panel controller as well, blanking alone keeps it scanning */
+    ret = set_display_sleep(true);
+    if (ret < 0 && ret != -ENOTSUP) {
+        LOG_WRN("Failed to put panel to sleep (ret: %d)", ret);
+    }
+
     LOG_INF("LCD display shutdown completed successfully");
     return 0;
 }
@@ -210,6 +254,31 @@ int change_brightness(uint8_t perc)
     return 0;
 }
 
+/**
+ * @brief Turn the display backlight fully off
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int turn_off_backlight(void)
+{
+    int ret;
+    struct pwm_dt_spec backlight;
+
+    ret = get_backlight_device(&backlight);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = pwm_set_dt(&backlight, PWM_PERIOD_NS, 0);
+    if (ret < 0) {
+        LOG_ERR("Failed to turn off backlight (ret: %d)", ret);
+        return ret;
+    }
+
+    LOG_DBG("Backlight turned off");
+    return 0;
+}
+
 /**
  * @brief Get current display status
  *
@@ -253,3 +322,128 @@ int set_display_blanking(bool blank)
 
     return ret;
 }
+
+/**
+ * @brief Set panel controller sleep state
+ *
+ * @param sleep true to enter sleep-in mode, false to wake the panel
+ * @return 0 on success, negative error code on failure
+ */
+int set_display_sleep(bool sleep)
+{
+#if defined(CONFIG_PM_DEVICE)
+    int ret;
+    uint32_t start_cycles;
+    uint32_t latency_us;
+    const struct device* display_dev = DEVICE_DT_GET(DT_CHOSEN(nr_lcd));
+
+    if (!device_is_ready(display_dev)) {
+        LOG_ERR("Display device is not ready");
+        return -ENODEV;
+    }
+
+    if (sleep == display_sleeping) {
+        return 0;
+    }
+
+    if (sleep) {
+        ret = pm_device_action_run(display_dev, PM_DEVICE_ACTION_SUSPEND);
+        if (ret < 0) {
+            LOG_ERR("Failed to enter panel sleep mode (ret: %d)", ret);
+            return ret;
+        }
+        display_sleeping = true;
+        LOG_DBG("Panel entered sleep-in mode");
+        return 0;
+    }
+
+    start_cycles = k_cycle_get_32();
+    ret = pm_device_action_run(display_dev, PM_DEVICE_ACTION_RESUME);
+    if (ret < 0) {
+        LOG_ERR("Failed to exit panel sleep mode (ret: %d)", ret);
+        return ret;
+    }
+    latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+    display_sleeping = false;
+
+    if (wake_latency_avg_us == 0) {
+        wake_latency_avg_us = latency_us;
+    } else {
+        wake_latency_avg_us = ((wake_latency_avg_us * (WAKE_LATENCY_AVG_WEIGHT - 1U)) + latency_us)
+            / WAKE_LATENCY_AVG_WEIGHT;
+    }
+
+    LOG_DBG("Panel woke from sleep in %u us (avg: %u us)", latency_us, wake_latency_avg_us);
+    return 0;
+#else
+    ARG_UNUSED(sleep);
+    return -ENOTSUP;
+#endif /* CONFIG_PM_DEVICE */
+}
+
+/**
+ * @brief Check panel controller sleep state
+ *
+ * @return true if the panel is in sleep-in mode, false otherwise
+ */
+bool is_display_sleeping(void)
+{
+    return display_sleeping;
+}
+
+/**
+ * @brief Get the measured panel wake latency
+ *
+ * @return Average wake latency in microseconds, 0 if never woken
+ */
+uint32_t get_display_wake_latency_us(void)
+{
+    return wake_latency_avg_us;
+}
+
+/**
+ * @brief Send a raw command to the panel controller
+ *
+ * @param cmd Controller command byte
+ * @param data Command parameters, may be NULL when len is 0
+ * @param len Number of parameter bytes
+ * @return 0 on success, negative error code on failure
+ */
+int send_display_command(uint8_t cmd, const uint8_t* data, size_t len)
+{
+    int ret;
+
+#if DT_NODE_HAS_PROP(LCD_NODE, cmd_data_gpios)
+    struct spi_buf buf = { .buf = &cmd, .len = sizeof(cmd) };
+    struct spi_buf_set buf_set = { .buffers = &buf, .count = 1 };
+
+    if (!spi_is_ready_dt(&lcd_spi) || !gpio_is_ready_dt(&lcd_cmd_data)) {
+        LOG_ERR("Display bus is not ready");
+        return -ENODEV;
+    }
+
+    /* Command byte with D/C asserted, parameters with it released */
+    gpio_pin_set_dt(&lcd_cmd_data, 1);
+    ret = spi_write_dt(&lcd_spi, &buf_set);
+    if (ret == 0 && data && len > 0) {
+        buf.buf = (void*)data;
+        buf.len = len;
+        gpio_pin_set_dt(&lcd_cmd_data, 0);
+        ret = spi_write_dt(&lcd_spi, &buf_set);
+    }
+#else
+    const struct device* dbi_dev = DEVICE_DT_GET(DT_PARENT(LCD_NODE));
+
+    if (!device_is_ready(dbi_dev)) {
+        LOG_ERR("Display bus is not ready");
+        return -ENODEV;
+    }
+
+    ret = mipi_dbi_command_write(dbi_dev, &lcd_dbi_config, cmd, data, len);
+#endif
+
+    if (ret < 0) {
+        LOG_ERR("Failed to send display command 0x%02x (ret: %d)", cmd, ret);
+    }
+    return ret;
+}
@@ -48,6 +48,7 @@ int enable_display(void);
  * This function performs graceful display shutdown:
  * - Enables display blanking (turns display off)
  * - Sets backlight to minimum brightness
+ * - Puts the panel controller into sleep-in mode
  *
  * @retval 0 Success
  * @retval Negative errno codes on failure
@@ -75,6 +76,18 @@ int disable_display(void);
  */
 int change_brightness(uint8_t perc);
 
+/**
+ * @brief Turn the display backlight fully off
+ *
+ * Sets the PWM duty cycle to zero. Unlike change_brightness() this bypasses
+ * the minimum brightness clamp. Use change_brightness() to turn it back on.
+ *
+ * @retval 0 Success
+ * @retval -ENODEV PWM device not ready
+ * @retval Other negative errno codes on PWM operation failure
+ */
+int turn_off_backlight(void);
+
 /**
  * @brief Get current display readiness status
  *
@@ -102,6 +115,61 @@ bool is_display_ready(void);
  */
 int set_display_blanking(bool blank);
 
+/**
+ * @brief Control panel controller sleep mode
+ *
+ * Sleep-in stops the panel's DC/DC converter, oscillator and GRAM scanning.
+ * Register settings and GRAM contents are retained, so waking only needs a
+ * sleep-out command and no re-initialization or redraw. Blanking and
+ * backlight are not touched, callers sequence those around this call.
+ *
+ * The duration of every wake is measured, see get_display_wake_latency_us().
+ *
+ * @param sleep true to enter sleep-in mode, false to wake the panel
+ *
+ * @retval 0 Success
+ * @retval -ENODEV Display device not ready
+ * @retval -ENOTSUP Panel power management is not available
+ * @retval Other negative errno codes on display operation failure
+ */
+int set_display_sleep(bool sleep);
+
+/**
+ * @brief Check whether the panel controller is in sleep-in mode
+ *
+ * @retval true Panel is sleeping
+ * @retval false Panel is awake
+ */
+bool is_display_sleeping(void);
+
+/**
+ * @brief Get the measured panel wake latency
+ *
+ * Returns the running average of the time taken by set_display_sleep(false),
+ * including the controller's mandatory sleep-out settling delay.
+ *
+ * @return Average wake latency in microseconds, 0 if never woken
+ */
+uint32_t get_display_wake_latency_us(void);
+
+/**
+ * @brief Send a raw command to the panel controller
+ *
+ * Writes a command byte and its parameters directly to the panel over the
+ * display bus, for controller features the display driver does not expose.
+ * Must not be called concurrently with display writes, in practice only from
+ * the LVGL thread or before LVGL is started.
+ *
+ * @param cmd Controller command byte
+ * @param data Command parameters, may be NULL when len is 0
+ * @param len Number of parameter bytes
+ *
+ * @retval 0 Success
+ * @retval -ENODEV Display bus not ready
+ * @retval Other negative errno codes on bus failure
+ */
+int send_display_command(uint8_t cmd, const uint8_t* data, size_t len);
+
 /**
  * @}
  */
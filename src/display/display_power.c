@@ -0,0 +1,515 @@
+/**
+ * @file display_power.c
+ * @brief Display Power State Machine Implementation
+ *
+ * The backlight is the dominant power draw on this board, so the display is
+ * stepped down whenever the user is not looking at it:
+ *
+ *   ACTIVE --(dim timeout)--> DIMMED --(off timeout)--> OFF
+ *     ^                          |                       |
+ *     +--------(touch)-----------+-----------------------+
+ *                                                        |
+ *   WAKE_ON_NOTIFICATION <------(new notification)-------+
+ *     |
+ *     +--(notification timeout)--> OFF
+ *
+ * With ambient mode enabled, AMBIENT (a very dim always-on face) takes the
+ * place of OFF in the diagram above.
+ *
+ * OFF has two depths. Short idle periods only blank the panel and cut the
+ * backlight, while long ones also put the panel controller into sleep-in
+ * mode. The depth is picked from the expected idle time (a running average
+ * of previous off periods) against a break-even derived from the measured
+ * panel wake latency. A blanked panel whose off period outlasts the
+ * break-even is put to sleep late rather than never.
+ *
+ * Time spent in every state is accumulated for battery analysis.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "display/display.h"
+#include "display/display_power.h"
+
+LOG_MODULE_REGISTER(display_power, LOG_LEVEL_INF);
+
+/** @brief Default idle time before dimming (10 seconds) */
+#define DEFAULT_DIM_TIMEOUT_MS 10000U
+
+/** @brief Default idle time in dimmed state before turning off (20 seconds) */
+#define DEFAULT_OFF_TIMEOUT_MS 20000U
+
+/** @brief Default on time after a notification wake (5 seconds) */
+#define DEFAULT_NOTIFICATION_TIMEOUT_MS 5000U
+
+/** @brief Backlight level while active */
+#define ACTIVE_BRIGHTNESS_PERCENT 50U
+
+/** @brief Backlight level while dimmed */
+#define DIMMED_BRIGHTNESS_PERCENT 10U
+
+/** @brief Backlight level of the ambient face (lowest the driver allows) */
+#define AMBIENT_BRIGHTNESS_PERCENT 5U
+
+/** @brief Shortest expected off period worth a panel sleep-in (30 seconds) */
+#define DEEP_SLEEP_MIN_IDLE_MS 30000U
+
+/** @brief Off period per microsecond of wake latency needed for sleep-in */
+#define DEEP_SLEEP_LATENCY_FACTOR 250U
+
+/** @brief Expected off period before any has been observed (60 seconds) */
+#define DEFAULT_EXPECTED_IDLE_MS 60000U
+
+/** @brief Weight of the newest sample in the expected idle average (1/N) */
+#define EXPECTED_IDLE_AVG_WEIGHT 4U
+
+/* Serializes state changes between the main loop and the LVGL thread */
+static K_MUTEX_DEFINE(power_lock);
+
+static display_power_state_t current_state = DISPLAY_STATE_ACTIVE;
+static struct display_power_timeouts timeouts = {
+    .dim_ms = DEFAULT_DIM_TIMEOUT_MS,
+    .off_ms = DEFAULT_OFF_TIMEOUT_MS,
+    .notification_ms = DEFAULT_NOTIFICATION_TIMEOUT_MS,
+};
+static struct display_power_stats stats;
+
+/** @brief Uptime of the last user activity or notification */
+static int64_t last_activity_ms;
+
+/** @brief Uptime when the current state was entered */
+static int64_t state_entered_ms;
+
+/** @brief Running average of observed off periods */
+static uint32_t expected_idle_ms = DEFAULT_EXPECTED_IDLE_MS;
+
+static bool initialized = false;
+
+static bool ambient_enabled = true;
+static display_power_state_cb_t state_cb = NULL;
+
+static const char* const state_names[DISPLAY_STATE_COUNT] = {
+    [DISPLAY_STATE_ACTIVE] = "active",
+    [DISPLAY_STATE_DIMMED] = "dimmed",
+    [DISPLAY_STATE_OFF] = "off",
+    [DISPLAY_STATE_WAKE_ON_NOTIFICATION] = "wake-on-notification",
+    [DISPLAY_STATE_AMBIENT] = "ambient",
+};
+
+/**
+ * @brief Get the state an idle display falls back to
+ *
+ * @return DISPLAY_STATE_AMBIENT or DISPLAY_STATE_OFF
+ */
+static display_power_state_t idle_state(void)
+{
+    return ambient_enabled ? DISPLAY_STATE_AMBIENT : DISPLAY_STATE_OFF;
+}
+
+/**
+ * @brief Check if a state shows nothing the user can act on
+ *
+ * @param state State to check
+ * @return true for OFF and AMBIENT
+ */
+static bool is_idle_state(display_power_state_t state)
+{
+    return state == DISPLAY_STATE_OFF || state == DISPLAY_STATE_AMBIENT;
+}
+
+/**
+ * @brief Get the off period from which a panel sleep-in pays off
+ *
+ * @return Break-even off period in milliseconds
+ */
+static uint32_t deep_sleep_break_even_ms(void)
+{
+    uint32_t latency_ms = (get_display_wake_latency_us() * DEEP_SLEEP_LATENCY_FACTOR) / 1000U;
+
+    return MAX(DEEP_SLEEP_MIN_IDLE_MS, latency_ms);
+}
+
+/**
+ * @brief Put the panel controller to sleep while off (power_lock must be held)
+ */
+static void enter_deep_off(void)
+{
+    int ret = set_display_sleep(true);
+
+    if (ret == 0) {
+        stats.deep_sleep_entries++;
+        LOG_DBG("Panel put to sleep (expected idle: %u ms)", expected_idle_ms);
+    } else if (ret != -ENOTSUP) {
+        LOG_WRN("Failed to put panel to sleep (ret: %d)", ret);
+    }
+}
+
+/**
+ * @brief Apply the hardware settings for a state
+ *
+ * @param from State being left
+ * @param to State being entered
+ * @return 0 on success, negative error code on failure
+ */
+static int apply_state(display_power_state_t from, display_power_state_t to)
+{
+    int ret;
+
+    if (to == DISPLAY_STATE_OFF) {
+        /* Backlight first so the blanking is never visible */
+        ret = turn_off_backlight();
+        if (ret < 0) {
+            return ret;
+        }
+        ret = set_display_blanking(true);
+        if (ret < 0) {
+            return ret;
+        }
+        if (expected_idle_ms >= deep_sleep_break_even_ms()) {
+            enter_deep_off();
+        }
+        return 0;
+    }
+
+    if (from == DISPLAY_STATE_OFF) {
+        /* GRAM survives sleep-in, so sleep-out is all the restore needed */
+        if (is_display_sleeping()) {
+            ret = set_display_sleep(false);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        ret = set_display_blanking(false);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    switch (to) {
+    case DISPLAY_STATE_DIMMED:
+        return change_brightness(DIMMED_BRIGHTNESS_PERCENT);
+    case DISPLAY_STATE_AMBIENT:
+        return change_brightness(AMBIENT_BRIGHTNESS_PERCENT);
+    default:
+        return change_brightness(ACTIVE_BRIGHTNESS_PERCENT);
+    }
+}
+
+/**
+ * @brief Switch to a new state (power_lock must be held)
+ *
+ * @param next State to enter
+ * @param now Current uptime in milliseconds
+ */
+static void enter_state(display_power_state_t next, int64_t now)
+{
+    int ret;
+    display_power_state_t prev = current_state;
+
+    if (next == prev) {
+        return;
+    }
+
+    ret = apply_state(prev, next);
+    if (ret < 0) {
+        LOG_ERR("Failed to enter display state %s (ret: %d)", state_names[next], ret);
+        return;
+    }
+
+    if (prev == DISPLAY_STATE_OFF) {
+        uint64_t off_ms = MIN(now - state_entered_ms, (int64_t)UINT32_MAX);
+        uint64_t weighted = (uint64_t)expected_idle_ms * (EXPECTED_IDLE_AVG_WEIGHT - 1U);
+
+        expected_idle_ms = (uint32_t)((weighted + off_ms) / EXPECTED_IDLE_AVG_WEIGHT);
+    }
+
+    stats.time_in_state_ms[prev] += now - state_entered_ms;
+    stats.transitions++;
+    state_entered_ms = now;
+    current_state = next;
+
+    LOG_DBG("Display state %s -> %s", state_names[prev], state_names[next]);
+
+    if (state_cb) {
+        state_cb(prev, next);
+    }
+}
+
+int display_power_init(void)
+{
+    int64_t now = k_uptime_get();
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+    memset(&stats, 0, sizeof(stats));
+    current_state = DISPLAY_STATE_ACTIVE;
+    last_activity_ms = now;
+    state_entered_ms = now;
+    initialized = true;
+    k_mutex_unlock(&power_lock);
+
+    LOG_INF("Display power management started (dim: %u ms, off: %u ms, notification: %u ms)",
+        timeouts.dim_ms, timeouts.off_ms, timeouts.notification_ms);
+    return 0;
+}
+
+void display_power_process(void)
+{
+    int64_t now;
+    int64_t idle_ms;
+
+    if (!initialized) {
+        return;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+
+    now = k_uptime_get();
+    idle_ms = now - last_activity_ms;
+
+    switch (current_state) {
+    case DISPLAY_STATE_ACTIVE:
+        if (idle_ms >= timeouts.dim_ms) {
+            enter_state(DISPLAY_STATE_DIMMED, now);
+        }
+        break;
+    case DISPLAY_STATE_DIMMED:
+        if (idle_ms >= (int64_t)timeouts.dim_ms + timeouts.off_ms) {
+            enter_state(idle_state(), now);
+        }
+        break;
+    case DISPLAY_STATE_WAKE_ON_NOTIFICATION:
+        if (idle_ms >= timeouts.notification_ms) {
+            enter_state(idle_state(), now);
+        }
+        break;
+    case DISPLAY_STATE_OFF:
+        /* Expected a short idle, but it has lasted long enough to sleep */
+        if (!is_display_sleeping() && (now - state_entered_ms) >= deep_sleep_break_even_ms()) {
+            enter_deep_off();
+        }
+        break;
+    default:
+        break;
+    }
+
+    k_mutex_unlock(&power_lock);
+}
+
+bool display_power_user_activity(void)
+{
+    bool was_off;
+    int64_t now;
+
+    if (!initialized) {
+        return false;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+
+    now = k_uptime_get();
+    was_off = is_idle_state(current_state);
+    last_activity_ms = now;
+    enter_state(DISPLAY_STATE_ACTIVE, now);
+
+    k_mutex_unlock(&power_lock);
+
+    return was_off;
+}
+
+void display_power_notification_event(void)
+{
+    int64_t now;
+
+    if (!initialized) {
+        return;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+
+    now = k_uptime_get();
+    last_activity_ms = now;
+
+    if (is_idle_state(current_state)) {
+        enter_state(DISPLAY_STATE_WAKE_ON_NOTIFICATION, now);
+    } else if (current_state == DISPLAY_STATE_DIMMED) {
+        enter_state(DISPLAY_STATE_ACTIVE, now);
+    }
+
+    k_mutex_unlock(&power_lock);
+}
+
+display_power_state_t display_power_get_state(void)
+{
+    return current_state;
+}
+
+void display_power_set_timeouts(const struct display_power_timeouts* new_timeouts)
+{
+    if (!new_timeouts) {
+        return;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+    if (new_timeouts->dim_ms) {
+        timeouts.dim_ms = new_timeouts->dim_ms;
+    }
+    if (new_timeouts->off_ms) {
+        timeouts.off_ms = new_timeouts->off_ms;
+    }
+    if (new_timeouts->notification_ms) {
+        timeouts.notification_ms = new_timeouts->notification_ms;
+    }
+    k_mutex_unlock(&power_lock);
+
+    LOG_INF("Display timeouts set (dim: %u ms, off: %u ms, notification: %u ms)",
+        timeouts.dim_ms, timeouts.off_ms, timeouts.notification_ms);
+}
+
+void display_power_get_timeouts(struct display_power_timeouts* out)
+{
+    if (!out) {
+        return;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+    *out = timeouts;
+    k_mutex_unlock(&power_lock);
+}
+
+void display_power_get_stats(struct display_power_stats* out)
+{
+    if (!out) {
+        return;
+    }
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+    *out = stats;
+    if (initialized) {
+        out->time_in_state_ms[current_state] += k_uptime_get() - state_entered_ms;
+    }
+    k_mutex_unlock(&power_lock);
+}
+
+void display_power_set_ambient(bool enable)
+{
+    k_mutex_lock(&power_lock, K_FOREVER);
+    ambient_enabled = enable;
+    k_mutex_unlock(&power_lock);
+
+    LOG_INF("Ambient mode %s", enable ? "enabled" : "disabled");
+}
+
+bool display_power_is_ambient_enabled(void)
+{
+    return ambient_enabled;
+}
+
+void display_power_set_state_callback(display_power_state_cb_t cb)
+{
+    k_mutex_lock(&power_lock, K_FOREVER);
+    state_cb = cb;
+    k_mutex_unlock(&power_lock);
+}
+
+void display_power_reset(void)
+{
+    int64_t now;
+
+    k_mutex_lock(&power_lock, K_FOREVER);
+
+    now = k_uptime_get();
+    last_activity_ms = now;
+    if (initialized) {
+        enter_state(DISPLAY_STATE_ACTIVE, now);
+    }
+
+    timeouts.dim_ms = DEFAULT_DIM_TIMEOUT_MS;
+    timeouts.off_ms = DEFAULT_OFF_TIMEOUT_MS;
+    timeouts.notification_ms = DEFAULT_NOTIFICATION_TIMEOUT_MS;
+    expected_idle_ms = DEFAULT_EXPECTED_IDLE_MS;
+    ambient_enabled = true;
+    memset(&stats, 0, sizeof(stats));
+    state_entered_ms = now;
+
+    k_mutex_unlock(&power_lock);
+}
+
+const char* display_power_state_name(display_power_state_t state)
+{
+    if (state >= DISPLAY_STATE_COUNT) {
+        return "unknown";
+    }
+    return state_names[state];
+}
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+static int cmd_display_power_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct display_power_stats snapshot;
+    uint64_t total_ms = 0;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    display_power_get_stats(&snapshot);
+    for (int i = 0; i < DISPLAY_STATE_COUNT; i++) {
+        total_ms += snapshot.time_in_state_ms[i];
+    }
+
+    shell_print(sh, "state: %s, transitions: %u, panel sleeps: %u",
+        display_power_state_name(current_state), snapshot.transitions,
+        snapshot.deep_sleep_entries);
+    shell_print(sh, "wake latency: %u us, expected idle: %u ms, sleep break-even: %u ms",
+        get_display_wake_latency_us(), expected_idle_ms, deep_sleep_break_even_ms());
+    for (int i = 0; i < DISPLAY_STATE_COUNT; i++) {
+        uint64_t ms = snapshot.time_in_state_ms[i];
+
+        shell_print(sh, "  %-22s %10llu ms (%3u%%)", state_names[i], (unsigned long long)ms,
+            total_ms ? (unsigned int)((ms * 100U) / total_ms) : 0U);
+    }
+    return 0;
+}
+
+static int cmd_display_power_timeouts(const struct shell* sh, size_t argc, char** argv)
+{
+    struct display_power_timeouts t;
+
+    if (argc == 4) {
+        t.dim_ms = strtoul(argv[1], NULL, 10);
+        t.off_ms = strtoul(argv[2], NULL, 10);
+        t.notification_ms = strtoul(argv[3], NULL, 10);
+        display_power_set_timeouts(&t);
+    }
+
+    display_power_get_timeouts(&t);
+    shell_print(sh, "dim: %u ms, off: %u ms, notification: %u ms",
+        t.dim_ms, t.off_ms, t.notification_ms);
+    return 0;
+}
+
+static int cmd_display_power_ambient(const struct shell* sh, size_t argc, char** argv)
+{
+    if (argc == 2) {
+        display_power_set_ambient(strcmp(argv[1], "on") == 0);
+    }
+
+    shell_print(sh, "ambient: %s", ambient_enabled ? "on" : "off");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(display_power_cmds,
+    SHELL_CMD(stats, NULL, "Show time spent per display state", cmd_display_power_stats),
+    SHELL_CMD_ARG(timeouts, NULL, "Show or set timeouts: [<dim_ms> <off_ms> <notification_ms>]",
+        cmd_display_power_timeouts, 1, 3),
+    SHELL_CMD_ARG(ambient, NULL, "Show or set ambient mode: [on|off]", cmd_display_power_ambient, 1, 1),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(display_power, &display_power_cmds, "Display power management", NULL);
+#endif /* CONFIG_SHELL */
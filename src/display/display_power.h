@@ -0,0 +1,185 @@
+/**
+ * @file display_power.h
+ * @brief Display Power State Machine Header
+ *
+ * Activity-driven display power management. The display steps down from
+ * active to dimmed to off when the user stops interacting with it, and is
+ * woken again by touch or by newly arriving notifications.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DISPLAY_POWER_H_
+#define DISPLAY_POWER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup display_power_api Display Power API
+ * @brief Idle auto-dim and auto-off display state machine
+ * @{
+ */
+
+/**
+ * @brief Display power states
+ */
+typedef enum {
+    DISPLAY_STATE_ACTIVE, /**< Full brightness, user is interacting */
+    DISPLAY_STATE_DIMMED, /**< Reduced brightness after idle timeout */
+    DISPLAY_STATE_OFF, /**< Panel blanked (or sleeping) and backlight off */
+    DISPLAY_STATE_WAKE_ON_NOTIFICATION, /**< Briefly on to show a new notification */
+    DISPLAY_STATE_AMBIENT, /**< Very dim always-on face instead of off */
+    DISPLAY_STATE_COUNT
+} display_power_state_t;
+
+/**
+ * @brief Display power state change callback
+ *
+ * Called with the state machine lock held, right after the hardware has
+ * been switched to the new state. Must not call back into this module.
+ *
+ * @param prev State that was left
+ * @param next State that was entered
+ */
+typedef void (*display_power_state_cb_t)(display_power_state_t prev, display_power_state_t next);
+
+/**
+ * @brief Display power timeouts in milliseconds
+ */
+struct display_power_timeouts {
+    uint32_t dim_ms; /**< Idle time in ACTIVE before dimming */
+    uint32_t off_ms; /**< Idle time in DIMMED before turning off */
+    uint32_t notification_ms; /**< On time after a notification wake */
+};
+
+/**
+ * @brief Accumulated time spent in each display state
+ */
+struct display_power_stats {
+    uint64_t time_in_state_ms[DISPLAY_STATE_COUNT]; /**< Residency per state */
+    uint32_t transitions; /**< Number of state transitions */
+    uint32_t deep_sleep_entries; /**< Off periods that put the panel to sleep */
+};
+
+/**
+ * @brief Initialize the display power state machine
+ *
+ * Must be called after enable_display(). The state machine starts in
+ * DISPLAY_STATE_ACTIVE with the default timeouts.
+ *
+ * @retval 0 Success
+ * @retval Negative errno codes on failure
+ */
+int display_power_init(void);
+
+/**
+ * @brief Run timeout-driven state transitions (call in main loop)
+ */
+void display_power_process(void);
+
+/**
+ * @brief Report user activity (touch)
+ *
+ * Restarts the idle timer and brings the display back to ACTIVE.
+ *
+ * @retval true The display was off or ambient and has just been woken,
+ *              the caller should not act on the input that woke it
+ * @retval false The display was already on
+ */
+bool display_power_user_activity(void);
+
+/**
+ * @brief Report a newly received notification
+ *
+ * Wakes the display from OFF or AMBIENT into
+ * DISPLAY_STATE_WAKE_ON_NOTIFICATION, or restarts the idle timer if the
+ * display is already on.
+ */
+void display_power_notification_event(void);
+
+/**
+ * @brief Get the current display power state
+ *
+ * @return Current state
+ */
+display_power_state_t display_power_get_state(void);
+
+/**
+ * @brief Set the state machine timeouts
+ *
+ * @param timeouts New timeouts, zero fields keep the current value
+ */
+void display_power_set_timeouts(const struct display_power_timeouts* timeouts);
+
+/**
+ * @brief Get the state machine timeouts
+ *
+ * @param timeouts Output for the current timeouts
+ */
+void display_power_get_timeouts(struct display_power_timeouts* timeouts);
+
+/**
+ * @brief Get time spent in each state since init
+ *
+ * The residency of the current state is included up to the time of the call.
+ *
+ * @param stats Output for the accumulated statistics
+ */
+void display_power_get_stats(struct display_power_stats* stats);
+
+/**
+ * @brief Use the ambient state instead of turning the display off
+ *
+ * Takes effect the next time the display would turn off.
+ *
+ * @param enable true to enter DISPLAY_STATE_AMBIENT on idle, false for OFF
+ */
+void display_power_set_ambient(bool enable);
+
+/**
+ * @brief Check if the ambient state replaces off
+ *
+ * @retval true Idle display goes to DISPLAY_STATE_AMBIENT
+ * @retval false Idle display goes to DISPLAY_STATE_OFF
+ */
+bool display_power_is_ambient_enabled(void);
+
+/**
+ * @brief Register the state change callback
+ *
+ * @param cb Callback, NULL to unregister
+ */
+void display_power_set_state_callback(display_power_state_cb_t cb);
+
+/**
+ * @brief Wake the display and go back to the default settings
+ *
+ * Enters DISPLAY_STATE_ACTIVE through the state change callback, restores
+ * the default timeouts and ambient mode, forgets the observed off periods
+ * and clears the statistics.
+ */
+void display_power_reset(void);
+
+/**
+ * @brief Get a printable name for a display power state
+ *
+ * @param state Display power state
+ * @return Static string with the state name
+ */
+const char* display_power_state_name(display_power_state_t state);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISPLAY_POWER_H_ */
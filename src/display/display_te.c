@@ -0,0 +1,250 @@
+/**
+ * @file display_te.c
+ * @brief Panel Tearing-Effect Synchronization Implementation
+ *
+ * With partial flushes of arbitrary areas the panel may scan out GRAM while a
+ * frame is only half written, which shows up as tearing during swipes. The
+ * GC9A01 can signal the start of vertical blanking on its TE pin. When that
+ * pin is wired to a GPIO, the first transfer of every frame waits for the
+ * TE edge so the write races ahead of the scan-out instead of crossing it.
+ *
+ * On native_sim there is no panel, so a timer stands in for the TE line at
+ * the panel refresh rate. This keeps the wait-time statistics meaningful in
+ * simulation.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "display/display.h"
+#include "display/display_te.h"
+
+LOG_MODULE_REGISTER(display_te, LOG_LEVEL_INF);
+
+/** @brief GC9A01 tearing effect line on command */
+#define GC9A01_CMD_TEON 0x35
+
+/** @brief TEON parameter: signal vertical blanking only */
+#define GC9A01_TE_MODE_VBLANK 0x00
+
+/** @brief Nominal panel refresh period in microseconds (~60 Hz) */
+#define TE_REFRESH_PERIOD_US 16667U
+
+/** @brief Give up waiting after this many refresh periods */
+#define TE_WAIT_TIMEOUT_PERIODS 2U
+
+/** @brief Node carrying the optional lcd-te-gpios property */
+#define TE_NODE DT_PATH(zephyr_user)
+
+#if defined(CONFIG_DISPLAY_TE_SYNC)
+
+/* Given on every TE edge, taken by the flush path */
+static K_SEM_DEFINE(te_sem, 0, 1);
+
+static struct display_te_stats te_stats;
+static bool te_active = false;
+
+#if DT_NODE_HAS_PROP(TE_NODE, lcd_te_gpios)
+static const struct gpio_dt_spec te_gpio = GPIO_DT_SPEC_GET(TE_NODE, lcd_te_gpios);
+static struct gpio_callback te_cb_data;
+
+/**
+ * @brief TE GPIO interrupt handler
+ */
+static void te_gpio_isr(const struct device* dev, struct gpio_callback* cb, gpio_port_pins_t pins)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(cb);
+    ARG_UNUSED(pins);
+
+    k_sem_give(&te_sem);
+}
+
+/**
+ * @brief Enable the panel TE output and the GPIO interrupt
+ *
+ * @return 0 on success, negative error code on failure
+ */
+static int init_te_source(void)
+{
+    int ret;
+    const uint8_t te_mode = GC9A01_TE_MODE_VBLANK;
+
+    if (!gpio_is_ready_dt(&te_gpio)) {
+        LOG_ERR("TE GPIO is not ready");
+        return -ENODEV;
+    }
+
+    ret = gpio_pin_configure_dt(&te_gpio, GPIO_INPUT);
+    if (ret < 0) {
+        LOG_ERR("Failed to configure TE GPIO (ret: %d)", ret);
+        return ret;
+    }
+
+    gpio_init_callback(&te_cb_data, te_gpio_isr, BIT(te_gpio.pin));
+    ret = gpio_add_callback_dt(&te_gpio, &te_cb_data);
+    if (ret < 0) {
+        LOG_ERR("Failed to add TE GPIO callback (ret: %d)", ret);
+        return ret;
+    }
+
+    ret = gpio_pin_interrupt_configure_dt(&te_gpio, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret < 0) {
+        LOG_ERR("Failed to enable TE GPIO interrupt (ret: %d)", ret);
+        return ret;
+    }
+
+    /* The controller keeps TE low until told to drive it */
+    return send_display_command(GC9A01_CMD_TEON, &te_mode, sizeof(te_mode));
+}
+#elif defined(CONFIG_DISPLAY_TE_SYNC_SIM)
+static struct k_timer te_sim_timer;
+
+/**
+ * @brief Simulated TE edge
+ */
+static void te_sim_timer_callback(struct k_timer* timer)
+{
+    ARG_UNUSED(timer);
+
+    k_sem_give(&te_sem);
+}
+
+/**
+ * @brief Start the simulated TE source
+ *
+ * @return 0 on success
+ */
+static int init_te_source(void)
+{
+    k_timer_init(&te_sim_timer, te_sim_timer_callback, NULL);
+    k_timer_start(&te_sim_timer, K_USEC(CONFIG_DISPLAY_TE_SIM_PERIOD_US),
+        K_USEC(CONFIG_DISPLAY_TE_SIM_PERIOD_US));
+    LOG_INF("Using simulated TE source (period: %d us)", CONFIG_DISPLAY_TE_SIM_PERIOD_US);
+    return 0;
+}
+#else
+static int init_te_source(void)
+{
+    return -ENOTSUP;
+}
+#endif
+
+int display_te_init(void)
+{
+    int ret = init_te_source();
+
+    if (ret < 0) {
+        if (ret == -ENOTSUP) {
+            LOG_WRN("No TE line available, flushing unsynchronized");
+        }
+        return ret;
+    }
+
+    te_active = true;
+    LOG_INF("TE synchronized flushing enabled");
+    return 0;
+}
+
+bool display_te_is_active(void)
+{
+    return te_active;
+}
+
+uint32_t display_te_wait(void)
+{
+    int ret;
+    uint32_t start_cycles;
+    uint32_t wait_us;
+
+    if (!te_active) {
+        return 0;
+    }
+
+    /* Only an edge that arrives from now on marks a fresh blanking period */
+    k_sem_reset(&te_sem);
+
+    start_cycles = k_cycle_get_32();
+    ret = k_sem_take(&te_sem, K_USEC(TE_REFRESH_PERIOD_US * TE_WAIT_TIMEOUT_PERIODS));
+    wait_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+
+    if (ret < 0) {
+        te_stats.timeouts++;
+    }
+    te_stats.frames++;
+    te_stats.total_wait_us += wait_us;
+    te_stats.max_wait_us = MAX(te_stats.max_wait_us, wait_us);
+
+    return wait_us;
+}
+
+void display_te_get_stats(struct display_te_stats* stats)
+{
+    if (stats) {
+        *stats = te_stats;
+    }
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_display_te_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "TE sync: %s", te_active ? "active" : "inactive");
+    shell_print(sh, "frames: %u, timeouts: %u", te_stats.frames, te_stats.timeouts);
+    shell_print(sh, "wait per frame: avg %u us, max %u us",
+        te_stats.frames ? (uint32_t)(te_stats.total_wait_us / te_stats.frames) : 0U,
+        te_stats.max_wait_us);
+    return 0;
+}
+
+static int cmd_display_te_reset(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    memset(&te_stats, 0, sizeof(te_stats));
+    shell_print(sh, "TE statistics cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(display_te_cmds,
+    SHELL_CMD(stats, NULL, "Show TE wait time per frame", cmd_display_te_stats),
+    SHELL_CMD(reset, NULL, "Clear TE statistics", cmd_display_te_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(display_te, &display_te_cmds, "Tearing-effect synchronization", NULL);
+#endif /* CONFIG_SHELL */
+
+#else /* !CONFIG_DISPLAY_TE_SYNC */
+
+int display_te_init(void)
+{
+    return -ENOTSUP;
+}
+
+bool display_te_is_active(void)
+{
+    return false;
+}
+
+uint32_t display_te_wait(void)
+{
+    return 0;
+}
+
+void display_te_get_stats(struct display_te_stats* stats)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+#endif /* CONFIG_DISPLAY_TE_SYNC */
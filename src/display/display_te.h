@@ -0,0 +1,85 @@
+/**
+ * @file display_te.h
+ * @brief Panel Tearing-Effect Synchronization Header
+ *
+ * Gates display transfers on the panel's tearing-effect (TE) output so a
+ * frame is never written into GRAM while the panel is scanning it out.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DISPLAY_TE_H_
+#define DISPLAY_TE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup display_te_api Display TE Sync API
+ * @brief Tearing-effect synchronized frame transfers
+ * @{
+ */
+
+/**
+ * @brief Accumulated TE synchronization statistics
+ */
+struct display_te_stats {
+    uint32_t frames; /**< Frames gated on a TE edge */
+    uint32_t timeouts; /**< Frames that gave up waiting for TE */
+    uint64_t total_wait_us; /**< Total time spent waiting for TE */
+    uint32_t max_wait_us; /**< Longest single wait */
+};
+
+/**
+ * @brief Initialize TE synchronization
+ *
+ * Enables the panel's TE output and its GPIO interrupt when a TE line is
+ * described in the devicetree (lcd-te-gpios on the zephyr,user node).
+ * Without one, a simulated TE source is used if CONFIG_DISPLAY_TE_SYNC_SIM
+ * is enabled (native_sim), otherwise synchronization stays inactive.
+ *
+ * @retval 0 Success, TE sync is active
+ * @retval -ENOTSUP No TE source available
+ * @retval Other negative errno codes on GPIO or bus failure
+ */
+int display_te_init(void);
+
+/**
+ * @brief Check if TE synchronization is active
+ *
+ * @retval true Frames are gated on TE
+ * @retval false TE sync is disabled or unavailable
+ */
+bool display_te_is_active(void);
+
+/**
+ * @brief Block until the start of the next panel vertical blanking
+ *
+ * Returns immediately if TE sync is inactive. Gives up after two refresh
+ * periods so a missing TE edge can only slow rendering down, never stop it.
+ *
+ * @return Time spent waiting in microseconds
+ */
+uint32_t display_te_wait(void);
+
+/**
+ * @brief Get accumulated TE synchronization statistics
+ *
+ * @param stats Output for the statistics
+ */
+void display_te_get_stats(struct display_te_stats* stats);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISPLAY_TE_H_ */
@@ -0,0 +1,257 @@
+/**
+ * @file dnd.c
+ * @brief Do Not Disturb Implementation
+ *
+ * Only keeps the configuration and the statistics. The notification screen
+ * asks dnd_is_active() before doing UI work and refreshes once when the
+ * user wakes the watch.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "clock/clock.h"
+#include "dnd/dnd.h"
+
+LOG_MODULE_REGISTER(dnd, LOG_LEVEL_INF);
+
+/** @brief Settings key of the persisted configuration */
+#define DND_SETTINGS_KEY "dnd/config"
+
+static struct dnd_config config;
+static struct dnd_stats stats;
+
+/**
+ * @brief Persist the configuration
+ */
+static int save_config(void)
+{
+    int ret;
+
+    if (!IS_ENABLED(CONFIG_SETTINGS)) {
+        return 0;
+    }
+
+    ret = settings_save_one(DND_SETTINGS_KEY, &config, sizeof(config));
+    if (ret < 0) {
+        LOG_WRN("Failed to persist do not disturb (ret: %d)", ret);
+    }
+    return ret;
+}
+
+bool dnd_is_active(void)
+{
+    struct clock_time now;
+    uint16_t minute;
+
+    if (config.manual) {
+        return true;
+    }
+    if (!config.schedule_enabled || !clock_is_set()) {
+        return false;
+    }
+
+    clock_get_time(&now);
+    minute = now.hours * 60 + now.minutes;
+
+    /* Same window semantics as the rules' time condition */
+    if (config.start_minute <= config.end_minute) {
+        return minute >= config.start_minute && minute < config.end_minute;
+    }
+    return minute >= config.start_minute || minute < config.end_minute;
+}
+
+int dnd_set_manual(bool enable)
+{
+    if (config.manual == enable) {
+        return 0;
+    }
+
+    config.manual = enable;
+    LOG_INF("Do not disturb %s", enable ? "on" : "off");
+    return save_config();
+}
+
+int dnd_set_schedule(bool enable, uint16_t start_minute, uint16_t end_minute)
+{
+    if (start_minute >= DND_MINUTES_PER_DAY || end_minute >= DND_MINUTES_PER_DAY) {
+        return -EINVAL;
+    }
+
+    if (config.schedule_enabled == enable && config.start_minute == start_minute
+        && config.end_minute == end_minute) {
+        return 0;
+    }
+
+    config.schedule_enabled = enable;
+    config.start_minute = start_minute;
+    config.end_minute = end_minute;
+    LOG_INF("Do not disturb schedule %s %02u:%02u-%02u:%02u", enable ? "on" : "off",
+        start_minute / 60, start_minute % 60, end_minute / 60, end_minute % 60);
+    return save_config();
+}
+
+void dnd_get_config(struct dnd_config* out)
+{
+    if (out) {
+        *out = config;
+    }
+}
+
+void dnd_count_deferred_notification(void)
+{
+    stats.deferred_notifications++;
+}
+
+void dnd_count_deferred_update(void)
+{
+    stats.deferred_updates++;
+}
+
+void dnd_count_coalesced_refresh(void)
+{
+    stats.coalesced_refreshes++;
+}
+
+void dnd_count_breakthrough(void)
+{
+    stats.breakthroughs++;
+}
+
+void dnd_get_stats(struct dnd_stats* out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
+
+#if defined(CONFIG_SETTINGS)
+/**
+ * @brief Restore the persisted configuration at settings load
+ */
+static int dnd_settings_set(const char* name, size_t len, settings_read_cb read_cb, void* cb_arg)
+{
+    struct dnd_config loaded;
+    const char* next;
+    ssize_t read_len;
+
+    if (!settings_name_steq(name, "config", &next) || next) {
+        return -ENOENT;
+    }
+
+    if (len != sizeof(loaded)) {
+        return -EINVAL;
+    }
+
+    read_len = read_cb(cb_arg, &loaded, sizeof(loaded));
+    if (read_len < 0) {
+        return (int)read_len;
+    }
+
+    if (loaded.start_minute >= DND_MINUTES_PER_DAY || loaded.end_minute >= DND_MINUTES_PER_DAY) {
+        return -EINVAL;
+    }
+
+    config = loaded;
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(dnd, "dnd", NULL, dnd_settings_set, NULL, NULL);
+#endif /* CONFIG_SETTINGS */
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+/**
+ * @brief Parse "hh:mm" into a minute of day
+ *
+ * @return Minute of day, negative if malformed
+ */
+static int parse_hhmm(const char* str)
+{
+    char* end;
+    unsigned long hours = strtoul(str, &end, 10);
+    unsigned long minutes;
+
+    if (*end != ':') {
+        return -EINVAL;
+    }
+    minutes = strtoul(end + 1, &end, 10);
+    if (*end != '\0' || hours > 23 || minutes > 59) {
+        return -EINVAL;
+    }
+    return (int)(hours * 60 + minutes);
+}
+
+static int cmd_dnd_on(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    return dnd_set_manual(true);
+}
+
+static int cmd_dnd_off(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    return dnd_set_manual(false);
+}
+
+static int cmd_dnd_schedule(const struct shell* sh, size_t argc, char** argv)
+{
+    int start, end;
+
+    if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        return dnd_set_schedule(false, config.start_minute, config.end_minute);
+    }
+    if (argc != 3) {
+        shell_error(sh, "Usage: dnd schedule <hh:mm> <hh:mm> | off");
+        return -EINVAL;
+    }
+
+    start = parse_hhmm(argv[1]);
+    end = parse_hhmm(argv[2]);
+    if (start < 0 || end < 0) {
+        shell_error(sh, "Invalid time");
+        return -EINVAL;
+    }
+    return dnd_set_schedule(true, start, end);
+}
+
+static int cmd_dnd_status(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "active: %s, manual: %s, schedule: %s %02u:%02u-%02u:%02u%s",
+        dnd_is_active() ? "yes" : "no", config.manual ? "on" : "off",
+        config.schedule_enabled ? "on" : "off",
+        config.start_minute / 60, config.start_minute % 60,
+        config.end_minute / 60, config.end_minute % 60,
+        clock_is_set() ? "" : " (clock not set)");
+    shell_print(sh, "deferred: %u notifications, %u updates, %u coalesced refreshes, "
+                    "%u priority breakthroughs",
+        stats.deferred_notifications, stats.deferred_updates, stats.coalesced_refreshes,
+        stats.breakthroughs);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(dnd_cmds,
+    SHELL_CMD(on, NULL, "Turn do not disturb on", cmd_dnd_on),
+    SHELL_CMD(off, NULL, "Turn do not disturb off", cmd_dnd_off),
+    SHELL_CMD_ARG(schedule, NULL, "Daily schedule: <hh:mm> <hh:mm> | off", cmd_dnd_schedule, 2, 1),
+    SHELL_CMD(status, NULL, "Show state and deferred work", cmd_dnd_status),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(dnd, &dnd_cmds, "Do not disturb", NULL);
+#endif /* CONFIG_SHELL */
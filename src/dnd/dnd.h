@@ -0,0 +1,122 @@
+/**
+ * @file dnd.h
+ * @brief Do Not Disturb Header
+ *
+ * Quiet mode enforced on the watch. While do not disturb is active,
+ * received notifications are still stored, but the display is not woken
+ * and the notification screen is not redrawn until the user wakes the
+ * watch. It is active when turned on manually or during the daily
+ * schedule, and both are persisted with the settings subsystem.
+ *
+ * Priority notifications are not held back.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef DND_H
+#define DND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Minutes in a day, schedule bounds are below this */
+#define DND_MINUTES_PER_DAY (24 * 60)
+
+/**
+ * @brief Do not disturb configuration
+ */
+struct dnd_config {
+    bool manual; /**< Turned on by the user until turned off */
+    bool schedule_enabled; /**< Daily schedule in use */
+    uint16_t start_minute; /**< Schedule start, minute of day, inclusive */
+    uint16_t end_minute; /**< Schedule end, minute of day, exclusive, may wrap */
+};
+
+/**
+ * @brief Work held back while do not disturb was active
+ */
+struct dnd_stats {
+    uint32_t deferred_notifications; /**< Notifications stored without UI work */
+    uint32_t deferred_updates; /**< Screen updates skipped (time, status, ...) */
+    uint32_t coalesced_refreshes; /**< Single refreshes replacing the above */
+    uint32_t breakthroughs; /**< Priority notifications shown anyway */
+};
+
+/**
+ * @brief Check if do not disturb is active now
+ *
+ * The schedule is ignored until the wall clock has been set.
+ *
+ * @retval true Manually on, or inside the schedule
+ * @retval false Notifications are presented normally
+ */
+bool dnd_is_active(void);
+
+/**
+ * @brief Turn manual do not disturb on or off
+ *
+ * @param enable true to turn on
+ *
+ * @retval 0 Success
+ * @retval Negative errno code if the setting could not be persisted
+ */
+int dnd_set_manual(bool enable);
+
+/**
+ * @brief Set the daily schedule
+ *
+ * An end before the start spans midnight. Equal start and end never match.
+ *
+ * @param enable true to use the schedule
+ * @param start_minute Start minute of day, inclusive
+ * @param end_minute End minute of day, exclusive
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Minute out of range
+ * @retval Negative errno code if the setting could not be persisted
+ */
+int dnd_set_schedule(bool enable, uint16_t start_minute, uint16_t end_minute);
+
+/**
+ * @brief Get the current configuration
+ *
+ * @param config Output for the configuration
+ */
+void dnd_get_config(struct dnd_config* config);
+
+/**
+ * @brief Account a notification stored without UI work
+ */
+void dnd_count_deferred_notification(void);
+
+/**
+ * @brief Account a screen update skipped while deferred
+ */
+void dnd_count_deferred_update(void);
+
+/**
+ * @brief Account a coalesced refresh of deferred work
+ */
+void dnd_count_coalesced_refresh(void);
+
+/**
+ * @brief Account a priority notification shown despite do not disturb
+ */
+void dnd_count_breakthrough(void);
+
+/**
+ * @brief Get deferral statistics
+ *
+ * @param stats Output for the statistics
+ */
+void dnd_get_stats(struct dnd_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DND_H */
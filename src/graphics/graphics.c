@@ -16,8 +16,14 @@
 #include <zephyr/drivers/display.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
 
+#include "display/display.h"
+#include "display/display_te.h"
 #include "graphics/graphics.h"
+#include "graphics/rgb444.h"
+#include "graphics/rle_decoder.h"
+#include "latency/latency.h"
 
 LOG_MODULE_REGISTER(graphics, LOG_LEVEL_INF);
 
@@ -33,6 +39,15 @@ LOG_MODULE_REGISTER(graphics, LOG_LEVEL_INF);
 /** @brief LVGL task handler stack size */
 #define LVGL_THREAD_STACK_SIZE 4096
 
+/** @brief GC9A01 commands used by the RGB444 transfer path */
+#define GC9A01_CMD_CASET 0x2A
+#define GC9A01_CMD_RASET 0x2B
+#define GC9A01_CMD_RAMWR 0x2C
+#define GC9A01_CMD_COLMOD 0x3A
+
+/** @brief COLMOD parameter selecting 12 bits per pixel on the MCU interface */
+#define GC9A01_COLMOD_12BIT 0x03
+
 /* Static display buffer for LVGL */
 static lv_color_t lvgl_display_buf[LVGL_BUFFER_SIZE];
 
@@ -47,6 +62,91 @@ K_THREAD_STACK_DEFINE(lvgl_thread_stack, LVGL_THREAD_STACK_SIZE);
 static struct k_thread lvgl_thread_data;
 static k_tid_t lvgl_thread_tid;
 
+/* Held by the LVGL thread while it runs timers, by others to touch objects */
+static K_MUTEX_DEFINE(lvgl_thread_lock);
+
+/* Set while the areas of one frame are being flushed */
+static bool frame_flush_in_progress = false;
+static uint32_t frame_start_cycles;
+
+/* Wakes the LVGL thread early for urgent redraws */
+static K_SEM_DEFINE(lvgl_wakeup, 0, 1);
+static atomic_t refresh_requested;
+
+/** @brief Frame probe states */
+enum {
+    PROBE_IDLE,
+    PROBE_ARMED,
+    PROBE_DONE,
+};
+
+/* Frame probe, armed by the caller and completed from the LVGL thread */
+static atomic_t probe_state = ATOMIC_INIT(PROBE_IDLE);
+static uint32_t probe_start_cycles;
+static uint32_t probe_armed_cycles;
+static uint32_t probe_latency_us;
+
+/* Glass probe, armed by the main loop and completed from the LVGL thread */
+static struct k_spinlock glass_lock;
+static bool glass_armed;
+static bool glass_hit; /* Part of the area was transferred in this frame */
+static lv_area_t glass_area;
+static uint32_t glass_start_cycles;
+static uint32_t glass_armed_cycles;
+static uint32_t glass_end_cycles;
+
+#if defined(CONFIG_DISPLAY_RGB444)
+/**
+ * @brief Write an area to the panel in 12-bit mode
+ *
+ * The display driver only knows 16/18-bit formats, so the address window
+ * and memory write are issued directly.
+ *
+ * @param area Area of the display to write
+ * @param px_map RGB565 pixels of the area, packed in place
+ * @param bytes Output for the number of bytes sent
+ * @return 0 on success, negative error code on failure
+ */
+static int write_area_rgb444(const lv_area_t* area, uint8_t* px_map, size_t* bytes)
+{
+    int ret;
+    uint32_t pixels = (uint32_t)lv_area_get_width(area) * lv_area_get_height(area);
+    uint8_t caset[4] = { area->x1 >> 8, area->x1 & 0xFF, area->x2 >> 8, area->x2 & 0xFF };
+    uint8_t raset[4] = { area->y1 >> 8, area->y1 & 0xFF, area->y2 >> 8, area->y2 & 0xFF };
+
+    *bytes = rgb444_pack(px_map, pixels);
+
+    ret = send_display_command(GC9A01_CMD_CASET, caset, sizeof(caset));
+    if (ret < 0) {
+        return ret;
+    }
+    ret = send_display_command(GC9A01_CMD_RASET, raset, sizeof(raset));
+    if (ret < 0) {
+        return ret;
+    }
+    return send_display_command(GC9A01_CMD_RAMWR, px_map, *bytes);
+}
+
+/**
+ * @brief Round invalidated areas to even widths
+ *
+ * RGB444 packs pixels in pairs, so every flushed area must start on an even
+ * column and span an even number of columns.
+ */
+static void rgb444_rounder_cb(lv_event_t* e)
+{
+    lv_area_t* area = lv_event_get_param(e);
+
+    area->x1 &= ~1;
+    area->x2 |= 1;
+}
+#endif /* CONFIG_DISPLAY_RGB444 */
+
+/* Flush statistics, updated from the LVGL thread only */
+static struct lvgl_flush_stats flush_stats;
+static uint32_t frame_pixels;
+static uint32_t frame_us;
+
 /**
  * @brief LVGL timer callback function
  *
@@ -74,20 +174,57 @@ static void lvgl_task_thread(void* arg1, void* arg2, void* arg3)
     LOG_INF("LVGL task handler thread started");
 
     while (1) {
+        /* Urgent redraw: refresh now rather than at the next period */
+        if (atomic_clear(&refresh_requested) && lvgl_display) {
+            lv_timer_ready(lv_display_get_refr_timer(lvgl_display));
+        }
+
         /* Process LVGL timers and tasks */
+        k_mutex_lock(&lvgl_thread_lock, K_FOREVER);
         uint32_t sleep_time = lv_timer_handler();
+        k_mutex_unlock(&lvgl_thread_lock);
 
         /* Sleep for the time recommended by LVGL or minimum period */
         if (sleep_time == LV_NO_TIMER_READY) {
-            k_sleep(K_MSEC(LVGL_REFRESH_PERIOD_MS));
+            k_sem_take(&lvgl_wakeup, K_MSEC(LVGL_REFRESH_PERIOD_MS));
         } else {
             /* Ensure minimum sleep time */
             sleep_time = MAX(sleep_time, 5);
-            k_sleep(K_MSEC(sleep_time));
+            k_sem_take(&lvgl_wakeup, K_MSEC(sleep_time));
         }
     }
 }
 
+static bool areas_overlap(const lv_area_t* a, const lv_area_t* b)
+{
+    return a->x1 <= b->x2 && b->x1 <= a->x2 && a->y1 <= b->y2 && b->y1 <= a->y2;
+}
+
+/**
+ * @brief Account a transferred area to the glass probe
+ *
+ * The probed area is on the panel once the last area of the frame that
+ * overlaps it has been transferred.
+ */
+static void glass_probe_flushed(const lv_area_t* area, bool last)
+{
+    k_spinlock_key_t key = k_spin_lock(&glass_lock);
+
+    /* Only a frame started after arming can show the probed change */
+    if (glass_armed && (int32_t)(frame_start_cycles - glass_armed_cycles) >= 0
+        && areas_overlap(area, &glass_area)) {
+        glass_hit = true;
+        glass_end_cycles = k_cycle_get_32();
+    }
+
+    if (last && glass_hit) {
+        latency_record(k_cyc_to_us_floor32(glass_end_cycles - glass_start_cycles));
+        glass_armed = false;
+        glass_hit = false;
+    }
+    k_spin_unlock(&glass_lock, key);
+}
+
 /**
  * @brief Display flush callback for LVGL 9.x
  *
@@ -112,12 +249,54 @@ static void display_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t*
     desc.height = height;
     desc.pitch = width;
 
+    /* Start each frame's first transfer at the panel's vertical blanking */
+    if (!frame_flush_in_progress) {
+        display_te_wait();
+        frame_flush_in_progress = true;
+        frame_start_cycles = k_cycle_get_32();
+    }
+
     /* Write to display */
+    uint32_t start_cycles = k_cycle_get_32();
+#if defined(CONFIG_DISPLAY_RGB444)
+    size_t bytes;
+    int ret = write_area_rgb444(area, px_map, &bytes);
+    ARG_UNUSED(display_dev);
+    ARG_UNUSED(desc);
+#else
+    size_t bytes = (size_t)width * height * 2U;
     int ret = display_write(display_dev, area->x1, area->y1, &desc, (void*)px_map);
+#endif
     if (ret < 0) {
         LOG_ERR("Failed to write to display (ret: %d)", ret);
     }
 
+    /* Account the transfer cost */
+    uint32_t write_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+    flush_stats.areas++;
+    flush_stats.bytes += bytes;
+    flush_stats.pixels += (uint32_t)width * height;
+    flush_stats.flush_us += write_us;
+    frame_pixels += (uint32_t)width * height;
+    frame_us += write_us;
+    glass_probe_flushed(area, lv_display_flush_is_last(disp));
+
+    if (lv_display_flush_is_last(disp)) {
+        frame_flush_in_progress = false;
+        flush_stats.frames++;
+        flush_stats.last_frame_pixels = frame_pixels;
+        flush_stats.last_frame_us = frame_us;
+        frame_pixels = 0;
+        frame_us = 0;
+
+        /* Only a frame started after arming can show the probed change */
+        if (atomic_get(&probe_state) == PROBE_ARMED
+            && (int32_t)(frame_start_cycles - probe_armed_cycles) >= 0) {
+            probe_latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - probe_start_cycles);
+            atomic_set(&probe_state, PROBE_DONE);
+        }
+    }
+
     /* Inform LVGL that the flush is complete */
     lv_display_flush_ready(disp);
 }
@@ -189,6 +368,21 @@ static int init_lvgl_display(void)
     lv_display_set_flush_cb(lvgl_display, display_flush_cb);
     lv_display_set_user_data(lvgl_display, (void*)display_dev);
 
+    /* Optional tear-free flushing, falls back to unsynchronized writes */
+    display_te_init();
+
+#if defined(CONFIG_DISPLAY_RGB444)
+    /* LVGL keeps rendering RGB565, the panel is switched to 12-bit input */
+    const uint8_t colmod = GC9A01_COLMOD_12BIT;
+    int ret = send_display_command(GC9A01_CMD_COLMOD, &colmod, sizeof(colmod));
+    if (ret < 0) {
+        LOG_ERR("Failed to switch panel to RGB444 (ret: %d)", ret);
+        return ret;
+    }
+    lv_display_add_event_cb(lvgl_display, rgb444_rounder_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    LOG_INF("Panel transfers in RGB444 (12 bpp)");
+#endif
+
     LOG_INF("LVGL display driver initialized successfully");
     return 0;
 }
@@ -255,6 +449,12 @@ int init_lvgl_graphics(void)
     lv_init();
     LOG_DBG("LVGL core initialized");
 
+    /* Palette + RLE assets are drawn row by row, without a decoded copy */
+    ret = rle_decoder_init();
+    if (ret < 0) {
+        LOG_WRN("RLE image decoder unavailable (ret: %d)", ret);
+    }
+
     /* Initialize display driver */
     ret = init_lvgl_display();
     if (ret < 0) {
@@ -343,3 +543,135 @@ lv_display_t* get_lvgl_display(void)
 {
     return lvgl_display;
 }
+
+/**
+ * @brief Get accumulated display flush statistics
+ *
+ * @param stats Output for the statistics since boot
+ */
+void get_lvgl_flush_stats(struct lvgl_flush_stats* stats)
+{
+    if (stats) {
+        *stats = flush_stats;
+    }
+}
+
+void lvgl_request_refresh(void)
+{
+    atomic_set(&refresh_requested, 1);
+    k_sem_give(&lvgl_wakeup);
+}
+
+void lvgl_arm_frame_probe(uint32_t start_cycles)
+{
+    atomic_set(&probe_state, PROBE_IDLE);
+    probe_start_cycles = start_cycles;
+    probe_armed_cycles = k_cycle_get_32();
+    atomic_set(&probe_state, PROBE_ARMED);
+}
+
+bool lvgl_take_frame_probe(uint32_t* latency_us)
+{
+    if (atomic_get(&probe_state) != PROBE_DONE) {
+        return false;
+    }
+
+    *latency_us = probe_latency_us;
+    atomic_set(&probe_state, PROBE_IDLE);
+    return true;
+}
+
+void lvgl_cancel_frame_probe(void)
+{
+    atomic_set(&probe_state, PROBE_IDLE);
+}
+
+void lvgl_arm_glass_probe(uint32_t start_cycles, const lv_area_t* area)
+{
+    k_spinlock_key_t key = k_spin_lock(&glass_lock);
+
+    if (glass_armed) {
+        latency_count_superseded();
+    }
+    glass_area = *area;
+    glass_start_cycles = start_cycles;
+    glass_armed_cycles = k_cycle_get_32();
+    glass_armed = true;
+    glass_hit = false;
+    k_spin_unlock(&glass_lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+/** @brief Longest wait for a single benchmark frame */
+#define BENCH_FRAME_TIMEOUT_MS 1000
+
+static int cmd_graphics_bench(const struct shell* sh, size_t argc, char** argv)
+{
+    struct lvgl_flush_stats before;
+    struct lvgl_flush_stats after;
+    uint32_t frames = (argc > 1) ? strtoul(argv[1], NULL, 10) : 20U;
+    uint64_t frame_us;
+    uint64_t frame_bytes;
+
+    if (!lvgl_display || frames == 0) {
+        return -EINVAL;
+    }
+
+    get_lvgl_flush_stats(&before);
+
+    /* Full-screen redraws through the normal render and flush path */
+    for (uint32_t i = 0; i < frames; i++) {
+        uint32_t done = flush_stats.frames;
+        int64_t start = k_uptime_get();
+
+        /* The shell thread must not race the LVGL thread's render */
+        k_mutex_lock(&lvgl_thread_lock, K_FOREVER);
+        lv_obj_invalidate(lv_screen_active());
+        k_mutex_unlock(&lvgl_thread_lock);
+        while (flush_stats.frames == done) {
+            if (k_uptime_get() - start > BENCH_FRAME_TIMEOUT_MS) {
+                shell_error(sh, "Frame %u not flushed", i);
+                return -ETIMEDOUT;
+            }
+            k_sleep(K_MSEC(1));
+        }
+    }
+
+    get_lvgl_flush_stats(&after);
+    frame_us = after.flush_us - before.flush_us;
+    frame_bytes = after.bytes - before.bytes;
+
+    shell_print(sh, "format: %s", IS_ENABLED(CONFIG_DISPLAY_RGB444) ? "RGB444 (12 bpp)" : "RGB565 (16 bpp)");
+    shell_print(sh, "frames: %u, bytes/frame: %u, write time/frame: %u us", frames,
+        (uint32_t)(frame_bytes / frames), (uint32_t)(frame_us / frames));
+    shell_print(sh, "throughput: %u KB/s, %u px/ms",
+        frame_us ? (uint32_t)((frame_bytes * 1000000U) / (frame_us * 1024U)) : 0U,
+        frame_us ? (uint32_t)(((after.pixels - before.pixels) * 1000U) / frame_us) : 0U);
+    return 0;
+}
+
+static int cmd_graphics_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct lvgl_flush_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    get_lvgl_flush_stats(&s);
+    shell_print(sh, "frames: %u, areas: %u, pixels: %llu, bytes: %llu, write time: %llu us",
+        s.frames, s.areas, (unsigned long long)s.pixels, (unsigned long long)s.bytes,
+        (unsigned long long)s.flush_us);
+    shell_print(sh, "last frame: %u px, %u us", s.last_frame_pixels, s.last_frame_us);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(graphics_cmds,
+    SHELL_CMD_ARG(bench, NULL, "Full-screen flush throughput: [frames]", cmd_graphics_bench, 1, 1),
+    SHELL_CMD(stats, NULL, "Show flush statistics", cmd_graphics_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(graphics, &graphics_cmds, "LVGL display path", NULL);
+#endif /* CONFIG_SHELL */
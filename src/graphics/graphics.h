@@ -26,6 +26,19 @@ extern "C" {
  * @{
  */
 
+/**
+ * @brief Accumulated display flush statistics
+ */
+struct lvgl_flush_stats {
+    uint32_t frames; /**< Completed frames (last area flushed) */
+    uint32_t areas; /**< Flushed areas */
+    uint64_t pixels; /**< Flushed pixels */
+    uint64_t bytes; /**< Bytes sent to the panel */
+    uint64_t flush_us; /**< Time spent writing areas to the panel */
+    uint32_t last_frame_pixels; /**< Pixels of the most recent frame */
+    uint32_t last_frame_us; /**< Write time of the most recent frame */
+};
+
 /**
  * @brief Initialize LVGL graphics library
  *
@@ -119,6 +132,59 @@ int lvgl_set_theme_mode(bool dark_mode);
  */
 void lvgl_force_refresh(void);
 
+/**
+ * @brief Get accumulated display flush statistics
+ *
+ * @param stats Output for the statistics since boot
+ */
+void get_lvgl_flush_stats(struct lvgl_flush_stats* stats);
+
+/**
+ * @brief Render pending changes now instead of at the next refresh period
+ *
+ * Wakes the LVGL thread and makes its display refresh timer ready. Safe to
+ * call from any thread.
+ */
+void lvgl_request_refresh(void);
+
+/**
+ * @brief Measure the time until the next frame reaches the panel
+ *
+ * The first frame whose flush starts after this call completes the probe.
+ * A new probe replaces one that has not completed yet.
+ *
+ * @param start_cycles Cycle count the latency is measured from
+ */
+void lvgl_arm_frame_probe(uint32_t start_cycles);
+
+/**
+ * @brief Collect the result of a completed frame probe
+ *
+ * @param latency_us Output for the time from start to the end of the frame
+ * @retval true Probe completed, latency_us is set and the probe is cleared
+ * @retval false No probe completed
+ */
+bool lvgl_take_frame_probe(uint32_t* latency_us);
+
+/**
+ * @brief Cancel a frame probe that has not completed
+ */
+void lvgl_cancel_frame_probe(void);
+
+/**
+ * @brief Measure the time until an area of the screen is on the panel
+ *
+ * Completes with the last transfer overlapping the area in the first frame
+ * whose flush starts after this call, and records the latency from
+ * start_cycles in the receipt to glass histogram (see latency.h). A new
+ * probe replaces one that has not completed, which is counted as
+ * superseded. Safe to call from any thread.
+ *
+ * @param start_cycles Cycle count the latency is measured from
+ * @param area Screen area to wait for, in display coordinates
+ */
+void lvgl_arm_glass_probe(uint32_t start_cycles, const lv_area_t* area);
+
 /**
  * @brief LVGL task handler function (for manual integration)
  *
@@ -0,0 +1,28 @@
+/**
+ * @file rgb444.c
+ * @brief RGB565 to RGB444 Pixel Packing Implementation
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include "graphics/rgb444.h"
+
+size_t rgb444_pack(uint8_t* buf, uint32_t pixels)
+{
+    const uint16_t* src = (const uint16_t*)buf;
+    uint8_t* dst = buf;
+
+    for (uint32_t i = 0; i < pixels; i += 2) {
+        uint16_t p0 = src[i];
+        uint16_t p1 = src[i + 1];
+        /* Keep the top 4 bits of each channel */
+        uint8_t r0 = p0 >> 12, g0 = (p0 >> 7) & 0x0F, b0 = (p0 >> 1) & 0x0F;
+        uint8_t r1 = p1 >> 12, g1 = (p1 >> 7) & 0x0F, b1 = (p1 >> 1) & 0x0F;
+
+        *dst++ = (r0 << 4) | g0;
+        *dst++ = (b0 << 4) | r1;
+        *dst++ = (g1 << 4) | b1;
+    }
+
+    return dst - buf;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file rgb444.h
+ * @brief RGB565 to RGB444 Pixel Packing Header
+ *
+ * The GC9A01 takes 12-bit pixels on its MCU interface, two pixels in three
+ * bytes: R0G0 B0R1 G1B1. LVGL renders RGB565, so the flush path packs each
+ * area before sending it (CONFIG_DISPLAY_RGB444). Each channel keeps its
+ * top 4 bits.
+ *
+ * This file has no Zephyr or LVGL dependencies so it also builds on the host
+ * for checking against an RGB444 reference (tools/rgb444_check).
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RGB444_H
+#define RGB444_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Pack RGB565 pixels to RGB444 in place
+ *
+ * The output never overtakes the input (3 bytes written per 4 read), so the
+ * LVGL draw buffer is reused and no bounce buffer is needed.
+ *
+ * @param buf Buffer holding native RGB565 pixels on entry, RGB444 on return
+ * @param pixels Number of pixels, must be even
+ * @return Number of packed bytes
+ */
+size_t rgb444_pack(uint8_t* buf, uint32_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RGB444_H */
@@ -0,0 +1,285 @@
+/**
+ * @file rle_decoder.c
+ * @brief LVGL Image Decoder for Palette + RLE Assets Implementation
+ *
+ * Open leaves dsc->decoded unset, which makes LVGL draw the image in pieces
+ * through get_area. Each get_area call decodes the next row of the clipped
+ * area into the decoder's single-row draw buffer. Rows above the clipped
+ * area are decoded without output to advance the stream; going back up
+ * restarts it.
+ *
+ * All callbacks run on the LVGL thread.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "graphics/rle_decoder.h"
+#include "graphics/rle_image.h"
+
+LOG_MODULE_REGISTER(rle_decoder, LOG_LEVEL_INF);
+
+/**
+ * @brief Per open image state
+ */
+struct rle_decoder_ctx {
+    struct rle_image_stream stream;
+    lv_draw_buf_t* row_buf; /**< One row, RGB565 or RGB565A8 */
+};
+
+static struct rle_decoder_stats stats;
+
+static const lv_image_dsc_t* rle_source(const lv_image_decoder_dsc_t* dsc)
+{
+    const lv_image_dsc_t* img;
+
+    if (dsc->src_type != LV_IMAGE_SRC_VARIABLE) {
+        return NULL;
+    }
+
+    img = dsc->src;
+    if (!(img->header.flags & RLE_IMAGE_FLAG)
+        || (img->header.cf != LV_COLOR_FORMAT_RAW && img->header.cf != LV_COLOR_FORMAT_RAW_ALPHA)) {
+        return NULL;
+    }
+    return img;
+}
+
+static bool is_transparent(const lv_image_dsc_t* img)
+{
+    return img->header.cf == LV_COLOR_FORMAT_RAW_ALPHA;
+}
+
+static lv_result_t rle_info(lv_image_decoder_t* decoder, lv_image_decoder_dsc_t* dsc,
+    lv_image_header_t* header)
+{
+    const lv_image_dsc_t* img = rle_source(dsc);
+
+    ARG_UNUSED(decoder);
+
+    if (!img) {
+        return LV_RESULT_INVALID;
+    }
+
+    *header = img->header;
+    header->cf = is_transparent(img) ? LV_COLOR_FORMAT_RGB565A8 : LV_COLOR_FORMAT_RGB565;
+    header->stride = img->header.w * 2;
+    return LV_RESULT_OK;
+}
+
+static lv_result_t rle_open(lv_image_decoder_t* decoder, lv_image_decoder_dsc_t* dsc)
+{
+    const lv_image_dsc_t* img = rle_source(dsc);
+    struct rle_decoder_ctx* ctx;
+
+    ARG_UNUSED(decoder);
+
+    if (!img) {
+        return LV_RESULT_INVALID;
+    }
+
+    ctx = lv_malloc_zeroed(sizeof(*ctx));
+    if (!ctx) {
+        return LV_RESULT_INVALID;
+    }
+
+    if (rle_image_begin(&ctx->stream, img->data, img->data_size, img->header.w, img->header.h,
+            is_transparent(img))
+        < 0) {
+        stats.errors++;
+        lv_free(ctx);
+        return LV_RESULT_INVALID;
+    }
+
+    ctx->row_buf = lv_draw_buf_create(img->header.w, 1, dsc->header.cf, LV_STRIDE_AUTO);
+    if (!ctx->row_buf) {
+        lv_free(ctx);
+        return LV_RESULT_INVALID;
+    }
+
+    /* No whole-image buffer: LVGL pulls rows through get_area */
+    dsc->decoded = NULL;
+    dsc->user_data = ctx;
+    stats.opens++;
+    return LV_RESULT_OK;
+}
+
+static lv_result_t rle_get_area(lv_image_decoder_t* decoder, lv_image_decoder_dsc_t* dsc,
+    const lv_area_t* full_area, lv_area_t* decoded_area)
+{
+    struct rle_decoder_ctx* ctx = dsc->user_data;
+    struct rle_image_stream* s = &ctx->stream;
+    lv_draw_buf_t* buf = ctx->row_buf;
+    uint32_t start = k_cycle_get_32();
+    int32_t y;
+    int ret;
+
+    ARG_UNUSED(decoder);
+
+    y = (decoded_area->y1 == LV_COORD_MIN) ? full_area->y1 : decoded_area->y1 + 1;
+    if (y > full_area->y2 || y >= s->height) {
+        return LV_RESULT_INVALID;
+    }
+
+    if (y < s->row) {
+        rle_image_begin(s, s->data, s->len, s->width, s->height, s->transparent);
+    }
+
+    while (s->row < y) {
+        ret = rle_image_decode_row(s, NULL, NULL);
+        if (ret < 0) {
+            goto error;
+        }
+        stats.skipped_rows++;
+    }
+
+    /* RGB565A8 keeps the alpha plane after the color plane */
+    ret = rle_image_decode_row(s, (uint16_t*)buf->data,
+        s->transparent ? buf->data + buf->header.stride : NULL);
+    if (ret < 0) {
+        goto error;
+    }
+
+    decoded_area->x1 = 0;
+    decoded_area->x2 = s->width - 1;
+    decoded_area->y1 = y;
+    decoded_area->y2 = y;
+    dsc->decoded = buf;
+
+    stats.rows++;
+    stats.decode_us += k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return LV_RESULT_OK;
+
+error:
+    stats.errors++;
+    LOG_WRN("Malformed RLE image at row %u", s->row);
+    return LV_RESULT_INVALID;
+}
+
+static void rle_close(lv_image_decoder_t* decoder, lv_image_decoder_dsc_t* dsc)
+{
+    struct rle_decoder_ctx* ctx = dsc->user_data;
+
+    ARG_UNUSED(decoder);
+
+    if (ctx) {
+        lv_draw_buf_destroy(ctx->row_buf);
+        lv_free(ctx);
+        dsc->user_data = NULL;
+    }
+    dsc->decoded = NULL;
+}
+
+int rle_decoder_init(void)
+{
+    lv_image_decoder_t* decoder = lv_image_decoder_create();
+
+    if (!decoder) {
+        return -ENOMEM;
+    }
+
+    lv_image_decoder_set_info_cb(decoder, rle_info);
+    lv_image_decoder_set_open_cb(decoder, rle_open);
+    lv_image_decoder_set_get_area_cb(decoder, rle_get_area);
+    lv_image_decoder_set_close_cb(decoder, rle_close);
+    return 0;
+}
+
+void rle_decoder_get_stats(struct rle_decoder_stats* out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
+
+#if defined(CONFIG_SHELL)
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+
+/** @brief Benchmark image size, one icon */
+#define BENCH_DIM 20
+
+static int cmd_rle_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct rle_decoder_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    rle_decoder_get_stats(&s);
+    shell_print(sh, "opens: %u, rows: %u, skipped rows: %u, errors: %u", s.opens, s.rows,
+        s.skipped_rows, s.errors);
+    shell_print(sh, "decode time: %llu us, %u ns/row", (unsigned long long)s.decode_us,
+        s.rows ? (uint32_t)((s.decode_us * 1000U) / s.rows) : 0U);
+    return 0;
+}
+
+/**
+ * @brief Decode an icon-sized image row by row against copying raw RGB565
+ * rows, the work a raw image blit does before blending
+ */
+static int cmd_rle_bench(const struct shell* sh, size_t argc, char** argv)
+{
+    static uint16_t raw[BENCH_DIM * BENCH_DIM];
+    static uint8_t encoded[1 + RLE_IMAGE_MAX_PALETTE * 2 + BENCH_DIM * BENCH_DIM];
+    static uint16_t row_rgb[BENCH_DIM];
+    static uint8_t row_alpha[BENCH_DIM];
+    uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000U;
+    struct rle_image_stream s;
+    size_t len = 1 + 4 * 2;
+    uint32_t start, raw_cycles, rle_cycles;
+
+    if (rounds == 0) {
+        return -EINVAL;
+    }
+
+    /* Flat glyph: transparent border around a 4-color body, runs of 4 */
+    encoded[0] = 4;
+    for (uint8_t i = 0; i < 4; i++) {
+        sys_put_le16(0x1111 * i, &encoded[1 + i * 2]);
+    }
+    for (size_t p = 0; p < BENCH_DIM * BENCH_DIM; p += 4) {
+        uint8_t index = (p / BENCH_DIM == 0 || p / BENCH_DIM == BENCH_DIM - 1) ? 0 : (p / 4) % 4;
+
+        encoded[len++] = (3 << 4) | index;
+        for (size_t i = 0; i < 4; i++) {
+            raw[p + i] = 0x1111 * index;
+        }
+    }
+
+    start = k_cycle_get_32();
+    for (uint32_t r = 0; r < rounds; r++) {
+        for (size_t y = 0; y < BENCH_DIM; y++) {
+            memcpy(row_rgb, &raw[y * BENCH_DIM], sizeof(row_rgb));
+        }
+    }
+    raw_cycles = k_cycle_get_32() - start;
+
+    start = k_cycle_get_32();
+    for (uint32_t r = 0; r < rounds; r++) {
+        rle_image_begin(&s, encoded, len, BENCH_DIM, BENCH_DIM, true);
+        while (rle_image_decode_row(&s, row_rgb, row_alpha) == 0) {
+        }
+    }
+    rle_cycles = k_cycle_get_32() - start;
+
+    shell_print(sh, "%ux%u image, raw %u bytes, rle %u bytes", BENCH_DIM, BENCH_DIM,
+        (uint32_t)sizeof(raw), (uint32_t)len);
+    shell_print(sh, "raw rows: %u ns/image, rle rows: %u ns/image",
+        (uint32_t)(k_cyc_to_ns_floor64(raw_cycles) / rounds),
+        (uint32_t)(k_cyc_to_ns_floor64(rle_cycles) / rounds));
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rle_cmds,
+    SHELL_CMD_ARG(bench, NULL, "Row decode vs raw row copy: [rounds]", cmd_rle_bench, 1, 1),
+    SHELL_CMD(stats, NULL, "Show decoder statistics", cmd_rle_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(rle, &rle_cmds, "Palette + RLE image decoder", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,88 @@
+/**
+ * @file rle_decoder.h
+ * @brief LVGL Image Decoder for Palette + RLE Assets Header
+ *
+ * Lets LVGL draw images in the palette + RLE format (see rle_image.h) like
+ * any other image source. Images are decoded one row at a time into a
+ * single-row draw buffer that LVGL blends into the display buffer, so no
+ * full decoded copy is ever allocated or cached.
+ *
+ * An RLE asset is an lv_image_dsc_t with the RLE_IMAGE_FLAG flag, color
+ * format LV_COLOR_FORMAT_RAW (opaque) or LV_COLOR_FORMAT_RAW_ALPHA (palette
+ * index 0 transparent), and the encoded stream as data:
+ *
+ *   static const uint8_t glyph_data[] = { ... };
+ *   static const lv_image_dsc_t glyph = RLE_IMAGE_DSC(12, 12, true, glyph_data);
+ *   lv_image_set_src(img, &glyph);
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RLE_DECODER_H
+#define RLE_DECODER_H
+
+#include <stdint.h>
+
+#include <lvgl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Image flag marking palette + RLE data */
+#define RLE_IMAGE_FLAG LV_IMAGE_FLAGS_USER1
+
+/**
+ * @brief Initializer for an RLE image descriptor
+ *
+ * @param width Image width
+ * @param height Image height
+ * @param transparent Palette index 0 is transparent
+ * @param data Encoded stream array
+ */
+#define RLE_IMAGE_DSC(width, height, transparent, data)                                    \
+    {                                                                                      \
+        .header = {                                                                        \
+            .magic = LV_IMAGE_HEADER_MAGIC,                                                \
+            .cf = (transparent) ? LV_COLOR_FORMAT_RAW_ALPHA : LV_COLOR_FORMAT_RAW,         \
+            .flags = RLE_IMAGE_FLAG,                                                       \
+            .w = (width),                                                                  \
+            .h = (height),                                                                 \
+        },                                                                                 \
+        .data_size = sizeof(data),                                                         \
+        .data = (data),                                                                    \
+    }
+
+/**
+ * @brief RLE decoder statistics
+ */
+struct rle_decoder_stats {
+    uint32_t opens; /**< Images opened for drawing */
+    uint32_t rows; /**< Rows decoded */
+    uint32_t skipped_rows; /**< Rows decoded only to reach a clipped area */
+    uint32_t errors; /**< Malformed images */
+    uint64_t decode_us; /**< Time spent decoding rows */
+};
+
+/**
+ * @brief Register the decoder with LVGL
+ *
+ * Call once after lv_init().
+ *
+ * @retval 0 Success
+ * @retval -ENOMEM Decoder could not be created
+ */
+int rle_decoder_init(void);
+
+/**
+ * @brief Get decoder statistics
+ *
+ * @param stats Output for the statistics
+ */
+void rle_decoder_get_stats(struct rle_decoder_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RLE_DECODER_H */
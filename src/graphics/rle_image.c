@@ -0,0 +1,111 @@
+/**
+ * @file rle_image.c
+ * @brief Palette + RLE Image Codec Implementation
+ *
+ * The palette is converted to native RGB565 once per image, so each run
+ * costs one table lookup and a fill.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+
+#include "graphics/rle_image.h"
+
+int rle_image_begin(struct rle_image_stream* s, const uint8_t* data, size_t len, uint16_t width,
+    uint16_t height, bool transparent)
+{
+    uint8_t colors;
+
+    if (len < 1) {
+        return -EINVAL;
+    }
+
+    colors = data[0];
+    if (colors == 0 || colors > RLE_IMAGE_MAX_PALETTE || len < 1 + (size_t)colors * 2) {
+        return -EINVAL;
+    }
+
+    for (uint8_t i = 0; i < colors; i++) {
+        s->palette[i] = data[1 + i * 2] | (data[2 + i * 2] << 8);
+    }
+
+    s->data = data;
+    s->len = len;
+    s->pos = 1 + (size_t)colors * 2;
+    s->width = width;
+    s->height = height;
+    s->row = 0;
+    s->colors = colors;
+    s->run_left = 0;
+    s->index = 0;
+    s->transparent = transparent;
+    return 0;
+}
+
+int rle_image_decode_row(struct rle_image_stream* s, uint16_t* rgb, uint8_t* alpha)
+{
+    /* Locals, so stores to the row cannot force reloads of the state */
+    const uint8_t* data = s->data;
+    size_t pos = s->pos;
+    uint16_t width = s->width;
+    uint8_t run_left = s->run_left;
+    uint8_t index = s->index;
+    uint16_t x = 0;
+
+    if (s->row >= s->height) {
+        return -ENODATA;
+    }
+
+    while (x < width) {
+        uint16_t n;
+
+        if (run_left == 0) {
+            if (pos >= s->len) {
+                return -EINVAL;
+            }
+            index = data[pos] & 0x0F;
+            run_left = (data[pos] >> 4) + 1;
+            pos++;
+            if (index >= s->colors) {
+                return -EINVAL;
+            }
+        }
+
+        n = width - x;
+        if (n > run_left) {
+            n = run_left;
+        }
+
+        if (rgb) {
+            uint16_t color = s->palette[index];
+            uint16_t* out = &rgb[x];
+
+            for (uint16_t i = 0; i < n; i++) {
+                out[i] = color;
+            }
+        }
+        if (alpha) {
+            uint8_t a = (s->transparent && index == 0) ? 0 : RLE_IMAGE_ALPHA_OPAQUE;
+            uint8_t* out = &alpha[x];
+
+            for (uint16_t i = 0; i < n; i++) {
+                out[i] = a;
+            }
+        }
+
+        x += n;
+        run_left -= n;
+    }
+
+    s->pos = pos;
+    s->run_left = run_left;
+    s->index = index;
+    s->row++;
+    return 0;
+}
+
+bool rle_image_complete(const struct rle_image_stream* s)
+{
+    return s->row == s->height && s->run_left == 0 && s->pos == s->len;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file rle_image.h
+ * @brief Palette + RLE Image Codec Header
+ *
+ * Compact format for small flat-colored UI assets (icons, status glyphs,
+ * watch-face parts). An image is a palette of up to 16 RGB565 colors and a
+ * stream of runs in row-major order:
+ *   [palette count] [palette RGB565 u16 LE ...] runs ...
+ * Each run byte is (length - 1) << 4 | palette index, and runs may continue
+ * across rows. In transparent images palette index 0 is fully transparent.
+ *
+ * Width and height are not part of the stream, they come from the image
+ * descriptor (or, for icons, the icon header).
+ *
+ * Decoding is incremental, one row at a time, so an image can be drawn
+ * without a buffer for the whole image.
+ *
+ * This file has no Zephyr or LVGL dependencies so it also builds on the host
+ * for benchmarking (tools/image_bench).
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RLE_IMAGE_H
+#define RLE_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Palette entries */
+#define RLE_IMAGE_MAX_PALETTE 16
+
+/** @brief Longest run of one run byte */
+#define RLE_IMAGE_MAX_RUN 16
+
+/** @brief Alpha of opaque pixels */
+#define RLE_IMAGE_ALPHA_OPAQUE 0xFF
+
+/**
+ * @brief Decoding position in an image
+ */
+struct rle_image_stream {
+    const uint8_t* data;
+    size_t len;
+    size_t pos; /**< Next run byte */
+    uint16_t width;
+    uint16_t height;
+    uint16_t row; /**< Next row to decode */
+    uint8_t colors;
+    uint8_t run_left; /**< Pixels left in the current run */
+    uint8_t index; /**< Palette index of the current run */
+    bool transparent; /**< Index 0 is transparent */
+    uint16_t palette[RLE_IMAGE_MAX_PALETTE];
+};
+
+/**
+ * @brief Start decoding an image from its first row
+ *
+ * @param s Stream state
+ * @param data Encoded image, must stay valid while decoding
+ * @param len Encoded length
+ * @param width Image width
+ * @param height Image height
+ * @param transparent Palette index 0 is transparent
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Malformed palette
+ */
+int rle_image_begin(struct rle_image_stream* s, const uint8_t* data, size_t len, uint16_t width,
+    uint16_t height, bool transparent);
+
+/**
+ * @brief Decode the next row
+ *
+ * @param s Stream state
+ * @param rgb Output for width RGB565 pixels, NULL to skip the row
+ * @param alpha Output for width alpha values, NULL if not needed
+ *
+ * @retval 0 Success
+ * @retval -ENODATA All rows were decoded
+ * @retval -EINVAL Malformed or truncated runs
+ */
+int rle_image_decode_row(struct rle_image_stream* s, uint16_t* rgb, uint8_t* alpha);
+
+/**
+ * @brief Check that a fully decoded image had no trailing data
+ *
+ * @param s Stream state after the last row
+ * @return true if every row was decoded and every run byte consumed
+ */
+bool rle_image_complete(const struct rle_image_stream* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RLE_IMAGE_H */
@@ -0,0 +1,512 @@
+/**
+ * @file icons.c
+ * @brief App Icon Cache Implementation
+ *
+ * Lookups run on the LVGL thread (swipes) and the main loop; loading,
+ * decoding and requests only on the main loop, under the same lock. Decoded
+ * icons are RGB565A8 so LVGL draws them in place without a decoder.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/protocol.h"
+#include "icons/icons.h"
+
+LOG_MODULE_REGISTER(icons, LOG_LEVEL_INF);
+
+/** @brief Settings subtree of the persisted icons */
+#define ICONS_SETTINGS_ROOT "icons"
+
+/** @brief Buffer size for "icons/<8 hex digits>" */
+#define ICONS_KEY_LEN (sizeof(ICONS_SETTINGS_ROOT) + 9)
+
+/** @brief Pixels in an icon */
+#define ICON_PIXELS (ICONS_DIM * ICONS_DIM)
+
+/** @brief Icons waiting to be loaded by icons_process() */
+#define WANTED_LEN 4
+
+/** @brief Icons requested from the phone on the current connection */
+#define REQUESTED_LEN 8
+
+/**
+ * @brief Decoded icon, RGB565 plane followed by the A8 plane
+ */
+struct ram_slot {
+    uint32_t id; /**< 0 if unused */
+    uint32_t last_used;
+    lv_image_dsc_t dsc;
+    uint8_t pixels[ICON_PIXELS * 3] __aligned(2);
+};
+
+static struct ram_slot ram[ICONS_RAM_SLOTS];
+
+BUILD_ASSERT(ICONS_RAM_SLOTS >= 2, "A pinned icon needs another slot to decode into");
+
+/* Icons persisted in flash, with RAM-only use stamps for eviction */
+static uint32_t flash_ids[ICONS_FLASH_SLOTS];
+static uint32_t flash_used[ICONS_FLASH_SLOTS];
+static uint8_t flash_count;
+
+static uint32_t wanted[WANTED_LEN];
+static uint8_t wanted_count;
+static uint32_t requested[REQUESTED_LEN];
+static uint8_t requested_next;
+
+static uint32_t use_counter;
+static uint32_t pinned_id; /* Shown, never evicted */
+static icons_ready_cb_t ready_cb;
+static struct icons_stats stats;
+static K_MUTEX_DEFINE(icons_lock);
+
+/* Encoded icon read back from flash, main loop only */
+static uint8_t load_buf[ICONS_MAX_ENCODED_LEN];
+static size_t load_len;
+
+/**
+ * @brief Decode an encoded icon into RGB565A8 pixels
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Malformed icon
+ */
+static int decode(const uint8_t* data, size_t len, uint8_t* out)
+{
+    uint16_t* rgb = (uint16_t*)out;
+    uint8_t* alpha = out + ICON_PIXELS * 2;
+    struct rle_image_stream s;
+    int ret;
+
+    if (len < 2 || data[0] != ICONS_DIM || data[1] != ICONS_DIM) {
+        return -EINVAL;
+    }
+
+    ret = rle_image_begin(&s, &data[2], len - 2, ICONS_DIM, ICONS_DIM, true);
+    for (size_t y = 0; ret == 0 && y < ICONS_DIM; y++) {
+        ret = rle_image_decode_row(&s, &rgb[y * ICONS_DIM], &alpha[y * ICONS_DIM]);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    return rle_image_complete(&s) ? 0 : -EINVAL;
+}
+
+static struct ram_slot* find_ram(uint32_t id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(ram); i++) {
+        if (ram[i].id == id) {
+            return &ram[i];
+        }
+    }
+    return NULL;
+}
+
+static int find_flash(uint32_t id)
+{
+    for (uint8_t i = 0; i < flash_count; i++) {
+        if (flash_ids[i] == id) {
+            return i;
+        }
+    }
+    return -ENOENT;
+}
+
+/**
+ * @brief Decode into the least recently used RAM slot
+ *
+ * Called with the lock held.
+ */
+static int decode_to_ram(uint32_t id, const uint8_t* data, size_t len)
+{
+    struct ram_slot* slot = &ram[0];
+    uint32_t start = k_cycle_get_32();
+    uint32_t decode_us;
+    int ret;
+
+    /* Least recently used, but never the icon on screen */
+    if (pinned_id && slot->id == pinned_id) {
+        slot = &ram[1];
+    }
+    for (size_t i = 1; i < ARRAY_SIZE(ram); i++) {
+        if (ram[i].last_used < slot->last_used && (!pinned_id || ram[i].id != pinned_id)) {
+            slot = &ram[i];
+        }
+    }
+
+    if (slot->id) {
+        lv_image_cache_drop(&slot->dsc);
+    }
+
+    slot->id = 0;
+    ret = decode(data, len, slot->pixels);
+    if (ret < 0) {
+        return ret;
+    }
+
+    slot->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+    slot->dsc.header.cf = LV_COLOR_FORMAT_RGB565A8;
+    slot->dsc.header.w = ICONS_DIM;
+    slot->dsc.header.h = ICONS_DIM;
+    slot->dsc.header.stride = ICONS_DIM * 2;
+    slot->dsc.data_size = sizeof(slot->pixels);
+    slot->dsc.data = slot->pixels;
+    slot->id = id;
+    slot->last_used = ++use_counter;
+
+    decode_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    stats.last_decode_us = decode_us;
+    stats.max_decode_us = MAX(stats.max_decode_us, decode_us);
+    return 0;
+}
+
+static void format_key(char* key, uint32_t id)
+{
+    snprintf(key, ICONS_KEY_LEN, ICONS_SETTINGS_ROOT "/%08x", id);
+}
+
+/**
+ * @brief Persist an icon, evicting the least recently used one if full
+ *
+ * Called with the lock held.
+ */
+static int persist(uint32_t id, const uint8_t* data, size_t len)
+{
+    char key[ICONS_KEY_LEN];
+    int slot;
+    int ret;
+
+    if (!IS_ENABLED(CONFIG_SETTINGS) || find_flash(id) >= 0) {
+        return 0;
+    }
+
+    if (flash_count == ICONS_FLASH_SLOTS) {
+        slot = 0;
+        for (uint8_t i = 1; i < flash_count; i++) {
+            if (flash_used[i] < flash_used[slot]) {
+                slot = i;
+            }
+        }
+        format_key(key, flash_ids[slot]);
+        settings_delete(key);
+    } else {
+        slot = flash_count++;
+    }
+
+    format_key(key, id);
+    ret = settings_save_one(key, data, len);
+    if (ret < 0) {
+        flash_ids[slot] = flash_ids[--flash_count];
+        flash_used[slot] = flash_used[flash_count];
+        return ret;
+    }
+
+    flash_ids[slot] = id;
+    flash_used[slot] = use_counter;
+    return 0;
+}
+
+static int load_direct_cb(const char* key, size_t len, settings_read_cb read_cb, void* cb_arg,
+    void* param)
+{
+    ssize_t read_len;
+
+    ARG_UNUSED(key);
+    ARG_UNUSED(param);
+
+    if (len > sizeof(load_buf)) {
+        return -E2BIG;
+    }
+
+    read_len = read_cb(cb_arg, load_buf, len);
+    if (read_len < 0) {
+        return (int)read_len;
+    }
+    load_len = (size_t)read_len;
+    return 0;
+}
+
+/**
+ * @brief Load an icon from flash and decode it
+ *
+ * Called with the lock held.
+ */
+static int load_from_flash(uint32_t id)
+{
+    char key[ICONS_KEY_LEN];
+    int ret;
+
+    format_key(key, id);
+    load_len = 0;
+    ret = settings_load_subtree_direct(key, load_direct_cb, NULL);
+    if (ret < 0 || load_len == 0) {
+        return (ret < 0) ? ret : -ENOENT;
+    }
+
+    /* Content addressed: a corrupted entry no longer matches its id */
+    if (crc32_ieee(load_buf, load_len) != id) {
+        return -EIO;
+    }
+
+    return decode_to_ram(id, load_buf, load_len);
+}
+
+static bool was_requested(uint32_t id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(requested); i++) {
+        if (requested[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void want(uint32_t id)
+{
+    for (uint8_t i = 0; i < wanted_count; i++) {
+        if (wanted[i] == id) {
+            return;
+        }
+    }
+
+    if (wanted_count == WANTED_LEN) {
+        /* Newest wins, older wants are for notifications already scrolled past */
+        memmove(&wanted[0], &wanted[1], (WANTED_LEN - 1) * sizeof(wanted[0]));
+        wanted_count--;
+    }
+    wanted[wanted_count++] = id;
+}
+
+const lv_image_dsc_t* icons_lookup(uint32_t id)
+{
+    const lv_image_dsc_t* dsc = NULL;
+    struct ram_slot* slot;
+
+    if (id == 0) {
+        return NULL;
+    }
+
+    k_mutex_lock(&icons_lock, K_FOREVER);
+
+    stats.lookups++;
+    slot = find_ram(id);
+    if (slot) {
+        stats.ram_hits++;
+        slot->last_used = ++use_counter;
+        dsc = &slot->dsc;
+    } else {
+        want(id);
+    }
+
+    k_mutex_unlock(&icons_lock);
+    return dsc;
+}
+
+void icons_pin(uint32_t id)
+{
+    k_mutex_lock(&icons_lock, K_FOREVER);
+    pinned_id = id;
+    k_mutex_unlock(&icons_lock);
+}
+
+void icons_prefetch(uint32_t id)
+{
+    if (id == 0) {
+        return;
+    }
+
+    k_mutex_lock(&icons_lock, K_FOREVER);
+    if (!find_ram(id)) {
+        want(id);
+    }
+    k_mutex_unlock(&icons_lock);
+}
+
+int icons_store(uint32_t id, const uint8_t* data, size_t len)
+{
+    int ret;
+
+    if (len > ICONS_MAX_ENCODED_LEN || crc32_ieee(data, len) != id) {
+        stats.rejected++;
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&icons_lock, K_FOREVER);
+
+    ret = find_ram(id) ? 0 : decode_to_ram(id, data, len);
+    if (ret == 0) {
+        stats.received++;
+        ret = persist(id, data, len);
+        if (ret < 0) {
+            LOG_WRN("Failed to persist icon %08x (ret: %d)", id, ret);
+        }
+    } else {
+        stats.rejected++;
+    }
+
+    k_mutex_unlock(&icons_lock);
+
+    if (ret == 0 && ready_cb) {
+        ready_cb(id);
+    }
+    return ret;
+}
+
+void icons_process(void)
+{
+    uint32_t id;
+    int index;
+    int ret;
+
+    for (;;) {
+        k_mutex_lock(&icons_lock, K_FOREVER);
+
+        if (wanted_count == 0) {
+            k_mutex_unlock(&icons_lock);
+            return;
+        }
+
+        id = wanted[--wanted_count];
+        if (find_ram(id)) {
+            ret = 0;
+        } else if ((index = find_flash(id)) >= 0) {
+            flash_used[index] = ++use_counter;
+            ret = load_from_flash(id);
+            if (ret == 0) {
+                stats.flash_loads++;
+            } else {
+                LOG_WRN("Failed to load icon %08x (ret: %d)", id, ret);
+            }
+        } else {
+            ret = -ENOENT;
+        }
+
+        k_mutex_unlock(&icons_lock);
+
+        if (ret == 0) {
+            if (ready_cb) {
+                ready_cb(id);
+            }
+        } else if (!was_requested(id)) {
+            /* The phone answers with CMD_SET_ICON */
+            requested[requested_next] = id;
+            requested_next = (requested_next + 1) % REQUESTED_LEN;
+            stats.requests++;
+            bluetooth_send_action(PROTOCOL_ACTION_REQUEST_ICON, id, NULL);
+        }
+    }
+}
+
+void icons_reset_requests(void)
+{
+    k_mutex_lock(&icons_lock, K_FOREVER);
+    memset(requested, 0, sizeof(requested));
+    k_mutex_unlock(&icons_lock);
+}
+
+void icons_reset(void)
+{
+    char key[ICONS_KEY_LEN];
+
+    k_mutex_lock(&icons_lock, K_FOREVER);
+
+    for (size_t i = 0; i < ARRAY_SIZE(ram); i++) {
+        if (ram[i].id) {
+            lv_image_cache_drop(&ram[i].dsc);
+        }
+        ram[i].id = 0;
+        ram[i].last_used = 0;
+    }
+
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        for (uint8_t i = 0; i < flash_count; i++) {
+            format_key(key, flash_ids[i]);
+            settings_delete(key);
+        }
+    }
+    flash_count = 0;
+
+    wanted_count = 0;
+    memset(requested, 0, sizeof(requested));
+    requested_next = 0;
+    use_counter = 0;
+    pinned_id = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    k_mutex_unlock(&icons_lock);
+}
+
+void icons_set_ready_callback(icons_ready_cb_t cb)
+{
+    ready_cb = cb;
+}
+
+void icons_get_stats(struct icons_stats* out)
+{
+    if (out) {
+        k_mutex_lock(&icons_lock, K_FOREVER);
+        *out = stats;
+        k_mutex_unlock(&icons_lock);
+    }
+}
+
+#if defined(CONFIG_SETTINGS)
+/**
+ * @brief Index the persisted icons at settings load, without reading them
+ */
+static int icons_settings_set(const char* name, size_t len, settings_read_cb read_cb, void* cb_arg)
+{
+    char* end;
+    uint32_t id;
+
+    ARG_UNUSED(read_cb);
+    ARG_UNUSED(cb_arg);
+
+    id = strtoul(name, &end, 16);
+    if (*end != '\0' || id == 0 || len > ICONS_MAX_ENCODED_LEN) {
+        return -EINVAL;
+    }
+
+    if (flash_count < ICONS_FLASH_SLOTS && find_flash(id) < 0) {
+        flash_ids[flash_count++] = id;
+    }
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(icons, ICONS_SETTINGS_ROOT, NULL, icons_settings_set, NULL, NULL);
+#endif /* CONFIG_SETTINGS */
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_icons_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    struct icons_stats s;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    icons_get_stats(&s);
+    shell_print(sh, "lookups: %u, ram hits: %u, flash loads: %u, stored in flash: %u/%u",
+        s.lookups, s.ram_hits, s.flash_loads, flash_count, ICONS_FLASH_SLOTS);
+    shell_print(sh, "received: %u, requested: %u, rejected: %u", s.received, s.requests,
+        s.rejected);
+    shell_print(sh, "decode: last %u us, max %u us", s.last_decode_us, s.max_decode_us);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(icons_cmds,
+    SHELL_CMD(stats, NULL, "Show icon cache statistics", cmd_icons_stats),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(icons, &icons_cmds, "App icon cache", NULL);
+#endif /* CONFIG_SHELL */
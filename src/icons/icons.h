@@ -0,0 +1,147 @@
+/**
+ * @file icons.h
+ * @brief App Icon Cache Header
+ *
+ * App icons are sent by the phone once, as small palette + RLE images, and
+ * kept in a content-addressed cache: an icon's id is the CRC32 of its
+ * encoded bytes, so the same picture is stored once whichever app uses it.
+ *
+ * Encoded icons are persisted with the settings subsystem ("icons/<id>").
+ * A few decoded icons are kept in RAM in least recently used order, ready
+ * to be drawn. Lookups never touch flash or decode; missing icons are
+ * loaded (or requested from the phone) by icons_process() on the main loop
+ * and announced with the ready callback.
+ *
+ * Encoded icon layout:
+ *   [width] [height] palette + RLE stream (see graphics/rle_image.h)
+ * Palette entry 0 is transparent.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef ICONS_H
+#define ICONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <lvgl.h>
+
+#include "graphics/rle_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Icon width and height in pixels */
+#define ICONS_DIM 20
+
+/** @brief Palette entries, including the transparent entry 0 */
+#define ICONS_MAX_PALETTE RLE_IMAGE_MAX_PALETTE
+
+/** @brief Longest encoded icon */
+#define ICONS_MAX_ENCODED_LEN (3 + ICONS_MAX_PALETTE * 2 + ICONS_DIM * ICONS_DIM)
+
+/** @brief Encoded icons kept in flash */
+#define ICONS_FLASH_SLOTS 32
+
+/** @brief Decoded icons kept in RAM */
+#define ICONS_RAM_SLOTS 6
+
+/**
+ * @brief Icon cache statistics
+ */
+struct icons_stats {
+    uint32_t lookups; /**< icons_lookup() calls */
+    uint32_t ram_hits; /**< Lookups served from RAM */
+    uint32_t flash_loads; /**< Icons loaded from flash and decoded */
+    uint32_t received; /**< Icons received from the phone */
+    uint32_t requests; /**< Icons requested from the phone */
+    uint32_t rejected; /**< Received icons that failed validation */
+    uint32_t last_decode_us; /**< Time of the latest decode */
+    uint32_t max_decode_us; /**< Worst decode time */
+};
+
+/**
+ * @brief Called on the main loop when a wanted icon becomes available
+ *
+ * @param id Icon id
+ */
+typedef void (*icons_ready_cb_t)(uint32_t id);
+
+/**
+ * @brief Get a decoded icon without blocking
+ *
+ * On a miss the icon is queued for icons_process(), which calls the ready
+ * callback once it is decoded.
+ *
+ * @param id Icon id, 0 for none
+ * @return Image descriptor valid until the icon is evicted, NULL on a miss
+ */
+const lv_image_dsc_t* icons_lookup(uint32_t id);
+
+/**
+ * @brief Keep an icon in RAM while it is on screen
+ *
+ * Its pixels are never decoded over, so the image LVGL draws stays valid.
+ * Only one icon is pinned at a time.
+ *
+ * @param id Icon id, 0 to unpin
+ */
+void icons_pin(uint32_t id);
+
+/**
+ * @brief Decode an icon ahead of use (e.g. when a notification arrives)
+ *
+ * @param id Icon id, 0 for none
+ */
+void icons_prefetch(uint32_t id);
+
+/**
+ * @brief Store an icon received from the phone
+ *
+ * @param id Icon id, must be the CRC32 of the encoded bytes
+ * @param data Encoded icon
+ * @param len Encoded length
+ *
+ * @retval 0 Stored and decoded
+ * @retval -EINVAL Id mismatch or malformed icon
+ * @retval Negative errno code if it could not be persisted
+ */
+int icons_store(uint32_t id, const uint8_t* data, size_t len);
+
+/**
+ * @brief Load wanted icons and request missing ones (call in main loop)
+ */
+void icons_process(void);
+
+/**
+ * @brief Forget which icons were requested (on reconnect)
+ */
+void icons_reset_requests(void);
+
+/**
+ * @brief Empty the cache, in RAM and in flash, and clear the statistics
+ */
+void icons_reset(void);
+
+/**
+ * @brief Register the icon ready callback
+ *
+ * @param cb Callback, NULL to unregister
+ */
+void icons_set_ready_callback(icons_ready_cb_t cb);
+
+/**
+ * @brief Get icon cache statistics
+ *
+ * @param stats Output for the statistics
+ */
+void icons_get_stats(struct icons_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ICONS_H */
@@ -0,0 +1,197 @@
+/**
+ * @file latency.c
+ * @brief Receipt to Glass Latency Histogram Implementation
+ *
+ * A ring holds the bucket of each sample in the window, so the oldest
+ * sample's count is taken back when it rolls out. Buckets are 5 ms wide up
+ * to 50 ms and grow wider above, the last one is open ended past 30 s.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "latency/latency.h"
+
+/** @brief Bucket upper bounds in ms, inclusive; the last bucket is unbounded */
+static const uint16_t bucket_ms[LATENCY_BUCKETS - 1] = {
+    5, 10, 15, 20, 25, 30, 35, 40, 45, 50,
+    60, 70, 80, 90, 100, 125, 150, 175, 200, 250,
+    300, 400, 500, 750, 1000, 1500, 2000, 3000, 5000, 10000,
+    30000,
+};
+
+static uint8_t ring[LATENCY_WINDOW];
+static uint16_t ring_ms[LATENCY_WINDOW];
+static size_t head;
+static size_t count;
+static uint16_t buckets[LATENCY_BUCKETS];
+static uint32_t total;
+static uint32_t superseded;
+static uint32_t last_ms;
+static struct k_spinlock lock;
+
+static uint8_t bucket_of(uint32_t ms)
+{
+    uint8_t i = 0;
+
+    while (i < ARRAY_SIZE(bucket_ms) && ms > bucket_ms[i]) {
+        i++;
+    }
+    return i;
+}
+
+void latency_record(uint32_t latency_us)
+{
+    uint32_t ms = latency_us / 1000U;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    size_t slot = (head + count) % LATENCY_WINDOW;
+
+    if (count == LATENCY_WINDOW) {
+        buckets[ring[head]]--;
+        head = (head + 1) % LATENCY_WINDOW;
+    } else {
+        count++;
+    }
+
+    ring[slot] = bucket_of(ms);
+    ring_ms[slot] = MIN(ms, UINT16_MAX);
+    buckets[ring[slot]]++;
+    total++;
+    last_ms = ms;
+    k_spin_unlock(&lock, key);
+}
+
+void latency_count_superseded(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    superseded++;
+    k_spin_unlock(&lock, key);
+}
+
+static uint32_t percentile(uint32_t percent, uint32_t max_ms)
+{
+    /* Smallest bucket holding at least percent of the samples */
+    uint32_t rank = DIV_ROUND_UP(count * percent, 100U);
+    uint32_t seen = 0;
+
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) {
+            return (i < ARRAY_SIZE(bucket_ms)) ? MIN(bucket_ms[i], max_ms) : max_ms;
+        }
+    }
+    return 0;
+}
+
+void latency_get_summary(struct latency_summary* out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t max_ms = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        max_ms = MAX(max_ms, ring_ms[(head + i) % LATENCY_WINDOW]);
+    }
+
+    out->samples = count;
+    out->total = total;
+    out->superseded = superseded;
+    out->p50_ms = percentile(50, max_ms);
+    out->p95_ms = percentile(95, max_ms);
+    out->p99_ms = percentile(99, max_ms);
+    out->max_ms = max_ms;
+    out->last_ms = last_ms;
+    k_spin_unlock(&lock, key);
+}
+
+size_t latency_encode(uint8_t* buf, size_t len)
+{
+    struct latency_summary s;
+
+    if (len < LATENCY_ENCODED_LEN) {
+        return 0;
+    }
+
+    latency_get_summary(&s);
+    buf[0] = LATENCY_ENCODING_VERSION;
+    sys_put_le16(s.samples, &buf[1]);
+    sys_put_le16(MIN(s.p50_ms, UINT16_MAX), &buf[3]);
+    sys_put_le16(MIN(s.p95_ms, UINT16_MAX), &buf[5]);
+    sys_put_le16(MIN(s.p99_ms, UINT16_MAX), &buf[7]);
+    sys_put_le16(MIN(s.max_ms, UINT16_MAX), &buf[9]);
+    sys_put_le32(s.total, &buf[11]);
+    return LATENCY_ENCODED_LEN;
+}
+
+void latency_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    head = 0;
+    count = 0;
+    memset(buckets, 0, sizeof(buckets));
+    total = 0;
+    superseded = 0;
+    last_ms = 0;
+    k_spin_unlock(&lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_latency_show(const struct shell* sh, size_t argc, char** argv)
+{
+    struct latency_summary s;
+    uint16_t snapshot[LATENCY_BUCKETS];
+    k_spinlock_key_t key;
+    uint16_t lower = 0;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    latency_get_summary(&s);
+    key = k_spin_lock(&lock);
+    memcpy(snapshot, buckets, sizeof(snapshot));
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "receipt to glass (%u of %u samples): p50 %u ms, p95 %u ms, p99 %u ms, "
+                    "max %u ms, last %u ms",
+        s.samples, s.total, s.p50_ms, s.p95_ms, s.p99_ms, s.max_ms, s.last_ms);
+    shell_print(sh, "superseded on screen before the transfer: %u", s.superseded);
+
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        if (snapshot[i] > 0) {
+            if (i < ARRAY_SIZE(bucket_ms)) {
+                shell_print(sh, "%5u-%5u ms: %u", lower, bucket_ms[i], snapshot[i]);
+            } else {
+                shell_print(sh, "   >%5u ms: %u", lower, snapshot[i]);
+            }
+        }
+        if (i < ARRAY_SIZE(bucket_ms)) {
+            lower = bucket_ms[i];
+        }
+    }
+    return 0;
+}
+
+static int cmd_latency_reset(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    latency_reset();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(latency_cmds,
+    SHELL_CMD(show, NULL, "Show the receipt to glass histogram and percentiles",
+        cmd_latency_show),
+    SHELL_CMD(reset, NULL, "Empty the histogram", cmd_latency_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(latency, &latency_cmds, "Receipt to glass latency", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,95 @@
+/**
+ * @file latency.h
+ * @brief Receipt to Glass Latency Histogram Header
+ *
+ * How long after the phone's write a notification is readable on the watch.
+ * Notifications are stamped when their packet is received, and the flush
+ * callback records the latency once the last area holding the notification
+ * has been transferred to the panel (see lvgl_arm_glass_probe()).
+ *
+ * The histogram covers the latest LATENCY_WINDOW samples, older ones roll
+ * out. Percentiles are the upper bound of the bucket they fall in, capped
+ * at the largest sample. Read with the 'latency' shell command or from the
+ * stats characteristic, encoded as (little endian):
+ *
+ *   [version] [samples u16] [p50 ms u16] [p95 ms u16] [p99 ms u16]
+ *   [max ms u16] [total u32]
+ *
+ * Safe to call from any thread.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Latest samples the histogram covers */
+#define LATENCY_WINDOW 256
+
+/** @brief Histogram buckets, the last one is unbounded */
+#define LATENCY_BUCKETS 32
+
+/** @brief Encoded summary version and length */
+#define LATENCY_ENCODING_VERSION 1
+#define LATENCY_ENCODED_LEN 15
+
+/**
+ * @brief Latency summary over the window
+ */
+struct latency_summary {
+    uint32_t samples; /**< Samples in the window */
+    uint32_t total; /**< Samples recorded since boot or reset */
+    uint32_t superseded; /**< Notifications replaced on screen before reaching it */
+    uint32_t p50_ms;
+    uint32_t p95_ms;
+    uint32_t p99_ms;
+    uint32_t max_ms; /**< Largest sample in the window */
+    uint32_t last_ms; /**< Latest sample */
+};
+
+/**
+ * @brief Record a receipt to glass latency
+ *
+ * @param latency_us Time from receipt to the end of the transfer
+ */
+void latency_record(uint32_t latency_us);
+
+/**
+ * @brief Count a notification replaced on screen by a newer one before it
+ *        was transferred, not measured
+ */
+void latency_count_superseded(void);
+
+/**
+ * @brief Get the summary of the window
+ *
+ * @param summary Output for the summary
+ */
+void latency_get_summary(struct latency_summary* summary);
+
+/**
+ * @brief Encode the summary for the stats characteristic
+ *
+ * @param buf Output buffer
+ * @param len Buffer length, at least LATENCY_ENCODED_LEN
+ * @return Encoded length, 0 if the buffer is too small
+ */
+size_t latency_encode(uint8_t* buf, size_t len);
+
+/**
+ * @brief Empty the histogram and the counters
+ */
+void latency_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_H */
@@ -0,0 +1,445 @@
+/**
+ * @file loadgen.c
+ * @brief Synthetic Notification Load Generator Implementation
+ *
+ * Packets are built and sent from the timer's expiry function, as the
+ * Bluetooth thread would write them. The handled callback (main loop) queues
+ * each generated packet until the LVGL thread finishes a frame started after
+ * it, which gives its UI latency. A generator with a fixed seed makes every
+ * run of a profile send the same packets.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <lvgl.h>
+
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/protocol.h"
+#include "loadgen/loadgen.h"
+
+#if defined(CONFIG_LOADGEN)
+
+/** @brief Handled packets waiting for a frame, later ones are not sampled */
+#define PENDING_LEN 32
+
+/** @brief Phone categories, as numbered by the Android app */
+#define CATEGORY_MESSAGE 1
+#define CATEGORY_EMAIL 2
+#define CATEGORY_SOCIAL 3
+#define CATEGORY_CALENDAR 4
+
+/** @brief Generator seed, the same for every run */
+#define SEED 12345U
+
+struct app {
+    const char* name;
+    uint8_t category;
+};
+
+static const struct app apps[LOADGEN_APP_COUNT] = {
+    { "WhatsApp", CATEGORY_MESSAGE },
+    { "Gmail", CATEGORY_EMAIL },
+    { "Telegram", CATEGORY_MESSAGE },
+    { "Instagram", CATEGORY_SOCIAL },
+    { "Calendar", CATEGORY_CALENDAR },
+};
+
+static const char* const senders[] = { "Dana", "Avi", "Noa", "Yossi", "Tamar", "Team" };
+
+static const char filler[] = "Did anyone see the new schedule for next week? "
+                             "I think they moved everything to Thursday. ";
+
+static const struct {
+    const char* name;
+    struct loadgen_profile profile;
+} presets[] = {
+    { "chat", { .rate = 20, .count = 60, .text_min = 2, .text_max = 80,
+                  .app_weights = { 1, 0, 0, 0, 0 } } },
+    { "email", { .rate = 50, .count = 25, .text_min = 60, .text_max = 200,
+                   .app_weights = { 0, 1, 0, 0, 0 } } },
+    { "mixed", { .rate = 2, .count = 100, .text_min = 4, .text_max = 200,
+                   .app_weights = { 4, 2, 2, 1, 1 } } },
+};
+
+/**
+ * @brief Generated packet handled, waiting for a frame
+ */
+struct pending {
+    uint32_t rx_cycles;
+    uint32_t handled_cycles;
+};
+
+static void on_send(struct k_timer* timer);
+
+static K_TIMER_DEFINE(send_timer, on_send, NULL);
+
+static struct k_spinlock lock;
+static struct loadgen_profile profile;
+static uint32_t weight_total;
+static uint32_t rng;
+static bool sending;
+static int64_t first_sent_ms;
+static int64_t last_handled_ms;
+static struct loadgen_report report;
+
+static struct pending pending[PENDING_LEN];
+static size_t pending_head;
+static size_t pending_count;
+static uint32_t frame_start_cycles;
+
+static uint32_t latency_us[LOADGEN_LATENCY_SAMPLES];
+static uint32_t sorted_us[LOADGEN_LATENCY_SAMPLES];
+
+static uint32_t next_random(void)
+{
+    rng = rng * 1103515245U + 12345U;
+    return (rng >> 8) & 0xFFFFFF;
+}
+
+static const struct app* pick_app(void)
+{
+    uint32_t n = next_random() % weight_total;
+
+    for (size_t i = 0; i < ARRAY_SIZE(apps); i++) {
+        if (n < profile.app_weights[i]) {
+            return &apps[i];
+        }
+        n -= profile.app_weights[i];
+    }
+    return &apps[0];
+}
+
+/**
+ * @brief Encode the next notification as createNotificationPacket() does
+ *
+ * @return Packet length
+ */
+static size_t build_packet(uint8_t* buf, uint32_t seq)
+{
+    const struct app* app = pick_app();
+    const char* sender = senders[next_random() % ARRAY_SIZE(senders)];
+    size_t app_len = strlen(app->name);
+    size_t sender_len = strlen(sender);
+    size_t text_len = profile.text_min + next_random() % (profile.text_max - profile.text_min + 1);
+    size_t pos = PROTOCOL_ADD_HEADER_LEN;
+
+    buf[0] = CMD_ADD_NOTIFICATION;
+    buf[1] = app->category | PROTOCOL_TYPE_HAS_KEY;
+    buf[2] = app_len;
+    buf[3] = sender_len;
+    buf[4] = text_len;
+    sys_put_le32(LOADGEN_KEY_BASE | (seq & 0xFFFF), &buf[pos]);
+    pos += PROTOCOL_KEY_LEN;
+    memcpy(&buf[pos], app->name, app_len);
+    pos += app_len;
+    memcpy(&buf[pos], sender, sender_len);
+    pos += sender_len;
+    for (size_t i = 0; i < text_len; i++) {
+        buf[pos++] = filler[(seq + i) % (sizeof(filler) - 1)];
+    }
+    return pos;
+}
+
+static void on_send(struct k_timer* timer)
+{
+    static uint8_t packet[BLUETOOTH_MAX_PACKET_LEN];
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    size_t len;
+    uint32_t seq;
+
+    if (!sending) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    seq = report.sent++;
+    if (report.sent == profile.count) {
+        sending = false;
+        k_timer_stop(timer);
+    }
+    if (seq == 0) {
+        first_sent_ms = k_uptime_get();
+    }
+    len = build_packet(packet, seq);
+    k_spin_unlock(&lock, key);
+
+    /* Outside the lock, the handled callback may run as soon as it is queued */
+    if (bluetooth_receive(LOADGEN_SOURCE, packet, len) < 0) {
+        key = k_spin_lock(&lock);
+        report.rejected++;
+        k_spin_unlock(&lock, key);
+    }
+}
+
+static bool is_generated(const uint8_t* data, size_t len)
+{
+    return len >= PROTOCOL_ADD_HEADER_LEN + PROTOCOL_KEY_LEN && data[0] == CMD_ADD_NOTIFICATION
+        && (data[1] & PROTOCOL_TYPE_HAS_KEY)
+        && (sys_get_le32(&data[PROTOCOL_ADD_HEADER_LEN]) & 0xFFFF0000U) == LOADGEN_KEY_BASE;
+}
+
+static void on_handled(uint8_t source, const uint8_t* data, size_t len, uint32_t rx_cycles)
+{
+    k_spinlock_key_t key;
+
+    if (source != LOADGEN_SOURCE || !is_generated(data, len)) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    report.handled++;
+    last_handled_ms = k_uptime_get();
+    if (pending_count < PENDING_LEN) {
+        pending[(pending_head + pending_count) % PENDING_LEN] = (struct pending) {
+            .rx_cycles = rx_cycles,
+            .handled_cycles = k_cycle_get_32(),
+        };
+        pending_count++;
+    }
+    k_spin_unlock(&lock, key);
+}
+
+static void on_render(lv_event_t* e)
+{
+    uint32_t now = k_cycle_get_32();
+    k_spinlock_key_t key;
+
+    if (lv_event_get_code(e) == LV_EVENT_RENDER_START) {
+        frame_start_cycles = now;
+        return;
+    }
+
+    /* Only packets handled before the frame started can be on it */
+    key = k_spin_lock(&lock);
+    while (pending_count > 0
+        && (int32_t)(frame_start_cycles - pending[pending_head].handled_cycles) >= 0) {
+        uint32_t sample_us = k_cyc_to_us_floor32(now - pending[pending_head].rx_cycles);
+
+        if (report.samples < LOADGEN_LATENCY_SAMPLES) {
+            latency_us[report.samples++] = sample_us;
+        }
+        report.latency_max_us = MAX(report.latency_max_us, sample_us);
+        pending_head = (pending_head + 1) % PENDING_LEN;
+        pending_count--;
+    }
+    k_spin_unlock(&lock, key);
+}
+
+void loadgen_init(void)
+{
+    lv_display_t* display = lv_display_get_default();
+
+    bluetooth_set_handled_callback(on_handled);
+    if (display) {
+        lv_display_add_event_cb(display, on_render, LV_EVENT_RENDER_START, NULL);
+        lv_display_add_event_cb(display, on_render, LV_EVENT_RENDER_READY, NULL);
+    }
+}
+
+const struct loadgen_profile* loadgen_get_preset(const char* name)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(presets); i++) {
+        if (strcmp(presets[i].name, name) == 0) {
+            return &presets[i].profile;
+        }
+    }
+    return NULL;
+}
+
+int loadgen_start(const struct loadgen_profile* p)
+{
+    uint32_t total = 0;
+    k_spinlock_key_t key;
+
+    for (size_t i = 0; i < ARRAY_SIZE(p->app_weights); i++) {
+        total += p->app_weights[i];
+    }
+    /* Longest app and sender names are 9 and 5 bytes */
+    if (p->rate == 0 || p->count == 0 || total == 0 || p->text_min > p->text_max
+        || PROTOCOL_ADD_HEADER_LEN + PROTOCOL_KEY_LEN + 9 + 5 + p->text_max
+            > BLUETOOTH_MAX_PACKET_LEN) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+    if (sending) {
+        k_spin_unlock(&lock, key);
+        return -EBUSY;
+    }
+    profile = *p;
+    weight_total = total;
+    rng = SEED;
+    memset(&report, 0, sizeof(report));
+    pending_head = 0;
+    pending_count = 0;
+    first_sent_ms = 0;
+    last_handled_ms = 0;
+    sending = true;
+    k_spin_unlock(&lock, key);
+
+    k_timer_start(&send_timer, K_NO_WAIT, K_USEC(USEC_PER_SEC / p->rate));
+    return 0;
+}
+
+void loadgen_stop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    sending = false;
+    k_spin_unlock(&lock, key);
+    k_timer_stop(&send_timer);
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(size_t n, unsigned int percent)
+{
+    return (n == 0) ? 0 : sorted_us[MIN(n - 1, n * percent / 100U)];
+}
+
+void loadgen_get_report(struct loadgen_report* out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    size_t n;
+
+    *out = report;
+    out->done = !sending && report.handled + report.rejected == report.sent;
+    if (report.handled > 0) {
+        out->duration_ms = (uint32_t)(last_handled_ms - first_sent_ms);
+    }
+    n = report.samples;
+    memcpy(sorted_us, latency_us, n * sizeof(sorted_us[0]));
+    k_spin_unlock(&lock, key);
+
+    if (out->duration_ms > 0) {
+        out->throughput = (uint32_t)((uint64_t)out->handled * MSEC_PER_SEC / out->duration_ms);
+    }
+
+    qsort(sorted_us, n, sizeof(sorted_us[0]), compare_u32);
+    out->latency_p50_us = percentile(n, 50);
+    out->latency_p95_us = percentile(n, 95);
+    out->latency_p99_us = percentile(n, 99);
+}
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_loadgen_start(const struct shell* sh, size_t argc, char** argv)
+{
+    const struct loadgen_profile* preset = loadgen_get_preset(argv[1]);
+    struct loadgen_profile p;
+    unsigned long rate, count, text_min, text_max;
+    int ret;
+
+    if (!preset) {
+        shell_error(sh, "Unknown profile %s", argv[1]);
+        return -EINVAL;
+    }
+
+    rate = (argc > 2) ? strtoul(argv[2], NULL, 10) : preset->rate;
+    count = (argc > 3) ? strtoul(argv[3], NULL, 10) : preset->count;
+    text_min = (argc > 5) ? strtoul(argv[4], NULL, 10) : preset->text_min;
+    text_max = (argc > 5) ? strtoul(argv[5], NULL, 10) : preset->text_max;
+
+    /* The packet carries the text length in one byte */
+    if (rate > UINT16_MAX || count > UINT16_MAX || text_max > UINT8_MAX || text_min > text_max) {
+        shell_error(sh, "Rate and count are at most %u, text min <= max <= %u bytes",
+            UINT16_MAX, UINT8_MAX);
+        return -EINVAL;
+    }
+
+    p = *preset;
+    p.rate = rate;
+    p.count = count;
+    p.text_min = text_min;
+    p.text_max = text_max;
+
+    ret = loadgen_start(&p);
+    if (ret < 0) {
+        shell_error(sh, "Failed to start (%d)", ret);
+        return ret;
+    }
+    shell_print(sh, "Sending %u notifications at %u/s, text %u-%u bytes", p.count, p.rate,
+        p.text_min, p.text_max);
+    return 0;
+}
+
+static int cmd_loadgen_stop(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    loadgen_stop();
+    return 0;
+}
+
+static int cmd_loadgen_report(const struct shell* sh, size_t argc, char** argv)
+{
+    struct loadgen_report r;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    loadgen_get_report(&r);
+    shell_print(sh, "%s: %u sent, %u pushed back, %u handled in %u ms (%u/s)",
+        r.done ? "done" : "running", r.sent, r.rejected, r.handled, r.duration_ms,
+        r.throughput);
+    shell_print(sh, "UI latency (%u samples): p50 %u us, p95 %u us, p99 %u us, max %u us",
+        r.samples, r.latency_p50_us, r.latency_p95_us, r.latency_p99_us, r.latency_max_us);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(loadgen_cmds,
+    SHELL_CMD_ARG(start, NULL,
+        "Send a profile: <chat|email|mixed> [rate/s] [count] [text min] [text max],\n"
+        "text up to 255 bytes",
+        cmd_loadgen_start, 2, 4),
+    SHELL_CMD(stop, NULL, "Stop sending", cmd_loadgen_stop),
+    SHELL_CMD(report, NULL, "Show throughput and UI latency of the latest run",
+        cmd_loadgen_report),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(loadgen, &loadgen_cmds, "Synthetic notification load generator", NULL);
+#endif /* CONFIG_SHELL */
+
+#else /* !CONFIG_LOADGEN */
+
+void loadgen_init(void)
+{
+}
+
+const struct loadgen_profile* loadgen_get_preset(const char* name)
+{
+    ARG_UNUSED(name);
+    return NULL;
+}
+
+int loadgen_start(const struct loadgen_profile* profile)
+{
+    ARG_UNUSED(profile);
+    return -ENOTSUP;
+}
+
+void loadgen_stop(void)
+{
+}
+
+void loadgen_get_report(struct loadgen_report* report)
+{
+    memset(report, 0, sizeof(*report));
+}
+
+#endif /* CONFIG_LOADGEN */
@@ -0,0 +1,125 @@
+/**
+ * @file loadgen.h
+ * @brief Synthetic Notification Load Generator Header
+ *
+ * Injects notification storms through the same ingest path as the phone's
+ * writes (bluetooth_receive()), so the lanes, rules, store and screen are
+ * loaded as in a group chat burst or an email sync, without a phone:
+ *
+ * - Rate: notifications per second, sent from a kernel timer
+ * - Size: text lengths uniformly distributed between a minimum and maximum
+ * - App mix: a weight per app of a fixed set, with their categories
+ *
+ * Packets are encoded like the Android app's, with keys from
+ * LOADGEN_KEY_BASE so they can be told apart from real traffic. They arrive
+ * on connection LOADGEN_SOURCE. Pushed back packets are not retried.
+ *
+ * The report gives throughput, notifications handled per second from the
+ * first packet sent to the last handled, and UI latency percentiles: the
+ * time from sending a packet to the end of the first frame rendered after
+ * it was handled. Frames are only rendered while the display is on and
+ * do not disturb allows it, so keep the watch awake during a run.
+ *
+ * On the watch, runs from the shell ('loadgen start chat'); on native_sim,
+ * see loadtest/.
+ *
+ * Without CONFIG_LOADGEN nothing is sent and loadgen_start() fails.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Apps in the mix */
+#define LOADGEN_APP_COUNT 5
+
+/** @brief High half of the generated notification keys, "LG" */
+#define LOADGEN_KEY_BASE 0x4C470000U
+
+/** @brief Connection the generated packets arrive on */
+#define LOADGEN_SOURCE 0
+
+/** @brief UI latencies kept for percentiles, later ones are not sampled */
+#define LOADGEN_LATENCY_SAMPLES 256
+
+/**
+ * @brief Load shape
+ */
+struct loadgen_profile {
+    uint16_t rate; /**< Notifications per second */
+    uint16_t count; /**< Notifications to send */
+    uint8_t text_min; /**< Shortest text in bytes */
+    uint8_t text_max; /**< Longest text in bytes */
+    uint8_t app_weights[LOADGEN_APP_COUNT]; /**< WhatsApp, Gmail, Telegram, Instagram, Calendar */
+};
+
+/**
+ * @brief Results of the latest run
+ */
+struct loadgen_report {
+    bool done; /**< Sending ended, every packet handled or pushed back */
+    uint32_t sent; /**< Packets offered to the lanes */
+    uint32_t rejected; /**< Packets pushed back by a full lane */
+    uint32_t handled; /**< Packets handed to the protocol parser */
+    uint32_t duration_ms; /**< First packet sent to the last handled */
+    uint32_t throughput; /**< Handled per second over the duration */
+    uint32_t samples; /**< UI latencies measured */
+    uint32_t latency_p50_us;
+    uint32_t latency_p95_us;
+    uint32_t latency_p99_us;
+    uint32_t latency_max_us;
+};
+
+/**
+ * @brief Hook into the ingest path and the display
+ *
+ * Call once LVGL and Bluetooth are initialized.
+ */
+void loadgen_init(void);
+
+/**
+ * @brief Get a built-in profile
+ *
+ * @param name "chat" (group chat storm), "email" (email sync) or "mixed"
+ *             (steady traffic from every app)
+ * @return Profile, NULL if unknown
+ */
+const struct loadgen_profile* loadgen_get_preset(const char* name);
+
+/**
+ * @brief Start sending, clearing the previous report
+ *
+ * @param profile Load shape
+ * @retval 0 Started
+ * @retval -EINVAL Zero rate or count, no app weight, or text too long
+ * @retval -EBUSY A run is still sending
+ * @retval -ENOTSUP Not compiled in
+ */
+int loadgen_start(const struct loadgen_profile* profile);
+
+/**
+ * @brief Stop sending, the packets sent are still measured
+ */
+void loadgen_stop(void);
+
+/**
+ * @brief Get the report of the latest run
+ *
+ * @param report Output for the report
+ */
+void loadgen_get_report(struct loadgen_report* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOADGEN_H */
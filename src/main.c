@@ -18,11 +18,20 @@
 #include <stdio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
 #include <zephyr/sys/reboot.h>
 
+#include "ambient/ambient.h"
+#include "bluetooth/bluetooth.h"
+#include "clock/clock.h"
 #include "display/display.h"
+#include "display/display_power.h"
+#include "dfu/dfu.h"
 #include "graphics/graphics.h"
+#include "icons/icons.h"
+#include "loadgen/loadgen.h"
 #include "notifications/notifications.h"
+#include "trace/trace.h"
 #include "watchdog/watchdog.h"
 
 /* Register logging module */
@@ -122,20 +131,68 @@ static int init_display_subsystem(void)
  */
 static int init_ble_communication(void)
 {
+    int ret;
+
     LOG_INF("Initializing BLE communication...");
 
-    /* TODO: Add actual BLE initialization code here */
-    /* This would typically include:
-     * - bt_enable()
-     * - Service and characteristic registration
-     * - Advertising configuration
-     * - Connection callbacks setup
-     */
+    ret = bluetooth_init();
+    if (ret != 0) {
+        return ret;
+    }
 
     LOG_INF("BLE communication initialized successfully");
     return 0;
 }
 
+/**
+ * @brief Load persisted settings
+ *
+ * Restores state saved by the modules (filter rules, Bluetooth bonds, ...)
+ * from flash.
+ * Failure is not fatal, the defaults are used instead.
+ */
+static void load_persisted_settings(void)
+{
+    int ret;
+
+    ret = settings_subsys_init();
+    if (ret == 0) {
+        ret = settings_load();
+    }
+
+    if (ret != 0) {
+        LOG_WRN("Failed to load settings, using defaults, ret = %d", ret);
+    }
+}
+
+/**
+ * @brief Switch between the notification screen and the ambient face
+ *
+ * Waking from off or ambient also applies the screen updates that do not
+ * disturb held back, so the user sees one refresh. Touch also speeds up
+ * advertising, see bluetooth_user_activity().
+ *
+ * @param prev Display power state that was left
+ * @param next Display power state that was entered
+ */
+static void on_display_state_changed(display_power_state_t prev, display_power_state_t next)
+{
+    if (next == DISPLAY_STATE_AMBIENT) {
+        ambient_show();
+    } else if (prev == DISPLAY_STATE_AMBIENT) {
+        ambient_hide();
+    }
+
+    if (next == DISPLAY_STATE_ACTIVE || next == DISPLAY_STATE_WAKE_ON_NOTIFICATION) {
+        notifications_refresh_deferred();
+    }
+
+    /* The user is at the watch, advertise fast so the phone is back soon */
+    if (next == DISPLAY_STATE_ACTIVE) {
+        bluetooth_user_activity();
+    }
+}
+
 /**
  * @brief Print system information and status
  *
@@ -211,6 +268,12 @@ int main(void)
         goto error_exit;
     }
 
+    /* Start idle dimming once the panel is on */
+    ret = display_power_init();
+    if (ret != 0) {
+        LOG_WRN("Display power management unavailable, ret = %d", ret);
+    }
+
     /* 3. Initialize LVGL graphics library */
     ret = init_lvgl_graphics();
     if (ret != 0) {
@@ -226,6 +289,12 @@ int main(void)
     create_notification_screen();
     LOG_INF("Notification screen created successfully");
 
+    /* Render and flush tracepoints, with CONFIG_PIPELINE_TRACING */
+    trace_init();
+
+    /* Idle display shows the ambient face over the notification screen */
+    display_power_set_state_callback(on_display_state_changed);
+
     /* 6. Initialize BLE communication */
     ret = init_ble_communication();
     if (ret != 0) {
@@ -233,6 +302,19 @@ int main(void)
         goto error_exit;
     }
 
+    /* Synthetic storms through the same ingest path, from the shell */
+    loadgen_init();
+
+    /* Restore persisted state, including the bonds enabled Bluetooth needs,
+     * before the main loop starts advertising and handling packets */
+    load_persisted_settings();
+
+    /* Bluetooth works, keep an updated image */
+    ret = dfu_init();
+    if (ret != 0) {
+        LOG_WRN("Firmware update init failed, ret = %d", ret);
+    }
+
     /* All systems initialized successfully */
     print_system_info();
 
@@ -243,6 +325,22 @@ int main(void)
         /* Handle notification timers (delete timeout, etc.) */
         notifications_handle_timers();
 
+        /* Apply packets received from the phone */
+        bluetooth_process();
+
+        /* Decode app icons the screen is waiting for */
+        icons_process();
+
+        /* Fast link while a firmware upload is running */
+        dfu_process();
+
+        /* Dim or turn off the display when idle */
+        display_power_process();
+
+        /* Per-minute clock updates on the status bar and ambient face */
+        clock_process();
+        ambient_process();
+
         /* Maintain watchdog to prevent system reset */
         ret = kick_watchdog();
         if (ret != 0) {
@@ -250,21 +348,14 @@ int main(void)
             /* Continue operation but log the error */
         }
 
-/* Optional: Run demo status changes for testing */
-#ifdef CONFIG_DEMO_MODE
-        demo_status_changes();
-#endif
-
         /* TODO: Add other periodic tasks here:
-         * - Process BLE notifications
-         * - Update time display
          * - Handle user input
-         * - Manage power states
          * - Check battery status
          */
 
-        /* Sleep to allow other threads to run and save power */
-        k_sleep(K_MSEC(MAIN_THREAD_SLEEP_TIME_MS));
+        /* Sleep to allow other threads to run and save power, urgent
+         * notifications end the sleep early */
+        bluetooth_wait(K_MSEC(MAIN_THREAD_SLEEP_TIME_MS));
     }
 
     /* This point should never be reached in normal operation */
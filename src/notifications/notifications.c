@@ -3,32 +3,52 @@
 #include <lvgl.h>
 #include <zephyr/kernel.h>
 
+#include "bluetooth/bluetooth.h"
+#include "bluetooth/protocol.h"
+#include "display/display_power.h"
+#include "dnd/dnd.h"
+#include "graphics/graphics.h"
+#include "icons/icons.h"
 #include "notifications/notifications.h"
+#include "notifications/search.h"
+#include "notifications/store.h"
+#include "trace/trace.h"
 
 #define SCREEN_WIDTH 240
 #define SCREEN_HEIGHT 240
 #define SCREEN_RADIUS 120
-#define MAX_NOTIFICATIONS 30
-
-// Notification structure
-typedef struct {
-    char app_name[32];
-    char sender[64];
-    char content[256];
-    char timestamp[16];
-    bool is_read;
-} notification_t;
+#define GROUP_LIST_ROWS 20 // Most recently active conversations or apps listed
+#define SEARCH_RESULT_ROWS 20 // Newest matches listed
 
 // Global UI objects
 static lv_obj_t* main_screen;
 static lv_obj_t* time_label;
 static lv_obj_t* status_circle;
 static lv_obj_t* app_icon;
+static lv_obj_t* app_icon_image;
+static lv_obj_t* app_container;
 static lv_obj_t* app_name_label;
+static lv_obj_t* content_container;
 static lv_obj_t* sender_label;
 static lv_obj_t* notification_content;
 static lv_obj_t* secondary_info;
 static lv_obj_t* counter_label;
+static lv_obj_t* reply_picker;
+static lv_obj_t* group_list;
+static enum store_list group_list_kind; // Conversations or apps listed
+
+// Search matches listed, by slot and arrival so a slot reused since is not opened
+static struct {
+    uint16_t slot;
+    uint32_t seq;
+} search_results[SEARCH_RESULT_ROWS];
+
+// Canned replies offered on long press
+static const char* const canned_replies[] = {
+    "OK",
+    "On my way",
+    "Can't talk now, later",
+};
 
 // Status colors - initialized in create_styles()
 static lv_color_t status_colors[4];
@@ -36,18 +56,33 @@ static lv_color_t status_colors[4];
 // App icon colors - initialized in create_styles()
 static lv_color_t app_colors[5];
 
-// Notification data
-static notification_t notifications[MAX_NOTIFICATIONS];
-static int notification_count = 0;
-static int current_notification = 0;
+// Shown notification, STORE_NONE when there are none, and its position in the view
+static uint16_t current = STORE_NONE;
+static int current_pos = 0;
+
+// Notifications viewed: all, or those of one conversation or app
+static enum store_list view = STORE_LIST_ALL;
+static uint16_t view_group = STORE_NONE;
+
+static struct notifications_stats stats;
 
 // Undo functionality
 static bool delete_pending = false;
-static int delete_pending_index = -1;
-static int delete_timer_counter = 0;
-static const int DELETE_TIMEOUT = 30; // 3 seconds (30 * 100ms)
+static uint16_t delete_pending_slot = STORE_NONE;
+static int64_t delete_deadline_ms;
+static const int64_t DELETE_TIMEOUT_MS = 3000; // Uptime, main loop passes come early on BLE events
 static lv_obj_t* undo_message;
 
+// Set when the current touch woke the display, so it is not acted upon
+static bool touch_woke_display = false;
+
+// UI work held back by do not disturb, applied in one refresh on wake
+static bool ui_deferred = false;
+static bool deferred_new_notification = false;
+static bool deferred_status_pending = false;
+static connection_status_t deferred_status;
+static char deferred_time[16];
+
 // Forward declarations
 static void update_notification_display(void);
 static void next_notification(void);
@@ -57,47 +92,8 @@ static void delete_current_notification(void);
 static void undo_deletion(void);
 static void complete_deletion(void);
 static void handle_delete_timeout(void);
-
-// Sample notifications for testing
-static void init_sample_notifications(void)
-{
-    notification_count = 5;
-
-    // Notification 1: WhatsApp
-    strcpy(notifications[0].app_name, "WhatsApp");
-    strcpy(notifications[0].sender, "Mom");
-    strcpy(notifications[0].content, "Hi honey! How are you today?");
-    strcpy(notifications[0].timestamp, "14:23");
-    notifications[0].is_read = false;
-
-    // Notification 2: Email (long content)
-    strcpy(notifications[1].app_name, "Gmail");
-    strcpy(notifications[1].sender, "Boss");
-    strcpy(notifications[1].content, "Meeting tomorrow at 9 AM. Please prepare the quarterly report and bring all necessary documents. This is very important for our Q4 planning.");
-    strcpy(notifications[1].timestamp, "13:45");
-    notifications[1].is_read = false;
-
-    // Notification 3: SMS
-    strcpy(notifications[2].app_name, "Messages");
-    strcpy(notifications[2].sender, "John");
-    strcpy(notifications[2].content, "Are we still meeting tonight?");
-    strcpy(notifications[2].timestamp, "12:30");
-    notifications[2].is_read = true;
-
-    // Notification 4: Discord
-    strcpy(notifications[3].app_name, "Discord");
-    strcpy(notifications[3].sender, "Dev Team");
-    strcpy(notifications[3].content, "New commit pushed to main branch. Please review the changes in the notification system implementation.");
-    strcpy(notifications[3].timestamp, "11:15");
-    notifications[3].is_read = false;
-
-    // Notification 5: Telegram
-    strcpy(notifications[4].app_name, "Telegram");
-    strcpy(notifications[4].sender, "Sarah");
-    strcpy(notifications[4].content, "Check this out! 😄");
-    strcpy(notifications[4].timestamp, "10:45");
-    notifications[4].is_read = false;
-}
+static void show_group_list(enum store_list list);
+static void hide_group_list(void);
 
 static void create_styles(void)
 {
@@ -145,11 +141,66 @@ static void create_styles(void)
     lv_style_set_text_color(&secondary_style, lv_color_hex(0x969696));
 }
 
+// Send an action on a notification back to the phone
+static void send_action(uint16_t slot, uint8_t action, const char* reply)
+{
+    const struct store_notification* notif = store_get(slot);
+
+    if (!notif || notif->meta.key == 0) {
+        return; // Not from the phone, nothing it could act on
+    }
+    bluetooth_send_action(action, notif->meta.key, reply);
+}
+
+static void show_reply_picker(bool show)
+{
+    if (show && current != STORE_NONE) {
+        lv_obj_clear_flag(reply_picker, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(reply_picker, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+static void reply_event_handler(lv_event_t* e)
+{
+    const char* reply = lv_event_get_user_data(e);
+
+    send_action(current, PROTOCOL_ACTION_REPLY, reply);
+    mark_current_as_read();
+    show_reply_picker(false);
+}
+
 // Touch event handler
 static void screen_event_handler(lv_event_t* e)
 {
     lv_event_code_t code = lv_event_get_code(e);
 
+    if (code == LV_EVENT_PRESSED) {
+        touch_woke_display = display_power_user_activity();
+        return;
+    }
+
+    // A touch that only woke the display must not change notifications
+    if (touch_woke_display) {
+        return;
+    }
+
+    // Any other touch closes the reply picker
+    if (!lv_obj_has_flag(reply_picker, LV_OBJ_FLAG_HIDDEN)) {
+        if (code == LV_EVENT_GESTURE || code == LV_EVENT_CLICKED) {
+            show_reply_picker(false);
+        }
+        return;
+    }
+
+    // And the conversation or app list
+    if (!lv_obj_has_flag(group_list, LV_OBJ_FLAG_HIDDEN)) {
+        if (code == LV_EVENT_GESTURE || code == LV_EVENT_CLICKED) {
+            hide_group_list();
+        }
+        return;
+    }
+
     if (code == LV_EVENT_GESTURE) {
         lv_dir_t dir = lv_indev_get_gesture_dir(lv_indev_get_act());
 
@@ -172,7 +223,10 @@ static void screen_event_handler(lv_event_t* e)
             }
             break;
         case LV_DIR_BOTTOM:
-            // Optional: could add another action here
+            if (!delete_pending) {
+                send_action(current, PROTOCOL_ACTION_OPEN, NULL);
+                mark_current_as_read();
+            }
             break;
         default:
             break;
@@ -181,9 +235,18 @@ static void screen_event_handler(lv_event_t* e)
         if (delete_pending) {
             // Undo the deletion
             undo_deletion();
+        } else if (lv_event_get_target(e) == app_container) {
+            show_group_list(STORE_LIST_THREAD); // Conversations
+        } else if (lv_event_get_target(e) == counter_label) {
+            show_group_list(STORE_LIST_APP); // App filter
         }
     } else if (code == LV_EVENT_DOUBLE_CLICKED) {
         mark_current_as_read(); // Mark as read
+        send_action(current, PROTOCOL_ACTION_MARK_READ, NULL);
+    } else if (code == LV_EVENT_LONG_PRESSED) {
+        if (!delete_pending) {
+            show_reply_picker(true);
+        }
     }
 }
 
@@ -229,12 +292,14 @@ static lv_color_t get_app_color(const char* app_name)
 static void create_app_info(void)
 {
     // Create container for app info (icon + name)
-    lv_obj_t* app_container = lv_obj_create(main_screen);
+    app_container = lv_obj_create(main_screen);
     lv_obj_set_size(app_container, SCREEN_WIDTH - 40, 30);
     lv_obj_align(app_container, LV_ALIGN_TOP_MID, 0, 50);
     lv_obj_set_style_bg_opa(app_container, LV_OPA_TRANSP, 0);
     lv_obj_set_style_border_opa(app_container, LV_OPA_TRANSP, 0);
     lv_obj_set_style_pad_all(app_container, 0, 0);
+    // Tapping it opens the conversations, handled with the screen's touches
+    lv_obj_add_flag(app_container, LV_OBJ_FLAG_EVENT_BUBBLE);
 
     // App icon (left side of container)
     app_icon = lv_obj_create(app_container);
@@ -242,6 +307,13 @@ static void create_app_info(void)
     lv_obj_align(app_icon, LV_ALIGN_LEFT_MID, 10, 0);
     lv_obj_set_style_radius(app_icon, LV_RADIUS_CIRCLE, 0);
     lv_obj_set_style_border_opa(app_icon, LV_OPA_TRANSP, 0);
+    // Let taps through to the app row
+    lv_obj_clear_flag(app_icon, LV_OBJ_FLAG_CLICKABLE);
+
+    // Phone-supplied app icon, shown over the colored circle once decoded
+    app_icon_image = lv_image_create(app_container);
+    lv_obj_align(app_icon_image, LV_ALIGN_LEFT_MID, 10, 0);
+    lv_obj_add_flag(app_icon_image, LV_OBJ_FLAG_HIDDEN);
 
     // App name (centered in container)
     app_name_label = lv_label_create(app_container);
@@ -253,7 +325,7 @@ static void create_app_info(void)
 static void create_notification_content(void)
 {
     // Main notification content area
-    lv_obj_t* content_container = lv_obj_create(main_screen);
+    content_container = lv_obj_create(main_screen);
     lv_obj_set_size(content_container, SCREEN_WIDTH - 40, 100);
     lv_obj_align(content_container, LV_ALIGN_CENTER, 0, 10);
     lv_obj_set_style_bg_opa(content_container, LV_OPA_TRANSP, 0);
@@ -289,6 +361,9 @@ static void create_bottom_info(void)
     lv_obj_align(counter_label, LV_ALIGN_BOTTOM_MID, 0, -20);
     lv_obj_set_style_text_font(counter_label, &lv_font_montserrat_10, 0);
     lv_obj_set_style_text_color(counter_label, lv_color_hex(0x969696), 0);
+    // Tapping it opens the app filter, handled with the screen's touches
+    lv_obj_add_flag(counter_label, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_EVENT_BUBBLE);
+    lv_obj_set_ext_click_area(counter_label, 10);
 
     // Undo message (initially hidden)
     undo_message = lv_label_create(main_screen);
@@ -299,6 +374,48 @@ static void create_bottom_info(void)
     lv_obj_add_flag(undo_message, LV_OBJ_FLAG_HIDDEN); // Hidden by default
 }
 
+static void create_reply_picker(void)
+{
+    // Column of canned replies over the notification content
+    reply_picker = lv_obj_create(main_screen);
+    lv_obj_set_size(reply_picker, 170, 150);
+    lv_obj_align(reply_picker, LV_ALIGN_CENTER, 0, 0);
+    lv_obj_set_style_bg_color(reply_picker, lv_color_hex(0x202020), 0);
+    lv_obj_set_style_border_opa(reply_picker, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_radius(reply_picker, 12, 0);
+    lv_obj_set_style_pad_all(reply_picker, 6, 0);
+    lv_obj_set_flex_flow(reply_picker, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_flex_align(reply_picker, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+
+    for (size_t i = 0; i < ARRAY_SIZE(canned_replies); i++) {
+        lv_obj_t* button = lv_button_create(reply_picker);
+        lv_obj_set_width(button, LV_PCT(100));
+        lv_obj_add_event_cb(button, reply_event_handler, LV_EVENT_CLICKED, (void*)canned_replies[i]);
+
+        lv_obj_t* label = lv_label_create(button);
+        lv_label_set_text(label, canned_replies[i]);
+        lv_obj_set_style_text_font(label, &lv_font_montserrat_12, 0);
+        lv_obj_center(label);
+    }
+
+    lv_obj_add_flag(reply_picker, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void create_group_list(void)
+{
+    // Column of conversations or apps over the notification, rows added when shown
+    group_list = lv_obj_create(main_screen);
+    lv_obj_set_size(group_list, 160, 160);
+    lv_obj_align(group_list, LV_ALIGN_CENTER, 0, 0);
+    lv_obj_set_style_bg_color(group_list, lv_color_hex(0x202020), 0);
+    lv_obj_set_style_border_opa(group_list, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_radius(group_list, 12, 0);
+    lv_obj_set_style_pad_all(group_list, 6, 0);
+    lv_obj_set_flex_flow(group_list, LV_FLEX_FLOW_COLUMN);
+
+    lv_obj_add_flag(group_list, LV_OBJ_FLAG_HIDDEN);
+}
+
 static void update_connection_status(connection_status_t status)
 {
     lv_obj_set_style_bg_color(status_circle, status_colors[status], 0);
@@ -309,23 +426,109 @@ static void update_time(const char* time_str)
     lv_label_set_text(time_label, time_str);
 }
 
+static void update_app_icon(const struct store_notification* notif)
+{
+    uint32_t id = notif ? notif->meta.icon_id : 0;
+    const lv_image_dsc_t* icon;
+
+    // Pinned before the lookup, decoding other icons must not overwrite it
+    icons_pin(id);
+    icon = icons_lookup(id);
+
+    // Fall back to the colored circle until the icon is decoded
+    if (icon) {
+        lv_image_set_src(app_icon_image, icon);
+        lv_obj_clear_flag(app_icon_image, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(app_icon, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(app_icon_image, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(app_icon, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+static const struct store_ends* view_ends(void)
+{
+    return store_list(view, view_group);
+}
+
+static bool in_view(const struct store_notification* notif)
+{
+    return view == STORE_LIST_ALL || notif->group[view] == view_group;
+}
+
+static void view_all(void)
+{
+    view = STORE_LIST_ALL;
+    view_group = STORE_NONE;
+}
+
+// Show the newest notification of the view
+static void show_last(void)
+{
+    const struct store_ends* ends = view_ends();
+
+    current = ends->last;
+    current_pos = ends->len;
+}
+
+// Show the newest notification, staying in the conversation or app if it is part of it
+static void show_newest(void)
+{
+    const struct store_notification* newest = store_get(store_list(STORE_LIST_ALL, 0)->last);
+
+    if (!newest || !in_view(newest)) {
+        view_all();
+    }
+    show_last();
+}
+
+static void step_next(void)
+{
+    const struct store_ends* ends = view_ends();
+
+    if (current == ends->last) {
+        current = ends->first;
+        current_pos = 1;
+    } else {
+        current = store_get(current)->links[view].next;
+        current_pos++;
+    }
+}
+
+static void step_prev(void)
+{
+    const struct store_ends* ends = view_ends();
+
+    if (current == ends->first) {
+        current = ends->last;
+        current_pos = ends->len;
+    } else {
+        current = store_get(current)->links[view].prev;
+        current_pos--;
+    }
+}
+
 static void update_notification_display(void)
 {
-    if (notification_count == 0) {
+    TRACE_POINT(UI_INTENT, current);
+
+    if (current == STORE_NONE) {
         lv_label_set_text(app_name_label, "No notifications");
         lv_label_set_text(sender_label, "");
         lv_label_set_text(notification_content, "All clear!");
         lv_label_set_text(secondary_info, "");
         lv_label_set_text(counter_label, "");
         lv_obj_set_style_bg_color(app_icon, lv_color_hex(0x666666), 0);
+        update_app_icon(NULL);
         return;
     }
 
-    notification_t* notif = &notifications[current_notification];
+    const struct store_notification* notif = store_get(current);
 
     // Update app info
     lv_label_set_text(app_name_label, notif->app_name);
     lv_obj_set_style_bg_color(app_icon, get_app_color(notif->app_name), 0);
+    update_app_icon(notif);
 
     // Update sender (add indicator for unread)
     static char sender_text[70];
@@ -335,7 +538,7 @@ static void update_notification_display(void)
 
     // Set sender color based on read status and delete pending
     lv_color_t sender_color;
-    if (delete_pending && delete_pending_index == current_notification) {
+    if (delete_pending && delete_pending_slot == current) {
         sender_color = lv_color_hex(0x666666); // Grayed out for pending deletion
     } else {
         sender_color = notif->is_read ? lv_color_hex(0xC8C8C8) : lv_color_hex(0xFFFFFF);
@@ -344,7 +547,7 @@ static void update_notification_display(void)
 
     // Update content with dimmed appearance if delete pending
     lv_label_set_text(notification_content, notif->content);
-    if (delete_pending && delete_pending_index == current_notification) {
+    if (delete_pending && delete_pending_slot == current) {
         lv_obj_set_style_text_color(notification_content, lv_color_hex(0x666666), 0);
     } else {
         lv_obj_set_style_text_color(notification_content, lv_color_hex(0xE0E0E0), 0);
@@ -355,73 +558,125 @@ static void update_notification_display(void)
 
     // Update counter
     static char counter_text[20];
-    int display_count = notification_count;
-    if (delete_pending)
-        display_count--; // Show count as if item is already deleted
+    int view_count = view_ends()->len;
+    int display_count = view_count;
+    int display_pos = current_pos;
+    const struct store_notification* pending = store_get(delete_pending_slot);
+    if (delete_pending && in_view(pending)) {
+        // Show count as if item is already deleted
+        display_count--;
+        if (pending->seq < notif->seq)
+            display_pos--;
+    }
 
     snprintf(counter_text, sizeof(counter_text), "%d of %d",
-        current_notification + 1, display_count > 0 ? display_count : notification_count);
+        display_pos, display_count > 0 ? display_count : view_count);
     lv_label_set_text(counter_label, counter_text);
 }
 
+/**
+ * @brief Measure receipt to glass for a notification just put on screen
+ */
+static void probe_glass(const struct store_notification* notif)
+{
+    lv_area_t area;
+
+    if (notif->meta.rx_cycles == 0) {
+        return;
+    }
+    lv_obj_get_coords(content_container, &area);
+    lvgl_arm_glass_probe(notif->meta.rx_cycles, &area);
+}
+
 static void next_notification(void)
 {
-    if (notification_count > 0) {
-        current_notification = (current_notification + 1) % notification_count;
+    if (current != STORE_NONE) {
+        step_next();
         update_notification_display();
     }
 }
 
 static void prev_notification(void)
 {
-    if (notification_count > 0) {
-        current_notification = (current_notification - 1 + notification_count) % notification_count;
+    if (current != STORE_NONE) {
+        step_prev();
         update_notification_display();
     }
 }
 
 static void mark_current_as_read(void)
 {
-    if (notification_count > 0) {
-        notifications[current_notification].is_read = true;
+    if (current != STORE_NONE) {
+        store_set_read(current, true);
         update_notification_display();
     }
 }
 
 static void delete_current_notification(void)
 {
-    if (notification_count == 0)
+    if (current == STORE_NONE)
         return;
 
     // Start delete pending process
     delete_pending = true;
-    delete_pending_index = current_notification;
-    delete_timer_counter = 0;
+    delete_pending_slot = current;
+    delete_deadline_ms = k_uptime_get() + DELETE_TIMEOUT_MS;
 
     // Show undo message
     lv_obj_clear_flag(undo_message, LV_OBJ_FLAG_HIDDEN);
 
     // Move to next notification for preview (but don't actually delete yet)
-    if (notification_count > 1) {
-        if (current_notification >= notification_count - 1) {
-            current_notification = 0;
+    if (view_ends()->len > 1) {
+        step_next();
+    }
+
+    update_notification_display();
+}
+
+static void clear_delete_pending(void)
+{
+    delete_pending = false;
+    delete_pending_slot = STORE_NONE;
+
+    // Hide undo message
+    lv_obj_add_flag(undo_message, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Remove a notification from the store, keeping the view on a stored one
+static void remove_notification(uint16_t slot)
+{
+    const struct store_notification* notif = store_get(slot);
+
+    if (delete_pending && delete_pending_slot == slot) {
+        clear_delete_pending();
+    }
+
+    if (in_view(notif)) {
+        if (view_ends()->len == 1) {
+            current = STORE_NONE; // Last of the view
         } else {
-            current_notification++;
+            if (slot == current) {
+                step_next(); // Its successor takes its place
+            }
+            if (notif->seq < store_get(current)->seq) {
+                current_pos--;
+            }
         }
     }
 
-    update_notification_display();
+    store_remove(slot);
+
+    // Back to all notifications once the conversation or app is gone
+    if (current == STORE_NONE) {
+        view_all();
+        show_last();
+    }
 }
 
 static void undo_deletion(void)
 {
-    if (delete_pending && delete_pending_index >= 0) {
-        delete_pending = false;
-        delete_pending_index = -1;
-        delete_timer_counter = 0;
-
-        // Hide undo message
-        lv_obj_add_flag(undo_message, LV_OBJ_FLAG_HIDDEN);
+    if (delete_pending) {
+        clear_delete_pending();
 
         // Refresh display
         update_notification_display();
@@ -430,102 +685,351 @@ static void undo_deletion(void)
 
 static void complete_deletion(void)
 {
-    if (!delete_pending || delete_pending_index < 0)
+    if (!delete_pending)
         return;
 
-    int index_to_delete = delete_pending_index;
+    uint16_t slot_to_delete = delete_pending_slot;
+
+    // The phone dismisses it too once the undo window has passed
+    send_action(slot_to_delete, PROTOCOL_ACTION_DISMISS, NULL);
+
+    clear_delete_pending();
+    remove_notification(slot_to_delete);
 
-    // Shift notifications down
-    for (int i = index_to_delete; i < notification_count - 1; i++) {
-        notifications[i] = notifications[i + 1];
+    update_notification_display();
+}
+
+// Show a conversation or app, or all notifications for STORE_NONE
+static void open_group(enum store_list list, uint16_t group)
+{
+    if (group != STORE_NONE && store_get_group(list, group)) {
+        view = list;
+        view_group = group;
+    } else {
+        view_all(); // Also when removed while the list was shown
     }
+    show_last();
+    update_notification_display();
+}
 
-    notification_count--;
+// Show a notification among all notifications, or the newest if it is gone
+static void open_notification(uint16_t slot, uint32_t seq)
+{
+    const struct store_notification* notif = store_get(slot);
 
-    // Adjust current notification index
-    if (current_notification >= notification_count && notification_count > 0) {
-        current_notification = notification_count - 1;
-    } else if (notification_count == 0) {
-        current_notification = 0;
-    } else if (current_notification > index_to_delete) {
-        current_notification--;
+    view_all();
+    if (!notif || notif->seq != seq) {
+        show_last();
+    } else {
+        current = slot;
+        current_pos = 1;
+        for (uint16_t s = notif->links[STORE_LIST_ALL].prev; s != STORE_NONE;
+             s = store_get(s)->links[STORE_LIST_ALL].prev) {
+            current_pos++;
+        }
     }
+    update_notification_display();
+}
 
-    // Clear delete pending state
-    delete_pending = false;
-    delete_pending_index = -1;
-    delete_timer_counter = 0;
+static void group_row_event_handler(lv_event_t* e)
+{
+    hide_group_list();
+    open_group(group_list_kind, (uint16_t)(uintptr_t)lv_event_get_user_data(e));
+}
 
-    // Hide undo message
-    lv_obj_add_flag(undo_message, LV_OBJ_FLAG_HIDDEN);
+static void close_row_event_handler(lv_event_t* e)
+{
+    hide_group_list();
+}
 
-    update_notification_display();
+static void result_row_event_handler(lv_event_t* e)
+{
+    uint16_t row = (uint16_t)(uintptr_t)lv_event_get_user_data(e);
+
+    hide_group_list();
+    open_notification(search_results[row].slot, search_results[row].seq);
 }
 
-static void handle_delete_timeout(void)
+// Add a row to the list overlay, id is passed to the handler as user data
+static void add_list_row(const char* text, lv_event_cb_t handler, uint16_t id)
 {
-    if (delete_pending) {
-        delete_timer_counter++;
-        if (delete_timer_counter >= DELETE_TIMEOUT) {
-            complete_deletion();
+    lv_obj_t* button = lv_button_create(group_list);
+    lv_obj_set_width(button, LV_PCT(100));
+    lv_obj_add_event_cb(button, handler, LV_EVENT_CLICKED, (void*)(uintptr_t)id);
+
+    lv_obj_t* label = lv_label_create(button);
+    lv_label_set_text(label, text);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_DOT);
+    lv_obj_set_width(label, LV_PCT(100));
+    lv_obj_set_style_text_font(label, &lv_font_montserrat_12, 0);
+}
+
+static void hide_group_list(void)
+{
+    lv_obj_add_flag(group_list, LV_OBJ_FLAG_HIDDEN);
+}
+
+// List the conversations (STORE_LIST_THREAD) or apps (STORE_LIST_APP) to pick from
+static void show_group_list(enum store_list list)
+{
+    static char row_text[STORE_APP_NAME_LEN + STORE_SENDER_LEN + 16];
+    int rows = 0;
+
+    if (current == STORE_NONE) {
+        return;
+    }
+
+    // Rebuilt each time, most recently active first
+    lv_obj_clean(group_list);
+    group_list_kind = list;
+    add_list_row("All notifications", group_row_event_handler, STORE_NONE);
+    for (uint16_t id = store_newest_group(list); id != STORE_NONE && rows < GROUP_LIST_ROWS;
+         id = store_get_group(list, id)->older, rows++) {
+        const struct store_group* group = store_get_group(list, id);
+        const struct store_notification* first = store_get(group->members.first);
+
+        if (list == STORE_LIST_THREAD) {
+            snprintf(row_text, sizeof(row_text), "%s%s: %s (%u)", group->unread ? "● " : "",
+                first->app_name, first->sender, group->members.len);
+        } else {
+            snprintf(row_text, sizeof(row_text), "%s%s (%u)", group->unread ? "● " : "",
+                first->app_name, group->members.len);
         }
+        add_list_row(row_text, group_row_event_handler, id);
+    }
+    lv_obj_clear_flag(group_list, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void handle_delete_timeout(void)
+{
+    if (delete_pending && k_uptime_get() >= delete_deadline_ms) {
+        complete_deletion();
     }
 }
 
+// UI work is held back while do not disturb is on and nobody is looking
+static bool defer_ui_work(void)
+{
+    display_power_state_t state = display_power_get_state();
+
+    return (state == DISPLAY_STATE_OFF || state == DISPLAY_STATE_AMBIENT) && dnd_is_active();
+}
+
+static void defer_update(void)
+{
+    ui_deferred = true;
+    dnd_count_deferred_update();
+}
+
 // Public API functions for external use
 void notifications_update_connection_status(connection_status_t status)
 {
+    if (defer_ui_work()) {
+        deferred_status = status;
+        deferred_status_pending = true;
+        defer_update();
+        return;
+    }
     update_connection_status(status);
 }
 
 void notifications_update_time(const char* time_str)
 {
+    if (defer_ui_work()) {
+        strncpy(deferred_time, time_str, sizeof(deferred_time) - 1);
+        defer_update();
+        return;
+    }
     update_time(time_str);
 }
 
+void notifications_refresh_deferred(void)
+{
+    if (!ui_deferred) {
+        return;
+    }
+
+    if (deferred_status_pending) {
+        update_connection_status(deferred_status);
+        deferred_status_pending = false;
+    }
+    if (deferred_time[0] != '\0') {
+        update_time(deferred_time);
+        deferred_time[0] = '\0';
+    }
+    if (deferred_new_notification) {
+        show_newest(); // Show newest notification
+    }
+    update_notification_display();
+
+    ui_deferred = false;
+    deferred_new_notification = false;
+    dnd_count_coalesced_refresh();
+}
+
 void notifications_add_notification(const char* app_name, const char* sender,
     const char* content, const char* timestamp)
 {
-    if (notification_count >= MAX_NOTIFICATIONS) {
-        // Remove oldest notification to make room
-        for (int i = 0; i < notification_count - 1; i++) {
-            notifications[i] = notifications[i + 1];
+    notifications_add_notification_flags(app_name, sender, content, timestamp, 0);
+}
+
+void notifications_add_notification_flags(const char* app_name, const char* sender,
+    const char* content, const char* timestamp, uint32_t flags)
+{
+    static const struct notification_meta no_meta;
+
+    notifications_add_notification_meta(&no_meta, app_name, sender, content, timestamp, flags);
+}
+
+void notifications_add_notification_meta(const struct notification_meta* meta,
+    const char* app_name, const char* sender, const char* content, const char* timestamp,
+    uint32_t flags)
+{
+    bool deferred = false;
+
+    if (dnd_is_active()) {
+        if (flags & NOTIFICATION_FLAG_PRIORITY) {
+            dnd_count_breakthrough();
+        } else {
+            // Store only: no wake, and no redraw while the display is off
+            flags |= NOTIFICATION_FLAG_SILENT;
+            deferred = defer_ui_work();
         }
-        notification_count--;
-        if (current_notification > 0) {
-            current_notification--;
+    }
+
+    if (!deferred) {
+        notifications_refresh_deferred();
+    }
+
+    // Urgent notifications don't wait out the undo window of a deletion
+    if ((flags & NOTIFICATION_FLAG_PRIORITY) && delete_pending) {
+        complete_deletion();
+    }
+
+    // Coalesce bursts from one conversation into its newest notification
+    uint16_t newest = store_list(STORE_LIST_ALL, 0)->last;
+    const struct store_notification* last = store_get(newest);
+    if ((flags & NOTIFICATION_FLAG_COALESCE) && last && !delete_pending) {
+        if (strncmp(last->app_name, app_name, sizeof(last->app_name) - 1) == 0
+            && strncmp(last->sender, sender, sizeof(last->sender) - 1) == 0) {
+            store_update(newest, meta, content, timestamp, (flags & NOTIFICATION_FLAG_PRIORITY) != 0);
+            stats.coalesced++;
+            TRACE_POINT(STORED, store_count());
+            if (deferred) {
+                deferred_new_notification = true;
+                ui_deferred = true;
+                dnd_count_deferred_notification();
+            } else if (!(flags & NOTIFICATION_FLAG_SILENT)) {
+                hide_group_list();
+                show_newest();
+                update_notification_display();
+                probe_glass(last);
+                display_power_notification_event();
+            }
+            return;
         }
     }
 
+    if (store_count() >= STORE_CAPACITY) {
+        // Remove oldest notification to make room
+        remove_notification(store_list(STORE_LIST_ALL, 0)->first);
+        stats.evicted++;
+    }
+
     // Add new notification
-    notification_t* new_notif = &notifications[notification_count];
-    strncpy(new_notif->app_name, app_name, sizeof(new_notif->app_name) - 1);
-    strncpy(new_notif->sender, sender, sizeof(new_notif->sender) - 1);
-    strncpy(new_notif->content, content, sizeof(new_notif->content) - 1);
-    strncpy(new_notif->timestamp, timestamp, sizeof(new_notif->timestamp) - 1);
-    new_notif->is_read = false;
-
-    notification_count++;
-    current_notification = notification_count - 1; // Show newest notification
+    uint16_t slot = store_add(meta, app_name, sender, content, timestamp,
+        (flags & NOTIFICATION_FLAG_PRIORITY) != 0);
+    if (current == STORE_NONE) {
+        show_newest();
+    }
+
+    stats.added++;
+    stats.peak_count = MAX(stats.peak_count, (uint32_t)store_count());
+    TRACE_POINT(STORED, store_count());
+
+    if (deferred) {
+        deferred_new_notification = true;
+        ui_deferred = true;
+        dnd_count_deferred_notification();
+        return;
+    }
+
+    // Silent notifications are stored without taking over the screen
+    if (flags & NOTIFICATION_FLAG_SILENT) {
+        update_notification_display();
+        return;
+    }
+
+    hide_group_list();
+    show_newest(); // Show newest notification
     update_notification_display();
+    probe_glass(store_get(slot));
+
+    display_power_notification_event();
 }
 
 void notifications_clear_all(void)
 {
-    notification_count = 0;
-    current_notification = 0;
+    if (delete_pending) {
+        clear_delete_pending();
+    }
+    store_clear();
+    current = STORE_NONE;
+    current_pos = 0;
+    view_all();
+    hide_group_list();
+    if (defer_ui_work()) {
+        defer_update();
+        return;
+    }
     update_notification_display();
 }
 
-int notifications_get_unread_count(void)
+void notifications_get_stats(struct notifications_stats* out)
 {
-    int count = 0;
-    for (int i = 0; i < notification_count; i++) {
-        if (!notifications[i].is_read) {
-            count++;
+    *out = stats;
+}
+
+void notifications_search(const char* query, size_t len)
+{
+    static char row_text[STORE_SENDER_LEN + STORE_CONTENT_LEN + 8];
+    uint32_t hits[SEARCH_HITS_WORDS];
+    int rows = 0;
+
+    // Asked for from the phone, so somebody is about to look
+    display_power_user_activity();
+    notifications_refresh_deferred();
+    show_reply_picker(false);
+
+    lv_obj_clean(group_list);
+    if (search_query(query, len, hits) == 0) {
+        add_list_row("No matches", close_row_event_handler, 0);
+        lv_obj_clear_flag(group_list, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+
+    // Newest first
+    for (uint16_t slot = store_list(STORE_LIST_ALL, 0)->last;
+         slot != STORE_NONE && rows < SEARCH_RESULT_ROWS;
+         slot = store_get(slot)->links[STORE_LIST_ALL].prev) {
+        const struct store_notification* notif = store_get(slot);
+
+        if (!(hits[slot / 32] & (1U << (slot % 32)))) {
+            continue;
         }
+        snprintf(row_text, sizeof(row_text), "%s%s: %s", notif->is_read ? "" : "● ",
+            notif->sender, notif->content);
+        search_results[rows].slot = slot;
+        search_results[rows].seq = notif->seq;
+        add_list_row(row_text, result_row_event_handler, rows);
+        rows++;
     }
-    return count;
+    lv_obj_clear_flag(group_list, LV_OBJ_FLAG_HIDDEN);
+}
+
+int notifications_get_unread_count(void)
+{
+    return store_unread_count();
 }
 
 // Call this in your main loop to handle delete timeouts
@@ -534,10 +1038,24 @@ void notifications_handle_timers(void)
     handle_delete_timeout();
 }
 
+static void on_icon_ready(uint32_t id)
+{
+    const struct store_notification* notif = store_get(current);
+
+    if (!notif || notif->meta.icon_id != id) {
+        return;
+    }
+
+    if (defer_ui_work()) {
+        defer_update();
+        return;
+    }
+    update_app_icon(notif);
+}
+
 void create_notification_screen(void)
 {
-    // Initialize sample data
-    init_sample_notifications();
+    store_init();
 
     // Create main screen
     main_screen = lv_obj_create(NULL);
@@ -551,6 +1069,9 @@ void create_notification_screen(void)
     create_app_info();
     create_notification_content();
     create_bottom_info();
+    create_reply_picker();
+    create_group_list();
+    icons_set_ready_callback(on_icon_ready);
 
     // Enable gesture detection and add event handler
     lv_obj_add_event_cb(main_screen, screen_event_handler, LV_EVENT_ALL, NULL);
@@ -563,44 +1084,3 @@ void create_notification_screen(void)
     // Load the screen
     lv_scr_load(main_screen);
 }
-
-// Demo function for testing (optional - remove in production)
-void demo_status_changes(void)
-{
-    static connection_status_t current_status = CONN_CONNECTED;
-    static int counter = 0;
-    static int demo_step = 0;
-
-    counter++;
-
-    // Handle delete timeout every cycle
-    handle_delete_timeout();
-
-    // Every 5 seconds, do something different
-    if (counter % 50 == 0) {
-        switch (demo_step % 6) {
-        case 0:
-            current_status = (current_status + 1) % 4;
-            update_connection_status(current_status);
-            break;
-        case 1: {
-            // Update time
-            static char time_buf[10];
-            int hours = 14 + (demo_step / 8) % 10;
-            int minutes = 23 + (demo_step * 7) % 60;
-            snprintf(time_buf, sizeof(time_buf), "%02d:%02d", hours, minutes);
-            update_time(time_buf);
-        } break;
-        case 2:
-            // Add a new notification
-            notifications_add_notification("Instagram", "Alice", "Liked your photo!", "now");
-            break;
-        case 3:
-        case 4:
-        case 5:
-            // Let user interact manually
-            break;
-        }
-        demo_step++;
-    }
-}
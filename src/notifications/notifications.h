@@ -9,12 +9,44 @@
 #define NOTIFICATIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** @brief Store without waking the display or changing the shown notification
+ *
+ * Implied for non-priority notifications while do not disturb is active.
+ */
+#define NOTIFICATION_FLAG_SILENT (1U << 0)
+
+/** @brief Mark the notification as priority */
+#define NOTIFICATION_FLAG_PRIORITY (1U << 1)
+
+/** @brief Merge into the newest notification if it has the same app and sender */
+#define NOTIFICATION_FLAG_COALESCE (1U << 2)
+
+/**
+ * @brief Notification store statistics
+ */
+struct notifications_stats {
+    uint32_t added; /**< Notifications stored in a new slot */
+    uint32_t coalesced; /**< Notifications merged into the newest one */
+    uint32_t evicted; /**< Oldest notifications dropped from a full store */
+    uint32_t peak_count; /**< Most notifications stored at once */
+};
+
+/**
+ * @brief Phone-side identity of a notification
+ */
+struct notification_meta {
+    uint32_t key; /**< Phone's notification key for actions, 0 if unknown */
+    uint32_t icon_id; /**< App icon in the icon cache, 0 for none */
+    uint32_t rx_cycles; /**< Cycle count at receipt, 0 if not from a phone */
+};
+
 // Connection status enum
 typedef enum {
     CONN_CONNECTED, // Green
@@ -59,11 +91,65 @@ void notifications_update_time(const char* time_str);
 void notifications_add_notification(const char* app_name, const char* sender,
     const char* content, const char* timestamp);
 
+/**
+ * @brief Add a new notification with delivery flags
+ *
+ * Same as notifications_add_notification(), with NOTIFICATION_FLAG_* bits
+ * controlling how it is stored and presented.
+ *
+ * @param app_name Name of the app (max 31 chars)
+ * @param sender Sender name (max 63 chars)
+ * @param content Notification content (max 255 chars)
+ * @param timestamp Time string (max 15 chars)
+ * @param flags NOTIFICATION_FLAG_* bits
+ */
+void notifications_add_notification_flags(const char* app_name, const char* sender,
+    const char* content, const char* timestamp, uint32_t flags);
+
+/**
+ * @brief Add a new notification from the phone
+ *
+ * Same as notifications_add_notification_flags(), with the phone's key and
+ * icon for the notification. Gestures on it (dismiss, mark read, open,
+ * reply) are sent back to the phone with the key.
+ *
+ * @param meta Phone-side identity, copied
+ * @param app_name Name of the app (max 31 chars)
+ * @param sender Sender name (max 63 chars)
+ * @param content Notification content (max 255 chars)
+ * @param timestamp Time string (max 15 chars)
+ * @param flags NOTIFICATION_FLAG_* bits
+ */
+void notifications_add_notification_meta(const struct notification_meta* meta,
+    const char* app_name, const char* sender, const char* content, const char* timestamp,
+    uint32_t flags);
+
+/**
+ * @brief Apply UI updates held back by do not disturb in one refresh
+ *
+ * Call when the display wakes. Shows the newest notification if any
+ * arrived while deferred. Does nothing if no work was deferred.
+ */
+void notifications_refresh_deferred(void);
+
 /**
  * @brief Clear all notifications
  */
 void notifications_clear_all(void);
 
+/**
+ * @brief Search the stored notifications and list the matches
+ *
+ * Wakes the display and lists the newest matches over the current
+ * notification, tapping one shows it among all notifications. Matching
+ * follows search.h: each word of the query must start a word of the app,
+ * sender or text.
+ *
+ * @param query Query text, not NUL terminated
+ * @param len Query length
+ */
+void notifications_search(const char* query, size_t len);
+
 /**
  * @brief Get count of unread notifications
  *
@@ -72,18 +158,18 @@ void notifications_clear_all(void);
 int notifications_get_unread_count(void);
 
 /**
- * @brief Handle internal timers (call in main loop)
+ * @brief Get notification store statistics
  *
- * This handles delete timeout functionality
+ * @param stats Output for the statistics since boot
  */
-void notifications_handle_timers(void);
+void notifications_get_stats(struct notifications_stats* stats);
 
 /**
- * @brief Demo function for testing status changes
+ * @brief Handle internal timers (call in main loop)
  *
- * Optional function for testing different UI states
+ * This handles delete timeout functionality
  */
-void demo_status_changes(void);
+void notifications_handle_timers(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,263 @@
+/**
+ * @file search.c
+ * @brief Notification Text Search Index Implementation
+ *
+ * Each term holds a singly linked list of postings (store slots), oldest
+ * first, so evicting the oldest notification finds its postings at the
+ * heads of their lists. A notification's postings are appended
+ * consecutively, so a repeated word is recognized at the tail of its list.
+ * Free terms and free postings are chained through their next links.
+ *
+ * Queries match word prefixes, so each query word scans the term pool and
+ * ORs the postings of every term it starts; the query's words are ANDed.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+
+#include "notifications/search.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+struct term {
+    char text[SEARCH_TERM_LEN];
+    uint8_t len; /**< 0 for a free term */
+    uint16_t postings; /**< Oldest posting, STORE_NONE for none */
+    uint16_t last; /**< Newest posting */
+    uint16_t next; /**< Next term in the bucket, or free term */
+};
+
+struct posting {
+    uint16_t slot;
+    uint16_t next;
+};
+
+static struct term terms[SEARCH_MAX_TERMS];
+static uint16_t buckets[SEARCH_TERM_BUCKETS];
+static uint16_t free_terms;
+static struct posting postings[SEARCH_MAX_POSTINGS];
+static uint16_t free_postings;
+static struct search_stats stats;
+
+static bool is_word_byte(uint8_t c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+/**
+ * @brief Get the next word of a text, lowercased and cut to SEARCH_TERM_LEN
+ *
+ * @param pos Position to search from, advanced past the word
+ * @return Word length, 0 past the last word
+ */
+static size_t next_word(const char* text, size_t len, size_t* pos, char word[SEARCH_TERM_LEN])
+{
+    size_t i = *pos;
+    size_t n = 0;
+
+    while (i < len && !is_word_byte(text[i])) {
+        i++;
+    }
+    for (; i < len && is_word_byte(text[i]); i++) {
+        if (n < SEARCH_TERM_LEN) {
+            char c = text[i];
+
+            word[n++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+        }
+    }
+    *pos = i;
+    return n;
+}
+
+static uint16_t* bucket_of(const char* word, size_t len)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)word[i]) * FNV_PRIME;
+    }
+    return &buckets[hash & (SEARCH_TERM_BUCKETS - 1)];
+}
+
+/**
+ * @brief Find the term of a word
+ *
+ * @param link Output for the link to the term in its bucket, or to the
+ *             bucket's end if it is not indexed
+ * @return Term, STORE_NONE if the word is not indexed
+ */
+static uint16_t find_term(const char* word, size_t len, uint16_t** link)
+{
+    uint16_t* p = bucket_of(word, len);
+
+    while (*p != STORE_NONE) {
+        if (terms[*p].len == len && memcmp(terms[*p].text, word, len) == 0) {
+            break;
+        }
+        p = &terms[*p].next;
+    }
+    *link = p;
+    return *p;
+}
+
+static void index_word(uint16_t slot, const char* word, size_t len)
+{
+    uint16_t* link;
+    uint16_t id = find_term(word, len, &link);
+    uint16_t posting;
+
+    if (id != STORE_NONE && postings[terms[id].last].slot == slot) {
+        return; /* Repeated in this notification */
+    }
+    if (free_postings == STORE_NONE || (id == STORE_NONE && free_terms == STORE_NONE)) {
+        stats.dropped++;
+        return;
+    }
+
+    if (id == STORE_NONE) {
+        id = free_terms;
+        free_terms = terms[id].next;
+        memcpy(terms[id].text, word, len);
+        terms[id].len = len;
+        terms[id].postings = STORE_NONE;
+        terms[id].next = STORE_NONE;
+        *link = id;
+        stats.terms++;
+    }
+
+    posting = free_postings;
+    free_postings = postings[posting].next;
+    postings[posting].slot = slot;
+    postings[posting].next = STORE_NONE;
+    if (terms[id].postings == STORE_NONE) {
+        terms[id].postings = posting;
+    } else {
+        postings[terms[id].last].next = posting;
+    }
+    terms[id].last = posting;
+    stats.postings++;
+}
+
+static void unindex_word(uint16_t slot, const char* word, size_t len)
+{
+    uint16_t* link;
+    uint16_t id = find_term(word, len, &link);
+    uint16_t prev = STORE_NONE;
+
+    if (id == STORE_NONE) {
+        return;
+    }
+
+    for (uint16_t* p = &terms[id].postings; *p != STORE_NONE; p = &postings[*p].next) {
+        if (postings[*p].slot == slot) {
+            uint16_t posting = *p;
+
+            *p = postings[posting].next;
+            if (terms[id].last == posting) {
+                terms[id].last = prev;
+            }
+            postings[posting].next = free_postings;
+            free_postings = posting;
+            stats.postings--;
+            break;
+        }
+        prev = *p;
+    }
+
+    if (terms[id].postings == STORE_NONE) {
+        *link = terms[id].next;
+        terms[id].len = 0;
+        terms[id].next = free_terms;
+        free_terms = id;
+        stats.terms--;
+    }
+}
+
+static void for_each_word(uint16_t slot, const struct store_notification* notif,
+    void (*fn)(uint16_t slot, const char* word, size_t len))
+{
+    const char* const fields[] = { notif->app_name, notif->sender, notif->content };
+    char word[SEARCH_TERM_LEN];
+
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        size_t len = strlen(fields[f]);
+        size_t pos = 0;
+        size_t n;
+
+        while ((n = next_word(fields[f], len, &pos, word)) > 0) {
+            fn(slot, word, n);
+        }
+    }
+}
+
+void search_clear(void)
+{
+    for (uint16_t i = 0; i < SEARCH_MAX_TERMS; i++) {
+        terms[i].len = 0;
+        terms[i].next = (i + 1 < SEARCH_MAX_TERMS) ? i + 1 : STORE_NONE;
+    }
+    free_terms = 0;
+
+    for (uint16_t i = 0; i < SEARCH_MAX_POSTINGS; i++) {
+        postings[i].next = (i + 1 < SEARCH_MAX_POSTINGS) ? i + 1 : STORE_NONE;
+    }
+    free_postings = 0;
+
+    memset(buckets, 0xFF, sizeof(buckets));
+    stats.terms = 0;
+    stats.postings = 0;
+}
+
+void search_add(uint16_t slot, const struct store_notification* notif)
+{
+    for_each_word(slot, notif, index_word);
+}
+
+void search_remove(uint16_t slot, const struct store_notification* notif)
+{
+    for_each_word(slot, notif, unindex_word);
+}
+
+int search_query(const char* query, size_t len, uint32_t hits[SEARCH_HITS_WORDS])
+{
+    uint32_t word_hits[SEARCH_HITS_WORDS];
+    char word[SEARCH_TERM_LEN];
+    size_t pos = 0;
+    size_t n;
+    int words = 0;
+    int count = 0;
+
+    stats.queries++;
+    memset(hits, 0, SEARCH_HITS_WORDS * sizeof(hits[0]));
+
+    while (words < SEARCH_MAX_QUERY_WORDS && (n = next_word(query, len, &pos, word)) > 0) {
+        memset(word_hits, 0, sizeof(word_hits));
+        for (uint16_t id = 0; id < SEARCH_MAX_TERMS; id++) {
+            if (terms[id].len < n || memcmp(terms[id].text, word, n) != 0) {
+                continue;
+            }
+            for (uint16_t p = terms[id].postings; p != STORE_NONE; p = postings[p].next) {
+                word_hits[postings[p].slot / 32] |= 1U << (postings[p].slot % 32);
+            }
+        }
+
+        for (size_t w = 0; w < SEARCH_HITS_WORDS; w++) {
+            hits[w] = words == 0 ? word_hits[w] : (hits[w] & word_hits[w]);
+        }
+        words++;
+    }
+
+    for (size_t w = 0; w < SEARCH_HITS_WORDS; w++) {
+        for (uint32_t bits = hits[w]; bits; bits &= bits - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void search_get_stats(struct search_stats* out)
+{
+    *out = stats;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file search.h
+ * @brief Notification Text Search Index Header
+ *
+ * Inverted index over the words of the stored notifications (app, sender
+ * and text), so a search follows the postings of the words it matches
+ * instead of reading every notification. The store keeps it up to date:
+ * notifications are indexed when added or updated and taken out when they
+ * are deleted or evicted.
+ *
+ * Words are runs of letters and digits, lowercased. Bytes of UTF-8
+ * sequences count as letters, so other scripts are indexed as written.
+ * Words longer than SEARCH_TERM_LEN are indexed by their first
+ * SEARCH_TERM_LEN bytes.
+ *
+ * A query matches the notifications that have, for each of its words, a
+ * word starting with it: "cod 48" finds "Your code is 483920".
+ *
+ * Terms and postings come from fixed pools sized from the store capacity.
+ * Words of a notification that find a pool exhausted are not indexed and
+ * counted as dropped, the pools refill as notifications leave the store.
+ *
+ * Main loop only.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "notifications/store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Indexed word length, longer words are cut */
+#define SEARCH_TERM_LEN 12
+
+/** @brief Distinct words indexed at once */
+#define SEARCH_MAX_TERMS (STORE_CAPACITY * 12)
+
+/** @brief Word occurrences indexed at once, one per word per notification */
+#define SEARCH_MAX_POSTINGS (STORE_CAPACITY * 32)
+
+/** @brief Term hash buckets, a power of two */
+#if STORE_CAPACITY > 100
+#define SEARCH_TERM_BUCKETS 1024
+#else
+#define SEARCH_TERM_BUCKETS 128
+#endif
+
+/** @brief Query words used, later ones are ignored */
+#define SEARCH_MAX_QUERY_WORDS 4
+
+/** @brief Words in a hits bitmap, one bit per store slot */
+#define SEARCH_HITS_WORDS ((STORE_CAPACITY + 31) / 32)
+
+/**
+ * @brief Search index statistics
+ */
+struct search_stats {
+    uint32_t terms; /**< Distinct words indexed */
+    uint32_t postings; /**< Word occurrences indexed */
+    uint32_t dropped; /**< Word occurrences not indexed for lack of room */
+    uint32_t queries; /**< Searches run */
+};
+
+/**
+ * @brief Empty the index
+ */
+void search_clear(void);
+
+/**
+ * @brief Index a stored notification
+ *
+ * @param slot Store slot
+ * @param notif Notification in the slot
+ */
+void search_add(uint16_t slot, const struct store_notification* notif);
+
+/**
+ * @brief Take a notification out of the index
+ *
+ * @param slot Store slot
+ * @param notif Notification in the slot, with the texts it was indexed with
+ */
+void search_remove(uint16_t slot, const struct store_notification* notif);
+
+/**
+ * @brief Find the notifications matching a query
+ *
+ * @param query Query text, not NUL terminated
+ * @param len Query length
+ * @param hits Output bitmap, bit n set for a match in store slot n
+ * @return Number of matches, 0 for a query without words
+ */
+int search_query(const char* query, size_t len, uint32_t hits[SEARCH_HITS_WORDS]);
+
+/**
+ * @brief Get search index statistics
+ *
+ * @param stats Output for the statistics
+ */
+void search_get_stats(struct search_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEARCH_H */
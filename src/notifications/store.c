@@ -0,0 +1,363 @@
+/**
+ * @file store.c
+ * @brief Notification Store Implementation
+ *
+ * Free slots and free groups are kept on stacks. A group is matched on the
+ * hash of its app and sender (threads) or app (apps), then on the texts of
+ * its first notification, as stored. Each grouped list has its own table
+ * of groups. The search index is updated along with the lists.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <string.h>
+
+#include "notifications/search.h"
+#include "notifications/store.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+/** @brief Grouped lists, STORE_LIST_THREAD onwards */
+#define GROUPED_LISTS (STORE_LISTS - STORE_LIST_THREAD)
+
+/**
+ * @brief Groups of one list; there are never more than notifications
+ */
+struct group_table {
+    struct store_group groups[STORE_CAPACITY];
+    uint16_t buckets[STORE_GROUP_BUCKETS];
+    uint16_t free[STORE_CAPACITY];
+    uint16_t free_count;
+    uint16_t newest;
+};
+
+static struct store_notification slots[STORE_CAPACITY];
+static uint16_t free_slots[STORE_CAPACITY];
+static uint16_t free_slot_count;
+static struct group_table tables[GROUPED_LISTS];
+static struct store_ends all;
+static uint16_t unread;
+static uint32_t next_seq;
+
+static struct group_table* table_of(enum store_list list)
+{
+    return &tables[list - STORE_LIST_THREAD];
+}
+
+static void copy_text(char* dst, size_t size, const char* src)
+{
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static uint32_t hash_text(uint32_t hash, const char* text)
+{
+    /* The terminator is hashed too, it separates texts */
+    for (const char* p = text;; p++) {
+        hash = (hash ^ (uint8_t)*p) * FNV_PRIME;
+        if (*p == '\0') {
+            return hash;
+        }
+    }
+}
+
+static uint32_t group_hash(enum store_list list, const struct store_notification* n)
+{
+    uint32_t hash = hash_text(FNV_OFFSET_BASIS, n->app_name);
+
+    return list == STORE_LIST_THREAD ? hash_text(hash, n->sender) : hash;
+}
+
+static bool group_matches(enum store_list list, const struct store_notification* a,
+    const struct store_notification* b)
+{
+    return strcmp(a->app_name, b->app_name) == 0
+        && (list != STORE_LIST_THREAD || strcmp(a->sender, b->sender) == 0);
+}
+
+static void link_append(struct store_ends* ends, enum store_list list, uint16_t slot)
+{
+    struct store_link* link = &slots[slot].links[list];
+
+    link->prev = ends->last;
+    link->next = STORE_NONE;
+    if (ends->last != STORE_NONE) {
+        slots[ends->last].links[list].next = slot;
+    } else {
+        ends->first = slot;
+    }
+    ends->last = slot;
+    ends->len++;
+}
+
+static void link_remove(struct store_ends* ends, enum store_list list, uint16_t slot)
+{
+    struct store_link* link = &slots[slot].links[list];
+
+    if (link->prev != STORE_NONE) {
+        slots[link->prev].links[list].next = link->next;
+    } else {
+        ends->first = link->next;
+    }
+    if (link->next != STORE_NONE) {
+        slots[link->next].links[list].prev = link->prev;
+    } else {
+        ends->last = link->prev;
+    }
+    ends->len--;
+}
+
+static void group_unlink_activity(struct group_table* table, uint16_t id)
+{
+    struct store_group* group = &table->groups[id];
+
+    if (group->newer != STORE_NONE) {
+        table->groups[group->newer].older = group->older;
+    } else {
+        table->newest = group->older;
+    }
+    if (group->older != STORE_NONE) {
+        table->groups[group->older].newer = group->newer;
+    }
+}
+
+static void group_make_newest(struct group_table* table, uint16_t id)
+{
+    struct store_group* group = &table->groups[id];
+
+    if (table->newest == id) {
+        return;
+    }
+    if (group->members.len > 0) {
+        group_unlink_activity(table, id);
+    }
+    group->newer = STORE_NONE;
+    group->older = table->newest;
+    if (table->newest != STORE_NONE) {
+        table->groups[table->newest].newer = id;
+    }
+    table->newest = id;
+}
+
+/**
+ * @brief Find the group of a stored notification in a list, or create it
+ */
+static uint16_t group_of(enum store_list list, const struct store_notification* n)
+{
+    struct group_table* table = table_of(list);
+    uint32_t hash = group_hash(list, n);
+    uint16_t* bucket = &table->buckets[hash & (STORE_GROUP_BUCKETS - 1)];
+    uint16_t id;
+
+    for (id = *bucket; id != STORE_NONE; id = table->groups[id].hash_next) {
+        if (table->groups[id].hash == hash
+            && group_matches(list, &slots[table->groups[id].members.first], n)) {
+            return id;
+        }
+    }
+
+    id = table->free[--table->free_count];
+    table->groups[id] = (struct store_group) {
+        .members = { .first = STORE_NONE, .last = STORE_NONE },
+        .newer = STORE_NONE,
+        .older = STORE_NONE,
+        .hash_next = *bucket,
+        .hash = hash,
+    };
+    *bucket = id;
+    return id;
+}
+
+static void group_free(struct group_table* table, uint16_t id)
+{
+    uint16_t* p = &table->buckets[table->groups[id].hash & (STORE_GROUP_BUCKETS - 1)];
+
+    while (*p != id) {
+        p = &table->groups[*p].hash_next;
+    }
+    *p = table->groups[id].hash_next;
+
+    group_unlink_activity(table, id);
+    table->free[table->free_count++] = id;
+}
+
+void store_init(void)
+{
+    store_clear();
+}
+
+void store_clear(void)
+{
+    for (uint16_t i = 0; i < STORE_CAPACITY; i++) {
+        slots[i].used = false;
+        /* Lowest slots are handed out first */
+        free_slots[i] = STORE_CAPACITY - 1 - i;
+    }
+    free_slot_count = STORE_CAPACITY;
+
+    for (size_t t = 0; t < GROUPED_LISTS; t++) {
+        struct group_table* table = &tables[t];
+
+        for (uint16_t i = 0; i < STORE_CAPACITY; i++) {
+            table->groups[i].members.len = 0;
+            table->free[i] = STORE_CAPACITY - 1 - i;
+        }
+        table->free_count = STORE_CAPACITY;
+        memset(table->buckets, 0xFF, sizeof(table->buckets));
+        table->newest = STORE_NONE;
+    }
+
+    all = (struct store_ends) { .first = STORE_NONE, .last = STORE_NONE };
+    unread = 0;
+    search_clear();
+}
+
+uint16_t store_add(const struct notification_meta* meta, const char* app_name,
+    const char* sender, const char* content, const char* timestamp, bool priority)
+{
+    struct store_notification* n;
+    uint16_t slot;
+
+    if (free_slot_count == 0) {
+        return STORE_NONE;
+    }
+
+    slot = free_slots[--free_slot_count];
+    n = &slots[slot];
+    copy_text(n->app_name, sizeof(n->app_name), app_name);
+    copy_text(n->sender, sizeof(n->sender), sender);
+    copy_text(n->content, sizeof(n->content), content);
+    copy_text(n->timestamp, sizeof(n->timestamp), timestamp);
+    n->used = true;
+    n->is_read = false;
+    n->is_priority = priority;
+    n->meta = *meta;
+    n->seq = next_seq++;
+    n->group[STORE_LIST_ALL] = STORE_NONE;
+
+    link_append(&all, STORE_LIST_ALL, slot);
+    for (enum store_list list = STORE_LIST_THREAD; list < STORE_LISTS; list++) {
+        struct group_table* table = table_of(list);
+        uint16_t id = group_of(list, n);
+
+        n->group[list] = id;
+        group_make_newest(table, id);
+        link_append(&table->groups[id].members, list, slot);
+        table->groups[id].unread++;
+    }
+    unread++;
+    search_add(slot, n);
+    return slot;
+}
+
+void store_update(uint16_t slot, const struct notification_meta* meta, const char* content,
+    const char* timestamp, bool priority)
+{
+    struct store_notification* n = &slots[slot];
+
+    search_remove(slot, n);
+    copy_text(n->content, sizeof(n->content), content);
+    copy_text(n->timestamp, sizeof(n->timestamp), timestamp);
+    search_add(slot, n);
+    n->is_priority |= priority;
+    n->meta = *meta;
+    store_set_read(slot, false);
+    for (enum store_list list = STORE_LIST_THREAD; list < STORE_LISTS; list++) {
+        group_make_newest(table_of(list), n->group[list]);
+    }
+}
+
+void store_remove(uint16_t slot)
+{
+    struct store_notification* n = &slots[slot];
+
+    search_remove(slot, n);
+    store_set_read(slot, true);
+    link_remove(&all, STORE_LIST_ALL, slot);
+    for (enum store_list list = STORE_LIST_THREAD; list < STORE_LISTS; list++) {
+        struct group_table* table = table_of(list);
+        struct store_group* group = &table->groups[n->group[list]];
+
+        link_remove(&group->members, list, slot);
+        if (group->members.len == 0) {
+            group_free(table, n->group[list]);
+        }
+    }
+
+    n->used = false;
+    free_slots[free_slot_count++] = slot;
+}
+
+void store_set_read(uint16_t slot, bool read)
+{
+    struct store_notification* n = &slots[slot];
+
+    if (n->is_read == read) {
+        return;
+    }
+    n->is_read = read;
+    for (enum store_list list = STORE_LIST_THREAD; list < STORE_LISTS; list++) {
+        struct store_group* group = &table_of(list)->groups[n->group[list]];
+
+        if (read) {
+            group->unread--;
+        } else {
+            group->unread++;
+        }
+    }
+    if (read) {
+        unread--;
+    } else {
+        unread++;
+    }
+}
+
+const struct store_notification* store_get(uint16_t slot)
+{
+    if (slot >= STORE_CAPACITY || !slots[slot].used) {
+        return NULL;
+    }
+    return &slots[slot];
+}
+
+const struct store_ends* store_list(enum store_list list, uint16_t group)
+{
+    const struct store_group* g;
+
+    if (list == STORE_LIST_ALL) {
+        return &all;
+    }
+    g = store_get_group(list, group);
+    return g ? &g->members : NULL;
+}
+
+const struct store_group* store_get_group(enum store_list list, uint16_t group)
+{
+    const struct group_table* table = table_of(list);
+
+    if (group >= STORE_CAPACITY || table->groups[group].members.len == 0) {
+        return NULL;
+    }
+    return &table->groups[group];
+}
+
+uint16_t store_newest_group(enum store_list list)
+{
+    return table_of(list)->newest;
+}
+
+uint16_t store_group_count(enum store_list list)
+{
+    return STORE_CAPACITY - table_of(list)->free_count;
+}
+
+uint16_t store_count(void)
+{
+    return all.len;
+}
+
+uint16_t store_unread_count(void)
+{
+    return unread;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file store.h
+ * @brief Notification Store Header
+ *
+ * Notifications live in fixed slots that keep their index for as long as
+ * they are stored, so other indexes can refer to them by slot. Each stored
+ * notification is linked, oldest to newest, into the list of all
+ * notifications, the list of its thread (the notifications of one app from
+ * one sender) and the list of its app. Threads and apps are groups, found
+ * by a hash of their app and sender or app, and kept in their own list,
+ * most recently active first.
+ *
+ * Adding, updating and removing a notification keeps every list up to date
+ * in constant time (plus the group's hash chain), so walking a thread or
+ * stepping through one app costs the notifications visited, not a scan of
+ * the store.
+ *
+ * Main loop only.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "notifications/notifications.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Notifications stored at once */
+#if defined(CONFIG_NOTIFICATION_STORE_SIZE)
+#define STORE_CAPACITY CONFIG_NOTIFICATION_STORE_SIZE
+#else
+#define STORE_CAPACITY 30
+#endif
+
+/** @brief Group hash buckets per list, a power of two */
+#define STORE_GROUP_BUCKETS 64
+
+/** @brief No slot or group, ends lists */
+#define STORE_NONE UINT16_MAX
+
+/** @brief Stored text lengths, with terminator */
+#define STORE_APP_NAME_LEN 32
+#define STORE_SENDER_LEN 64
+#define STORE_CONTENT_LEN 256
+#define STORE_TIMESTAMP_LEN 16
+
+/**
+ * @brief Lists a notification is linked into
+ */
+enum store_list {
+    STORE_LIST_ALL, /**< Every notification */
+    STORE_LIST_THREAD, /**< Notifications of one thread */
+    STORE_LIST_APP, /**< Notifications of one app */
+    STORE_LISTS,
+};
+
+/**
+ * @brief Neighbours in a list, STORE_NONE past the ends
+ */
+struct store_link {
+    uint16_t prev; /**< Older */
+    uint16_t next; /**< Newer */
+};
+
+/**
+ * @brief Ends of a list
+ */
+struct store_ends {
+    uint16_t first; /**< Oldest */
+    uint16_t last; /**< Newest */
+    uint16_t len;
+};
+
+/**
+ * @brief Stored notification
+ */
+struct store_notification {
+    char app_name[STORE_APP_NAME_LEN];
+    char sender[STORE_SENDER_LEN];
+    char content[STORE_CONTENT_LEN];
+    char timestamp[STORE_TIMESTAMP_LEN];
+    bool used;
+    bool is_read;
+    bool is_priority;
+    struct notification_meta meta;
+    uint32_t seq; /**< Arrival order, older notifications have lower ones */
+    uint16_t group[STORE_LISTS]; /**< Thread and app, unused for STORE_LIST_ALL */
+    struct store_link links[STORE_LISTS];
+};
+
+/**
+ * @brief Group of notifications: a thread, or an app
+ */
+struct store_group {
+    struct store_ends members;
+    uint16_t unread;
+    uint16_t newer; /**< More recently active group */
+    uint16_t older; /**< Less recently active group */
+    uint16_t hash_next; /**< Next group in the hash bucket */
+    uint32_t hash;
+};
+
+/**
+ * @brief Initialize an empty store
+ */
+void store_init(void);
+
+/**
+ * @brief Remove every notification
+ */
+void store_clear(void);
+
+/**
+ * @brief Store a notification as the newest one
+ *
+ * Texts are truncated to their stored length. The notification joins the
+ * thread of its app and sender and the group of its app, created if
+ * needed, which become the most recently active.
+ *
+ * @param meta Phone-side identity, copied
+ * @param app_name App name
+ * @param sender Sender name
+ * @param content Notification text
+ * @param timestamp Time string
+ * @param priority Priority notification
+ * @return Slot, STORE_NONE if the store is full
+ */
+uint16_t store_add(const struct notification_meta* meta, const char* app_name,
+    const char* sender, const char* content, const char* timestamp, bool priority);
+
+/**
+ * @brief Replace the text of a stored notification with a newer message
+ *
+ * The notification keeps its place and becomes unread, its groups become
+ * the most recently active.
+ *
+ * @param slot Stored notification
+ * @param meta Phone-side identity, copied
+ * @param content Notification text
+ * @param timestamp Time string
+ * @param priority Also mark it as priority
+ */
+void store_update(uint16_t slot, const struct notification_meta* meta, const char* content,
+    const char* timestamp, bool priority);
+
+/**
+ * @brief Remove a notification
+ *
+ * Its groups are removed with their last notification.
+ *
+ * @param slot Stored notification
+ */
+void store_remove(uint16_t slot);
+
+/**
+ * @brief Mark a notification as read or unread
+ *
+ * @param slot Stored notification
+ * @param read Read state
+ */
+void store_set_read(uint16_t slot, bool read);
+
+/**
+ * @brief Get a stored notification
+ *
+ * @param slot Slot
+ * @return Notification, NULL if the slot is empty
+ */
+const struct store_notification* store_get(uint16_t slot);
+
+/**
+ * @brief Get the ends of a list
+ *
+ * @param list List
+ * @param group Thread or app, ignored for STORE_LIST_ALL
+ * @return Ends of the list, NULL if the group does not exist
+ */
+const struct store_ends* store_list(enum store_list list, uint16_t group);
+
+/**
+ * @brief Get a group
+ *
+ * @param list STORE_LIST_THREAD or STORE_LIST_APP
+ * @param group Thread or app
+ * @return Group, NULL if it does not exist
+ */
+const struct store_group* store_get_group(enum store_list list, uint16_t group);
+
+/**
+ * @brief Get the most recently active group, follow older to walk the rest
+ *
+ * @param list STORE_LIST_THREAD or STORE_LIST_APP
+ * @return Group, STORE_NONE if the store is empty
+ */
+uint16_t store_newest_group(enum store_list list);
+
+/**
+ * @brief Get the number of groups
+ *
+ * @param list STORE_LIST_THREAD or STORE_LIST_APP
+ */
+uint16_t store_group_count(enum store_list list);
+
+/**
+ * @brief Get the number of stored notifications
+ */
+uint16_t store_count(void);
+
+/**
+ * @brief Get the number of unread notifications
+ */
+uint16_t store_unread_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STORE_H */
@@ -0,0 +1,335 @@
+/**
+ * @file keywords.c
+ * @brief Multi-Keyword Matcher Implementation
+ *
+ * The trie is first built with temporary child/sibling lists, then
+ * renumbered breadth-first into the image so that every state's edges are
+ * contiguous and sorted. Fail and output links are computed in that same
+ * order, where each state's parent has already been resolved.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "rules/keywords.h"
+
+/** @brief Temporary trie used while building */
+static struct {
+    uint16_t child[KEYWORDS_MAX_STATES]; /**< First child, 0 if none */
+    uint16_t sibling[KEYWORDS_MAX_STATES]; /**< Next sibling, 0 if none */
+    uint8_t in_char[KEYWORDS_MAX_STATES]; /**< Byte on the edge into the state */
+    uint8_t keyword[KEYWORDS_MAX_STATES];
+    uint16_t order[KEYWORDS_MAX_STATES]; /**< Breadth-first order */
+    uint16_t new_id[KEYWORDS_MAX_STATES];
+} trie;
+
+/**
+ * @brief Point the array views at their sections of the image
+ *
+ * @return Image length for the given counts
+ */
+static size_t layout(struct keyword_automaton* ac, uint16_t n, uint16_t e)
+{
+    uint8_t* p = ac->image + KEYWORDS_IMAGE_HEADER_LEN;
+
+    ac->first_edge = (const uint16_t*)p;
+    p += (n + 1) * sizeof(uint16_t);
+    ac->fail = (const uint16_t*)p;
+    p += n * sizeof(uint16_t);
+    ac->out = (const uint16_t*)p;
+    p += n * sizeof(uint16_t);
+    ac->edge_target = (const uint16_t*)p;
+    p += e * sizeof(uint16_t);
+    ac->keyword = p;
+    p += n;
+    ac->edge_char = p;
+    p += e;
+
+    ac->state_count = n;
+    return p - ac->image;
+}
+
+/**
+ * @brief Follow the edge of a non-root state for a byte
+ *
+ * @return Target state, 0 if there is no such edge
+ */
+static uint16_t step(const struct keyword_automaton* ac, uint16_t state, uint8_t c)
+{
+    for (uint16_t i = ac->first_edge[state]; i < ac->first_edge[state + 1]; i++) {
+        if (ac->edge_char[i] == c) {
+            return ac->edge_target[i];
+        }
+        if (ac->edge_char[i] > c) {
+            break; /* Edges are sorted */
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Fill the root transition table from the root's edges
+ */
+static void fill_root_table(struct keyword_automaton* ac)
+{
+    memset(ac->root_next, 0, sizeof(ac->root_next));
+    for (uint16_t i = ac->first_edge[0]; i < ac->first_edge[1]; i++) {
+        ac->root_next[ac->edge_char[i]] = ac->edge_target[i];
+    }
+}
+
+/**
+ * @brief Find or create the child of a trie state for a byte
+ *
+ * Children are kept sorted by byte.
+ *
+ * @return Child state, 0 if the state limit is reached
+ */
+static uint16_t trie_child(uint16_t state, uint8_t c, uint16_t* count)
+{
+    uint16_t prev = 0;
+    uint16_t cur = trie.child[state];
+    uint16_t node;
+
+    while (cur && trie.in_char[cur] < c) {
+        prev = cur;
+        cur = trie.sibling[cur];
+    }
+    if (cur && trie.in_char[cur] == c) {
+        return cur;
+    }
+    if (*count >= KEYWORDS_MAX_STATES) {
+        return 0;
+    }
+
+    node = (*count)++;
+    trie.child[node] = 0;
+    trie.sibling[node] = cur;
+    trie.in_char[node] = c;
+    trie.keyword[node] = KEYWORDS_NO_ID;
+    if (prev) {
+        trie.sibling[prev] = node;
+    } else {
+        trie.child[state] = node;
+    }
+    return node;
+}
+
+int keywords_build(struct keyword_automaton* ac, const struct keyword* words, size_t count,
+    uint32_t tag)
+{
+    uint16_t n = 1;
+    uint16_t e = 0;
+    uint16_t head = 0, tail = 1;
+    uint16_t* first_edge;
+    uint16_t* fail;
+    uint16_t* out;
+    uint16_t* edge_target;
+    uint8_t* keyword;
+    uint8_t* edge_char;
+
+    trie.child[0] = 0;
+    trie.keyword[0] = KEYWORDS_NO_ID;
+
+    for (size_t i = 0; i < count; i++) {
+        uint16_t state = 0;
+
+        if (words[i].len == 0 || words[i].id >= KEYWORDS_MAX_IDS) {
+            return -EINVAL;
+        }
+        for (uint8_t j = 0; j < words[i].len; j++) {
+            state = trie_child(state, words[i].bytes[j], &n);
+            if (!state) {
+                return -E2BIG;
+            }
+        }
+        if (trie.keyword[state] == KEYWORDS_NO_ID) {
+            trie.keyword[state] = words[i].id;
+        }
+    }
+
+    /* Breadth-first renumbering */
+    trie.order[0] = 0;
+    while (head < tail) {
+        for (uint16_t c = trie.child[trie.order[head++]]; c; c = trie.sibling[c]) {
+            trie.order[tail++] = c;
+        }
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        trie.new_id[trie.order[i]] = i;
+    }
+
+    layout(ac, n, n - 1);
+    first_edge = (uint16_t*)ac->first_edge;
+    fail = (uint16_t*)ac->fail;
+    out = (uint16_t*)ac->out;
+    edge_target = (uint16_t*)ac->edge_target;
+    keyword = (uint8_t*)ac->keyword;
+    edge_char = (uint8_t*)ac->edge_char;
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t old = trie.order[i];
+
+        first_edge[i] = e;
+        keyword[i] = trie.keyword[old];
+        for (uint16_t c = trie.child[old]; c; c = trie.sibling[c]) {
+            edge_char[e] = trie.in_char[c];
+            edge_target[e] = trie.new_id[c];
+            e++;
+        }
+    }
+    first_edge[n] = e;
+    fill_root_table(ac);
+
+    /* Fail links: longest proper suffix that is also a trie path */
+    fail[0] = 0;
+    out[0] = 0;
+    for (uint16_t s = 0; s < n; s++) {
+        for (uint16_t i = first_edge[s]; i < first_edge[s + 1]; i++) {
+            uint16_t t = edge_target[i];
+            uint8_t c = edge_char[i];
+            uint16_t f = fail[s];
+
+            if (s == 0) {
+                fail[t] = 0;
+            } else {
+                for (;;) {
+                    uint16_t g = f ? step(ac, f, c) : ac->root_next[c];
+
+                    if (g || !f) {
+                        fail[t] = g;
+                        break;
+                    }
+                    f = fail[f];
+                }
+            }
+            out[t] = (keyword[fail[t]] != KEYWORDS_NO_ID) ? fail[t] : out[fail[t]];
+        }
+    }
+
+    memcpy(&ac->image[0], &tag, sizeof(tag));
+    memcpy(&ac->image[4], &n, sizeof(n));
+    memcpy(&ac->image[6], &e, sizeof(e));
+    return 0;
+}
+
+int keywords_load_image(struct keyword_automaton* ac, size_t len)
+{
+    uint16_t n, e;
+
+    if (len < KEYWORDS_IMAGE_HEADER_LEN) {
+        return -EINVAL;
+    }
+
+    memcpy(&n, &ac->image[4], sizeof(n));
+    memcpy(&e, &ac->image[6], sizeof(e));
+    if (n == 0 || n > KEYWORDS_MAX_STATES || e != n - 1 || layout(ac, n, e) != len) {
+        ac->state_count = 0;
+        return -EINVAL;
+    }
+
+    /* The root ends no keyword and its links end the chains */
+    if (ac->first_edge[0] != 0 || ac->first_edge[n] != e || ac->fail[0] != 0 || ac->out[0] != 0
+        || ac->keyword[0] != KEYWORDS_NO_ID) {
+        goto invalid;
+    }
+    /* Lower numbered links guarantee every fail chain ends at the root, and
+     * out links must lead to states ending a keyword */
+    for (uint16_t s = 0; s < n; s++) {
+        if (ac->first_edge[s] > ac->first_edge[s + 1]
+            || (s > 0 && (ac->fail[s] >= s || ac->out[s] >= s))
+            || (ac->out[s] != 0 && ac->keyword[ac->out[s]] == KEYWORDS_NO_ID)
+            || (ac->keyword[s] != KEYWORDS_NO_ID && ac->keyword[s] >= KEYWORDS_MAX_IDS)) {
+            goto invalid;
+        }
+    }
+    for (uint16_t i = 0; i < e; i++) {
+        if (ac->edge_target[i] == 0 || ac->edge_target[i] >= n) {
+            goto invalid;
+        }
+    }
+
+    fill_root_table(ac);
+    return 0;
+
+invalid:
+    ac->state_count = 0;
+    return -EINVAL;
+}
+
+size_t keywords_image_len(const struct keyword_automaton* ac)
+{
+    uint16_t n = ac->state_count;
+
+    if (n == 0) {
+        return 0;
+    }
+    return KEYWORDS_IMAGE_HEADER_LEN + 2 + n * 7 + (n - 1) * 3;
+}
+
+uint32_t keywords_image_tag(const struct keyword_automaton* ac)
+{
+    uint32_t tag;
+
+    memcpy(&tag, &ac->image[0], sizeof(tag));
+    return tag;
+}
+
+int keywords_find(const struct keyword_automaton* ac, const uint8_t* word, size_t len)
+{
+    uint16_t state;
+
+    if (ac->state_count == 0 || len == 0) {
+        return -ENOENT;
+    }
+
+    state = ac->root_next[word[0]];
+    for (size_t i = 1; i < len && state; i++) {
+        state = step(ac, state, word[i]);
+    }
+
+    if (!state || ac->keyword[state] == KEYWORDS_NO_ID) {
+        return -ENOENT;
+    }
+    return ac->keyword[state];
+}
+
+void keywords_scan(const struct keyword_automaton* ac, const char* text, size_t len,
+    uint32_t* hits)
+{
+    uint16_t state = 0;
+
+    if (ac->state_count <= 1) {
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)text[i];
+        uint16_t match;
+
+        for (;;) {
+            uint16_t next;
+
+            if (state == 0) {
+                state = ac->root_next[c];
+                break;
+            }
+            next = step(ac, state, c);
+            if (next) {
+                state = next;
+                break;
+            }
+            state = ac->fail[state];
+        }
+
+        match = (ac->keyword[state] != KEYWORDS_NO_ID) ? state : ac->out[state];
+        while (match) {
+            uint8_t id = ac->keyword[match];
+
+            hits[id / 32] |= 1U << (id % 32);
+            match = ac->out[match];
+        }
+    }
+}
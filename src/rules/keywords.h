@@ -0,0 +1,162 @@
+/**
+ * @file keywords.h
+ * @brief Multi-Keyword Matcher Header
+ *
+ * Aho-Corasick automaton over the keywords of the filter rules, so a text is
+ * scanned once for all keywords instead of once per keyword.
+ *
+ * The automaton lives in a compact image (header, then flat state and edge
+ * arrays) that is used in place for matching and can be stored in flash as
+ * is. Edges are kept sparse, sorted per state, with a full transition table
+ * only for the root state.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum automaton states (total keyword bytes + 1) */
+#define KEYWORDS_MAX_STATES 512
+
+/** @brief Keyword ids must be below this */
+#define KEYWORDS_MAX_IDS 96
+
+/** @brief Words in a hits bitmap */
+#define KEYWORDS_HITS_WORDS ((KEYWORDS_MAX_IDS + 31) / 32)
+
+/** @brief State without a keyword ending on it */
+#define KEYWORDS_NO_ID 0xFF
+
+/** @brief Image header length */
+#define KEYWORDS_IMAGE_HEADER_LEN 8
+
+/** @brief Largest image: 7 bytes per state, 3 per edge, plus header */
+#define KEYWORDS_MAX_IMAGE_LEN \
+    (KEYWORDS_IMAGE_HEADER_LEN + 2 + KEYWORDS_MAX_STATES * 7 + (KEYWORDS_MAX_STATES - 1) * 3)
+
+/**
+ * @brief Keyword to insert into the automaton
+ */
+struct keyword {
+    const uint8_t* bytes; /**< Keyword bytes, not NUL terminated */
+    uint8_t len; /**< Keyword length, must not be 0 */
+    uint8_t id; /**< Id reported in the hits bitmap */
+};
+
+/**
+ * @brief Keyword automaton
+ *
+ * Image layout (little endian host order, 2-byte aligned):
+ *   u32 tag | u16 state count (n) | u16 edge count (e)
+ *   u16 first_edge[n + 1] | u16 fail[n] | u16 out[n] | u16 edge_target[e]
+ *   u8 keyword[n] | u8 edge_char[e]
+ *
+ * States are numbered in breadth-first order, so fail and out links always
+ * point to lower numbered states.
+ */
+struct keyword_automaton {
+    /* Views into the image, set by build and load */
+    const uint16_t* first_edge;
+    const uint16_t* fail;
+    const uint16_t* out; /**< Next state on the fail chain ending a keyword */
+    const uint16_t* edge_target;
+    const uint8_t* keyword;
+    const uint8_t* edge_char;
+    uint16_t state_count;
+    uint16_t root_next[256]; /**< Full root transition table, rebuilt on load */
+
+    /** @brief Compact image, used in place and suitable for storing */
+    union {
+        uint8_t image[KEYWORDS_MAX_IMAGE_LEN];
+        uint32_t align;
+    };
+};
+
+/**
+ * @brief Build the automaton from a set of keywords
+ *
+ * Keywords with equal bytes share a state; the first one's id is reported.
+ * Use keywords_find() to map each keyword to its reported id.
+ *
+ * @param ac Automaton to build
+ * @param words Keywords
+ * @param count Number of keywords
+ * @param tag Opaque value stored in the image header
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Empty keyword or id out of range
+ * @retval -E2BIG Keywords need more than KEYWORDS_MAX_STATES states
+ */
+int keywords_build(struct keyword_automaton* ac, const struct keyword* words, size_t count,
+    uint32_t tag);
+
+/**
+ * @brief Validate an image written to ac->image and prepare it for matching
+ *
+ * @param ac Automaton whose image holds the data
+ * @param len Image length
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Malformed image
+ */
+int keywords_load_image(struct keyword_automaton* ac, size_t len);
+
+/**
+ * @brief Get the used length of the image
+ *
+ * @param ac Automaton
+ * @return Image length in bytes, 0 if the automaton is empty
+ */
+size_t keywords_image_len(const struct keyword_automaton* ac);
+
+/**
+ * @brief Get the tag stored in the image header
+ *
+ * @param ac Automaton
+ * @return Tag passed to keywords_build()
+ */
+uint32_t keywords_image_tag(const struct keyword_automaton* ac);
+
+/**
+ * @brief Look up the id reported for a keyword
+ *
+ * @param ac Automaton
+ * @param word Keyword bytes
+ * @param len Keyword length
+ * @return Reported id, negative if the keyword is not in the automaton
+ */
+int keywords_find(const struct keyword_automaton* ac, const uint8_t* word, size_t len);
+
+/**
+ * @brief Scan a text and set the bit of every keyword it contains
+ *
+ * @param ac Automaton
+ * @param text Text to scan
+ * @param len Text length
+ * @param hits Bitmap of KEYWORDS_HITS_WORDS words, bits are only set
+ */
+void keywords_scan(const struct keyword_automaton* ac, const char* text, size_t len,
+    uint32_t* hits);
+
+/**
+ * @brief Check a keyword id in a hits bitmap
+ */
+static inline bool keywords_hit(const uint32_t* hits, uint8_t id)
+{
+    return (hits[id / 32] >> (id % 32)) & 1U;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEYWORDS_H */
@@ -0,0 +1,919 @@
+/**
+ * @file rules.c
+ * @brief Notification Filter Rules Engine Implementation
+ *
+ * Programs are validated once when loaded and indexed (string and rule
+ * offsets), so evaluation runs without any bounds checks. Per notification,
+ * the fields are lowercased once into scratch buffers and the rules are then
+ * walked in order until one matches.
+ *
+ * Keyword ops (sender/content contains) do not search per keyword: all
+ * keywords of the program go into one automaton, and sender and content are
+ * each scanned once per notification into a hits bitmap that the ops test.
+ *
+ * The active program and its keyword automaton image are persisted with the
+ * settings subsystem so rules survive a reboot without the phone re-sending
+ * them, and the automaton is not rebuilt at boot.
+ *
+ * All functions are expected to be called from the main loop thread.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+
+#include "rules/keywords.h"
+#include "rules/rules.h"
+
+LOG_MODULE_REGISTER(rules, LOG_LEVEL_INF);
+
+/** @brief Program header length */
+#define RULES_HEADER_LEN 5
+
+/** @brief Settings key of the persisted program */
+#define RULES_SETTINGS_KEY "rules/program"
+
+/** @brief Settings key of the persisted keyword automaton image */
+#define RULES_KEYWORDS_SETTINGS_KEY "rules/keywords"
+
+/* String indexes are used as keyword ids */
+BUILD_ASSERT(RULES_MAX_STRINGS <= KEYWORDS_MAX_IDS, "keyword ids cannot hold all strings");
+
+/** @brief Scratch sizes for lowercased fields, match the notification store */
+#define LOWER_APP_LEN 32
+#define LOWER_SENDER_LEN 64
+#define LOWER_CONTENT_LEN 256
+
+/**
+ * @brief Validated and indexed rules program
+ */
+struct rules_program {
+    uint8_t code[RULES_MAX_PROGRAM_LEN];
+    size_t len;
+    uint8_t string_count;
+    uint8_t rule_count;
+    uint16_t string_offset[RULES_MAX_STRINGS]; /**< Offset of each string's length byte */
+    uint16_t rule_offset[RULES_MAX_RULES]; /**< Offset of each rule's action byte */
+    const struct keyword_automaton* keywords; /**< NULL to search keywords one by one */
+    uint8_t keyword_id[RULES_MAX_STRINGS]; /**< Id reported by the automaton per string */
+};
+
+/**
+ * @brief Notification fields prepared for matching
+ */
+struct lowered_input {
+    char app[LOWER_APP_LEN];
+    size_t app_len;
+    char sender[LOWER_SENDER_LEN];
+    size_t sender_len;
+    char content[LOWER_CONTENT_LEN];
+    size_t content_len;
+    uint8_t category;
+    uint16_t minute_of_day;
+    uint32_t sender_hits[KEYWORDS_HITS_WORDS]; /**< Keywords found in the sender */
+    uint32_t content_hits[KEYWORDS_HITS_WORDS]; /**< Keywords found in the content */
+};
+
+static struct rules_program active_program;
+static struct keyword_automaton active_keywords;
+static struct lowered_input scratch;
+static struct rules_stats stats;
+
+/* Chunked transfer staging */
+static uint8_t staging[RULES_MAX_PROGRAM_LEN];
+static uint16_t staging_len;
+static uint16_t staging_total;
+
+static const char* const action_names[RULE_ACTION_COUNT] = {
+    [RULE_ACTION_NONE] = "none",
+    [RULE_ACTION_DROP] = "drop",
+    [RULE_ACTION_SILENT] = "silent",
+    [RULE_ACTION_PRIORITY] = "priority",
+    [RULE_ACTION_COALESCE] = "coalesce",
+};
+
+/**
+ * @brief Get the operand length of an op code
+ *
+ * @param op Op code without RULE_OP_NOT
+ * @return Operand length in bytes, negative if the op code is unknown
+ */
+static int op_operand_len(uint8_t op)
+{
+    switch (op) {
+    case RULE_OP_APP_IS:
+    case RULE_OP_SENDER_IS:
+    case RULE_OP_SENDER_HAS:
+    case RULE_OP_CONTENT_HAS:
+    case RULE_OP_CATEGORY_IS:
+        return 1;
+    case RULE_OP_TIME_IN:
+        return 4;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Check if an op code takes a string operand
+ *
+ * @param op Op code without RULE_OP_NOT
+ * @return true if the operand is a string index
+ */
+static bool op_takes_string(uint8_t op)
+{
+    return op == RULE_OP_APP_IS || op == RULE_OP_SENDER_IS || op == RULE_OP_SENDER_HAS
+        || op == RULE_OP_CONTENT_HAS;
+}
+
+/**
+ * @brief Validate a program and build its index
+ *
+ * @param prog Output program, code must already hold the bytecode
+ * @param len Program length in bytes
+ * @return 0 on success, negative error code on malformed programs
+ */
+static int index_program(struct rules_program* prog, size_t len)
+{
+    const uint8_t* code = prog->code;
+    size_t pos = RULES_HEADER_LEN;
+
+    prog->len = len;
+    prog->string_count = 0;
+    prog->rule_count = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    if (len < RULES_HEADER_LEN || code[0] != RULES_MAGIC_0 || code[1] != RULES_MAGIC_1) {
+        return -EINVAL;
+    }
+    if (code[2] != RULES_VERSION) {
+        LOG_WRN("Unsupported rules version %u", code[2]);
+        return -EINVAL;
+    }
+    if (code[3] > RULES_MAX_STRINGS || code[4] > RULES_MAX_RULES) {
+        return -E2BIG;
+    }
+
+    for (int i = 0; i < code[3]; i++) {
+        if (pos >= len || pos + 1 + code[pos] > len) {
+            return -EINVAL;
+        }
+        prog->string_offset[i] = pos;
+        pos += 1 + code[pos];
+    }
+
+    for (int i = 0; i < code[4]; i++) {
+        uint8_t op_count;
+
+        if (pos + 2 > len || code[pos] == RULE_ACTION_NONE || code[pos] >= RULE_ACTION_COUNT) {
+            return -EINVAL;
+        }
+        prog->rule_offset[i] = pos;
+        op_count = code[pos + 1];
+        pos += 2;
+
+        for (int j = 0; j < op_count; j++) {
+            uint8_t op;
+            int operand_len;
+
+            if (pos >= len) {
+                return -EINVAL;
+            }
+            op = code[pos] & ~RULE_OP_NOT;
+            operand_len = op_operand_len(op);
+            if (operand_len < 0 || pos + 1 + operand_len > len) {
+                return -EINVAL;
+            }
+            if (op_takes_string(op) && code[pos + 1] >= code[3]) {
+                return -EINVAL;
+            }
+            pos += 1 + operand_len;
+        }
+    }
+
+    if (pos != len) {
+        return -EINVAL;
+    }
+
+    prog->string_count = code[3];
+    prog->rule_count = code[4];
+    return 0;
+}
+
+/**
+ * @brief Copy a field lowercased into a scratch buffer
+ *
+ * @return Number of bytes copied
+ */
+static size_t copy_lower(char* dst, size_t dst_size, const char* src, size_t src_len)
+{
+    size_t n = MIN(src_len, dst_size);
+
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (char)tolower((unsigned char)src[i]);
+    }
+    return n;
+}
+
+/**
+ * @brief Check if a buffer contains a substring
+ */
+static bool contains(const char* hay, size_t hay_len, const uint8_t* needle, size_t needle_len)
+{
+    if (needle_len == 0) {
+        return true;
+    }
+
+    for (size_t i = 0; i + needle_len <= hay_len; i++) {
+        if (hay[i] == (char)needle[0] && memcmp(&hay[i], needle, needle_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Check a keyword op against the prepared fields
+ *
+ * @param prog Program holding the op
+ * @param in Prepared notification fields
+ * @param index String index of the keyword
+ * @param str Keyword bytes
+ * @param str_len Keyword length
+ * @param in_content true to also look in the content, not just the sender
+ * @return true if the keyword was found
+ */
+static bool has_keyword(const struct rules_program* prog, const struct lowered_input* in,
+    uint8_t index, const uint8_t* str, size_t str_len, bool in_content)
+{
+    if (str_len == 0) {
+        return true;
+    }
+
+    if (prog->keywords) {
+        uint8_t id = prog->keyword_id[index];
+
+        return keywords_hit(in->sender_hits, id) || (in_content && keywords_hit(in->content_hits, id));
+    }
+
+    return contains(in->sender, in->sender_len, str, str_len)
+        || (in_content && contains(in->content, in->content_len, str, str_len));
+}
+
+/**
+ * @brief Check if a buffer equals a string
+ */
+static bool equals(const char* field, size_t field_len, const uint8_t* str, size_t str_len)
+{
+    return field_len == str_len && memcmp(field, str, str_len) == 0;
+}
+
+/**
+ * @brief Evaluate a single op against prepared fields
+ *
+ * @param prog Program holding the op
+ * @param pc Offset of the op code, advanced past the op
+ * @param in Prepared notification fields
+ * @return true if the op (including its negation) matches
+ */
+static bool eval_op(const struct rules_program* prog, size_t* pc, const struct lowered_input* in)
+{
+    const uint8_t* code = prog->code;
+    uint8_t raw = code[*pc];
+    uint8_t op = raw & ~RULE_OP_NOT;
+    const uint8_t* operand = &code[*pc + 1];
+    const uint8_t* str = NULL;
+    size_t str_len = 0;
+    bool match = false;
+
+    if (op_takes_string(op)) {
+        uint16_t off = prog->string_offset[operand[0]];
+
+        str_len = code[off];
+        str = &code[off + 1];
+    }
+
+    switch (op) {
+    case RULE_OP_APP_IS:
+        match = equals(in->app, in->app_len, str, str_len);
+        break;
+    case RULE_OP_SENDER_IS:
+        match = equals(in->sender, in->sender_len, str, str_len);
+        break;
+    case RULE_OP_SENDER_HAS:
+        match = has_keyword(prog, in, operand[0], str, str_len, false);
+        break;
+    case RULE_OP_CONTENT_HAS:
+        match = has_keyword(prog, in, operand[0], str, str_len, true);
+        break;
+    case RULE_OP_CATEGORY_IS:
+        match = in->category == operand[0];
+        break;
+    case RULE_OP_TIME_IN: {
+        uint16_t start = operand[0] | (operand[1] << 8);
+        uint16_t end = operand[2] | (operand[3] << 8);
+
+        if (start <= end) {
+            match = in->minute_of_day >= start && in->minute_of_day < end;
+        } else {
+            match = in->minute_of_day >= start || in->minute_of_day < end;
+        }
+    } break;
+    default:
+        break;
+    }
+
+    *pc += 1 + op_operand_len(op);
+    return (raw & RULE_OP_NOT) ? !match : match;
+}
+
+/**
+ * @brief Evaluate a program against prepared fields
+ *
+ * @return Action of the first matching rule
+ */
+static rule_action_t eval_program(const struct rules_program* prog, const struct lowered_input* in)
+{
+    for (int i = 0; i < prog->rule_count; i++) {
+        size_t pc = prog->rule_offset[i];
+        uint8_t action = prog->code[pc];
+        uint8_t op_count = prog->code[pc + 1];
+        bool match = true;
+
+        pc += 2;
+        for (int j = 0; j < op_count; j++) {
+            /* All ops must match, skip the rest of the rule on the first miss */
+            if (!eval_op(prog, &pc, in)) {
+                match = false;
+                break;
+            }
+        }
+
+        if (match) {
+            return (rule_action_t)action;
+        }
+    }
+
+    return RULE_ACTION_NONE;
+}
+
+/**
+ * @brief Prepare notification fields for matching
+ */
+static void prepare_input(struct lowered_input* out, const struct rules_input* in,
+    const struct rules_program* prog)
+{
+    out->app_len = copy_lower(out->app, sizeof(out->app), in->app, in->app_len);
+    out->sender_len = copy_lower(out->sender, sizeof(out->sender), in->sender, in->sender_len);
+    out->content_len = copy_lower(out->content, sizeof(out->content), in->content, in->content_len);
+    out->category = in->category;
+    out->minute_of_day = in->minute_of_day;
+
+    if (prog->keywords) {
+        memset(out->sender_hits, 0, sizeof(out->sender_hits));
+        memset(out->content_hits, 0, sizeof(out->content_hits));
+        keywords_scan(prog->keywords, out->sender, out->sender_len, out->sender_hits);
+        keywords_scan(prog->keywords, out->content, out->content_len, out->content_hits);
+    }
+}
+
+/**
+ * @brief Collect the keywords of a program's keyword ops
+ *
+ * @param prog Indexed program
+ * @param words Output, RULES_MAX_STRINGS entries
+ * @return Number of distinct keyword strings
+ */
+static size_t collect_keywords(const struct rules_program* prog, struct keyword* words)
+{
+    uint32_t seen[KEYWORDS_HITS_WORDS] = { 0 };
+    size_t count = 0;
+
+    for (int i = 0; i < prog->rule_count; i++) {
+        size_t pc = prog->rule_offset[i];
+        uint8_t op_count = prog->code[pc + 1];
+
+        pc += 2;
+        for (int j = 0; j < op_count; j++) {
+            uint8_t op = prog->code[pc] & ~RULE_OP_NOT;
+            uint8_t index = prog->code[pc + 1];
+
+            if ((op == RULE_OP_SENDER_HAS || op == RULE_OP_CONTENT_HAS)
+                && !keywords_hit(seen, index)) {
+                uint16_t off = prog->string_offset[index];
+
+                seen[index / 32] |= 1U << (index % 32);
+                if (prog->code[off] > 0) {
+                    words[count].bytes = &prog->code[off + 1];
+                    words[count].len = prog->code[off];
+                    words[count].id = index;
+                    count++;
+                }
+            }
+            pc += 1 + op_operand_len(op);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Use an automaton for a program's keyword ops
+ *
+ * @param prog Indexed program
+ * @param ac Automaton built from the program's keywords
+ * @return 0 on success, -ENOENT if a keyword is missing from the automaton
+ */
+static int attach_keywords(struct rules_program* prog, const struct keyword_automaton* ac)
+{
+    static struct keyword words[RULES_MAX_STRINGS];
+    size_t count = collect_keywords(prog, words);
+
+    prog->keywords = NULL;
+    if (count == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int id = keywords_find(ac, words[i].bytes, words[i].len);
+
+        if (id < 0) {
+            return -ENOENT;
+        }
+        prog->keyword_id[words[i].id] = (uint8_t)id;
+    }
+
+    prog->keywords = ac;
+    return 0;
+}
+
+/**
+ * @brief Build the keyword automaton of a program
+ *
+ * Programs whose keywords do not fit fall back to searching each keyword.
+ *
+ * @param prog Indexed program
+ * @param ac Automaton to build
+ */
+static void build_keywords(struct rules_program* prog, struct keyword_automaton* ac)
+{
+    static struct keyword words[RULES_MAX_STRINGS];
+    size_t count = collect_keywords(prog, words);
+    int ret;
+
+    prog->keywords = NULL;
+    ac->state_count = 0;
+    if (count == 0) {
+        return;
+    }
+
+    ret = keywords_build(ac, words, count, crc32_ieee(prog->code, prog->len));
+    if (ret < 0) {
+        LOG_WRN("Keyword automaton unavailable, searching per keyword (ret: %d)", ret);
+        ac->state_count = 0;
+        return;
+    }
+
+    attach_keywords(prog, ac);
+    LOG_INF("Keyword automaton: %u keywords, %u states, %u bytes", (unsigned int)count,
+        ac->state_count, (unsigned int)keywords_image_len(ac));
+}
+
+/**
+ * @brief Store or remove the active keyword automaton image
+ */
+static void persist_keywords(void)
+{
+    size_t len = keywords_image_len(&active_keywords);
+    int ret;
+
+    if (!IS_ENABLED(CONFIG_SETTINGS)) {
+        return;
+    }
+
+    ret = (active_program.keywords && len > 0)
+        ? settings_save_one(RULES_KEYWORDS_SETTINGS_KEY, active_keywords.image, len)
+        : settings_delete(RULES_KEYWORDS_SETTINGS_KEY);
+    if (ret < 0) {
+        LOG_WRN("Failed to persist keyword automaton (ret: %d)", ret);
+    }
+}
+
+/**
+ * @brief Validate and activate a program
+ *
+ * @param program Bytecode program
+ * @param len Program length
+ * @param with_keywords true to build the keyword automaton now
+ * @param persist true to store program and automaton in flash
+ */
+static int load_program(const uint8_t* program, size_t len, bool with_keywords, bool persist)
+{
+    static struct rules_program candidate;
+    int ret;
+
+    if (len > RULES_MAX_PROGRAM_LEN) {
+        return -E2BIG;
+    }
+
+    if (len > 0) {
+        memcpy(candidate.code, program, len);
+    }
+    ret = index_program(&candidate, len);
+    if (ret < 0) {
+        LOG_ERR("Rejected rules program (len: %u, ret: %d)", (unsigned int)len, ret);
+        return ret;
+    }
+
+    active_program = candidate;
+    active_program.keywords = NULL;
+    LOG_INF("Loaded %u rules (%u bytes)", active_program.rule_count, (unsigned int)len);
+
+    if (with_keywords) {
+        build_keywords(&active_program, &active_keywords);
+    }
+
+    if (persist && IS_ENABLED(CONFIG_SETTINGS)) {
+        ret = (len > 0) ? settings_save_one(RULES_SETTINGS_KEY, program, len)
+                        : settings_delete(RULES_SETTINGS_KEY);
+        if (ret < 0) {
+            LOG_WRN("Failed to persist rules (ret: %d)", ret);
+        }
+        persist_keywords();
+    }
+
+    return 0;
+}
+
+int rules_load(const uint8_t* program, size_t len, bool persist)
+{
+    return load_program(program, len, true, persist);
+}
+
+int rules_receive_chunk(uint16_t offset, uint16_t total, const uint8_t* data, size_t len)
+{
+    int ret;
+
+    if (total > RULES_MAX_PROGRAM_LEN) {
+        return -E2BIG;
+    }
+
+    /* A chunk at offset 0 always restarts the transfer */
+    if (offset == 0) {
+        staging_len = 0;
+        staging_total = total;
+    }
+
+    if (offset != staging_len || total != staging_total || offset + len > total) {
+        LOG_WRN("Out of order rules chunk (offset: %u, expected: %u)", offset, staging_len);
+        staging_len = 0;
+        staging_total = 0;
+        return -EINVAL;
+    }
+
+    memcpy(&staging[offset], data, len);
+    staging_len += len;
+
+    if (staging_len < staging_total) {
+        return 0;
+    }
+
+    ret = rules_load(staging, staging_total, true);
+    staging_len = 0;
+    staging_total = 0;
+    return (ret < 0) ? ret : 1;
+}
+
+void rules_reset(void)
+{
+    load_program(NULL, 0, true, false);
+    staging_len = 0;
+    staging_total = 0;
+}
+
+rule_action_t rules_evaluate(const struct rules_input* input)
+{
+    uint32_t start_cycles;
+    rule_action_t action;
+
+    if (!input || active_program.rule_count == 0) {
+        return RULE_ACTION_NONE;
+    }
+
+    start_cycles = k_cycle_get_32();
+    prepare_input(&scratch, input, &active_program);
+    action = eval_program(&active_program, &scratch);
+
+    stats.total_eval_ns += k_cyc_to_ns_floor64(k_cycle_get_32() - start_cycles);
+    stats.evaluations++;
+    stats.actions[action]++;
+
+    return action;
+}
+
+int rules_get_count(void)
+{
+    return active_program.rule_count;
+}
+
+void rules_get_stats(struct rules_stats* out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
+
+const char* rules_action_name(rule_action_t action)
+{
+    if (action >= RULE_ACTION_COUNT) {
+        return "unknown";
+    }
+    return action_names[action];
+}
+
+#if defined(CONFIG_SETTINGS)
+/* Settings load state, resolved in rules_settings_commit() */
+static bool program_restored;
+static bool keywords_restored;
+
+/**
+ * @brief Restore the persisted program and keyword automaton at settings load
+ */
+static int rules_settings_set(const char* name, size_t len, settings_read_cb read_cb, void* cb_arg)
+{
+    const char* next;
+    ssize_t read_len;
+    int ret;
+
+    if (settings_name_steq(name, "program", &next) && !next) {
+        if (len > RULES_MAX_PROGRAM_LEN) {
+            return -E2BIG;
+        }
+
+        read_len = read_cb(cb_arg, staging, len);
+        if (read_len < 0) {
+            return (int)read_len;
+        }
+
+        /* The automaton is restored or rebuilt once everything is loaded */
+        ret = load_program(staging, (size_t)read_len, false, false);
+        program_restored = (ret == 0);
+        return ret;
+    }
+
+    if (settings_name_steq(name, "keywords", &next) && !next) {
+        if (len > sizeof(active_keywords.image)) {
+            return -E2BIG;
+        }
+
+        read_len = read_cb(cb_arg, active_keywords.image, len);
+        if (read_len < 0) {
+            return (int)read_len;
+        }
+
+        keywords_restored = (keywords_load_image(&active_keywords, (size_t)read_len) == 0);
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+/**
+ * @brief Attach the restored automaton, or rebuild it if it is stale
+ */
+static int rules_settings_commit(void)
+{
+    bool restored = keywords_restored;
+
+    keywords_restored = false;
+    if (!program_restored) {
+        return 0;
+    }
+    program_restored = false;
+
+    if (restored
+        && keywords_image_tag(&active_keywords) == crc32_ieee(active_program.code, active_program.len)
+        && attach_keywords(&active_program, &active_keywords) == 0) {
+        LOG_INF("Keyword automaton restored (%u states)", active_keywords.state_count);
+        return 0;
+    }
+
+    build_keywords(&active_program, &active_keywords);
+    persist_keywords();
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(rules, "rules", NULL, rules_settings_set, rules_settings_commit, NULL);
+#endif /* CONFIG_SETTINGS */
+
+#if defined(CONFIG_SHELL)
+#include <stdio.h>
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+
+/** @brief Benchmark dimensions */
+#define BENCH_RULES 50
+#define BENCH_NOTIFICATIONS 1000
+
+/**
+ * @brief Append a string to a program under construction
+ */
+static size_t bench_put_string(uint8_t* code, size_t pos, const char* str)
+{
+    size_t len = strlen(str);
+
+    code[pos++] = (uint8_t)len;
+    memcpy(&code[pos], str, len);
+    return pos + len;
+}
+
+/**
+ * @brief Build a synthetic program of BENCH_RULES rules
+ *
+ * Each rule has its own string. Rules cycle through app, sender, keyword and
+ * app-plus-time-window conditions, with actions spread over all kinds.
+ */
+static size_t bench_build_program(uint8_t* code)
+{
+    char str[16];
+    size_t pos = RULES_HEADER_LEN;
+
+    code[0] = RULES_MAGIC_0;
+    code[1] = RULES_MAGIC_1;
+    code[2] = RULES_VERSION;
+    code[3] = BENCH_RULES;
+    code[4] = BENCH_RULES;
+
+    for (int i = 0; i < BENCH_RULES; i++) {
+        switch (i % 4) {
+        case 0:
+        case 3:
+            snprintf(str, sizeof(str), "app%02d", i);
+            break;
+        case 1:
+            snprintf(str, sizeof(str), "user%02d", i);
+            break;
+        default:
+            snprintf(str, sizeof(str), "kw%02d", i);
+            break;
+        }
+        pos = bench_put_string(code, pos, str);
+    }
+
+    for (int i = 0; i < BENCH_RULES; i++) {
+        code[pos++] = RULE_ACTION_DROP + (i % (RULE_ACTION_COUNT - 1));
+        switch (i % 4) {
+        case 0:
+            code[pos++] = 1;
+            code[pos++] = RULE_OP_APP_IS;
+            code[pos++] = i;
+            break;
+        case 1:
+            code[pos++] = 1;
+            code[pos++] = RULE_OP_SENDER_HAS;
+            code[pos++] = i;
+            break;
+        case 2:
+            code[pos++] = 1;
+            code[pos++] = RULE_OP_CONTENT_HAS;
+            code[pos++] = i;
+            break;
+        default:
+            code[pos++] = 2;
+            code[pos++] = RULE_OP_APP_IS;
+            code[pos++] = i;
+            code[pos++] = RULE_OP_TIME_IN;
+            code[pos++] = (22 * 60) & 0xFF;
+            code[pos++] = (22 * 60) >> 8;
+            code[pos++] = (7 * 60) & 0xFF;
+            code[pos++] = (7 * 60) >> 8;
+            break;
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * @brief Evaluate the benchmark notifications against a program
+ *
+ * @param sh Shell to print the results to
+ * @param prog Program to evaluate
+ * @param mode Keyword matching mode name for the report
+ */
+static void bench_run(const struct shell* sh, const struct rules_program* prog, const char* mode)
+{
+    static struct lowered_input bench_input;
+    uint32_t outcomes[RULE_ACTION_COUNT] = { 0 };
+    char app[16];
+    char sender[16];
+    char content[96];
+    uint64_t cycles = 0;
+
+    for (int i = 0; i < BENCH_NOTIFICATIONS; i++) {
+        struct rules_input in;
+        uint32_t start_cycles;
+        rule_action_t action;
+
+        /* About half of the notifications hit some rule */
+        snprintf(app, sizeof(app), "App%02d", i % 64);
+        snprintf(sender, sizeof(sender), "User%02d", (i * 7) % 80);
+        snprintf(content, sizeof(content),
+            "Message %d from the group chat, see you at the usual place kw%02d", i, (i * 13) % 90);
+
+        in.app = app;
+        in.app_len = strlen(app);
+        in.sender = sender;
+        in.sender_len = strlen(sender);
+        in.content = content;
+        in.content_len = strlen(content);
+        in.category = i % 6;
+        in.minute_of_day = (i * 17) % (24 * 60);
+
+        start_cycles = k_cycle_get_32();
+        prepare_input(&bench_input, &in, prog);
+        action = eval_program(prog, &bench_input);
+        cycles += k_cycle_get_32() - start_cycles;
+        outcomes[action]++;
+    }
+
+    shell_print(sh, "%s: %d notifications x %d rules (%u bytes): %llu us total, %u ns/notification",
+        mode, BENCH_NOTIFICATIONS, BENCH_RULES, (unsigned int)prog->len,
+        (unsigned long long)k_cyc_to_us_floor64(cycles),
+        (uint32_t)(k_cyc_to_ns_floor64(cycles) / BENCH_NOTIFICATIONS));
+    for (int i = 0; i < RULE_ACTION_COUNT; i++) {
+        shell_print(sh, "  %-9s %u", action_names[i], outcomes[i]);
+    }
+}
+
+static int cmd_rules_bench(const struct shell* sh, size_t argc, char** argv)
+{
+    static struct rules_program bench_program;
+    static struct keyword_automaton bench_keywords;
+    int ret;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    ret = index_program(&bench_program, bench_build_program(bench_program.code));
+    if (ret < 0) {
+        shell_error(sh, "Failed to build benchmark program (ret: %d)", ret);
+        return ret;
+    }
+
+    build_keywords(&bench_program, &bench_keywords);
+    if (bench_program.keywords) {
+        bench_run(sh, &bench_program, "automaton");
+    }
+
+    bench_program.keywords = NULL;
+    bench_run(sh, &bench_program, "per keyword");
+    return 0;
+}
+
+static int cmd_rules_stats(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "rules: %u (%u bytes), evaluations: %u, avg %u ns", active_program.rule_count,
+        (unsigned int)active_program.len, stats.evaluations,
+        stats.evaluations ? (uint32_t)(stats.total_eval_ns / stats.evaluations) : 0U);
+    for (int i = 0; i < RULE_ACTION_COUNT; i++) {
+        shell_print(sh, "  %-9s %u", action_names[i], stats.actions[i]);
+    }
+    if (active_program.keywords) {
+        shell_print(sh, "keywords: automaton, %u states, %u byte image", active_keywords.state_count,
+            (unsigned int)keywords_image_len(&active_keywords));
+    } else {
+        shell_print(sh, "keywords: per keyword search");
+    }
+    return 0;
+}
+
+static int cmd_rules_clear(const struct shell* sh, size_t argc, char** argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    rules_load(NULL, 0, true);
+    shell_print(sh, "Rules cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rules_cmds,
+    SHELL_CMD(bench, NULL, "Evaluate 1000 notifications against 50 rules", cmd_rules_bench),
+    SHELL_CMD(stats, NULL, "Show active rules and outcomes", cmd_rules_stats),
+    SHELL_CMD(clear, NULL, "Remove all rules", cmd_rules_clear),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(rules, &rules_cmds, "Notification filter rules", NULL);
+#endif /* CONFIG_SHELL */
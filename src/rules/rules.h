@@ -0,0 +1,173 @@
+/**
+ * @file rules.h
+ * @brief Notification Filter Rules Engine Header
+ *
+ * Evaluates filter rules compiled on the phone into a compact bytecode
+ * against every received notification, so muting and priority decisions are
+ * made on the watch without the phone re-sending anything.
+ *
+ * Program layout (all multi-byte values little endian):
+ *
+ *   magic 'Z' 'R' | version | string count | rule count
+ *   strings: { length, bytes[length] } x string count
+ *   rules:   { action, op count, ops... } x rule count
+ *
+ * Strings are lowercase. A rule matches when all of its ops match, and the
+ * first matching rule decides the action. Op codes:
+ *
+ *   RULE_OP_APP_IS      <string>         app name equals
+ *   RULE_OP_SENDER_IS   <string>         sender equals
+ *   RULE_OP_SENDER_HAS  <string>         sender contains
+ *   RULE_OP_CONTENT_HAS <string>         sender or content contains
+ *   RULE_OP_CATEGORY_IS <category>       phone notification category equals
+ *   RULE_OP_TIME_IN     <start> <end>    local time in [start, end) minutes,
+ *                                        wrapping past midnight if start > end
+ *
+ * Setting RULE_OP_NOT on an op code negates the op.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Program magic bytes */
+#define RULES_MAGIC_0 'Z'
+#define RULES_MAGIC_1 'R'
+
+/** @brief Supported program format version */
+#define RULES_VERSION 1
+
+/** @brief Program size and complexity limits */
+#define RULES_MAX_PROGRAM_LEN 2048
+#define RULES_MAX_STRINGS 96
+#define RULES_MAX_RULES 64
+
+/** @brief Rule op codes */
+#define RULE_OP_APP_IS 0x01
+#define RULE_OP_SENDER_IS 0x02
+#define RULE_OP_SENDER_HAS 0x03
+#define RULE_OP_CONTENT_HAS 0x04
+#define RULE_OP_CATEGORY_IS 0x05
+#define RULE_OP_TIME_IN 0x06
+#define RULE_OP_NOT 0x80
+
+/**
+ * @brief Rule actions
+ */
+typedef enum {
+    RULE_ACTION_NONE = 0, /**< No rule matched, deliver normally */
+    RULE_ACTION_DROP, /**< Discard the notification */
+    RULE_ACTION_SILENT, /**< Store without waking the display */
+    RULE_ACTION_PRIORITY, /**< Deliver as priority */
+    RULE_ACTION_COALESCE, /**< Merge into the newest notification of the same sender */
+    RULE_ACTION_COUNT
+} rule_action_t;
+
+/**
+ * @brief Notification fields a rule can match on
+ *
+ * Strings do not need to be NUL terminated.
+ */
+struct rules_input {
+    const char* app;
+    size_t app_len;
+    const char* sender;
+    size_t sender_len;
+    const char* content;
+    size_t content_len;
+    uint8_t category;
+    uint16_t minute_of_day;
+};
+
+/**
+ * @brief Rules engine statistics
+ */
+struct rules_stats {
+    uint32_t evaluations; /**< Notifications evaluated */
+    uint32_t actions[RULE_ACTION_COUNT]; /**< Outcomes per action */
+    uint64_t total_eval_ns; /**< Time spent evaluating */
+};
+
+/**
+ * @brief Validate and activate a rules program
+ *
+ * The program is copied. An empty program (len 0) removes all rules.
+ *
+ * @param program Bytecode program
+ * @param len Program length in bytes
+ * @param persist true to also store the program in flash
+ *
+ * @retval 0 Success
+ * @retval -EINVAL Malformed program, the active rules are kept
+ * @retval -E2BIG Program exceeds the size or complexity limits
+ */
+int rules_load(const uint8_t* program, size_t len, bool persist);
+
+/**
+ * @brief Receive one chunk of a rules program sent in pieces
+ *
+ * Chunks must arrive in order. The program is loaded and persisted once the
+ * last chunk completes it.
+ *
+ * @param offset Offset of this chunk within the program
+ * @param total Total program length
+ * @param data Chunk data
+ * @param len Chunk length
+ *
+ * @retval 0 Chunk accepted, more expected
+ * @retval 1 Program complete and loaded
+ * @retval Negative errno codes on out-of-order chunks or invalid programs
+ */
+int rules_receive_chunk(uint16_t offset, uint16_t total, const uint8_t* data, size_t len);
+
+/**
+ * @brief Remove all rules and drop a partly received program
+ *
+ * Flash is left alone, the rules persisted there come back at the next boot.
+ */
+void rules_reset(void);
+
+/**
+ * @brief Evaluate the active rules against a notification
+ *
+ * @param input Notification fields
+ * @return Action of the first matching rule, RULE_ACTION_NONE otherwise
+ */
+rule_action_t rules_evaluate(const struct rules_input* input);
+
+/**
+ * @brief Get the number of active rules
+ *
+ * @return Rule count
+ */
+int rules_get_count(void);
+
+/**
+ * @brief Get rules engine statistics
+ *
+ * @param stats Output for the statistics
+ */
+void rules_get_stats(struct rules_stats* stats);
+
+/**
+ * @brief Get a printable name for a rule action
+ *
+ * @param action Rule action
+ * @return Static string with the action name
+ */
+const char* rules_action_name(rule_action_t action);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RULES_H */
@@ -0,0 +1,67 @@
+/**
+ * @file trace.c
+ * @brief Notification Pipeline Tracepoints Implementation
+ *
+ * The render and flush stages come from LVGL's display events, sent around
+ * the flush callback, so they are traced the same with the panel driver on
+ * the watch and the dummy display on native_sim.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <zephyr/kernel.h>
+
+#include <lvgl.h>
+
+#include "trace/trace.h"
+
+#if defined(CONFIG_PIPELINE_TRACING)
+
+static void on_display_event(lv_event_t* e)
+{
+    const lv_area_t* area;
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_RENDER_START:
+        TRACE_POINT(RENDER_START, 0);
+        break;
+    case LV_EVENT_RENDER_READY:
+        TRACE_POINT(RENDER_END, 0);
+        break;
+    case LV_EVENT_FLUSH_START:
+        area = lv_event_get_param(e);
+        TRACE_POINT(FLUSH_START, area ? lv_area_get_width(area) * lv_area_get_height(area) : 0);
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+        TRACE_POINT(FLUSH_END, 0);
+        break;
+    default:
+        break;
+    }
+}
+
+void trace_init(void)
+{
+    static const lv_event_code_t codes[] = {
+        LV_EVENT_RENDER_START,
+        LV_EVENT_RENDER_READY,
+        LV_EVENT_FLUSH_START,
+        LV_EVENT_FLUSH_FINISH,
+    };
+    lv_display_t* display = lv_display_get_default();
+
+    if (!display) {
+        return;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(codes); i++) {
+        lv_display_add_event_cb(display, on_display_event, codes[i], NULL);
+    }
+}
+
+#else /* !CONFIG_PIPELINE_TRACING */
+
+void trace_init(void)
+{
+}
+
+#endif /* CONFIG_PIPELINE_TRACING */
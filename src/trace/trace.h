@@ -0,0 +1,95 @@
+/**
+ * @file trace.h
+ * @brief Notification Pipeline Tracepoints
+ *
+ * Marks the stages a notification goes through, from the phone's write to
+ * the panel, as Zephyr tracing named events, so a CTF trace shows where the
+ * time goes next to the kernel's thread and ISR events. Each event carries
+ * its tracepoint ID in arg0 and a stage value in arg1:
+ *
+ *   ID  Name          Where                                arg1
+ *   1   rx            Packet queued on a lane              source << 16 | length
+ *   2   parsed        Notification decoded, rules applied  notification key
+ *   3   stored        Notification in the store            notifications stored
+ *   4   ui_intent     Notification screen update posted    notification shown
+ *   5   render_start  LVGL starts rendering a frame        0
+ *   6   render_end    LVGL finished rendering it           0
+ *   7   flush_start   Area handed to the panel driver      pixels in the area
+ *   8   flush_end     Area transferred                     0
+ *
+ * IDs are stable: tools and scripts match on them, never renumber one, add
+ * new tracepoints with new IDs.
+ *
+ * With CONFIG_PIPELINE_TRACING off, TRACE_POINT() expands to nothing and
+ * its argument is not evaluated. Capture a trace on the watch over UART,
+ * a console on USB, and convert it with babeltrace or open it in Trace
+ * Compass with Zephyr's CTF metadata (subsys/tracing/ctf/tsdl/metadata):
+ *
+ *   west build -b esp32s3_touch_lcd_1_28/esp32s3/procpu -- \
+ *       -DEXTRA_CONF_FILE=tracing.conf -DEXTRA_DTC_OVERLAY_FILE=boards/tracing.overlay
+ *
+ * On native_sim, build any of the sim applications with
+ * -DPIPELINE_TRACING=ON, the trace is written to channel0_0.
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#if defined(CONFIG_PIPELINE_TRACING)
+#include <zephyr/tracing/tracing.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Tracepoint IDs and event names */
+#define TRACE_ID_RX 1
+#define TRACE_NAME_RX "rx"
+#define TRACE_ID_PARSED 2
+#define TRACE_NAME_PARSED "parsed"
+#define TRACE_ID_STORED 3
+#define TRACE_NAME_STORED "stored"
+#define TRACE_ID_UI_INTENT 4
+#define TRACE_NAME_UI_INTENT "ui_intent"
+#define TRACE_ID_RENDER_START 5
+#define TRACE_NAME_RENDER_START "render_start"
+#define TRACE_ID_RENDER_END 6
+#define TRACE_NAME_RENDER_END "render_end"
+#define TRACE_ID_FLUSH_START 7
+#define TRACE_NAME_FLUSH_START "flush_start"
+#define TRACE_ID_FLUSH_END 8
+#define TRACE_NAME_FLUSH_END "flush_end"
+
+/**
+ * @brief Emit a tracepoint
+ *
+ * @param point Tracepoint, RX to FLUSH_END
+ * @param arg Stage value, see the table above
+ */
+#if defined(CONFIG_PIPELINE_TRACING)
+#define TRACE_POINT(point, arg) \
+    sys_trace_named_event(TRACE_NAME_##point, TRACE_ID_##point, (uint32_t)(arg))
+#else
+#define TRACE_POINT(point, arg) \
+    do {                        \
+    } while (0)
+#endif
+
+/**
+ * @brief Trace the LVGL render and flush stages of the default display
+ *
+ * Call once LVGL is initialized. Does nothing without
+ * CONFIG_PIPELINE_TRACING.
+ */
+void trace_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,217 @@
+/**
+ * @file adv_sim.c
+ * @brief Host Simulation of the Advertising Scheduler
+ *
+ * After a disconnect the phone comes back after a random time: most often
+ * within seconds (a brief link loss), sometimes after minutes, sometimes
+ * only after an hour away. It then scans for the watch with Android's
+ * direct connection duty cycle and connects on the first advertising event
+ * it hears. Meanwhile the user touches the watch now and then.
+ *
+ * Compares fixed fast advertising, fixed slow advertising and the
+ * firmware's scheduler (src/bluetooth/adv_sched.c). Prints the advertising
+ * events per hour, the power cost, and the reconnect latency from the
+ * phone's return to the connection. For the scheduler, also the time and
+ * events it accounts per phase, as `ble adv` shows them on the watch, and
+ * the reconnect latency by the phase the phone came back in.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/adv_sim/adv_sim.c src/bluetooth/adv_sched.c -lm \
+ *       -o adv_sim && ./adv_sim
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bluetooth/adv_sched.h"
+
+#define TRIALS 2000
+
+/** @brief Phone's direct connection scan (Android foreground defaults) */
+#define SCAN_INTERVAL_MS 60.0
+#define SCAN_WINDOW_MS 30.0
+
+/** @brief Advertising packets lost to interference */
+#define ADV_LOSS 0.05
+
+/** @brief Mean time between touches while disconnected */
+#define TOUCH_MEAN_MS (10.0 * 60 * 1000)
+
+enum policy {
+    POLICY_FAST,
+    POLICY_SLOW,
+    POLICY_SCHEDULER,
+    POLICIES
+};
+
+static const char* const policy_names[POLICIES] = {
+    "fixed fast (30 ms)",
+    "fixed slow (1280 ms)",
+    "scheduler",
+};
+
+struct result {
+    double adv_ms; /**< Time spent advertising */
+    double events;
+    double latency_total_ms;
+    double latency[TRIALS];
+    uint32_t phase_connects[ADV_SCHED_PHASES]; /**< By the phase connected in */
+    double phase_latency_ms[ADV_SCHED_PHASES];
+    double phase_latency_max_ms[ADV_SCHED_PHASES];
+};
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * ((double)rand() / RAND_MAX);
+}
+
+static double exponential(double mean)
+{
+    return -mean * log(uniform(1e-9, 1.0));
+}
+
+/**
+ * @brief Time the phone comes back after the disconnect
+ */
+static double return_time(void)
+{
+    double r = uniform(0, 1);
+
+    if (r < 0.5) {
+        return uniform(1000, 30000); /* Brief link loss */
+    }
+    if (r < 0.8) {
+        return uniform(30000, 5 * 60000); /* Walked away for a while */
+    }
+    return uniform(5 * 60000, 60 * 60000); /* Away */
+}
+
+static bool scanning(double t, double scan_start, double phase)
+{
+    double in_interval;
+
+    if (t < scan_start) {
+        return false;
+    }
+    in_interval = t - scan_start + phase;
+    in_interval -= SCAN_INTERVAL_MS * (int)(in_interval / SCAN_INTERVAL_MS);
+    return in_interval < SCAN_WINDOW_MS;
+}
+
+/**
+ * @brief Advertise from a disconnect until the phone connects
+ *
+ * @return Reconnect latency from the phone's return
+ */
+static double run_once(enum policy policy, struct adv_sched* sched, struct result* res)
+{
+    double back = return_time();
+    double phase = uniform(0, SCAN_INTERVAL_MS);
+    double touch = exponential(TOUCH_MEAN_MS);
+    uint32_t interval = 0;
+    double t = 0;
+
+    adv_sched_reset(sched, 0);
+
+    for (;;) {
+        uint32_t now = (uint32_t)t;
+        uint32_t next;
+
+        while (touch <= t) {
+            adv_sched_activity(sched, now);
+            touch += exponential(TOUCH_MEAN_MS);
+        }
+
+        switch (policy) {
+        case POLICY_FAST:
+            next = ADV_SCHED_FAST_INTERVAL_MS;
+            break;
+        case POLICY_SLOW:
+            next = ADV_SCHED_SLOW_INTERVAL_MS;
+            break;
+        default:
+            next = adv_sched_interval(sched, now);
+            break;
+        }
+        if (next != interval) {
+            /* Restarted at the new interval, as bluetooth_process() does */
+            adv_sched_stopped(sched, now);
+            adv_sched_started(sched, next, now);
+            interval = next;
+        }
+
+        res->events++;
+        if (scanning(t, back, phase) && uniform(0, 1) > ADV_LOSS) {
+            enum adv_sched_phase in = adv_sched_phase_of(interval);
+
+            adv_sched_connected(sched, now);
+            res->adv_ms += t;
+            res->phase_connects[in]++;
+            res->phase_latency_ms[in] += t - back;
+            if (t - back > res->phase_latency_max_ms[in]) {
+                res->phase_latency_max_ms[in] = t - back;
+            }
+            return t - back;
+        }
+        t += interval + uniform(0, 10);
+    }
+}
+
+static int compare(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+int main(void)
+{
+    static struct result results[POLICIES];
+    static const char* const phase_names[ADV_SCHED_PHASES] = { "fast", "backoff", "slow" };
+    struct adv_sched_phase_stats phases[ADV_SCHED_PHASES];
+    struct adv_sched sched;
+
+    printf("%d disconnects, phone back within 30 s (50%%), 5 min (30%%), 1 h (20%%), "
+           "touch every %.0f min on average\n\n",
+        TRIALS, TOUCH_MEAN_MS / 60000);
+    printf("%-22s %12s %10s %10s %10s\n", "policy", "events/hour", "avg ms", "p50 ms", "p95 ms");
+
+    for (int p = 0; p < POLICIES; p++) {
+        struct result* res = &results[p];
+
+        srand(1);
+        adv_sched_init(&sched, 0);
+        for (int i = 0; i < TRIALS; i++) {
+            res->latency[i] = run_once(p, &sched, res);
+            res->latency_total_ms += res->latency[i];
+        }
+        qsort(res->latency, TRIALS, sizeof(res->latency[0]), compare);
+
+        printf("%-22s %12.0f %10.0f %10.0f %10.0f\n", policy_names[p],
+            res->events * 3600000.0 / res->adv_ms, res->latency_total_ms / TRIALS,
+            res->latency[TRIALS / 2], res->latency[TRIALS * 95 / 100]);
+    }
+
+    /* Per phase statistics of the last run, the scheduler's */
+    adv_sched_get_stats(&sched, 0, phases);
+    printf("\nscheduler by phase (latency from the phone's return)\n");
+    printf("%-8s %10s %12s %9s %10s %10s\n", "phase", "time s", "events/hour", "connects",
+        "avg ms", "max ms");
+    for (int i = 0; i < ADV_SCHED_PHASES; i++) {
+        const struct result* res = &results[POLICY_SCHEDULER];
+
+        printf("%-8s %10llu %12llu %9u %10.0f %10.0f\n", phase_names[i],
+            (unsigned long long)(phases[i].time_ms / 1000),
+            (unsigned long long)(phases[i].time_ms ? phases[i].events * 3600000ULL / phases[i].time_ms
+                                                   : 0),
+            res->phase_connects[i],
+            res->phase_connects[i] ? res->phase_latency_ms[i] / res->phase_connects[i] : 0,
+            res->phase_latency_max_ms[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,542 @@
+/**
+ * @file delta_sim.c
+ * @brief Host Simulation of Delta Firmware Updates
+ *
+ * Encodes delta patches the way the Android app does (DeltaEncoder.kt),
+ * rebuilds the new image from each with the firmware's decoder
+ * (src/dfu/delta.c) fed in upload sized chunks, checks it is identical, and
+ * reports the patch size, the transfer time against a full upload, and the
+ * watch's rebuild and verification time.
+ *
+ * Without arguments, typical releases are made from a synthetic image laid
+ * out like firmware: functions of code with literal pool pointers to other
+ * functions, so an edit that grows a function moves everything after it
+ * and changes the pointers to what moved, as a relink does. With two file
+ * arguments, the patch between two real images is measured instead.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/delta_sim/delta_sim.c src/dfu/delta.c -o delta_sim
+ *   ./delta_sim [old.bin new.bin]
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dfu/delta.h"
+
+/** @brief Encoder, as in DeltaEncoder.kt */
+#define HASH_BITS 18
+#define BLOCK 8
+#define MIN_MATCH 12 /* Copy found through the hash table */
+#define MIN_CONTINUATION 4 /* Copy continuing the previous one */
+
+/** @brief Upload: patch data per chunk, and full image throughput (dfu_sim, bulk) */
+#define CHUNK_SIZE 488
+#define UPLOAD_KBPS 13.2
+
+/** @brief ESP32-S3 SPI NOR flash and SHA-256, as in dfu_sim */
+#define FLASH_READ_MBPS 10.0
+#define FLASH_PROGRAM_US 700.0
+#define FLASH_PROGRAM_SIZE 256
+#define FLASH_ERASE_US 45000.0
+#define FLASH_PAGE_SIZE 4096
+#define SHA256_MBPS 5.0
+
+/** @brief Synthetic image */
+#define IMAGE_SIZE (360 * 1024)
+#define IMAGE_BASE 0x42000000U
+#define POINTER_EVERY 48 /* Average bytes of code per literal pool pointer */
+
+struct buf {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+};
+
+static void put(struct buf* b, const void* data, size_t len)
+{
+    if (b->len + len > b->cap) {
+        b->cap = (b->len + len) * 2;
+        b->data = realloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void put_varint(struct buf* b, uint32_t v)
+{
+    uint8_t byte;
+
+    do {
+        byte = v & 0x7F;
+        v >>= 7;
+        if (v) {
+            byte |= 0x80;
+        }
+        put(b, &byte, 1);
+    } while (v);
+}
+
+static void put_le32(struct buf* b, uint32_t v)
+{
+    uint8_t bytes[4] = { v, v >> 8, v >> 16, v >> 24 };
+
+    put(b, bytes, 4);
+}
+
+static uint32_t hash(const uint8_t* p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - HASH_BITS));
+}
+
+static size_t match_length(const struct buf* source, size_t s, const struct buf* target, size_t t)
+{
+    size_t n = 0;
+
+    while (s + n < source->len && t + n < target->len && source->data[s + n] == target->data[t + n]) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Encode a patch rebuilding target from source
+ *
+ * Greedy: at each target position the copy continuing the previous one,
+ * moved by the bytes added since, is tried first, then the last source
+ * position with the same 8 bytes. The source SHA-256 in the header is left
+ * zero, the decoder does not check it.
+ */
+static void encode(const struct buf* source, const struct buf* target, struct buf* patch)
+{
+    int32_t* table = malloc(sizeof(int32_t) << HASH_BITS);
+    uint8_t sha[DELTA_SHA256_SIZE] = { 0 };
+    size_t literal = 0; /* Start of bytes to add */
+    size_t source_pos = 0; /* End of the previous copy */
+    size_t t = 0;
+
+    memset(table, 0xFF, sizeof(int32_t) << HASH_BITS);
+    for (size_t i = 0; i + BLOCK <= source->len; i++) {
+        table[hash(source->data + i)] = (int32_t)i;
+    }
+
+    patch->len = 0;
+    put_le32(patch, DELTA_MAGIC);
+    put_le32(patch, source->len);
+    put_le32(patch, target->len);
+    put(patch, sha, sizeof(sha));
+
+    while (t < target->len) {
+        size_t best = 0, best_len = 0;
+        size_t next = source_pos + (t - literal);
+
+        if (next < source->len) {
+            best_len = match_length(source, next, target, t);
+            best = next;
+            if (best_len < MIN_CONTINUATION) {
+                best_len = 0;
+            }
+        }
+        if (best_len < MIN_MATCH && t + BLOCK <= target->len) {
+            int32_t found = table[hash(target->data + t)];
+
+            if (found >= 0) {
+                size_t len = match_length(source, found, target, t);
+
+                if (len >= MIN_MATCH && len > best_len) {
+                    best = found;
+                    best_len = len;
+                }
+            }
+        }
+
+        if (best_len == 0) {
+            t++;
+            continue;
+        }
+
+        if (t > literal) {
+            put_varint(patch, (uint32_t)(t - literal) << 1 | DELTA_OP_ADD);
+            put(patch, target->data + literal, t - literal);
+        }
+        int32_t move = (int32_t)best - (int32_t)source_pos;
+
+        put_varint(patch, (uint32_t)best_len << 1 | DELTA_OP_COPY);
+        put_varint(patch, (uint32_t)(move << 1) ^ (uint32_t)(move >> 31));
+        source_pos = best + best_len;
+        t += best_len;
+        literal = t;
+    }
+    if (t > literal) {
+        put_varint(patch, (uint32_t)(t - literal) << 1 | DELTA_OP_ADD);
+        put(patch, target->data + literal, t - literal);
+    }
+
+    free(table);
+}
+
+struct rebuild {
+    const struct buf* source;
+    struct buf out;
+    uint64_t copied;
+};
+
+static int read_source(void* ctx, uint32_t off, uint8_t* buf, size_t len)
+{
+    struct rebuild* r = ctx;
+
+    memcpy(buf, r->source->data + off, len);
+    r->copied += len;
+    return 0;
+}
+
+static int write_image(void* ctx, const uint8_t* buf, size_t len)
+{
+    struct rebuild* r = ctx;
+
+    put(&r->out, buf, len);
+    return 0;
+}
+
+/**
+ * @brief Rebuild the target from the patch in upload chunks, as the watch does
+ *
+ * @return Source bytes copied, or -1 if the image differs
+ */
+static int64_t rebuild(const struct buf* source, const struct buf* target, const struct buf* patch,
+    double* host_ms)
+{
+    struct rebuild r = { .source = source };
+    struct delta_header header;
+    struct delta d;
+    clock_t start = clock();
+
+    if (delta_parse_header(&header, patch->data, patch->len) < 0) {
+        return -1;
+    }
+    delta_init(&d, &header, read_source, write_image, &r);
+    for (size_t off = DELTA_HEADER_SIZE; off < patch->len; off += CHUNK_SIZE) {
+        size_t n = patch->len - off < CHUNK_SIZE ? patch->len - off : CHUNK_SIZE;
+
+        if (delta_feed(&d, patch->data + off, n) < 0) {
+            return -1;
+        }
+    }
+    *host_ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+    if (!delta_done(&d) || r.out.len != target->len
+        || memcmp(r.out.data, target->data, target->len) != 0) {
+        return -1;
+    }
+    free(r.out.data);
+    return (int64_t)r.copied;
+}
+
+/**
+ * @brief Watch time to rebuild: source reads, then writing the image
+ */
+static double rebuild_ms(uint64_t copied, size_t image_size)
+{
+    size_t pages = (image_size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    size_t programs = (image_size + FLASH_PROGRAM_SIZE - 1) / FLASH_PROGRAM_SIZE;
+
+    return copied / (FLASH_READ_MBPS * 1000) + (pages * FLASH_ERASE_US + programs * FLASH_PROGRAM_US) / 1000;
+}
+
+/**
+ * @brief Watch time to check the source and the rebuilt image
+ */
+static double verify_ms(size_t source_size, size_t image_size)
+{
+    double bytes = source_size + image_size;
+
+    return bytes / (FLASH_READ_MBPS * 1000) + bytes / (SHA256_MBPS * 1000);
+}
+
+static void report(const char* name, const struct buf* source, const struct buf* target)
+{
+    struct buf patch = { 0 };
+    double host_ms;
+    int64_t copied;
+    size_t changed = 0;
+    double full_s = target->len / 1024.0 / UPLOAD_KBPS;
+    double delta_s;
+
+    for (size_t i = 0; i < target->len; i++) {
+        changed += i >= source->len || source->data[i] != target->data[i];
+    }
+
+    encode(source, target, &patch);
+    copied = rebuild(source, target, &patch, &host_ms);
+    if (copied < 0) {
+        printf("%-22s rebuilt image differs\n", name);
+        exit(1);
+    }
+
+    delta_s = patch.len / 1024.0 / UPLOAD_KBPS + rebuild_ms(copied, target->len) / 1000
+        + verify_ms(source->len, target->len) / 1000;
+    printf("%-22s %9.1f %10.1f %9.1f %6.1f%% %8.1f %8.1f %10.0f %9.0f %8.1f\n", name,
+        target->len / 1024.0, changed / 1024.0, patch.len / 1024.0, patch.len * 100.0 / target->len,
+        full_s, delta_s, rebuild_ms(copied, target->len), verify_ms(source->len, target->len),
+        host_ms);
+    free(patch.data);
+}
+
+/* Synthetic firmware: functions with literal pool pointers to others */
+
+struct function {
+    uint8_t* code;
+    uint32_t size;
+    uint32_t* pointers; /* Offsets of pointer slots in the code */
+    uint32_t* targets; /* Function each slot points to */
+    uint32_t count;
+};
+
+struct firmware {
+    struct function* functions;
+    uint32_t count;
+};
+
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void make_function(struct function* f, uint32_t size, uint32_t functions)
+{
+    f->size = size;
+    f->code = malloc(size);
+    f->count = 0;
+    f->pointers = malloc(sizeof(uint32_t) * (size / 4 + 1));
+    f->targets = malloc(sizeof(uint32_t) * (size / 4 + 1));
+
+    for (uint32_t i = 0; i < size; i++) {
+        f->code[i] = (uint8_t)next_random();
+    }
+    for (uint32_t off = 0; off + 4 <= size; off += 4) {
+        if (next_random() % (POINTER_EVERY / 4) == 0) {
+            f->pointers[f->count] = off;
+            f->targets[f->count++] = next_random() % functions;
+        }
+    }
+}
+
+static void make_firmware(struct firmware* fw)
+{
+    uint32_t total = 0;
+
+    fw->count = 0;
+    fw->functions = malloc(sizeof(struct function) * 4096);
+    while (total < IMAGE_SIZE) {
+        uint32_t size = 40 + next_random() % 560;
+
+        make_function(&fw->functions[fw->count++], size & ~3U, 1);
+        total += size & ~3U;
+    }
+
+    /* Pointer targets once the number of functions is known */
+    for (uint32_t i = 0; i < fw->count; i++) {
+        struct function* f = &fw->functions[i];
+
+        for (uint32_t p = 0; p < f->count; p++) {
+            f->targets[p] = next_random() % fw->count;
+        }
+    }
+}
+
+static void copy_firmware(struct firmware* to, const struct firmware* from)
+{
+    to->count = from->count;
+    to->functions = malloc(sizeof(struct function) * 4096);
+    for (uint32_t i = 0; i < from->count; i++) {
+        const struct function* f = &from->functions[i];
+        struct function* g = &to->functions[i];
+
+        *g = *f;
+        g->code = malloc(f->size);
+        memcpy(g->code, f->code, f->size);
+        g->pointers = malloc(sizeof(uint32_t) * (f->size / 4 + 1));
+        memcpy(g->pointers, f->pointers, sizeof(uint32_t) * f->count);
+        g->targets = malloc(sizeof(uint32_t) * (f->size / 4 + 1));
+        memcpy(g->targets, f->targets, sizeof(uint32_t) * f->count);
+    }
+}
+
+static void free_firmware(struct firmware* fw)
+{
+    for (uint32_t i = 0; i < fw->count; i++) {
+        free(fw->functions[i].code);
+        free(fw->functions[i].pointers);
+        free(fw->functions[i].targets);
+    }
+    free(fw->functions);
+}
+
+/**
+ * @brief Edit a function: rewrite a few bytes of code, grow it by some
+ */
+static void edit_function(struct function* f, uint32_t rewrite, uint32_t grow)
+{
+    uint32_t at = (next_random() % (f->size / 4)) * 4;
+    uint8_t* code = malloc(f->size + grow);
+
+    memcpy(code, f->code, at);
+    for (uint32_t i = 0; i < grow; i++) {
+        code[at + i] = (uint8_t)next_random();
+    }
+    memcpy(code + at + grow, f->code + at, f->size - at);
+    for (uint32_t i = 0; i < rewrite && at + grow + i < f->size + grow; i++) {
+        code[at + grow + i] = (uint8_t)next_random();
+    }
+    free(f->code);
+    f->code = code;
+    f->size += grow;
+    f->pointers = realloc(f->pointers, sizeof(uint32_t) * (f->size / 4 + 1));
+    f->targets = realloc(f->targets, sizeof(uint32_t) * (f->size / 4 + 1));
+    for (uint32_t i = 0; i < f->count; i++) {
+        if (f->pointers[i] >= at) {
+            f->pointers[i] += grow;
+        }
+    }
+}
+
+/**
+ * @brief Insert new functions after a function
+ */
+static void add_functions(struct firmware* fw, uint32_t after, uint32_t count)
+{
+    memmove(&fw->functions[after + 1 + count], &fw->functions[after + 1],
+        sizeof(struct function) * (fw->count - after - 1));
+    for (uint32_t i = 0; i < count; i++) {
+        make_function(&fw->functions[after + 1 + i], (80 + next_random() % 400) & ~3U, fw->count);
+    }
+    fw->count += count;
+    /* Pointers by index moved along with their functions */
+    for (uint32_t i = 0; i < fw->count; i++) {
+        struct function* f = &fw->functions[i];
+
+        if (i > after && i <= after + count) {
+            continue;
+        }
+        for (uint32_t p = 0; p < f->count; p++) {
+            if (f->targets[p] > after) {
+                f->targets[p] += count;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Link: lay the functions out and fill in the pointers
+ */
+static void link_firmware(const struct firmware* fw, struct buf* image)
+{
+    uint32_t* address = malloc(sizeof(uint32_t) * fw->count);
+    uint32_t at = IMAGE_BASE;
+
+    for (uint32_t i = 0; i < fw->count; i++) {
+        address[i] = at;
+        at += fw->functions[i].size;
+    }
+
+    image->len = 0;
+    for (uint32_t i = 0; i < fw->count; i++) {
+        const struct function* f = &fw->functions[i];
+        size_t start = image->len;
+
+        put(image, f->code, f->size);
+        for (uint32_t p = 0; p < f->count; p++) {
+            uint32_t v = address[f->targets[p]];
+
+            memcpy(image->data + start + f->pointers[p], &v, 4);
+        }
+    }
+    free(address);
+}
+
+static void release(const char* name, const struct firmware* base, const struct buf* base_image,
+    uint32_t edits, uint32_t rewrite, uint32_t grow, uint32_t new_functions, bool early)
+{
+    struct firmware fw;
+    struct buf image = { 0 };
+
+    copy_firmware(&fw, base);
+    for (uint32_t i = 0; i < edits; i++) {
+        uint32_t at = early ? i : next_random() % fw.count;
+
+        edit_function(&fw.functions[at], rewrite, grow);
+    }
+    if (new_functions) {
+        add_functions(&fw, fw.count / 2, new_functions);
+    }
+    link_firmware(&fw, &image);
+    report(name, base_image, &image);
+
+    free(image.data);
+    free_firmware(&fw);
+}
+
+static int load(const char* path, struct buf* b)
+{
+    FILE* f = fopen(path, "rb");
+    uint8_t chunk[4096];
+    size_t n;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        put(b, chunk, n);
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    struct firmware base;
+    struct buf base_image = { 0 };
+
+    printf("%-22s %9s %10s %9s %7s %8s %8s %10s %9s %8s\n", "release", "image KB", "changed KB",
+        "patch KB", "ratio", "full s", "delta s", "rebuild ms", "verify ms", "host ms");
+
+    if (argc == 3) {
+        struct buf source = { 0 }, target = { 0 };
+
+        if (load(argv[1], &source) < 0 || load(argv[2], &target) < 0) {
+            return 1;
+        }
+        report(argv[2], &source, &target);
+        return 0;
+    }
+
+    make_firmware(&base);
+    link_firmware(&base, &base_image);
+
+    release("constant tweak", &base, &base_image, 1, 4, 0, 0, false);
+    release("bug fix", &base, &base_image, 1, 16, 40, 0, false);
+    release("bug fix, early code", &base, &base_image, 1, 16, 40, 0, true);
+    release("small feature", &base, &base_image, 5, 32, 64, 4, false);
+    release("large feature", &base, &base_image, 40, 64, 96, 20, false);
+    release("refactor", &base, &base_image, 300, 128, 32, 10, false);
+
+    free_firmware(&base);
+    free(base_image.data);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file dfu_sim.c
+ * @brief Host Simulation of the Firmware Upload Throughput
+ *
+ * Models the phone uploading an MCUboot image with SMP over BLE, one chunk
+ * in flight, connection event by connection event:
+ *
+ * - The phone writes one ATT packet at a time, notifications first. A chunk
+ *   is a write without response of one MTU, a notification a write with
+ *   response, which holds the phone's next write for a connection event.
+ * - Packets are split into link layer PDUs of the data length, and an event
+ *   carries as many PDUs (each acknowledged by an empty PDU) as fit its
+ *   length on the PHY.
+ * - The watch writes a chunk to flash, erasing each page when the upload
+ *   reaches it (progressive erase), then notifies the response with the
+ *   next offset; the phone sends the next chunk in the following event.
+ * - Notifications arrive at random during the upload and are received by
+ *   the watch's main loop, which the SMP work queue does not block.
+ *
+ * Prints throughput in KB/s and the latency of the notifications received
+ * meanwhile for the default and the bulk link profile (bluetooth_set_bulk())
+ * and the two steps in between, then the upload time with a link loss
+ * halfway, resumed from the last acknowledged offset or restarted.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 tools/dfu_sim/dfu_sim.c -lm -o dfu_sim && ./dfu_sim
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define IMAGE_SIZE (360 * 1024)
+#define ATT_MTU 517
+#define ATT_L2CAP_HEADERS 7 /* L2CAP 4, ATT 3 */
+#define SMP_OVERHEAD (8 + 18) /* Header, CBOR map with off and data */
+#define CHUNK_SIZE (ATT_MTU - 3 - SMP_OVERHEAD)
+#define NOTIFICATION_SIZE 150
+
+/** @brief ESP32-S3 SPI NOR flash, 256 B page program and 4 KB sector erase */
+#define FLASH_PROGRAM_US 700.0
+#define FLASH_PROGRAM_SIZE 256
+#define FLASH_PAGE_SIZE 4096
+#define FLASH_ERASE_US 45000.0
+#define SMP_HANDLING_US 1000.0
+
+/** @brief Link loss to the upload continuing, reconnect_sim's bonded case */
+#define RECONNECT_US 420000.0
+
+#define NOTIFICATION_MEAN_US 2000000.0
+#define MAX_NOTIFICATIONS 4096
+
+struct profile {
+    const char* name;
+    double interval_us;
+    int phy_mbps;
+    int data_len; /**< Link layer payload per PDU */
+};
+
+static const struct profile profiles[] = {
+    { "default (45 ms, 1M, 27 B)", 45000, 1, 27 },
+    { "interval (15 ms, 1M, 27 B)", 15000, 1, 27 },
+    { "interval+DLE (15 ms, 1M, 251 B)", 15000, 1, 251 },
+    { "bulk (15 ms, 2M, 251 B)", 15000, 2, 251 },
+};
+
+struct result {
+    double upload_us;
+    double latency_total_us;
+    double latency_max_us;
+    int notifications;
+};
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * ((double)rand() / RAND_MAX);
+}
+
+/**
+ * @brief PDUs of a data length one connection event carries
+ *
+ * Each data PDU (preamble, access address, header, payload, MIC, CRC) is
+ * followed by an empty acknowledgement PDU, with the 150 us spacing after
+ * both. The event leaves 1.25 ms for the controller's other work.
+ */
+static int pdus_per_event(const struct profile* p)
+{
+    int preamble = p->phy_mbps;
+    double us_per_byte = 8.0 / p->phy_mbps;
+    double data_us = (preamble + 4 + 2 + p->data_len + 4 + 3) * us_per_byte;
+    double empty_us = (preamble + 4 + 2 + 3) * us_per_byte;
+
+    return (int)((p->interval_us - 1250) / (data_us + empty_us + 300));
+}
+
+static int pdus_for(const struct profile* p, int att_payload)
+{
+    return (att_payload + ATT_L2CAP_HEADERS + p->data_len - 1) / p->data_len;
+}
+
+/**
+ * @brief Upload the image from an offset
+ *
+ * @param lose_at Offset the link is lost at, or -1
+ * @param resume Continue after the loss from the last acknowledged offset
+ */
+static void upload(const struct profile* p, int lose_at, bool resume, struct result* res)
+{
+    static double arrivals[MAX_NOTIFICATIONS];
+    int capacity = pdus_per_event(p);
+    int arrived = 0, sent = 0;
+    double next_arrival = -NOTIFICATION_MEAN_US * log(uniform(1e-9, 1.0));
+    int offset = 0; /* Acknowledged */
+    int erased = 0; /* Bytes erased ahead of the upload */
+    int chunk_left = 0; /* PDUs of the chunk still to send */
+    int notification_left = 0;
+    bool chunk_ready = true; /* The phone may send the next chunk */
+    double response_at = -1; /* Watch done with the chunk, response due */
+    double phone_free = 0; /* Next event the phone may start a write */
+    double t = 0;
+
+    res->notifications = 0;
+    res->latency_total_us = 0;
+    res->latency_max_us = 0;
+
+    while (offset < IMAGE_SIZE) {
+        int left = capacity;
+
+        while (next_arrival <= t && arrived < MAX_NOTIFICATIONS) {
+            arrivals[arrived++] = next_arrival;
+            next_arrival += -NOTIFICATION_MEAN_US * log(uniform(1e-9, 1.0));
+        }
+
+        /* Watch to phone: the chunk's response with the next offset */
+        if (response_at >= 0 && response_at <= t) {
+            offset += CHUNK_SIZE;
+            response_at = -1;
+            chunk_ready = true;
+            phone_free = t + p->interval_us;
+
+            if (lose_at >= 0 && offset >= lose_at) {
+                lose_at = -1;
+                t += RECONNECT_US;
+                t = ceil(t / p->interval_us) * p->interval_us;
+                if (!resume) {
+                    offset = 0;
+                    erased = 0;
+                }
+                continue;
+            }
+        }
+
+        /* Phone to watch: notifications first, then the next chunk */
+        while (left > 0 && t >= phone_free) {
+            if (notification_left == 0 && chunk_left == 0) {
+                if (sent < arrived) {
+                    notification_left = pdus_for(p, NOTIFICATION_SIZE);
+                } else if (chunk_ready && offset < IMAGE_SIZE) {
+                    chunk_left = pdus_for(p, ATT_MTU - 3);
+                    chunk_ready = false;
+                } else {
+                    break;
+                }
+            }
+
+            if (notification_left > 0) {
+                int n = notification_left < left ? notification_left : left;
+
+                notification_left -= n;
+                left -= n;
+                if (notification_left == 0) {
+                    double latency = t - arrivals[sent++];
+
+                    res->notifications++;
+                    res->latency_total_us += latency;
+                    if (latency > res->latency_max_us) {
+                        res->latency_max_us = latency;
+                    }
+                    /* Write response in the next event, next write after it */
+                    phone_free = t + 2 * p->interval_us;
+                }
+            } else {
+                int n = chunk_left < left ? chunk_left : left;
+
+                chunk_left -= n;
+                left -= n;
+                if (chunk_left == 0) {
+                    double busy = SMP_HANDLING_US
+                        + (CHUNK_SIZE + FLASH_PROGRAM_SIZE - 1) / FLASH_PROGRAM_SIZE * FLASH_PROGRAM_US;
+
+                    while (erased < offset + CHUNK_SIZE) {
+                        busy += FLASH_ERASE_US;
+                        erased += FLASH_PAGE_SIZE;
+                    }
+                    response_at = t + busy;
+                }
+            }
+        }
+
+        t += p->interval_us;
+    }
+
+    res->upload_us = t;
+}
+
+int main(void)
+{
+    struct result res;
+
+    printf("%d KB image, %d B chunks, notification every %.0f s on average\n\n",
+        IMAGE_SIZE / 1024, CHUNK_SIZE, NOTIFICATION_MEAN_US / 1e6);
+    printf("%-32s %10s %9s %8s %16s %16s\n", "link", "PDUs/event", "upload s", "KB/s",
+        "notif avg ms", "notif max ms");
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        srand(1);
+        upload(&profiles[i], -1, true, &res);
+        printf("%-32s %10d %9.1f %8.2f %16.0f %16.0f\n", profiles[i].name,
+            pdus_per_event(&profiles[i]), res.upload_us / 1e6,
+            IMAGE_SIZE / 1024.0 / (res.upload_us / 1e6),
+            res.notifications ? res.latency_total_us / res.notifications / 1000 : 0,
+            res.latency_max_us / 1000);
+    }
+
+    printf("\nlink lost halfway, bulk profile\n");
+    srand(1);
+    upload(&profiles[3], IMAGE_SIZE / 2, true, &res);
+    printf("%-32s %9.1f s\n", "resumed at the acknowledged offset", res.upload_us / 1e6);
+    srand(1);
+    upload(&profiles[3], IMAGE_SIZE / 2, false, &res);
+    printf("%-32s %9.1f s\n", "restarted from offset 0", res.upload_us / 1e6);
+    return 0;
+}
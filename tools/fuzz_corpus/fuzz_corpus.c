@@ -0,0 +1,346 @@
+/**
+ * @file fuzz_corpus.c
+ * @brief Seed Corpus Generator for the Protocol Fuzzer
+ *
+ * Writes short sessions in the fuzzer's record format (see fuzz/src/main.c)
+ * so coverage starts from packets the phone really sends. Notifications are
+ * encoded as the Android app's createNotificationPacket() does, including
+ * its truncation to the MTU; rules are a compiled program split in chunks
+ * as sendRules() does, icons are palette + RLE images with their CRC32 id.
+ *
+ * Build and run from the repository root, the seeds are committed in
+ * fuzz/corpus:
+ *
+ *   gcc -O2 -Isrc tools/fuzz_corpus/fuzz_corpus.c -o fuzz_corpus \
+ *       && ./fuzz_corpus fuzz/corpus
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bluetooth/protocol.h"
+#include "rules/rules.h"
+
+/** @brief Record control bits, as in fuzz/src/main.c */
+#define CTL_FIX_ICON_ID 0x20
+#define CTL_TOUCH 0x40
+#define CTL_PROCESS 0x80
+
+/** @brief Android app encoder values (BLEService.kt) */
+#define NOTIFICATION_HEADER_SIZE 13
+#define DEFAULT_MTU 247
+#define MAX_DATA_SIZE (DEFAULT_MTU - 3 - 5)
+#define MAX_APP_LEN 20
+#define MAX_TITLE_LEN 40
+
+/** @brief Phone notification categories (getNotificationType()) */
+enum {
+    TYPE_PHONE,
+    TYPE_MESSAGE,
+    TYPE_EMAIL,
+    TYPE_SOCIAL,
+    TYPE_CALENDAR,
+    TYPE_OTHER,
+};
+
+#define ICON_DIM 20
+
+static uint8_t seed[8192];
+static size_t seed_len;
+
+static void put_le16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t crc32_ieee(const uint8_t* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void record(uint8_t ctl, const uint8_t* packet, size_t len)
+{
+    seed[seed_len] = ctl;
+    put_le16(&seed[seed_len + 1], (uint16_t)len);
+    memcpy(&seed[seed_len + 3], packet, len);
+    seed_len += 3 + len;
+}
+
+/**
+ * @brief Cut a UTF-8 string to at most max bytes, the app's limits
+ *
+ * The app decodes the cut bytes again, turning a partial character into
+ * U+FFFD. The seeds keep the partial character, a forged packet can too.
+ */
+static size_t cut(const char* s, size_t max)
+{
+    size_t len = strlen(s);
+
+    return len < max ? len : max;
+}
+
+/**
+ * @brief CMD_ADD_NOTIFICATION as createNotificationPacket() encodes it
+ */
+static void notification(uint8_t ctl, int category, int priority, uint32_t key, uint32_t icon,
+    const char* app, const char* title, const char* text)
+{
+    uint8_t packet[MAX_DATA_SIZE];
+    size_t app_len = cut(app, MAX_APP_LEN);
+    size_t title_len = cut(title, MAX_TITLE_LEN);
+    size_t text_len = cut(text, MAX_DATA_SIZE - NOTIFICATION_HEADER_SIZE - app_len - title_len);
+    size_t pos = 0;
+
+    packet[pos++] = CMD_ADD_NOTIFICATION;
+    packet[pos++] = category | PROTOCOL_TYPE_HAS_KEY | PROTOCOL_TYPE_HAS_ICON
+        | (priority ? PROTOCOL_TYPE_PRIORITY : 0);
+    packet[pos++] = app_len;
+    packet[pos++] = title_len;
+    packet[pos++] = text_len;
+    put_le32(&packet[pos], key);
+    pos += 4;
+    put_le32(&packet[pos], icon);
+    pos += 4;
+    memcpy(&packet[pos], app, app_len);
+    pos += app_len;
+    memcpy(&packet[pos], title, title_len);
+    pos += title_len;
+    memcpy(&packet[pos], text, text_len);
+    pos += text_len;
+
+    record(ctl, packet, pos);
+}
+
+static void set_time(uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    uint8_t packet[] = { CMD_SET_TIME, hours, minutes, seconds };
+
+    record(CTL_PROCESS, packet, sizeof(packet));
+}
+
+static void set_dnd(int enabled, uint16_t start, uint16_t end)
+{
+    uint8_t packet[PROTOCOL_DND_LEN] = { CMD_SET_DND, enabled };
+
+    put_le16(&packet[2], start);
+    put_le16(&packet[4], end);
+    record(CTL_PROCESS, packet, sizeof(packet));
+}
+
+static void clear_all(void)
+{
+    uint8_t packet[] = { CMD_CLEAR_ALL };
+
+    record(CTL_PROCESS, packet, sizeof(packet));
+}
+
+static void action_ack(uint8_t seq, uint8_t status)
+{
+    uint8_t packet[] = { CMD_ACTION_ACK, seq, status };
+
+    record(0, packet, sizeof(packet));
+}
+
+/**
+ * @brief Rules program in RuleCompiler's layout, sent like sendRules()
+ *
+ * Mutes an app, raises a sender and silences the night.
+ */
+static void rules(size_t chunk)
+{
+    static const char* strings[] = { "instagram", "mom", "meeting" };
+    uint8_t program[128];
+    uint8_t packet[PROTOCOL_RULES_HEADER_LEN + 128];
+    size_t len = 0;
+
+    program[len++] = RULES_MAGIC_0;
+    program[len++] = RULES_MAGIC_1;
+    program[len++] = RULES_VERSION;
+    program[len++] = 3;
+    program[len++] = 4;
+    for (size_t i = 0; i < 3; i++) {
+        program[len++] = strlen(strings[i]);
+        memcpy(&program[len], strings[i], strlen(strings[i]));
+        len += strlen(strings[i]);
+    }
+
+    program[len++] = RULE_ACTION_DROP;
+    program[len++] = 1;
+    program[len++] = RULE_OP_APP_IS;
+    program[len++] = 0;
+
+    program[len++] = RULE_ACTION_PRIORITY;
+    program[len++] = 2;
+    program[len++] = RULE_OP_SENDER_IS;
+    program[len++] = 1;
+    program[len++] = RULE_OP_CATEGORY_IS;
+    program[len++] = TYPE_MESSAGE;
+
+    program[len++] = RULE_ACTION_PRIORITY;
+    program[len++] = 1;
+    program[len++] = RULE_OP_CONTENT_HAS;
+    program[len++] = 2;
+
+    program[len++] = RULE_ACTION_SILENT;
+    program[len++] = 2;
+    program[len++] = RULE_OP_TIME_IN;
+    put_le16(&program[len], 23 * 60);
+    put_le16(&program[len + 2], 7 * 60);
+    len += 4;
+    program[len++] = RULE_OP_CATEGORY_IS | RULE_OP_NOT;
+    program[len++] = TYPE_PHONE;
+
+    for (size_t offset = 0; offset < len; offset += chunk) {
+        size_t n = len - offset < chunk ? len - offset : chunk;
+
+        packet[0] = CMD_SET_RULES;
+        packet[1] = 0;
+        put_le16(&packet[2], offset);
+        put_le16(&packet[4], len);
+        memcpy(&packet[PROTOCOL_RULES_HEADER_LEN], &program[offset], n);
+        record(0, packet, PROTOCOL_RULES_HEADER_LEN + n);
+    }
+}
+
+/**
+ * @brief Icon ring: transparent background, one color, runs across rows
+ *
+ * @return Icon id
+ */
+static uint32_t icon(uint16_t color)
+{
+    uint8_t packet[PROTOCOL_ICON_HEADER_LEN + 512];
+    uint8_t* icon = &packet[PROTOCOL_ICON_HEADER_LEN];
+    size_t len = 0;
+    int run_index = -1;
+    int run_len = 0;
+    uint32_t id;
+
+    icon[len++] = ICON_DIM;
+    icon[len++] = ICON_DIM;
+    icon[len++] = 2;
+    put_le16(&icon[len], 0);
+    put_le16(&icon[len + 2], color);
+    len += 4;
+
+    for (int y = 0; y < ICON_DIM; y++) {
+        for (int x = 0; x < ICON_DIM; x++) {
+            int dx = 2 * x - (ICON_DIM - 1);
+            int dy = 2 * y - (ICON_DIM - 1);
+            int r2 = dx * dx + dy * dy;
+            int index = (r2 >= 12 * 12 && r2 < 19 * 19) ? 1 : 0;
+
+            if (index != run_index || run_len == 16) {
+                if (run_len > 0) {
+                    icon[len++] = (uint8_t)((run_len - 1) << 4 | run_index);
+                }
+                run_index = index;
+                run_len = 0;
+            }
+            run_len++;
+        }
+    }
+    icon[len++] = (uint8_t)((run_len - 1) << 4 | run_index);
+
+    id = crc32_ieee(icon, len);
+    packet[0] = CMD_SET_ICON;
+    put_le32(&packet[1], id);
+    record(CTL_PROCESS | CTL_FIX_ICON_ID, packet, PROTOCOL_ICON_HEADER_LEN + len);
+    return id;
+}
+
+static int write_seed(const char* dir, const char* name)
+{
+    char path[512];
+    FILE* f;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "wb");
+    if (!f || fwrite(seed, 1, seed_len, f) != seed_len) {
+        perror(path);
+        return -1;
+    }
+    fclose(f);
+    printf("%-24s %5zu bytes\n", name, seed_len);
+    seed_len = 0;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argc > 1 ? argv[1] : "fuzz/corpus";
+    uint32_t whatsapp;
+    int ret = 0;
+
+    notification(CTL_PROCESS, TYPE_MESSAGE, 0, 0x1A2B3C4D, 0, "WhatsApp", "Dana",
+        "Running 10 minutes late, order for me?");
+    ret |= write_seed(dir, "message");
+
+    notification(CTL_PROCESS | CTL_TOUCH, TYPE_PHONE, 1, 0x00000001, 0, "Phone",
+        "Incoming call", "Mom");
+    ret |= write_seed(dir, "priority_call");
+
+    /* Longest packet the app sends at the default MTU */
+    notification(CTL_PROCESS, TYPE_EMAIL, 0, 0xDEADBEEF, 0, "Gmail with a long app name",
+        "Quarterly report: numbers, charts and the follow-up we talked about",
+        "Hi all, attached are the numbers for the quarter. Revenue is up, costs are flat "
+        "and the charts are in the second tab. Please read before Thursday so we can "
+        "spend the meeting on the follow-up items rather than the slides themselves. "
+        "Thanks!");
+    ret |= write_seed(dir, "truncated_email");
+
+    /* Multi-byte text, cut mid-character by the app's byte limits */
+    notification(CTL_PROCESS, TYPE_SOCIAL, 0, 0x0BADF00D, 0, "טלגרם ✈️ Telegram",
+        "קבוצת המשפחה 👨‍👩‍👧‍👦 שלום לכולם, מה נשמע היום?", "🎉🎂 יום הולדת שמח! 🎈");
+    ret |= write_seed(dir, "utf8");
+
+    whatsapp = icon(0x25C3);
+    notification(CTL_PROCESS, TYPE_MESSAGE, 0, 0x1000, whatsapp, "WhatsApp", "Noa",
+        "Photo");
+    notification(CTL_PROCESS, TYPE_OTHER, 0, 0x1001, 0x12345678, "Maps", "Traffic",
+        "Heavy traffic on your route home");
+    ret |= write_seed(dir, "icons");
+
+    rules(40);
+    notification(CTL_PROCESS, TYPE_SOCIAL, 0, 0x2000, 0, "Instagram", "new_follower",
+        "started following you");
+    notification(CTL_PROCESS, TYPE_MESSAGE, 0, 0x2001, 0, "Messages", "Mom", "Call me");
+    notification(CTL_PROCESS, TYPE_CALENDAR, 0, 0x2002, 0, "Calendar", "Meeting in 10",
+        "Design review, room 3");
+    ret |= write_seed(dir, "rules");
+
+    /* Two phones: the browser repeats the app's notifications */
+    set_time(8, 59, 30);
+    set_dnd(1, 22 * 60, 7 * 60);
+    notification(0, TYPE_MESSAGE, 0, 0x3000, 0, "Signal", "Avi", "Are we still on for lunch?");
+    notification(1, TYPE_MESSAGE, 0, 0, 0, "Signal", "Avi", "Are we still on for lunch?");
+    notification(0, TYPE_MESSAGE, 1, 0x3001, 0, "Signal", "Avi", "Urgent: call me back");
+    notification(1 | CTL_PROCESS, TYPE_EMAIL, 0, 0, 0, "Outlook", "Invoice", "Due today");
+    notification(0, TYPE_MESSAGE, 0, 0x3000, 0, "Signal", "Avi",
+        "Are we still on for lunch? 12:30 works");
+    action_ack(0, 0);
+    action_ack(1, 1);
+    clear_all();
+    ret |= write_seed(dir, "session");
+
+    return ret ? 1 : 0;
+}
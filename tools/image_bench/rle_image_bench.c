@@ -0,0 +1,209 @@
+/**
+ * @file rle_image_bench.c
+ * @brief Host Benchmark of Palette + RLE Row Decoding vs Raw Blits
+ *
+ * Generates flat-colored test images the size of the watch's assets (status
+ * glyph, app icon, full watch face), encodes them in the palette + RLE
+ * format, and compares decoding a row with the firmware's codec
+ * (src/graphics/rle_image.c) against copying the same row out of a raw
+ * RGB565 image, which is what a raw image blit reads per row. Checks that
+ * every decoded row matches the raw image and prints the encoded sizes.
+ *
+ * Host memcpy is vectorized, so the ratio overstates the decode cost on the
+ * watch; `rle bench` on the device shell runs the icon case on the target.
+ *
+ * Build and run from the repository root (-Os like the firmware):
+ *
+ *   gcc -Os -Isrc tools/image_bench/rle_image_bench.c src/graphics/rle_image.c \
+ *       -o rle_image_bench && ./rle_image_bench
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "graphics/rle_image.h"
+
+#define MAX_DIM 240
+#define ROUNDS 2000
+
+/** @brief Worst case: one run byte per pixel */
+#define MAX_ENCODED_LEN (1 + RLE_IMAGE_MAX_PALETTE * 2 + MAX_DIM * MAX_DIM)
+
+struct test_image {
+    const char* name;
+    uint16_t width;
+    uint16_t height;
+    uint8_t colors;
+    /** @brief Palette index of a pixel */
+    uint8_t (*pixel)(int x, int y, int width, int height);
+};
+
+static const uint16_t palette[RLE_IMAGE_MAX_PALETTE] = {
+    0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F, 0xFFE0, 0x07FF, 0xF81F,
+    0x8410, 0x4208, 0xFC00, 0x841F, 0x2104, 0xC618, 0x7BEF, 0x39E7,
+};
+
+static uint16_t raw[MAX_DIM * MAX_DIM];
+static uint8_t encoded[MAX_ENCODED_LEN];
+static uint16_t row_rgb[MAX_DIM];
+static uint8_t row_alpha[MAX_DIM];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Ring glyph, transparent outside */
+static uint8_t glyph_pixel(int x, int y, int width, int height)
+{
+    int dx = 2 * x - width + 1;
+    int dy = 2 * y - height + 1;
+    int r2 = dx * dx + dy * dy;
+    int outer = width * width;
+
+    return (r2 < outer && r2 > outer / 3) ? 1 : 0;
+}
+
+/* App icon: rounded square, two-tone background and a bar mark */
+static uint8_t icon_pixel(int x, int y, int width, int height)
+{
+    if ((x < 2 || x >= width - 2) && (y < 2 || y >= height - 2)) {
+        return 0;
+    }
+    if (y >= height / 3 && y < height / 3 + 3 && x >= 4 && x < width - 4) {
+        return 3;
+    }
+    return (y < height / 2) ? 1 : 2;
+}
+
+/* Watch face: background, dial ring, tick marks and a few color bands */
+static uint8_t face_pixel(int x, int y, int width, int height)
+{
+    int dx = 2 * x - width + 1;
+    int dy = 2 * y - height + 1;
+    int r2 = dx * dx + dy * dy;
+
+    if (r2 > width * width) {
+        return 0;
+    }
+    if (r2 > (width - 16) * (width - 16)) {
+        return ((x / 10 + y / 10) % 2) ? 1 : 2;
+    }
+    if (y > height / 2 - 20 && y < height / 2 + 20) {
+        return 3 + (x / 40) % 4;
+    }
+    return 7 + (y / 60);
+}
+
+/**
+ * @brief Encode the raw image: palette, then runs of up to 16 pixels
+ */
+static size_t encode(const struct test_image* img)
+{
+    size_t len = 0;
+    size_t pixels = (size_t)img->width * img->height;
+    size_t p = 0;
+
+    encoded[len++] = img->colors;
+    for (uint8_t i = 0; i < img->colors; i++) {
+        encoded[len++] = palette[i] & 0xFF;
+        encoded[len++] = palette[i] >> 8;
+    }
+
+    while (p < pixels) {
+        uint8_t index = img->pixel(p % img->width, p / img->width, img->width, img->height);
+        size_t run = 1;
+
+        while (p + run < pixels && run < RLE_IMAGE_MAX_RUN
+            && img->pixel((p + run) % img->width, (p + run) / img->width, img->width, img->height)
+                == index) {
+            run++;
+        }
+
+        encoded[len++] = ((run - 1) << 4) | index;
+        p += run;
+    }
+    return len;
+}
+
+static int bench(const struct test_image* img)
+{
+    struct rle_image_stream s;
+    size_t row_bytes = img->width * sizeof(uint16_t);
+    size_t len;
+    double start, raw_ns, rle_ns;
+    volatile uint32_t sink = 0;
+
+    for (int y = 0; y < img->height; y++) {
+        for (int x = 0; x < img->width; x++) {
+            raw[y * img->width + x] = palette[img->pixel(x, y, img->width, img->height)];
+        }
+    }
+    len = encode(img);
+
+    /* Round trip check, transparent pixels compare by palette color */
+    if (rle_image_begin(&s, encoded, len, img->width, img->height, true) < 0) {
+        return -1;
+    }
+    for (int y = 0; y < img->height; y++) {
+        if (rle_image_decode_row(&s, row_rgb, row_alpha) < 0
+            || memcmp(row_rgb, &raw[y * img->width], row_bytes) != 0) {
+            fprintf(stderr, "%s: row %d mismatch\n", img->name, y);
+            return -1;
+        }
+    }
+    if (!rle_image_complete(&s)) {
+        fprintf(stderr, "%s: trailing data\n", img->name);
+        return -1;
+    }
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int y = 0; y < img->height; y++) {
+            memcpy(row_rgb, &raw[y * img->width], row_bytes);
+            sink += row_rgb[r % img->width];
+        }
+    }
+    raw_ns = (now_ns() - start) / ROUNDS;
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        rle_image_begin(&s, encoded, len, img->width, img->height, true);
+        while (rle_image_decode_row(&s, row_rgb, row_alpha) == 0) {
+            sink += row_rgb[r % img->width];
+        }
+    }
+    rle_ns = (now_ns() - start) / ROUNDS;
+
+    printf("%-8s %3ux%-3u %8zu %8zu %6.1fx %10.0f %10.0f %8.2fx\n", img->name, img->width,
+        img->height, row_bytes * img->height, len, (double)(row_bytes * img->height) / len, raw_ns,
+        rle_ns, rle_ns / raw_ns);
+    return 0;
+}
+
+int main(void)
+{
+    static const struct test_image images[] = {
+        { "glyph", 12, 12, 2, glyph_pixel },
+        { "icon", 20, 20, 4, icon_pixel },
+        { "face", MAX_DIM, MAX_DIM, 11, face_pixel },
+    };
+
+    printf("ns per image, raw = RGB565 row copies, rle = row decode with alpha\n");
+    printf("%-8s %7s %8s %8s %7s %10s %10s %9s\n", "image", "size", "raw B", "rle B", "ratio",
+        "raw ns", "rle ns", "rle/raw");
+    for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+        if (bench(&images[i]) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
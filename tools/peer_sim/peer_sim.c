@@ -0,0 +1,356 @@
+/**
+ * @file peer_sim.c
+ * @brief Host Simulation of Two Connected Centrals
+ *
+ * Simulates the Android app and a Web Bluetooth page writing notifications
+ * at the same time, with the firmware's receive scheduler
+ * (src/bluetooth/rx_sched.c) and cross-source de-duplication
+ * (src/bluetooth/dedup.c).
+ *
+ * Throughput and fairness: both peers offer more than the main loop can
+ * store, one steadily with small packets and one flooding with bursts of
+ * large ones. Each peer
+ * has its own bounded queue, as on the watch, and is compared against the
+ * old single shared queue. Prints the bytes stored per peer, the packets
+ * pushed back, and Jain's fairness index over the stored bytes (1.0 is an
+ * even split).
+ *
+ * De-duplication: both peers deliver the same notifications, the browser a
+ * little later, with and without the phone's keys; the phone updates a
+ * conversation under one key; the phone reconnects and updates what it sent
+ * before. Checks what reaches the store and where actions go, held while
+ * their phone is away, and exits with 1 on a mismatch.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/peer_sim/peer_sim.c src/bluetooth/rx_sched.c \
+ *       src/bluetooth/dedup.c -o peer_sim && ./peer_sim
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bluetooth/dedup.h"
+#include "bluetooth/rx_sched.h"
+
+#define PEERS 2
+#define ANDROID 0 /* Connection identities for de-duplication */
+#define BROWSER 1
+#define QUEUE_LEN 8 /* BLUETOOTH_RX_QUEUE_LEN */
+#define TICKS 100000
+#define TICK_MS 1
+
+/** @brief Bytes the main loop stores per tick, below the offered load */
+#define STORE_BYTES_PER_TICK 300
+
+struct peer_load {
+    const char* name;
+    uint16_t packet_len;
+    uint32_t packets_per_1000_ticks;
+    uint32_t burst; /**< Packets written back to back */
+};
+
+static const struct peer_load loads[PEERS] = {
+    { "android", 120, 1500, 1 }, /* 180 B/tick, steady */
+    { "browser", 480, 1000, 8 }, /* 480 B/tick, flooding in bursts */
+};
+
+struct queue {
+    uint16_t len[QUEUE_LEN];
+    uint8_t source[QUEUE_LEN];
+    uint8_t head;
+    uint8_t count;
+};
+
+struct result {
+    uint64_t stored_bytes[PEERS];
+    uint32_t stored_packets[PEERS];
+    uint32_t rejected[PEERS];
+};
+
+static bool queue_put(struct queue* q, uint16_t len, uint8_t source)
+{
+    uint8_t tail;
+
+    if (q->count == QUEUE_LEN) {
+        return false;
+    }
+    tail = (q->head + q->count) % QUEUE_LEN;
+    q->len[tail] = len;
+    q->source[tail] = source;
+    q->count++;
+    return true;
+}
+
+static void queue_take(struct queue* q)
+{
+    q->head = (q->head + 1) % QUEUE_LEN;
+    q->count--;
+}
+
+static uint16_t queue_head_len(const struct queue* q)
+{
+    return q->count ? q->len[q->head] : 0;
+}
+
+/**
+ * @brief Offer each peer's packets for this tick
+ *
+ * @param queues One queue per peer, or one shared queue
+ * @param shared All peers write to queues[0]
+ */
+static void offer(struct queue* queues, bool shared, uint32_t tick, struct result* res)
+{
+    for (uint8_t p = 0; p < PEERS; p++) {
+        uint32_t period = loads[p].burst * 1000 / loads[p].packets_per_1000_ticks;
+        uint32_t due;
+
+        if (loads[p].burst > 1) {
+            due = (tick % period == 0) ? loads[p].burst : 0;
+        } else {
+            due = (tick + 1) * loads[p].packets_per_1000_ticks / 1000
+                - tick * loads[p].packets_per_1000_ticks / 1000;
+        }
+
+        for (uint32_t i = 0; i < due; i++) {
+            if (!queue_put(&queues[shared ? 0 : p], loads[p].packet_len, p)) {
+                res->rejected[p]++;
+            }
+        }
+    }
+}
+
+static double jain_index(const uint64_t* x, size_t n)
+{
+    double sum = 0, sum_sq = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        sum += (double)x[i];
+        sum_sq += (double)x[i] * x[i];
+    }
+    return sum_sq > 0 ? (sum * sum) / (n * sum_sq) : 1.0;
+}
+
+static void run(bool shared, struct result* res)
+{
+    struct queue queues[PEERS];
+    struct rx_sched sched;
+    struct queue* current = NULL; /* Packet being stored, may span ticks */
+    int32_t budget = 0;
+
+    memset(queues, 0, sizeof(queues));
+    memset(res, 0, sizeof(*res));
+    rx_sched_init(&sched);
+
+    for (uint32_t tick = 0; tick < TICKS; tick++) {
+        offer(queues, shared, tick, res);
+
+        /* The store works through STORE_BYTES_PER_TICK per tick */
+        budget += STORE_BYTES_PER_TICK;
+        for (;;) {
+            uint16_t head_len[PEERS];
+            int source;
+
+            if (!current) {
+                if (shared) {
+                    current = queues[0].count ? &queues[0] : NULL;
+                } else {
+                    for (uint8_t p = 0; p < PEERS; p++) {
+                        head_len[p] = queue_head_len(&queues[p]);
+                    }
+                    source = rx_sched_pick(&sched, head_len, PEERS);
+                    current = (source >= 0) ? &queues[source] : NULL;
+                }
+            }
+            if (!current) {
+                budget = 0; /* Idle time is not saved up */
+                break;
+            }
+            if (budget < (int32_t)queue_head_len(current)) {
+                break;
+            }
+
+            budget -= queue_head_len(current);
+            res->stored_bytes[current->source[current->head]] += queue_head_len(current);
+            res->stored_packets[current->source[current->head]]++;
+            queue_take(current);
+            current = NULL;
+        }
+    }
+}
+
+static void print_result(const char* name, const struct result* res)
+{
+    printf("%s\n", name);
+    for (uint8_t p = 0; p < PEERS; p++) {
+        printf("  %-8s offered %4u B/s, stored %6.0f B/s (%6u packets), pushed back %6u\n",
+            loads[p].name, loads[p].packet_len * loads[p].packets_per_1000_ticks,
+            (double)res->stored_bytes[p] * 1000 / (TICKS * TICK_MS), res->stored_packets[p],
+            res->rejected[p]);
+    }
+    printf("  fairness (Jain, bytes): %.3f\n", jain_index(res->stored_bytes, PEERS));
+}
+
+static uint32_t text_hash(const char* text)
+{
+    return dedup_hash(dedup_hash_init(), (const uint8_t*)text, strlen(text));
+}
+
+static bool expect(const char* what, uint32_t got, uint32_t want)
+{
+    printf("  %-44s %5u%s\n", what, got, got == want ? "" : "  FAILED");
+    if (got != want) {
+        fprintf(stderr, "%s: %u, expected %u\n", what, got, want);
+    }
+    return got == want;
+}
+
+/**
+ * @brief Both peers deliver the same notifications, the browser a little later
+ *
+ * @param keyed The browser has the phone's keys too
+ */
+static bool run_mirror(bool keyed)
+{
+    static const char* const texts[] = {
+        "WhatsApp|Mom|Dinner at 8?",
+        "Gmail|Boss|Quarterly report",
+        "Calendar|Standup|in 10 minutes",
+        "Messages|John|Are we still meeting tonight?",
+    };
+    uint32_t delivered = 0, sent = 0;
+    uint32_t now = 0;
+    struct dedup_stats stats;
+    bool ok = true;
+
+    dedup_reset();
+    for (int round = 0; round < 250; round++) {
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+            uint32_t key = 0x1000 + round * 16 + i;
+            char text[64];
+            uint32_t hash;
+
+            /* Unique notification text per round */
+            snprintf(text, sizeof(text), "%s #%d", texts[i], round);
+            hash = text_hash(text);
+
+            delivered += !dedup_check(ANDROID, key, hash, now);
+            now += 50;
+            delivered += !dedup_check(BROWSER, keyed ? key : 0, hash, now);
+            now += 950;
+            sent += 2;
+        }
+    }
+
+    dedup_get_stats(&stats);
+    printf("de-duplication, browser mirror %s keys: %u packets\n", keyed ? "with" : "without",
+        sent);
+    ok &= expect("stored", delivered, sent / 2);
+    ok &= expect("dropped by key", stats.key_duplicates, keyed ? sent / 2 : 0);
+    ok &= expect("dropped by text", stats.text_duplicates, keyed ? 0 : sent / 2);
+    return ok;
+}
+
+/**
+ * @brief Source actions on a key go to, -1 if it is away or unknown
+ */
+static int route(uint32_t key)
+{
+    bool connected = false;
+    int source = dedup_source_of(key, &connected);
+
+    return connected ? source : -1;
+}
+
+/**
+ * @brief A conversation keeps its key and gets new messages from the phone
+ */
+static bool run_updates(void)
+{
+    const uint32_t key = 0x2000;
+    uint32_t delivered = 0, mirrored = 0;
+    uint32_t now = 0;
+    bool ok = true;
+
+    dedup_reset();
+    for (int message = 0; message < 20; message++) {
+        char text[64];
+
+        snprintf(text, sizeof(text), "WhatsApp|Family|message %d", message);
+        delivered += !dedup_check(ANDROID, key, text_hash(text), now);
+        mirrored += !dedup_check(BROWSER, key, text_hash(text), now + 50);
+        now += 20000;
+    }
+
+    printf("de-duplication, updates to one key every 20 s\n");
+    ok &= expect("updates stored from the phone", delivered, 20);
+    ok &= expect("updates stored from the mirror", mirrored, 0);
+    ok &= expect("actions routed to the phone", route(key), ANDROID);
+    return ok;
+}
+
+/**
+ * @brief The phone reconnects as a new connection and updates what it sent
+ *
+ * Actions on its notifications wait while it is away and go to the new
+ * connection once it is back.
+ *
+ * Also the browser sending a key the phone sent long ago, which is its own
+ * notification by then.
+ */
+static bool run_reconnect(void)
+{
+    const uint8_t android_again = BROWSER + 1;
+    uint32_t delivered = 0, routed = 0;
+    bool connected;
+    uint32_t now = 0;
+    bool ok = true;
+
+    dedup_reset();
+    for (uint32_t key = 1; key <= 8; key++) {
+        dedup_check(ANDROID, key, key, now);
+        now += 100;
+    }
+
+    printf("de-duplication, phone reconnected as a new connection\n");
+    dedup_forget_source(ANDROID);
+    ok &= expect("lost phone's actions held", route(1) < 0, 1);
+    ok &= expect("and not given to the browser", dedup_source_of(1, &connected), ANDROID);
+
+    now += 5000;
+    dedup_adopt_source(ANDROID, android_again);
+    for (uint32_t key = 1; key <= 8; key++) {
+        routed += route(key) == android_again;
+        delivered += !dedup_check(android_again, key, 100 + key, now);
+        now += 100;
+    }
+
+    ok &= expect("updates stored after the reconnect", delivered, 8);
+    ok &= expect("held actions routed to the new connection", routed, 8);
+    ok &= expect("mirror of an update stored", !dedup_check(BROWSER, 1, 200, now), 0);
+
+    now += DEDUP_KEY_WINDOW_MS;
+    ok &= expect("browser key past the window stored", !dedup_check(BROWSER, 2, 300, now), 1);
+    ok &= expect("actions on it routed to the browser", route(2), BROWSER);
+    return ok;
+}
+
+int main(void)
+{
+    struct result res;
+
+    printf("%d ms simulated, store drains %d B/ms, %d packets queued per peer\n", TICKS,
+        STORE_BYTES_PER_TICK, QUEUE_LEN);
+
+    run(true, &res);
+    print_result("single shared queue (before)", &res);
+
+    run(false, &res);
+    print_result("per-peer queues + deficit round robin", &res);
+
+    return run_mirror(false) && run_mirror(true) && run_updates() && run_reconnect() ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file rgb444_check.c
+ * @brief Host Visual Diff of RGB444 Panel Transfers
+ *
+ * Renders test frames in RGB565 as LVGL does, packs them with the flush
+ * path's packer (src/graphics/rgb444.c) in place, and decodes the packed
+ * bytes the way the GC9A01 reads them in 12-bit mode. Each frame is then
+ * compared, as shown on the panel, against the same frame sent as RGB565:
+ *
+ * - known pixel pairs must pack to their exact bytes (R0G0 B0R1 G1B1),
+ * - no channel of any pixel may be off by more than the quantization error
+ *   of dropping RGB565 to 4 bits per channel.
+ *
+ * Prints the largest and mean error, PSNR and the share of changed pixels
+ * per frame, and exits with 1 on a failed check.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/rgb444_check/rgb444_check.c src/graphics/rgb444.c \
+ *       -lm -o rgb444_check && ./rgb444_check
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graphics/rgb444.h"
+
+#define WIDTH 240
+#define HEIGHT 240
+#define PIXELS (WIDTH * HEIGHT)
+
+struct rgb {
+    uint8_t r, g, b;
+};
+
+/* UI colors, as in notifications.c */
+static const uint32_t ui_colors[] = {
+    0x25D366, 0x1877F2, 0xFF0000, 0x0096FF, 0xFFFF00, 0x00FF00, 0x202020, 0x666666, 0xC8C8C8,
+    0xE0E0E0, 0xFFFFFF,
+};
+
+static uint16_t frame[PIXELS];
+
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+    rng = rng * 1103515245U + 12345U;
+    return rng >> 8;
+}
+
+static uint16_t to_rgb565(uint32_t rgb)
+{
+    return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+}
+
+/* The panel expands 5 and 6 bit channels by repeating their top bits */
+static struct rgb show_rgb565(uint16_t p)
+{
+    uint8_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+
+    return (struct rgb) { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+}
+
+/* And 4 bit channels the same way */
+static struct rgb show_rgb444(uint8_t r, uint8_t g, uint8_t b)
+{
+    return (struct rgb) { r * 17, g * 17, b * 17 };
+}
+
+static struct rgb unpack(const uint8_t* packed, uint32_t i)
+{
+    const uint8_t* p = &packed[i / 2 * 3];
+
+    if (i % 2 == 0) {
+        return show_rgb444(p[0] >> 4, p[0] & 0x0F, p[1] >> 4);
+    }
+    return show_rgb444(p[1] & 0x0F, p[2] >> 4, p[2] & 0x0F);
+}
+
+/* Largest difference on the panel between a channel in RGB565 and RGB444 */
+static int channel_bound(int bits)
+{
+    int bound = 0;
+
+    for (int v = 0; v < (1 << bits); v++) {
+        int wide = (v << (8 - bits)) | (v >> (2 * bits - 8));
+        int narrow = (v >> (bits - 4)) * 17;
+
+        bound = abs(wide - narrow) > bound ? abs(wide - narrow) : bound;
+    }
+    return bound;
+}
+
+static bool check_layout(void)
+{
+    static const struct {
+        uint16_t p0, p1;
+        uint8_t bytes[3];
+    } pairs[] = {
+        { 0xF800, 0x07E0, { 0xF0, 0x00, 0xF0 } }, /* Red, green */
+        { 0x001F, 0xFFFF, { 0x00, 0xFF, 0xFF } }, /* Blue, white */
+        { 0x8410, 0x0000, { 0x88, 0x80, 0x00 } }, /* Grey, black */
+        { 0x0000, 0x8410, { 0x00, 0x08, 0x88 } }, /* Black, grey */
+    };
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        uint16_t buf[2] = { pairs[i].p0, pairs[i].p1 };
+
+        if (rgb444_pack((uint8_t*)buf, 2) != 3 || memcmp(buf, pairs[i].bytes, 3) != 0) {
+            fprintf(stderr, "%04x %04x packed wrong\n", pairs[i].p0, pairs[i].p1);
+            ok = false;
+        }
+    }
+    printf("pixel pair layout: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/* Notification screen: black round face, flat colored blocks, anti-aliased text */
+static void render_ui(void)
+{
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            int dx = x - WIDTH / 2, dy = y - HEIGHT / 2;
+            uint32_t color = 0x000000;
+
+            if (dx * dx + dy * dy > 120 * 120) {
+                color = 0x000000;
+            } else if (y >= 50 && y < 80 && x >= 30 && x < 50) {
+                color = ui_colors[(y / 10) % 3]; /* App icon */
+            } else if (y >= 90 && y < 180 && x >= 30 && x < 210 && (x / 3 + y / 12) % 5 == 0) {
+                uint32_t level = 0x20 + ((x * 7 + y * 3) % 0xC0); /* Glyph edges */
+
+                color = level << 16 | level << 8 | level;
+            } else if (y >= 190 && y < 200) {
+                color = ui_colors[3 + x * 8 / WIDTH];
+            }
+            frame[y * WIDTH + x] = to_rgb565(color);
+        }
+    }
+}
+
+static void render_gradient(void)
+{
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            uint32_t v = x * 255 / (WIDTH - 1);
+
+            frame[y * WIDTH + x] = to_rgb565(y < 80 ? v << 16 : y < 160 ? v << 8 : v);
+        }
+    }
+}
+
+static void render_noise(void)
+{
+    for (int i = 0; i < PIXELS; i++) {
+        frame[i] = next_random();
+    }
+}
+
+static bool check_frame(const char* name, void (*render)(void))
+{
+    static uint16_t reference[PIXELS];
+    const int bounds[3] = { channel_bound(5), channel_bound(6), channel_bound(5) };
+    int max_error = 0;
+    uint64_t squared = 0, total = 0;
+    uint32_t changed = 0;
+    bool ok = true;
+    double psnr;
+
+    render();
+    memcpy(reference, frame, sizeof(frame));
+
+    if (rgb444_pack((uint8_t*)frame, PIXELS) != PIXELS / 2 * 3) {
+        fprintf(stderr, "%s: wrong packed length\n", name);
+        return false;
+    }
+
+    for (int i = 0; i < PIXELS; i++) {
+        struct rgb want = show_rgb565(reference[i]);
+        struct rgb got = unpack((const uint8_t*)frame, i);
+        const int errors[3] = { abs(want.r - got.r), abs(want.g - got.g), abs(want.b - got.b) };
+
+        for (int c = 0; c < 3; c++) {
+            if (errors[c] > bounds[c] && ok) {
+                fprintf(stderr, "%s: pixel %d channel %d off by %d\n", name, i, c, errors[c]);
+                ok = false;
+            }
+            max_error = errors[c] > max_error ? errors[c] : max_error;
+            squared += errors[c] * errors[c];
+            total += errors[c];
+        }
+        changed += errors[0] || errors[1] || errors[2];
+    }
+
+    psnr = squared ? 10 * log10(255.0 * 255.0 * PIXELS * 3 / squared) : INFINITY;
+    printf("%-12s %9d %10.2f %8.1f %8.1f%% %s\n", name, max_error,
+        (double)total / (PIXELS * 3), psnr, 100.0 * changed / PIXELS, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(void)
+{
+    bool ok = check_layout();
+
+    printf("quantization bound: r %d, g %d, b %d\n", channel_bound(5), channel_bound(6),
+        channel_bound(5));
+    printf("%-12s %9s %10s %8s %9s\n", "frame", "max error", "mean error", "PSNR dB", "changed");
+    ok &= check_frame("ui", render_ui);
+    ok &= check_frame("gradients", render_gradient);
+    ok &= check_frame("noise", render_noise);
+    return ok ? 0 : 1;
+}
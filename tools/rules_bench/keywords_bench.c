@@ -0,0 +1,210 @@
+/**
+ * @file keywords_bench.c
+ * @brief Host Benchmark of Keyword Automaton vs Per-Keyword Search
+ *
+ * Scans generated notification texts for growing keyword sets with the
+ * firmware's keyword automaton (src/rules/keywords.c), with the per-keyword
+ * byte loop the rules engine falls back to, and with the C library's strstr
+ * per keyword. Checks that all find the same keywords and prints the time
+ * per text.
+ *
+ * The byte loop is the relevant baseline for the watch; host strstr is
+ * vectorized and shown for reference only.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/rules_bench/keywords_bench.c src/rules/keywords.c \
+ *       -o keywords_bench && ./keywords_bench
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rules/keywords.h"
+
+#define TEXT_COUNT 1000
+#define TEXT_LEN 200
+#define ROUNDS 20
+
+static const char* const vocabulary[] = {
+    "otp", "urgent", "code", "verify", "meeting", "invoice", "delivery", "alarm", "reminder",
+    "password", "login", "payment", "failed", "security", "alert", "flight", "gate", "boarding",
+    "dinner", "tonight", "tomorrow", "call", "missed", "voicemail", "package", "shipped",
+    "refund", "order", "sale", "discount", "offer", "coupon", "newsletter", "digest", "weekly",
+    "build", "deploy", "outage", "incident", "pager", "oncall", "review", "merge", "comment",
+    "mention", "reply", "like", "follow", "story", "live", "match", "score", "goal", "weather",
+    "storm", "rain", "traffic", "accident", "school", "homework", "exam", "grade", "doctor",
+    "appointment", "pharmacy", "prescription", "bank", "balance", "transfer", "deposit",
+    "withdrawal", "statement", "battery", "update", "backup", "storage", "download", "upload",
+    "photo", "video", "album", "memory", "birthday", "anniversary", "party", "invite", "rsvp",
+    "ticket", "concert", "movie", "stream", "episode", "season", "podcast",
+};
+
+#define VOCABULARY_SIZE (sizeof(vocabulary) / sizeof(vocabulary[0]))
+
+static char texts[TEXT_COUNT][TEXT_LEN + 1];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void generate_texts(void)
+{
+    srand(1234);
+
+    for (int i = 0; i < TEXT_COUNT; i++) {
+        size_t len = 0;
+
+        while (len < TEXT_LEN) {
+            /* Mostly filler words, sometimes a vocabulary word */
+            const char* word = (rand() % 8 == 0) ? vocabulary[rand() % VOCABULARY_SIZE] : "lorem";
+            size_t word_len = strlen(word);
+
+            if (len + word_len + 1 > TEXT_LEN) {
+                break;
+            }
+            memcpy(&texts[i][len], word, word_len);
+            len += word_len;
+            texts[i][len++] = ' ';
+        }
+        texts[i][len] = '\0';
+    }
+}
+
+/* Same search as contains() in src/rules/rules.c */
+static bool contains(const char* hay, size_t hay_len, const uint8_t* needle, size_t needle_len)
+{
+    for (size_t i = 0; i + needle_len <= hay_len; i++) {
+        if (hay[i] == (char)needle[0] && memcmp(&hay[i], needle, needle_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void loop_scan(const struct keyword* words, size_t count, const char* text, uint32_t* hits)
+{
+    size_t len = strlen(text);
+
+    for (size_t k = 0; k < count; k++) {
+        if (contains(text, len, words[k].bytes, words[k].len)) {
+            hits[words[k].id / 32] |= 1U << (words[k].id % 32);
+        }
+    }
+}
+
+static void strstr_scan(const struct keyword* words, size_t count, const char* text, uint32_t* hits)
+{
+    for (size_t k = 0; k < count; k++) {
+        char needle[64];
+
+        memcpy(needle, words[k].bytes, words[k].len);
+        needle[words[k].len] = '\0';
+        if (strstr(text, needle)) {
+            hits[words[k].id / 32] |= 1U << (words[k].id % 32);
+        }
+    }
+}
+
+static int bench(size_t count)
+{
+    static struct keyword_automaton ac;
+    struct keyword words[KEYWORDS_MAX_IDS];
+    uint32_t ac_hits[KEYWORDS_HITS_WORDS];
+    uint32_t naive_hits[KEYWORDS_HITS_WORDS];
+    double start, ac_ns, loop_ns, strstr_ns;
+    volatile uint32_t sink = 0;
+    int ret;
+
+    for (size_t k = 0; k < count; k++) {
+        words[k].bytes = (const uint8_t*)vocabulary[k];
+        words[k].len = (uint8_t)strlen(vocabulary[k]);
+        words[k].id = (uint8_t)k;
+    }
+
+    ret = keywords_build(&ac, words, count, 0);
+    if (ret < 0) {
+        fprintf(stderr, "build failed for %zu keywords: %d\n", count, ret);
+        return ret;
+    }
+
+    /* Both must find the same keywords */
+    for (int i = 0; i < TEXT_COUNT; i++) {
+        memset(ac_hits, 0, sizeof(ac_hits));
+        memset(naive_hits, 0, sizeof(naive_hits));
+        keywords_scan(&ac, texts[i], strlen(texts[i]), ac_hits);
+        strstr_scan(words, count, texts[i], naive_hits);
+        if (memcmp(ac_hits, naive_hits, sizeof(ac_hits)) != 0) {
+            fprintf(stderr, "mismatch on text %d with %zu keywords\n", i, count);
+            return -1;
+        }
+        memset(naive_hits, 0, sizeof(naive_hits));
+        loop_scan(words, count, texts[i], naive_hits);
+        if (memcmp(ac_hits, naive_hits, sizeof(ac_hits)) != 0) {
+            fprintf(stderr, "mismatch on text %d with %zu keywords\n", i, count);
+            return -1;
+        }
+    }
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TEXT_COUNT; i++) {
+            memset(ac_hits, 0, sizeof(ac_hits));
+            keywords_scan(&ac, texts[i], strlen(texts[i]), ac_hits);
+            sink += ac_hits[0];
+        }
+    }
+    ac_ns = (now_ns() - start) / (ROUNDS * TEXT_COUNT);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TEXT_COUNT; i++) {
+            memset(naive_hits, 0, sizeof(naive_hits));
+            loop_scan(words, count, texts[i], naive_hits);
+            sink += naive_hits[0];
+        }
+    }
+    loop_ns = (now_ns() - start) / (ROUNDS * TEXT_COUNT);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TEXT_COUNT; i++) {
+            memset(naive_hits, 0, sizeof(naive_hits));
+            strstr_scan(words, count, texts[i], naive_hits);
+            sink += naive_hits[0];
+        }
+    }
+    strstr_ns = (now_ns() - start) / (ROUNDS * TEXT_COUNT);
+
+    printf("%8zu %7u %6zu %10.0f %10.0f %10.0f %8.1fx\n", count, ac.state_count,
+        keywords_image_len(&ac), ac_ns, loop_ns, strstr_ns, loop_ns / ac_ns);
+    return 0;
+}
+
+int main(void)
+{
+    static const size_t counts[] = { 1, 5, 10, 25, 50, 75, KEYWORDS_MAX_IDS };
+
+    generate_texts();
+
+    printf("%d texts of up to %d bytes, ns per text\n", TEXT_COUNT, TEXT_LEN);
+    printf("%8s %7s %6s %10s %10s %10s %9s\n", "keywords", "states", "image", "automaton",
+        "byte loop", "strstr", "vs loop");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        size_t count = counts[i] < VOCABULARY_SIZE ? counts[i] : VOCABULARY_SIZE;
+
+        if (bench(count) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file search_bench.c
+ * @brief Host Benchmark of the Notification Search Index
+ *
+ * Fills the firmware's notification store (src/notifications/store.c) with
+ * generated notifications, which indexes them (src/notifications/search.c),
+ * then measures:
+ *
+ * - the index update cost per notification, taking it out of the index and
+ *   indexing it again,
+ * - the cost of an arrival on a full store, evicting the oldest
+ *   notification and storing the new one, index included,
+ * - the latency of typical queries, against scanning the text of every
+ *   stored notification for the same word prefixes.
+ *
+ * Checks that the index finds exactly what the scan finds, after the fill
+ * and after the store has turned over many times.
+ *
+ * Build and run from the repository root, at the store size to measure:
+ *
+ *   gcc -O2 -Isrc -DCONFIG_NOTIFICATION_STORE_SIZE=500 tools/search_bench/search_bench.c \
+ *       src/notifications/store.c src/notifications/search.c -o search_bench && ./search_bench
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "notifications/search.h"
+#include "notifications/store.h"
+
+#define ARRIVALS 20000
+#define QUERY_ROUNDS 200
+
+static const char* const apps[] = {
+    "WhatsApp", "Gmail", "Messages", "Telegram", "Slack", "Discord", "Calendar", "Bank",
+};
+
+static const char* const senders[] = {
+    "Alice", "Bob", "Carol", "Dan", "Erin", "Frank", "Grace", "Heidi", "Ivan", "Judy",
+    "Mallory", "Niaj", "Olivia", "Peggy", "Rupert", "Sybil", "Trent", "Victor", "Walter",
+    "Family", "Work team", "Book club", "Security", "Billing", "Team Standup",
+};
+
+static const char* const vocabulary[] = {
+    "the", "a", "to", "and", "you", "is", "on", "for", "in", "at", "me", "we", "see",
+    "otp", "urgent", "code", "verify", "meeting", "invoice", "delivery", "alarm", "reminder",
+    "password", "login", "payment", "failed", "security", "alert", "flight", "gate", "boarding",
+    "dinner", "tonight", "tomorrow", "call", "missed", "voicemail", "package", "shipped",
+    "refund", "order", "sale", "discount", "offer", "coupon", "newsletter", "digest", "weekly",
+    "build", "deploy", "outage", "incident", "pager", "oncall", "review", "merge", "comment",
+    "mention", "reply", "like", "follow", "story", "live", "match", "score", "goal", "weather",
+    "storm", "rain", "traffic", "accident", "school", "homework", "exam", "grade", "doctor",
+    "appointment", "pharmacy", "prescription", "bank", "balance", "transfer", "deposit",
+    "withdrawal", "statement", "battery", "update", "backup", "storage", "download", "upload",
+    "photo", "video", "album", "memory", "birthday", "anniversary", "party", "invite", "rsvp",
+    "ticket", "concert", "movie", "stream", "episode", "season", "podcast",
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static const char* const queries[] = {
+    "code", /* Common word */
+    "48", /* Prefix of one-time codes */
+    "al", /* Short prefix, many words */
+    "alice dinner", /* Sender and word */
+    "whatsapp photo tomorrow", /* Three words */
+    "work team", /* Sender of several words */
+    "zebra", /* No match */
+};
+
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+    rng = rng * 1103515245U + 12345U;
+    return rng >> 8;
+}
+
+/* Skewed towards the front of a list, as word use is */
+static size_t skewed(size_t count)
+{
+    return next_random() % (1 + next_random() % count);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void arrive(void)
+{
+    static const struct notification_meta meta;
+    char content[STORE_CONTENT_LEN];
+    size_t len = 0;
+    size_t words = 4 + next_random() % 27;
+
+    for (size_t i = 0; i < words; i++) {
+        const char* word = vocabulary[skewed(COUNT(vocabulary))];
+        size_t word_len = strlen(word);
+
+        if (len + word_len + 2 > sizeof(content)) {
+            break;
+        }
+        memcpy(&content[len], word, word_len);
+        len += word_len;
+        content[len++] = ' ';
+    }
+    content[len] = '\0';
+
+    /* Every tenth one carries a one-time code */
+    if (next_random() % 10 == 0) {
+        snprintf(content, sizeof(content), "Your code is %06u, valid 5 minutes",
+            next_random() % 1000000);
+    }
+
+    if (store_count() >= STORE_CAPACITY) {
+        store_remove(store_list(STORE_LIST_ALL, 0)->first);
+    }
+    store_add(&meta, apps[skewed(COUNT(apps))], senders[skewed(COUNT(senders))], content,
+        "12:00", false);
+}
+
+/* Lowercase and cut a word as the index does */
+static size_t fold_word(const char* text, size_t len, size_t* pos, char* word)
+{
+    size_t n = 0;
+    size_t i = *pos;
+
+#define IS_WORD(c) (((c) >= '0' && (c) <= '9') || ((c) >= 'a' && (c) <= 'z') \
+    || ((c) >= 'A' && (c) <= 'Z') || (uint8_t)(c) >= 0x80)
+    while (i < len && !IS_WORD(text[i])) {
+        i++;
+    }
+    for (; i < len && IS_WORD(text[i]); i++) {
+        if (n < SEARCH_TERM_LEN) {
+            char c = text[i];
+
+            word[n++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+        }
+    }
+#undef IS_WORD
+    *pos = i;
+    return n;
+}
+
+static bool has_word_prefix(const char* text, const char* prefix, size_t prefix_len)
+{
+    char word[SEARCH_TERM_LEN];
+    size_t len = strlen(text);
+    size_t pos = 0;
+    size_t n;
+
+    while ((n = fold_word(text, len, &pos, word)) > 0) {
+        if (n >= prefix_len && memcmp(word, prefix, prefix_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Read every stored notification, the alternative to the index */
+static int scan_query(const char* query, uint32_t hits[SEARCH_HITS_WORDS])
+{
+    char words[SEARCH_MAX_QUERY_WORDS][SEARCH_TERM_LEN];
+    size_t lens[SEARCH_MAX_QUERY_WORDS];
+    size_t count = 0;
+    size_t pos = 0;
+    size_t n;
+    int matches = 0;
+
+    while (count < SEARCH_MAX_QUERY_WORDS
+        && (n = fold_word(query, strlen(query), &pos, words[count])) > 0) {
+        lens[count++] = n;
+    }
+
+    memset(hits, 0, SEARCH_HITS_WORDS * sizeof(hits[0]));
+    for (uint16_t slot = 0; count > 0 && slot < STORE_CAPACITY; slot++) {
+        const struct store_notification* notif = store_get(slot);
+        bool match = notif != NULL;
+
+        for (size_t w = 0; match && w < count; w++) {
+            match = has_word_prefix(notif->app_name, words[w], lens[w])
+                || has_word_prefix(notif->sender, words[w], lens[w])
+                || has_word_prefix(notif->content, words[w], lens[w]);
+        }
+        if (match) {
+            hits[slot / 32] |= 1U << (slot % 32);
+            matches++;
+        }
+    }
+    return matches;
+}
+
+static bool check_queries(const char* when)
+{
+    uint32_t index_hits[SEARCH_HITS_WORDS];
+    uint32_t scan_hits[SEARCH_HITS_WORDS];
+
+    for (size_t q = 0; q < COUNT(queries); q++) {
+        int found = search_query(queries[q], strlen(queries[q]), index_hits);
+
+        if (found != scan_query(queries[q], scan_hits)
+            || memcmp(index_hits, scan_hits, sizeof(index_hits)) != 0) {
+            fprintf(stderr, "mismatch on \"%s\" %s\n", queries[q], when);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_update(void)
+{
+    double total_remove = 0, total_add = 0, max_remove = 0, max_add = 0;
+
+    for (uint16_t slot = 0; slot < STORE_CAPACITY; slot++) {
+        const struct store_notification* notif = store_get(slot);
+        double t0 = now_ns();
+
+        search_remove(slot, notif);
+        double t1 = now_ns();
+        search_add(slot, notif);
+        double t2 = now_ns();
+
+        total_remove += t1 - t0;
+        total_add += t2 - t1;
+        max_remove = (t1 - t0 > max_remove) ? t1 - t0 : max_remove;
+        max_add = (t2 - t1 > max_add) ? t2 - t1 : max_add;
+    }
+
+    printf("index update, ns per notification: add %.0f (max %.0f), remove %.0f (max %.0f)\n",
+        total_add / STORE_CAPACITY, max_add, total_remove / STORE_CAPACITY, max_remove);
+}
+
+static void bench_arrivals(void)
+{
+    double start = now_ns();
+
+    for (int i = 0; i < ARRIVALS; i++) {
+        arrive();
+    }
+    printf("arrival on a full store, evicting the oldest: %.0f ns\n",
+        (now_ns() - start) / ARRIVALS);
+}
+
+static void bench_queries(void)
+{
+    uint32_t hits[SEARCH_HITS_WORDS];
+    volatile int sink = 0;
+
+    printf("%-26s %7s %10s %10s %9s\n", "query", "matches", "index ns", "scan ns", "vs scan");
+    for (size_t q = 0; q < COUNT(queries); q++) {
+        const char* query = queries[q];
+        double start, index_ns, scan_ns;
+        int matches = search_query(query, strlen(query), hits);
+
+        start = now_ns();
+        for (int r = 0; r < QUERY_ROUNDS; r++) {
+            sink += search_query(query, strlen(query), hits);
+        }
+        index_ns = (now_ns() - start) / QUERY_ROUNDS;
+
+        start = now_ns();
+        for (int r = 0; r < QUERY_ROUNDS; r++) {
+            sink += scan_query(query, hits);
+        }
+        scan_ns = (now_ns() - start) / QUERY_ROUNDS;
+
+        printf("%-26s %7d %10.0f %10.0f %8.1fx\n", query, matches, index_ns, scan_ns,
+            scan_ns / index_ns);
+    }
+}
+
+int main(void)
+{
+    struct search_stats stats;
+
+    store_init();
+    for (int i = 0; i < STORE_CAPACITY; i++) {
+        arrive();
+    }
+    if (!check_queries("after filling the store")) {
+        return 1;
+    }
+
+    search_get_stats(&stats);
+    printf("%d notifications stored: %u terms of %u, %u postings of %u, %u dropped\n",
+        STORE_CAPACITY, stats.terms, SEARCH_MAX_TERMS, stats.postings, SEARCH_MAX_POSTINGS,
+        stats.dropped);
+
+    bench_update();
+    bench_arrivals();
+    if (!check_queries("after the store turned over")) {
+        return 1;
+    }
+    bench_queries();
+
+    search_get_stats(&stats);
+    if (stats.dropped > 0) {
+        printf("%u word occurrences were not indexed, their notifications may be missed\n",
+            stats.dropped);
+    }
+    return 0;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file trace_gen.c
+ * @brief Synthetic Notification Trace Generator
+ *
+ * Writes a trace in the recorder's dump format (see
+ * src/bluetooth/recorder.h) for the replay benchmark, until traces
+ * recorded on the watch are at hand. Packets are encoded as the Android
+ * app sends them; the Android app and a Web Bluetooth page are connected:
+ *
+ * - On connect: time, do not disturb schedule and rules in chunks
+ * - Background chat and email every 10 to 40 s, icons before an app's
+ *   first notification
+ * - A group chat storm: 60 messages within 8 s, a priority call in it
+ * - An email sync: 25 messages back to back
+ * - The browser repeats a third of the notifications, keyless, 300 ms
+ *   later
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -Isrc tools/trace_gen/trace_gen.c -o trace_gen \
+ *       && ./trace_gen > replay/traces/storm.txt
+ *
+ * @author Yehuda@YehudaE.net
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bluetooth/protocol.h"
+#include "rules/rules.h"
+
+/** @brief Android app encoder values (BLEService.kt) */
+#define NOTIFICATION_HEADER_SIZE 13
+#define MTU 247
+#define MAX_DATA_SIZE (MTU - 3 - 5)
+#define MAX_APP_LEN 20
+#define MAX_TITLE_LEN 40
+#define RULES_CHUNK (MTU - 3 - PROTOCOL_RULES_HEADER_LEN)
+
+#define PEER_APP 0
+#define PEER_BROWSER 1
+
+/** @brief Browser delay behind the app */
+#define BROWSER_LAG_US 300000
+
+#define ICON_DIM 20
+
+/** @brief Phone notification categories */
+enum {
+    TYPE_PHONE,
+    TYPE_MESSAGE,
+    TYPE_EMAIL,
+    TYPE_SOCIAL,
+};
+
+struct event {
+    uint64_t time_us;
+    uint8_t source;
+    uint16_t len;
+    uint8_t data[MAX_DATA_SIZE];
+};
+
+struct app {
+    const char* name;
+    int category;
+    uint32_t icon_id;
+    int icon_sent;
+};
+
+static struct event events[4096];
+static size_t event_count;
+static uint32_t next_key = 0x1000;
+static uint32_t rng = 12345;
+
+static uint32_t next_random(void)
+{
+    rng = rng * 1103515245U + 12345U;
+    return (rng >> 8) & 0xFFFFFF;
+}
+
+static uint32_t random_between(uint32_t lo, uint32_t hi)
+{
+    return lo + next_random() % (hi - lo + 1);
+}
+
+static void put_le16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t crc32_ieee(const uint8_t* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static struct event* add_event(uint64_t time_us, uint8_t source)
+{
+    struct event* e = &events[event_count++];
+
+    e->time_us = time_us;
+    e->source = source;
+    e->len = 0;
+    return e;
+}
+
+static size_t cut(const char* s, size_t max)
+{
+    size_t len = strlen(s);
+
+    return len < max ? len : max;
+}
+
+/**
+ * @brief CMD_ADD_NOTIFICATION as createNotificationPacket() encodes it
+ */
+static void notification(uint64_t time_us, uint8_t source, int category, int priority,
+    uint32_t key, uint32_t icon, const char* app, const char* title, const char* text)
+{
+    struct event* e = add_event(time_us, source);
+    size_t app_len = cut(app, MAX_APP_LEN);
+    size_t title_len = cut(title, MAX_TITLE_LEN);
+    size_t text_len = cut(text, MAX_DATA_SIZE - NOTIFICATION_HEADER_SIZE - app_len - title_len);
+    uint8_t type = category;
+
+    if (key != 0) {
+        type |= PROTOCOL_TYPE_HAS_KEY | PROTOCOL_TYPE_HAS_ICON;
+    }
+    if (priority) {
+        type |= PROTOCOL_TYPE_PRIORITY;
+    }
+
+    e->data[e->len++] = CMD_ADD_NOTIFICATION;
+    e->data[e->len++] = type;
+    e->data[e->len++] = app_len;
+    e->data[e->len++] = title_len;
+    e->data[e->len++] = text_len;
+    if (key != 0) {
+        put_le32(&e->data[e->len], key);
+        put_le32(&e->data[e->len + 4], icon);
+        e->len += 8;
+    }
+    memcpy(&e->data[e->len], app, app_len);
+    e->len += app_len;
+    memcpy(&e->data[e->len], title, title_len);
+    e->len += title_len;
+    memcpy(&e->data[e->len], text, text_len);
+    e->len += text_len;
+}
+
+/**
+ * @brief Single color ring icon, as palette + RLE
+ */
+static void send_icon(uint64_t time_us, struct app* app, uint16_t color)
+{
+    struct event* e = add_event(time_us, PEER_APP);
+    uint8_t* icon = &e->data[PROTOCOL_ICON_HEADER_LEN];
+    size_t len = 0;
+    int run_index = -1;
+    int run_len = 0;
+
+    icon[len++] = ICON_DIM;
+    icon[len++] = ICON_DIM;
+    icon[len++] = 2;
+    put_le16(&icon[len], 0);
+    put_le16(&icon[len + 2], color);
+    len += 4;
+    for (int y = 0; y < ICON_DIM; y++) {
+        for (int x = 0; x < ICON_DIM; x++) {
+            int dx = 2 * x - (ICON_DIM - 1);
+            int dy = 2 * y - (ICON_DIM - 1);
+            int r2 = dx * dx + dy * dy;
+            int index = (r2 >= 12 * 12 && r2 < 19 * 19) ? 1 : 0;
+
+            if (index != run_index || run_len == 16) {
+                if (run_len > 0) {
+                    icon[len++] = (uint8_t)((run_len - 1) << 4 | run_index);
+                }
+                run_index = index;
+                run_len = 0;
+            }
+            run_len++;
+        }
+    }
+    icon[len++] = (uint8_t)((run_len - 1) << 4 | run_index);
+
+    app->icon_id = crc32_ieee(icon, len);
+    app->icon_sent = 1;
+    e->data[0] = CMD_SET_ICON;
+    put_le32(&e->data[1], app->icon_id);
+    e->len = PROTOCOL_ICON_HEADER_LEN + len;
+}
+
+static void connect(uint64_t time_us)
+{
+    static const char* strings[] = { "instagram", "mom" };
+    uint8_t program[64];
+    size_t len = 0;
+    struct event* e;
+
+    e = add_event(time_us, PEER_APP);
+    e->data[0] = CMD_SET_TIME;
+    e->data[1] = 8;
+    e->data[2] = 0;
+    e->data[3] = 0;
+    e->len = 4;
+
+    e = add_event(time_us + 20000, PEER_APP);
+    e->data[0] = CMD_SET_DND;
+    e->data[1] = 1;
+    put_le16(&e->data[2], 23 * 60);
+    put_le16(&e->data[4], 7 * 60);
+    e->len = PROTOCOL_DND_LEN;
+
+    program[len++] = RULES_MAGIC_0;
+    program[len++] = RULES_MAGIC_1;
+    program[len++] = RULES_VERSION;
+    program[len++] = 2;
+    program[len++] = 2;
+    for (size_t i = 0; i < 2; i++) {
+        program[len++] = strlen(strings[i]);
+        memcpy(&program[len], strings[i], strlen(strings[i]));
+        len += strlen(strings[i]);
+    }
+    program[len++] = RULE_ACTION_SILENT;
+    program[len++] = 1;
+    program[len++] = RULE_OP_APP_IS;
+    program[len++] = 0;
+    program[len++] = RULE_ACTION_PRIORITY;
+    program[len++] = 1;
+    program[len++] = RULE_OP_SENDER_IS;
+    program[len++] = 1;
+
+    for (size_t offset = 0; offset < len; offset += RULES_CHUNK) {
+        size_t n = len - offset < RULES_CHUNK ? len - offset : RULES_CHUNK;
+
+        e = add_event(time_us + 40000, PEER_APP);
+        e->data[0] = CMD_SET_RULES;
+        e->data[1] = 0;
+        put_le16(&e->data[2], offset);
+        put_le16(&e->data[4], len);
+        memcpy(&e->data[PROTOCOL_RULES_HEADER_LEN], &program[offset], n);
+        e->len = PROTOCOL_RULES_HEADER_LEN + n;
+    }
+}
+
+/**
+ * @brief A notification from the app, icon first, repeated by the browser
+ *        for one in three
+ */
+static void deliver(uint64_t time_us, struct app* app, int priority, const char* title,
+    const char* text)
+{
+    if (!app->icon_sent) {
+        send_icon(time_us, app, (uint16_t)next_random());
+        time_us += 15000;
+    }
+
+    notification(time_us, PEER_APP, app->category, priority, next_key++, app->icon_id, app->name,
+        title, text);
+    if (next_random() % 3 == 0) {
+        notification(time_us + BROWSER_LAG_US, PEER_BROWSER, app->category, priority, 0, 0,
+            app->name, title, text);
+    }
+}
+
+static int compare_events(const void* a, const void* b)
+{
+    const struct event* x = a;
+    const struct event* y = b;
+
+    if (x->time_us != y->time_us) {
+        return x->time_us < y->time_us ? -1 : 1;
+    }
+    return x < y ? -1 : 1;
+}
+
+int main(void)
+{
+    static const char* senders[] = { "Dana", "Avi", "Noa", "Yossi", "Mom", "Tamar" };
+    static const char* texts[] = {
+        "ok",
+        "On my way, 10 minutes",
+        "Did anyone see the new schedule for next week? I think they moved everything",
+        "😂😂😂",
+        "Can you send me the code from the email? The one that starts with 48",
+        "Photo",
+        "Sure, let's do Thursday at 7 then, I'll book a table for the six of us",
+    };
+    struct app apps[] = {
+        { .name = "WhatsApp", .category = TYPE_MESSAGE },
+        { .name = "Gmail", .category = TYPE_EMAIL },
+        { .name = "Instagram", .category = TYPE_SOCIAL },
+        { .name = "Phone", .category = TYPE_PHONE },
+    };
+    uint64_t t = 0;
+    uint64_t last = 0;
+    char subject[48];
+
+    connect(t);
+
+    /* Ten minutes of background traffic */
+    for (t = 1000000; t < 600000000; t += random_between(10000000, 40000000)) {
+        struct app* app = &apps[next_random() % 3];
+
+        deliver(t, app, 0, senders[next_random() % 6], texts[next_random() % 7]);
+    }
+
+    /* Group chat storm at 2 minutes, with a call in the middle */
+    t = 120000000;
+    for (int i = 0; i < 60; i++) {
+        t += random_between(30000, 250000);
+        deliver(t, &apps[0], 0, senders[next_random() % 6], texts[next_random() % 7]);
+        if (i == 30) {
+            deliver(t + 5000, &apps[3], 1, "Incoming call", "Mom");
+        }
+    }
+
+    /* Email sync at 6 minutes, as fast as the link takes writes */
+    t = 360000000;
+    for (int i = 0; i < 25; i++) {
+        t += random_between(7500, 15000);
+        snprintf(subject, sizeof(subject), "Newsletter #%d: this week's updates", i + 1);
+        deliver(t, &apps[1], 0, subject, texts[2]);
+    }
+
+    qsort(events, event_count, sizeof(events[0]), compare_events);
+
+    for (size_t i = 0; i < event_count; i++) {
+        printf("t %u %u ", (unsigned int)(events[i].time_us - last), events[i].source);
+        for (size_t j = 0; j < events[i].len; j++) {
+            printf("%02x", events[i].data[j]);
+        }
+        printf("\n");
+        last = events[i].time_us;
+    }
+
+    fprintf(stderr, "%zu packets over %llu s\n", event_count,
+        (unsigned long long)(last / 1000000));
+    return 0;
+}